@@ -1,36 +1,20 @@
-QT       += core gui
-
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-
-CONFIG += c++17
-
-
-HEADERS += \
-    main_window.h \
-    dialog_windows.h \
-    commands.h \
-    draw_area.h \
-    toolbar.h \
-    tool.h \
-    constants.h
-SOURCES += main.cpp \
-    main_window.cpp \
-    commands.cpp \
-    dialog_windows.cpp \
-    toolbar.cpp \
-    draw_area.cpp \
-    tool.cpp
-CONFIG += qt warn_on
-CONFIG += debug
-
-RESOURCES += \
-    icons.qrc
-
-
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
-
-DISTFILES +=
+# Paint++ se compone de cinco proyectos:
+#  - core: biblioteca estatica con el lienzo, las capas, las herramientas, los filtros y los comandos (solo QtGui)
+#  - app:  la aplicacion de escritorio (QtWidgets)
+#  - cli:  herramienta de linea de comandos para procesar lotes de imagenes sin ventana
+#  - benchmarks: pruebas de rendimiento con QtTest sobre el nucleo
+#  - latency: arnes que mide la latencia de evento a pantalla del DrawArea (usa gui.pri)
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    core \
+    app \
+    cli \
+    benchmarks \
+    latency
+
+app.file = app.pro
+app.depends = core
+cli.depends = core
+benchmarks.depends = core
+latency.depends = core
@@ -0,0 +1,24 @@
+QT       += core gui concurrent
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++17
+
+TARGET = Paint_PP
+
+include(core/core.pri)
+
+include(gui.pri)
+
+SOURCES += main.cpp
+CONFIG += qt warn_on
+CONFIG += debug
+
+
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
+
+DISTFILES +=
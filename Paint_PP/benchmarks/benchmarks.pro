@@ -0,0 +1,16 @@
+# Pruebas de rendimiento (QBENCHMARK) de las rutas criticas del dibujo.
+# Resultados en formato legible por maquina:
+#   ./bench_drawing -csv
+#   ./bench_drawing -o results.xml,xml
+QT       = core gui concurrent testlib
+
+CONFIG += console c++17 testcase
+CONFIG -= app_bundle
+CONFIG += qt warn_on
+
+TARGET = bench_drawing
+
+include(../core/core.pri)
+
+SOURCES += \
+    tst_drawing.cpp
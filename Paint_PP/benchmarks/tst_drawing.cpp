@@ -0,0 +1,943 @@
+#include <QtTest>
+#include <QBuffer>
+#include <QTemporaryDir>
+#include <QPainter>
+
+#include "constants.h"
+#include "canvas.h"
+#include "tool.h"
+#include "quantize.h"
+#include "transform.h"
+#include "png_codec.h"
+#include "qoi_codec.h"
+#include "bmp_rle.h"
+#include "op_log.h"
+
+
+/**
+ * DrawingBenchmark: Mide las rutas criticas del dibujo (herramientas, comandos de "undo", comparacion de imagenes,
+ * redimensionar y guardar/abrir BMP) sobre lienzos de distintos tamaños hasta MAX_IMG_WIDTH x MAX_IMG_HEIGHT.
+ * Cada funcion tiene su tabla "_data" con una fila por tamaño, asi los resultados de QBENCHMARK quedan separados
+ * por tamaño y se pueden exportar con las opciones de QtTest (-csv, -xml, -o archivo,formato).
+ */
+class DrawingBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void pencilDrawTo_data();
+    void pencilDrawTo();
+    void formatStroke_data();
+    void formatStroke();
+    void penDrawTo_data();
+    void penDrawTo();
+    void dashedPolyline_data();
+    void dashedPolyline();
+    void shapesDrawTo_data();
+    void shapesDrawTo();
+    void rectangleSpans_data();
+    void rectangleSpans();
+    void clearImage_data();
+    void clearImage();
+    void drawCommand_data();
+    void drawCommand();
+    void imagesEqual_data();
+    void imagesEqual();
+    void resizeImage_data();
+    void resizeImage();
+    void transformImage_data();
+    void transformImage();
+    void transformPixels_data();
+    void transformPixels();
+    void saveBmp_data();
+    void saveBmp();
+    void quantize_data();
+    void quantize();
+    void quantizeExact_data();
+    void quantizeExact();
+    void loadBmp_data();
+    void loadBmp();
+    void saveRle_data();
+    void saveRle();
+    void loadRle_data();
+    void loadRle();
+    void rleRoundTrip_data();
+    void rleRoundTrip();
+    void saveFormat_data();
+    void saveFormat();
+    void loadFormat_data();
+    void loadFormat();
+    void codecRoundTrip_data();
+    void codecRoundTrip();
+    void savedRecording();
+
+private:
+    void addSizes();
+    void prepare(Canvas&, const QSize&);
+
+    QTemporaryDir dir;
+};
+
+void DrawingBenchmark::initTestCase()
+{
+    QVERIFY(dir.isValid());
+}
+
+/**
+ * Tamaños de lienzo que se miden, del tamaño por defecto al maximo que permite el editor.
+ */
+static QList<QSize> canvasSizes()
+{
+    return { QSize(DEFAULT_IMG_WIDTH, DEFAULT_IMG_HEIGHT),
+             QSize(1280, 720),
+             QSize(1920, 1080),
+             QSize(MAX_IMG_WIDTH, MAX_IMG_HEIGHT) };
+}
+
+static QByteArray sizeName(const QSize &size)
+{
+    return QByteArray::number(size.width()) + "x" + QByteArray::number(size.height());
+}
+
+/**
+ * patternImage: Degradado con ruido de un generador fijo (siempre la misma imagen), asi los filtros de PNG y las
+ * repeticiones de QOI tienen de todo un poco. En ARGB32 el alfa tambien varia; en Indexed8 la paleta tiene 256
+ * colores y los primeros 64 son semitransparentes (el tRNS es mas corto que el PLTE).
+ */
+static QImage patternImage(const QSize &size, QImage::Format format)
+{
+    quint32 seed = 12345;
+    auto noise = [&seed]() { seed = seed * 1103515245u + 12345u; return int(seed >> 16) & 15; };
+
+    QImage image(size, format);
+    if(format == QImage::Format_Indexed8)
+    {
+        QVector<QRgb> colors;
+        for(int i = 0; i < PALETTE_SIZE; ++i)
+            colors << qRgba(i, 255 - i, (i * 7) & 0xff, i < 64 ? i * 4 : 255);
+        image.setColorTable(colors);
+    }
+    for(int y = 0; y < size.height(); ++y)
+    {
+        uchar *bytes = image.scanLine(y);
+        QRgb *pixels = reinterpret_cast<QRgb*>(bytes);
+        for(int x = 0; x < size.width(); ++x)
+        {
+            int across = x * 255 / size.width(), down = y * 255 / size.height();
+            if(image.depth() == 8)
+                bytes[x] = uchar(across + noise());
+            else
+                pixels[x] = qRgba((across + noise()) & 0xff, (down + noise()) & 0xff, ((across + down) / 2) ^ noise(),
+                                  format == QImage::Format_ARGB32 ? (down + noise()) & 0xff : 255);
+        }
+    }
+    return image;
+}
+
+/**
+ * @brief DrawingBenchmark::addSizes: Filas comunes a casi todas las pruebas, una por tamaño de lienzo.
+ */
+void DrawingBenchmark::addSizes()
+{
+    QTest::addColumn<QSize>("size");
+
+    for(const QSize &size : canvasSizes())
+        QTest::newRow(sizeName(size).constData()) << size;
+}
+
+/**
+ * @brief DrawingBenchmark::prepare: Lienzo nuevo del tamaño pedido, con la pila de "undo" vacia y limitada a dos
+ *                                   comandos para que las pruebas largas no acumulen cientos de capas completas.
+ */
+void DrawingBenchmark::prepare(Canvas &canvas, const QSize &size)
+{
+    canvas.createNewImage(size);
+    canvas.getUndoStack()->clear();
+    canvas.getUndoStack()->setUndoLimit(2);
+}
+
+void DrawingBenchmark::pencilDrawTo_data()
+{
+    addSizes();
+}
+
+/**
+ * @brief DrawingBenchmark::pencilDrawTo: Un trazo de lapiz que recorre la diagonal del lienzo en segmentos cortos,
+ *                                        como llegan los eventos del mouse.
+ */
+void DrawingBenchmark::pencilDrawTo()
+{
+    QFETCH(QSize, size);
+
+    Canvas canvas;
+    prepare(canvas, size);
+    Tool *tool = canvas.setCurrentTool(pencil);
+    tool->setWidth(3);
+
+    QBENCHMARK {
+        tool->setStartPoint(QPoint(0, 0));
+        for(int i = 8; i < size.height(); i += 8)
+            tool->drawTo(QPoint(i * size.width() / size.height(), i), &canvas, canvas.getImage());
+    }
+}
+
+void DrawingBenchmark::formatStroke_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("format");
+
+    const char* names[] = {"rgb", "indexed", "grayscale"};
+    for(const QSize &size : canvasSizes())
+        for(int format = rgb_pixels; format <= grayscale_pixels; ++format)
+            QTest::newRow((sizeName(size) + ' ' + names[format]).constData()) << size << format;
+}
+
+/**
+ * @brief DrawingBenchmark::formatStroke: El trazo completo de pencilDrawTo (con su DrawCommand) en cada formato de
+ *                                        documento; los de 8 bits copian y comparan la cuarta parte de los bytes.
+ */
+void DrawingBenchmark::formatStroke()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, format);
+
+    Canvas canvas;
+    canvas.createNewImage(size, PixelFormat(format));
+    canvas.getUndoStack()->clear();
+    canvas.getUndoStack()->setUndoLimit(2);
+    canvas.setCurrentTool(pencil)->setWidth(3);
+
+    QBENCHMARK {
+        canvas.beginStroke(QPoint(0, 0));
+        for(int i = 8; i < size.height(); i += 8)
+            canvas.moveStroke(QPoint(i * size.width() / size.height(), i));
+        canvas.endStroke(QPoint(size.width() - 1, size.height() - 1));
+    }
+}
+
+void DrawingBenchmark::penDrawTo_data()
+{
+    addSizes();
+}
+
+/**
+ * @brief DrawingBenchmark::penDrawTo: Una linea del lapicero de esquina a esquina.
+ */
+void DrawingBenchmark::penDrawTo()
+{
+    QFETCH(QSize, size);
+
+    Canvas canvas;
+    prepare(canvas, size);
+    Tool *tool = canvas.setCurrentTool(pen);
+    tool->setWidth(5);
+    tool->setStartPoint(QPoint(0, 0));
+    QPoint end(size.width() - 1, size.height() - 1);
+
+    QBENCHMARK {
+        tool->drawTo(end, &canvas, canvas.getImage());
+    }
+}
+
+void DrawingBenchmark::dashedPolyline_data()
+{
+    addSizes();
+}
+
+/**
+ * @brief DrawingBenchmark::dashedPolyline: Arrastre del ultimo vertice de una polilinea punteada de 200 segmentos,
+ *                                          con el repintado de la capa superpuesta. Los guiones de los segmentos
+ *                                          anteriores ya estan calculados y solo se pinta el area del segmento
+ *                                          activo, con su union. Al final la polilinea se guarda con el mismo trazo
+ *                                          y tiene que dejar en la capa los pixeles de la vista previa.
+ */
+void DrawingBenchmark::dashedPolyline()
+{
+    QFETCH(QSize, size);
+
+    Canvas canvas;
+    prepare(canvas, size);
+    canvas.setCurrentTool(pen);
+    canvas.setLineMode(poly);
+    canvas.OnPenLineStyleConfig(dashed);
+
+    canvas.beginStroke(QPoint(0, 0));
+    for(int i = 1; i <= 200; ++i)
+    {
+        QPoint vertex((i * 37) % size.width(), i * (size.height() - 1) / 200);
+        canvas.moveStroke(vertex);
+        canvas.endStroke(vertex);
+        canvas.beginStroke(vertex);
+    }
+
+    QImage overlay(size, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&overlay);
+    QPoint last((200 * 37) % size.width(), size.height() - 1);
+    int step = 0;
+    QBENCHMARK {
+        QPoint point(size.width() / 2 + (step++ % 64), size.height() / 2);
+        canvas.moveStroke(point);
+        canvas.paintPolyline(painter, QRect(last, point).normalized().adjusted(-1, -1, 1, 1));
+    }
+    painter.end();
+    canvas.endStroke(QPoint(size.width() / 2, size.height() / 2));
+
+    // la vista previa completa sobre la capa tiene que ser lo que la polilinea deja en ella
+    QImage expected = canvas.getImage()->convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QPainter preview(&expected);
+    canvas.paintPolyline(preview, QRect());
+    preview.end();
+    canvas.endPolyline();
+    QCOMPARE(canvas.getImage()->convertToFormat(QImage::Format_ARGB32_Premultiplied), expected);
+}
+
+/**
+ * @brief DrawingBenchmark::shapesDrawTo_data: Cada figura con cada modo de relleno en cada tamaño.
+ */
+void DrawingBenchmark::shapesDrawTo_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("shape");
+    QTest::addColumn<int>("fill");
+
+    const char *shapeNames[] = { "rectangle", "ellipse", "triangle" };
+    const char *fillNames[] = { "foreground", "background", "no_fill" };
+
+    for(const QSize &size : canvasSizes())
+        for(int shape = rectangle; shape <= triangle; shape++)
+            for(int fill = foreground; fill <= no_fill; fill++)
+            {
+                QByteArray name = sizeName(size) + " " + shapeNames[shape] + " " + fillNames[fill];
+                QTest::newRow(name.constData()) << size << shape << fill;
+            }
+}
+
+/**
+ * @brief DrawingBenchmark::shapesDrawTo: La figura ocupa casi todo el lienzo, es el peor caso del arrastre.
+ */
+void DrawingBenchmark::shapesDrawTo()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, shape);
+    QFETCH(int, fill);
+
+    Canvas canvas;
+    prepare(canvas, size);
+    Tool *tool = canvas.setCurrentTool(shapes_tool);
+    canvas.OnSelectShapeTypeConfig(shape);
+    canvas.OnShapesFillConfig(fill);
+    tool->setWidth(3);
+    tool->setStartPoint(QPoint(4, 4));
+    QPoint end(size.width() - 4, size.height() - 4);
+
+    QBENCHMARK {
+        tool->drawTo(end, &canvas, canvas.getImage());
+    }
+}
+
+void DrawingBenchmark::rectangleSpans_data()
+{
+    QTest::addColumn<QPoint>("start");
+    QTest::addColumn<QPoint>("end");
+    QTest::addColumn<int>("fill");
+
+    const QPoint topLeft(7, 5), bottomRight(41, 30);
+    const QPoint topRight(bottomRight.x(), topLeft.y()), bottomLeft(topLeft.x(), bottomRight.y());
+    for(int fill : {int(foreground), int(no_fill)})
+    {
+        const QByteArray suffix = fill == no_fill ? " outline" : " filled";
+        QTest::newRow(("down-right" + suffix).constData()) << topLeft << bottomRight << fill;
+        QTest::newRow(("up-right" + suffix).constData()) << bottomLeft << topRight << fill;
+        QTest::newRow(("down-left" + suffix).constData()) << topRight << bottomLeft << fill;
+        QTest::newRow(("up-left" + suffix).constData()) << bottomRight << topLeft << fill;
+    }
+}
+
+/**
+ * @brief DrawingBenchmark::rectangleSpans: El rectangulo de un pixel que se dibuja con tramos (spanFill y spanOutline)
+ *                                          tiene que cubrir los mismos pixeles que QPainter entre las dos esquinas,
+ *                                          hacia cualquier lado que se arrastre.
+ */
+void DrawingBenchmark::rectangleSpans()
+{
+    QFETCH(QPoint, start);
+    QFETCH(QPoint, end);
+    QFETCH(int, fill);
+
+    Canvas canvas;
+    prepare(canvas, QSize(64, 48));
+    canvas.updateColorConfig(QColor(200, 40, 10), foreground);
+    Tool *tool = canvas.setCurrentTool(shapes_tool);
+    canvas.OnSelectShapeTypeConfig(rectangle);
+    canvas.OnShapesFillConfig(fill);
+    tool->setWidth(1);
+
+    QImage expected = canvas.getImage()->copy();
+    {
+        QPainter painter(&expected);
+        painter.setPen(static_cast<QPen>(*tool));
+        QRect corners(QPoint(qMin(start.x(), end.x()), qMin(start.y(), end.y())),
+                      QPoint(qMax(start.x(), end.x()), qMax(start.y(), end.y())));
+        if(fill != no_fill)
+            painter.fillRect(corners, canvas.getForegroundColor());
+        painter.drawRect(corners);
+    }
+
+    tool->setStartPoint(start);
+    tool->drawTo(end, &canvas, canvas.getImage());
+    QCOMPARE(*canvas.getImage(), expected);
+}
+
+void DrawingBenchmark::clearImage_data()
+{
+    addSizes();
+}
+
+/**
+ * @brief DrawingBenchmark::clearImage: Borra la capa completa, alternando el color para que siempre cambie y se
+ *                                      guarde el comando. Es lo que tarda la memoria en escribir toda la capa.
+ */
+void DrawingBenchmark::clearImage()
+{
+    QFETCH(QSize, size);
+
+    Canvas canvas;
+    prepare(canvas, size);
+    bool black = false;
+
+    QBENCHMARK {
+        canvas.updateColorConfig(black ? Qt::black : Qt::white, background);
+        canvas.clearImage();
+        black = !black;
+    }
+}
+
+void DrawingBenchmark::drawCommand_data()
+{
+    addSizes();
+}
+
+/**
+ * @brief DrawingBenchmark::drawCommand: Un punto pintado (la capa se separa de la copia compartida), el DrawCommand
+ *                                       que lo guarda en la pila, y un "undo" y "redo" completos.
+ */
+void DrawingBenchmark::drawCommand()
+{
+    QFETCH(QSize, size);
+
+    Canvas canvas;
+    prepare(canvas, size);
+
+    QBENCHMARK {
+        QImage old = *canvas.getImage();
+        canvas.getImage()->setPixel(0, 0, qRgb(0, 0, 0));
+        canvas.saveDrawCommand(old);
+        canvas.undo();
+        canvas.redo();
+    }
+}
+
+void DrawingBenchmark::imagesEqual_data()
+{
+    addSizes();
+}
+
+/**
+ * @brief DrawingBenchmark::imagesEqual: Dos imagenes iguales pero sin compartir los datos, la comparacion tiene que
+ *                                       recorrer todos los pixeles.
+ */
+void DrawingBenchmark::imagesEqual()
+{
+    QFETCH(QSize, size);
+
+    QImage first(size, QImage::Format_ARGB32_Premultiplied);
+    first.fill(Qt::white);
+    QImage second = first.copy();
+    bool equal = false;
+
+    QBENCHMARK {
+        equal = ::imagesEqual(first, second);
+    }
+    QVERIFY(equal);
+}
+
+void DrawingBenchmark::resizeImage_data()
+{
+    addSizes();
+}
+
+/**
+ * @brief DrawingBenchmark::resizeImage: Reduce el lienzo a la mitad y lo vuelve a su tamaño, con el comando de
+ *                                       "undo" incluido.
+ */
+void DrawingBenchmark::resizeImage()
+{
+    QFETCH(QSize, size);
+
+    Canvas canvas;
+    prepare(canvas, size);
+
+    QBENCHMARK {
+        canvas.resizeImage(size / 2);
+        canvas.resizeImage(size);
+    }
+}
+
+void DrawingBenchmark::transformImage_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("transform");
+
+    const char* names[] = {"rotate 90", "rotate 180", "rotate 270", "flip h", "flip v"};
+    for(const QSize &size : canvasSizes())
+        for(int transform = rotate_90; transform <= flip_vertical; ++transform)
+            QTest::newRow((sizeName(size) + ' ' + names[transform]).constData()) << size << transform;
+}
+
+/**
+ * @brief DrawingBenchmark::transformImage: Gira o refleja el lienzo y lo deshace, el comando de "undo" no copia
+ *                                          pixeles asi que cada vuelta son dos transformaciones.
+ */
+void DrawingBenchmark::transformImage()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, transform);
+
+    Canvas canvas;
+    prepare(canvas, size);
+
+    QBENCHMARK {
+        canvas.transformImage(ImageTransform(transform));
+        canvas.undo();
+    }
+    QCOMPARE(canvas.getImage()->size(), size);
+}
+
+void DrawingBenchmark::transformPixels_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("transform");
+
+    const char* names[] = {"rotate 90", "rotate 180", "rotate 270", "flip h", "flip v"};
+    for(const QSize &size : {QSize(131, 67), QSize(70, 197), QSize(3, 5)})
+        for(QImage::Format format : {QImage::Format_ARGB32, QImage::Format_Indexed8})
+            for(int transform = rotate_90; transform <= flip_vertical; ++transform)
+                QTest::newRow((sizeName(size) + (format == QImage::Format_Indexed8 ? " 8 bits " : " 32 bits ")
+                               + names[transform]).constData()) << size << int(format) << transform;
+}
+
+/**
+ * @brief DrawingBenchmark::transformPixels: Compara el giro o reflejo con QImage::transformed y mirrored, en tamaños
+ *                                           que no completan los bloques de SSE2 ni los mosaicos, y verifica que la
+ *                                           transformacion inversa devuelve la imagen original.
+ */
+void DrawingBenchmark::transformPixels()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, format);
+    QFETCH(int, transform);
+
+    QImage source(size, QImage::Format(format));
+    if(source.depth() == 8)
+    {
+        QVector<QRgb> colors;
+        for(int i = 0; i < PALETTE_SIZE; ++i)
+            colors << qRgb(i, 255 - i, (i * 7) & 0xff);
+        source.setColorTable(colors);
+    }
+    quint32 seed = 12345;
+    for(int y = 0; y < source.height(); ++y)
+    {
+        uchar *row = source.scanLine(y);
+        for(int x = 0; x < source.bytesPerLine(); ++x)
+        {
+            seed = seed * 1103515245u + 12345u;
+            row[x] = uchar(seed >> 16);
+        }
+    }
+
+    QImage expected;
+    switch(transform)
+    {
+        case rotate_90:       expected = source.transformed(QTransform().rotate(90)); break;
+        case rotate_180:      expected = source.transformed(QTransform().rotate(180)); break;
+        case rotate_270:      expected = source.transformed(QTransform().rotate(270)); break;
+        case flip_horizontal: expected = source.mirrored(true, false); break;
+        default:              expected = source.mirrored(false, true); break;
+    }
+
+    QImage result = ::transformImage(source, ImageTransform(transform));
+    QCOMPARE(result.format(), source.format());
+    QCOMPARE(result.size(), expected.size());
+    for(int y = 0; y < result.height(); ++y)
+        for(int x = 0; x < result.width(); ++x)
+            QCOMPARE(result.pixel(x, y), expected.pixel(x, y));
+
+    QCOMPARE(::transformImage(result, inverseTransform(ImageTransform(transform))), source);
+}
+
+void DrawingBenchmark::saveBmp_data()
+{
+    addSizes();
+}
+
+void DrawingBenchmark::saveBmp()
+{
+    QFETCH(QSize, size);
+
+    Canvas canvas;
+    prepare(canvas, size);
+    QString fileName = dir.filePath("save.bmp");
+    bool saved = false;
+
+    QBENCHMARK {
+        saved = canvas.saveImage(fileName);
+    }
+    QVERIFY(saved);
+}
+
+void DrawingBenchmark::quantize_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("dither");
+
+    const char* names[] = {"none", "ordered", "diffusion"};
+    for(const QSize &size : canvasSizes())
+        for(int dither = no_dither; dither <= diffusion_dither; ++dither)
+            QTest::newRow((sizeName(size) + ' ' + names[dither]).constData()) << size << dither;
+}
+
+/**
+ * @brief DrawingBenchmark::quantize: Reduce a 256 colores (la exportacion a BMP de 8 bits sin guardar el archivo) un
+ *                                    degradado con todos los tonos, el peor caso para el octree.
+ */
+void DrawingBenchmark::quantize()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, dither);
+
+    QImage image(size, QImage::Format_RGB32);
+    for(int y = 0; y < size.height(); ++y)
+    {
+        QRgb *row = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for(int x = 0; x < size.width(); ++x)
+            row[x] = qRgb(x * 255 / size.width(), y * 255 / size.height(), (x + y) & 255);
+    }
+    QImage result;
+
+    QBENCHMARK {
+        result = quantizeImage(image, PALETTE_SIZE, DitherMode(dither));
+    }
+    QVERIFY(result.colorCount() <= PALETTE_SIZE);
+}
+
+void DrawingBenchmark::quantizeExact_data()
+{
+    QTest::addColumn<int>("colors");
+    QTest::addColumn<int>("dither");
+
+    const char* names[] = {"none", "ordered", "diffusion"};
+    for(int colors : {1, 17, PALETTE_SIZE})
+        for(int dither = no_dither; dither <= diffusion_dither; ++dither)
+            QTest::newRow((QByteArray::number(colors) + " colors " + names[dither]).constData()) << colors << dither;
+}
+
+/**
+ * @brief DrawingBenchmark::quantizeExact: Una imagen con a lo sumo PALETTE_SIZE colores distintos, casi todos en el
+ *                                         mismo color del histograma (solo cambian los bits bajos), tiene que quedar
+ *                                         exacta con cualquier tramado.
+ */
+void DrawingBenchmark::quantizeExact()
+{
+    QFETCH(int, colors);
+    QFETCH(int, dither);
+
+    QImage image(97, 61, QImage::Format_RGB32);
+    for(int y = 0; y < image.height(); ++y)
+    {
+        QRgb *row = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for(int x = 0; x < image.width(); ++x)
+        {
+            const int i = (x / 3 + y * 7) % colors;
+            row[x] = qRgb(100 + (i & 7), 50 + (i >> 3 & 7), 200 + (i >> 6));
+        }
+    }
+
+    const QImage result = quantizeImage(image, PALETTE_SIZE, DitherMode(dither));
+    QCOMPARE(result.colorCount(), colors);
+    QCOMPARE(result.convertToFormat(QImage::Format_RGB32), image);
+}
+
+void DrawingBenchmark::loadBmp_data()
+{
+    addSizes();
+}
+
+void DrawingBenchmark::loadBmp()
+{
+    QFETCH(QSize, size);
+
+    Canvas canvas;
+    prepare(canvas, size);
+    QString fileName = dir.filePath("load.bmp");
+    QVERIFY(canvas.saveImage(fileName));
+    bool loaded = false;
+
+    QBENCHMARK {
+        loaded = canvas.loadImage(fileName);
+    }
+    QVERIFY(loaded);
+}
+
+void DrawingBenchmark::saveRle_data()
+{
+    addSizes();
+}
+
+/**
+ * @brief DrawingBenchmark::saveRle: Guarda el lienzo liso (el caso tipico de un dibujo de colores planos) como BMP de
+ *                                   256 colores comprimido, con la cuantizacion incluida.
+ */
+void DrawingBenchmark::saveRle()
+{
+    QFETCH(QSize, size);
+
+    Canvas canvas;
+    prepare(canvas, size);
+    QString fileName = dir.filePath("save_rle.bmp");
+    bool saved = false;
+
+    QBENCHMARK {
+        saved = canvas.exportIndexed(fileName, no_dither, true);
+    }
+    QVERIFY(saved);
+}
+
+void DrawingBenchmark::loadRle_data()
+{
+    addSizes();
+}
+
+void DrawingBenchmark::loadRle()
+{
+    QFETCH(QSize, size);
+
+    Canvas canvas;
+    prepare(canvas, size);
+    QString fileName = dir.filePath("load_rle.bmp");
+    QVERIFY(canvas.exportIndexed(fileName, no_dither, true));
+    bool loaded = false;
+
+    QBENCHMARK {
+        loaded = canvas.loadImage(fileName);
+    }
+    QVERIFY(loaded);
+}
+
+void DrawingBenchmark::rleRoundTrip_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("colors");
+
+    for(int width : {601, 7, 1})
+        for(int colors : {16, 17})
+            QTest::newRow((QByteArray::number(width) + " px " + QByteArray::number(colors) + " colors").constData())
+                    << width << colors;
+}
+
+/**
+ * @brief DrawingBenchmark::rleRoundTrip: Escribe y vuelve a leer un BMP con RLE (BI_RLE4 con 16 colores, BI_RLE8 con
+ *                                        17) y compara los indices. Cada fila ejercita un caso de la codificacion:
+ *                                        pares repetidos, un color por pixel (tramos absolutos que se cortan a los
+ *                                        255), un solo color (tramos codificados de 255), tramos absolutos de menos
+ *                                        de tres pixeles entre grupos de tres iguales, ruido y bandas de 300 pixeles.
+ *                                        Los anchos impares dejan medio byte suelto en BI_RLE4.
+ */
+void DrawingBenchmark::rleRoundTrip()
+{
+    QFETCH(int, width);
+    QFETCH(int, colors);
+
+    QVector<QRgb> palette;
+    for(int i = 0; i < colors; ++i)
+        palette << qRgb(i * 15, 255 - i * 15, (i * 97) & 0xff);
+    const uchar mixed[] = {1, 2, 3, 3, 3, 4, 5, 5, 6, 7, 8, 8, 8, 8, 9};
+
+    QImage source(width, 12, QImage::Format_Indexed8);
+    source.setColorTable(palette);
+    quint32 seed = 12345;
+    for(int y = 0; y < source.height(); ++y)
+    {
+        uchar *row = source.scanLine(y);
+        for(int x = 0; x < width; ++x)
+        {
+            seed = seed * 1103515245u + 12345u;
+            switch(y % 6)
+            {
+                case 0:  row[x] = uchar((x / 2 + y) % colors); break;
+                case 1:  row[x] = uchar((x + y) % colors); break;
+                case 2:  row[x] = uchar(y % colors); break;
+                case 3:  row[x] = uchar((mixed[(x + y) % sizeof(mixed)] + y) % colors); break;
+                case 4:  row[x] = uchar((seed >> 16) % quint32(colors)); break;
+                default: row[x] = uchar((x / 300 + y) % colors); break;
+            }
+        }
+    }
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+    QVERIFY(writeRleBmp(&buffer, source));
+
+    QImage decoded;
+    buffer.seek(0);
+    QVERIFY(readRleBmp(&buffer, &decoded));
+    QCOMPARE(decoded.format(), QImage::Format_Indexed8);
+    QCOMPARE(decoded.size(), source.size());
+    QCOMPARE(decoded.colorTable(), palette);
+    for(int y = 0; y < decoded.height(); ++y)
+        QVERIFY2(memcmp(decoded.constScanLine(y), source.constScanLine(y), size_t(width)) == 0,
+                 QByteArray("row " + QByteArray::number(y)).constData());
+}
+
+void DrawingBenchmark::saveFormat_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QString>("suffix");
+
+    for(const QSize &size : canvasSizes())
+        for(const char *suffix : {"png", "qoi"})
+            QTest::newRow((sizeName(size) + ' ' + suffix).constData()) << size << QString(suffix);
+}
+
+/**
+ * @brief DrawingBenchmark::saveFormat: Guarda el lienzo en PNG (deflate por bloques en paralelo) y en QOI, con los
+ *                                      codecs propios elegidos por la extension.
+ */
+void DrawingBenchmark::saveFormat()
+{
+    QFETCH(QSize, size);
+    QFETCH(QString, suffix);
+
+    Canvas canvas;
+    prepare(canvas, size);
+    QString fileName = dir.filePath("save." + suffix);
+    bool saved = false;
+
+    QBENCHMARK {
+        saved = canvas.saveImage(fileName);
+    }
+    QVERIFY(saved);
+}
+
+void DrawingBenchmark::loadFormat_data()
+{
+    saveFormat_data();
+}
+
+void DrawingBenchmark::loadFormat()
+{
+    QFETCH(QSize, size);
+    QFETCH(QString, suffix);
+
+    Canvas canvas;
+    prepare(canvas, size);
+    QString fileName = dir.filePath("load." + suffix);
+    QVERIFY(canvas.saveImage(fileName));
+    bool loaded = false;
+
+    QBENCHMARK {
+        loaded = canvas.loadImage(fileName);
+    }
+    QVERIFY(loaded);
+}
+
+void DrawingBenchmark::codecRoundTrip_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QString>("suffix");
+    QTest::addColumn<int>("format");
+
+    const QImage::Format formats[] = {QImage::Format_ARGB32, QImage::Format_RGB32,
+                                      QImage::Format_Grayscale8, QImage::Format_Indexed8};
+    const char* names[] = {"argb", "rgb", "gray", "indexed"};
+    for(const QSize &size : {QSize(641, 1023), QSize(7, 3)})
+        for(const char *suffix : {"png", "qoi"})
+            for(int i = 0; i < 4; ++i)
+                QTest::newRow((sizeName(size) + ' ' + suffix + ' ' + names[i]).constData())
+                        << size << QString(suffix) << int(formats[i]);
+}
+
+/**
+ * @brief DrawingBenchmark::codecRoundTrip: Escribe y vuelve a leer la imagen con los codecs propios (no con Qt) y
+ *                                          compara los pixeles. El alto mas grande reparte las filas del PNG en
+ *                                          varios bloques de deflate. PNG conserva el formato (la paleta con su
+ *                                          alfa en las de 8 bits); QOI devuelve ARGB32 si habia alfa y RGB32 si no.
+ */
+void DrawingBenchmark::codecRoundTrip()
+{
+    QFETCH(QSize, size);
+    QFETCH(QString, suffix);
+    QFETCH(int, format);
+
+    const QImage source = patternImage(size, QImage::Format(format));
+    const bool png = suffix == "png";
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite));
+    QVERIFY(png ? writePng(&buffer, source) : writeQoi(&buffer, source));
+
+    QImage decoded;
+    buffer.seek(0);
+    QVERIFY(png ? readPng(&buffer, &decoded) : readQoi(&buffer, &decoded));
+
+    QImage::Format expected = source.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32;
+    if(png && (source.format() == QImage::Format_Grayscale8 || source.format() == QImage::Format_Indexed8))
+        expected = source.format();
+    QCOMPARE(decoded.format(), expected);
+    QCOMPARE(decoded.size(), source.size());
+    if(expected == QImage::Format_Indexed8)
+        QCOMPARE(decoded.colorTable(), source.colorTable());
+
+    const QImage converted = source.convertToFormat(expected);
+    for(int y = 0; y < decoded.height(); ++y)
+        QVERIFY2(memcmp(decoded.constScanLine(y), converted.constScanLine(y),
+                        size_t(decoded.width()) * size_t(decoded.depth() / 8)) == 0,
+                 QByteArray("row " + QByteArray::number(y)).constData());
+}
+
+/**
+ * @brief DrawingBenchmark::savedRecording: Con el diario de recuperacion activo, un vaciado del diario entre stop() y
+ *                                          save() (el temporizador mientras el dialogo de guardar esta abierto) no
+ *                                          puede dejar el archivo vacio: se guarda, se vuelve a leer y se reproduce.
+ */
+void DrawingBenchmark::savedRecording()
+{
+    Canvas canvas;
+    prepare(canvas, QSize(120, 80));
+    canvas.getOpLog()->setJournaling(true);
+    canvas.startRecording();
+    canvas.setCurrentTool(pencil)->setWidth(3);
+    canvas.beginStroke(QPoint(5, 5));
+    canvas.moveStroke(QPoint(60, 40));
+    canvas.endStroke(QPoint(110, 70));
+    canvas.transformImage(rotate_90);
+    canvas.stopRecording();
+    canvas.getOpLog()->takeJournal();
+
+    QString fileName = dir.filePath("recording.ppol");
+    QVERIFY(canvas.getOpLog()->save(fileName));
+    QByteArray data;
+    QVERIFY(OpLog::load(fileName, &data));
+
+    Canvas replay;
+    OpPlayer player(&replay, data);
+    QVERIFY(player.isValid());
+    player.runAll();
+    QCOMPARE(*replay.getImage(), *canvas.getImage());
+}
+
+QTEST_GUILESS_MAIN(DrawingBenchmark)
+
+#include "tst_drawing.moc"
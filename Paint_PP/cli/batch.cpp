@@ -0,0 +1,269 @@
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+
+#include "batch.h"
+#include "canvas.h"
+
+
+/**
+ * @brief parseInts: Interpreta los argumentos numericos de una operacion ("blur:3" -> {3}).
+ */
+static bool parseInts(const QStringList &args, int count, QList<int> *values)
+{
+    if(args.size() > count)
+        return false;
+
+    for(const QString &arg : args)
+    {
+        bool ok = false;
+        int value = arg.toInt(&ok);
+        if(!ok)
+            return false;
+        values->append(value);
+    }
+    return true;
+}
+
+BatchProcessor::BatchProcessor()
+{
+}
+
+/**
+ * @brief BatchProcessor::addOperation: Agrega una operacion con el formato "nombre:arg1:arg2...". Operaciones:
+ *                                      resize:ANCHOxALTO, scale:PORCENTAJE, fill:COLOR, blur:RADIO,
+ *                                      sharpen:RADIO:CANTIDAD, edges, brightness:V, contrast:V,
+ *                                      levels:NEGRO:BLANCO:GAMMA, hue:TONO:SATURACION:LUZ, rotate:90|180|270,
+ *                                      flip:h|v.
+ */
+bool BatchProcessor::addOperation(const QString &spec, QString *error)
+{
+    QStringList args = spec.trimmed().split(':');
+    QString name = args.takeFirst().toLower();
+    QList<int> values;
+
+    BatchOperation op;
+    op.percent = 100;
+    op.filter.type = gaussian_blur;
+    op.filter.radius = DEFAULT_FILTER_RADIUS;
+    op.filter.amount = DEFAULT_SHARPEN_AMOUNT;
+    op.transform = rotate_90;
+
+    if(name == "resize")
+    {
+        QStringList size = args.value(0).split('x');
+        if(args.size() != 1 || size.size() != 2 || !parseInts(size, 2, &values)
+                || values[0] < MIN_IMG_WIDTH || values[1] < MIN_IMG_HEIGHT)
+        {
+            *error = QString("resize espera ANCHOxALTO: %1").arg(spec);
+            return false;
+        }
+        op.type = resize_op;
+        op.size = QSize(values[0], values[1]);
+    }
+    else if(name == "scale")
+    {
+        if(args.size() != 1 || !parseInts(args, 1, &values) || values[0] <= 0)
+        {
+            *error = QString("scale espera un porcentaje: %1").arg(spec);
+            return false;
+        }
+        op.type = scale_op;
+        op.percent = values[0];
+    }
+    else if(name == "fill")
+    {
+        op.color = QColor(args.value(0));
+        if(args.size() != 1 || !op.color.isValid())
+        {
+            *error = QString("fill espera un color: %1").arg(spec);
+            return false;
+        }
+        op.type = fill_op;
+    }
+    else if(name == "blur" || name == "sharpen" || name == "edges")
+    {
+        if(!parseInts(args, name == "sharpen" ? 2 : 1, &values))
+        {
+            *error = QString("argumentos invalidos: %1").arg(spec);
+            return false;
+        }
+        op.type = filter_op;
+        op.filter.type = name == "blur" ? gaussian_blur : (name == "sharpen" ? unsharp_mask : edge_detect);
+        if(values.size() > 0)
+            op.filter.radius = qBound(MIN_FILTER_RADIUS, values[0], MAX_FILTER_RADIUS);
+        if(values.size() > 1)
+            op.filter.amount = qBound(MIN_SHARPEN_AMOUNT, values[1], MAX_SHARPEN_AMOUNT);
+    }
+    else if(name == "brightness" || name == "contrast")
+    {
+        if(args.size() != 1 || !parseInts(args, 1, &values))
+        {
+            *error = QString("%1 espera un valor: %2").arg(name, spec);
+            return false;
+        }
+        op.type = adjust_op;
+        if(name == "brightness")
+            op.pipeline.addBrightness(qBound(MIN_BRIGHTNESS, values[0], MAX_BRIGHTNESS));
+        else
+            op.pipeline.addContrast(qBound(MIN_CONTRAST, values[0], MAX_CONTRAST));
+    }
+    else if(name == "levels")
+    {
+        if(args.size() != 3 || !parseInts(args, 3, &values))
+        {
+            *error = QString("levels espera NEGRO:BLANCO:GAMMA: %1").arg(spec);
+            return false;
+        }
+        op.type = adjust_op;
+        op.pipeline.addLevels(qBound(0, values[0], 255), qBound(0, values[1], 255),
+                              qBound(MIN_LEVELS_GAMMA, values[2], MAX_LEVELS_GAMMA));
+    }
+    else if(name == "hue")
+    {
+        if(args.size() != 3 || !parseInts(args, 3, &values))
+        {
+            *error = QString("hue espera TONO:SATURACION:LUZ: %1").arg(spec);
+            return false;
+        }
+        op.type = adjust_op;
+        op.pipeline.addHueSaturation(qBound(MIN_HUE_SHIFT, values[0], MAX_HUE_SHIFT),
+                                     qBound(MIN_SATURATION, values[1], MAX_SATURATION),
+                                     qBound(MIN_SATURATION, values[2], MAX_SATURATION));
+    }
+    else if(name == "rotate")
+    {
+        if(args.size() != 1 || !parseInts(args, 1, &values)
+                || (values[0] != 90 && values[0] != 180 && values[0] != 270))
+        {
+            *error = QString("rotate espera 90, 180 o 270: %1").arg(spec);
+            return false;
+        }
+        op.type = transform_op;
+        op.transform = values[0] == 90 ? rotate_90 : (values[0] == 180 ? rotate_180 : rotate_270);
+    }
+    else if(name == "flip")
+    {
+        QString axis = args.value(0).toLower();
+        if(args.size() != 1 || (axis != "h" && axis != "v"))
+        {
+            *error = QString("flip espera h o v: %1").arg(spec);
+            return false;
+        }
+        op.type = transform_op;
+        op.transform = axis == "h" ? flip_horizontal : flip_vertical;
+    }
+    else
+    {
+        *error = QString("operacion desconocida: %1").arg(spec);
+        return false;
+    }
+
+    operations.append(op);
+    return true;
+}
+
+/**
+ * @brief BatchProcessor::loadScript: Lee un guion con una operacion por linea, las lineas vacias y las que
+ *                                    empiezan con "#" se ignoran.
+ */
+bool BatchProcessor::loadScript(const QString &fileName, QString *error)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        *error = QString("no se pudo abrir el guion: %1").arg(fileName);
+        return false;
+    }
+
+    QTextStream in(&file);
+    while(!in.atEnd())
+    {
+        QString line = in.readLine().trimmed();
+        if(line.isEmpty() || line.startsWith('#'))
+            continue;
+        if(!addOperation(line, error))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief BatchProcessor::process: Carga un archivo, le aplica todas las operaciones y lo guarda. Se puede llamar
+ *                                 desde varios hilos a la vez, cada llamada usa su propio Canvas. Nunca escribe
+ *                                 sobre el archivo de entrada, en ese caso devuelve un error.
+ */
+BatchResult BatchProcessor::process(const QString &fileName) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    BatchResult result;
+    result.input = fileName;
+    result.ok = false;
+
+    QFileInfo info(fileName);
+    QString suffix = format.isEmpty() ? info.suffix().toLower() : format;
+    QString dir = outputDir.isEmpty() ? info.absolutePath() : outputDir;
+    result.output = QDir(dir).filePath(info.completeBaseName() + "." + suffix);
+
+    // sin -o ni -f (o con -o apuntando a la carpeta de entrada) la salida seria la misma imagen de entrada
+    QFileInfo target(result.output);
+    if(target.absoluteFilePath() == info.absoluteFilePath()
+       || (target.exists() && target.canonicalFilePath() == info.canonicalFilePath()))
+    {
+        result.error = "la salida sobrescribiria la imagen de entrada, use -o con otra carpeta o -f";
+        result.elapsed = timer.elapsed();
+        return result;
+    }
+
+    Canvas canvas;
+    canvas.getUndoStack()->setEnabled(false);
+
+    if(!canvas.loadImage(fileName))
+    {
+        result.error = "no se pudo leer la imagen";
+        result.elapsed = timer.elapsed();
+        return result;
+    }
+
+    for(const BatchOperation &op : operations)
+    {
+        switch(op.type)
+        {
+            case resize_op: canvas.resizeImage(op.size); break;
+            case scale_op:
+                canvas.resizeImage(QSize(qMax(1, canvas.getImage()->width() * op.percent / 100),
+                                         qMax(1, canvas.getImage()->height() * op.percent / 100)));
+                break;
+            case fill_op:
+                canvas.updateColorConfig(op.color, background);
+                canvas.clearImage();
+                break;
+            case filter_op: canvas.applyFilter(op.filter);       break;
+            case adjust_op: canvas.applyAdjustments(op.pipeline); break;
+            case transform_op: canvas.transformImage(op.transform); break;
+            default:                                              break;
+        }
+    }
+
+    if(!canvas.saveImage(result.output, suffix.toUpper().toLatin1().constData()))
+        result.error = "no se pudo guardar la imagen";
+    else
+        result.ok = true;
+
+    result.elapsed = timer.elapsed();
+    return result;
+}
+
+/**
+ * @brief BatchProcessor::run: Procesa todos los archivos en paralelo y devuelve los resultados en el mismo orden.
+ */
+QList<BatchResult> BatchProcessor::run(const QStringList &files) const
+{
+    std::function<BatchResult(const QString&)> job = [this](const QString &fileName) { return process(fileName); };
+    return QtConcurrent::blockingMapped<QList<BatchResult> >(files, job);
+}
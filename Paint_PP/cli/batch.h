@@ -0,0 +1,63 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QSize>
+#include <QColor>
+
+#include "filters.h"
+#include "adjustments.h"
+
+
+enum BatchOpType {resize_op, scale_op, fill_op, filter_op, adjust_op, transform_op};
+
+/** Una operacion del guion, ya interpretada. */
+struct BatchOperation
+{
+    BatchOpType type;
+    QSize size;               // resize
+    int percent;              // scale
+    QColor color;             // fill
+    FilterParams filter;      // filter
+    ColorPipeline pipeline;   // adjust
+    ImageTransform transform; // rotate, flip
+};
+
+struct BatchResult
+{
+    QString input;
+    QString output;
+    bool ok;
+    QString error;
+    qint64 elapsed;         // milisegundos
+};
+
+
+/**
+ * BatchProcessor: Aplica la misma lista de operaciones a muchos archivos. Cada archivo se procesa en su propio
+ * Canvas sin pila de "undo", los archivos se reparten entre los hilos del pool global y los filtros de cada
+ * archivo tambien se dividen en mosaicos en el mismo pool.
+ */
+class BatchProcessor
+{
+public:
+    BatchProcessor();
+
+    bool addOperation(const QString &spec, QString *error);
+    bool loadScript(const QString &fileName, QString *error);
+    void setOutputDir(const QString &dir) { outputDir = dir; }
+    void setFormat(const QString &format) { this->format = format.toLower(); }
+    int operationCount() const { return operations.size(); }
+
+    BatchResult process(const QString &fileName) const;
+    QList<BatchResult> run(const QStringList &files) const;
+
+private:
+    QList<BatchOperation> operations;
+    QString outputDir;
+    QString format;
+};
+
+#endif // BATCH_H
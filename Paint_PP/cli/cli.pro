@@ -0,0 +1,14 @@
+QT       = core gui concurrent
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+CONFIG += qt warn_on
+
+TARGET = paintpp-cli
+
+include(../core/core.pri)
+
+HEADERS += \
+    batch.h
+SOURCES += main.cpp \
+    batch.cpp
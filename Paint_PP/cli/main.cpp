@@ -0,0 +1,149 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QTextStream>
+#include <QDir>
+#include <QFileInfo>
+
+#include "batch.h"
+#include "canvas.h"
+#include "trace.h"
+
+
+/**
+ * @brief replayLog: Reproduce un registro de operaciones sin esperas y guarda el resultado. Devuelve el codigo
+ *                   de salida del programa.
+ */
+static int replayLog(const QString &logFile, const QString &output, const QString &format, QTextStream &out,
+                     QTextStream &err)
+{
+    QByteArray data;
+    if(!OpLog::load(logFile, &data))
+    {
+        err << "no se pudo leer el registro: " << logFile << endl;
+        return 1;
+    }
+
+    Canvas canvas;
+    OpPlayer player(&canvas, data);
+    if(!player.isValid())
+    {
+        err << logFile << " no es un registro de operaciones" << endl;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    player.runAll();
+    qint64 elapsed = timer.elapsed();
+
+    QString suffix = format.isEmpty() ? QFileInfo(output).suffix() : format;
+    if(!canvas.saveImage(output, suffix.isEmpty() ? "BMP" : suffix.toUpper().toLatin1().constData()))
+    {
+        err << "no se pudo guardar la imagen: " << output << endl;
+        return 2;
+    }
+
+    out << player.played() << " operaciones en " << elapsed << " ms -> " << output << endl;
+    return 0;
+}
+
+/**
+ * Paint++ por lotes: aplica un guion de operaciones a muchos archivos sin abrir ninguna ventana.
+ *
+ *   paintpp-cli --op resize:1280x720 --op sharpen:2:150 -f png -o salida/ *.bmp
+ *   paintpp-cli --script ajustes.txt -j 8 -o salida/ fotos/*.jpg
+ *   paintpp-cli --replay sesion.ppol resultado.png
+ */
+int main(int argc, char* argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("paintpp-cli");
+    Trace::startFromEnvironment();
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Aplica operaciones de Paint++ a un lote de imagenes.\n"
+                                     "Operaciones: resize:ANCHOxALTO, scale:PORCENTAJE, fill:COLOR, blur:RADIO,\n"
+                                     "sharpen:RADIO:CANTIDAD, edges, brightness:V, contrast:V,\n"
+                                     "levels:NEGRO:BLANCO:GAMMA, hue:TONO:SATURACION:LUZ, rotate:90|180|270, flip:h|v");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "Imagenes de entrada.", "<archivos...>");
+
+    QCommandLineOption opOption(QStringList() << "op", "Operacion a aplicar, se puede repetir.", "operacion");
+    QCommandLineOption scriptOption(QStringList() << "s" << "script", "Guion con una operacion por linea.", "archivo");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Carpeta de salida.", "carpeta");
+    QCommandLineOption formatOption(QStringList() << "f" << "format", "Formato de salida (bmp, png, jpg...).", "formato");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs", "Hilos en paralelo.", "n");
+    QCommandLineOption replayOption(QStringList() << "replay",
+                                    "Reproduce un registro de operaciones y guarda el resultado en el archivo indicado.",
+                                    "registro");
+    parser.addOption(opOption);
+    parser.addOption(scriptOption);
+    parser.addOption(outputOption);
+    parser.addOption(formatOption);
+    parser.addOption(jobsOption);
+    parser.addOption(replayOption);
+    parser.process(a);
+
+    QStringList files = parser.positionalArguments();
+    if(files.isEmpty())
+        parser.showHelp(1);
+
+    if(parser.isSet(replayOption))
+        return replayLog(parser.value(replayOption), files.first(), parser.value(formatOption), out, err);
+
+    BatchProcessor processor;
+    QString error;
+    if(parser.isSet(scriptOption) && !processor.loadScript(parser.value(scriptOption), &error))
+    {
+        err << error << endl;
+        return 1;
+    }
+    for(const QString &spec : parser.values(opOption))
+    {
+        if(!processor.addOperation(spec, &error))
+        {
+            err << error << endl;
+            return 1;
+        }
+    }
+
+    if(parser.isSet(outputOption))
+    {
+        QString dir = parser.value(outputOption);
+        if(!QDir().mkpath(dir))
+        {
+            err << "no se pudo crear la carpeta de salida: " << dir << endl;
+            return 1;
+        }
+        processor.setOutputDir(dir);
+    }
+    if(parser.isSet(formatOption))
+        processor.setFormat(parser.value(formatOption));
+    if(parser.isSet(jobsOption))
+        QThreadPool::globalInstance()->setMaxThreadCount(qMax(1, parser.value(jobsOption).toInt()));
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<BatchResult> results = processor.run(files);
+
+    int failed = 0;
+    for(const BatchResult &result : results)
+    {
+        if(result.ok)
+            out << result.input << " -> " << result.output << " (" << result.elapsed << " ms)" << endl;
+        else
+        {
+            err << result.input << ": " << result.error << endl;
+            failed++;
+        }
+    }
+    out << results.size() - failed << "/" << results.size() << " imagenes en " << timer.elapsed() << " ms, "
+        << QThreadPool::globalInstance()->maxThreadCount() << " hilos" << endl;
+
+    return failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,342 @@
+#include <QtConcurrent>
+#include <cmath>
+
+#include "adjustments.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ADJUSTMENTS_AVX2
+#endif
+
+
+static inline int clamp255(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/** Division entre 255 exacta para valores en [0, 255*255]. */
+static inline int div255(int x)
+{
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+/**
+ * ReciprocalTable: Tabla de inversos en punto fijo 16.16 para evitar divisiones al convertir a HSV.
+ */
+struct ReciprocalTable
+{
+    int value[256];
+
+    ReciprocalTable()
+    {
+        value[0] = 0;
+        for(int i = 1; i < 256; ++i)
+            value[i] = ((1 << 16) + i / 2) / i;
+    }
+};
+
+static const int* reciprocals()
+{
+    static const ReciprocalTable table;
+    return table.value;
+}
+
+/**
+ * @brief adjustHsv: Convierte un pixel a HSV en punto fijo (tono en [0, 1536), saturacion y valor en [0, 255]),
+ *                   aplica el desplazamiento del tono y los factores de saturacion y valor, y lo devuelve a RGB.
+ */
+static inline QRgb adjustHsv(QRgb pixel, int hueShift, int satFactor, int valFactor, const int *recip)
+{
+    int r = qRed(pixel), g = qGreen(pixel), b = qBlue(pixel);
+    int max = qMax(r, qMax(g, b));
+    int min = qMin(r, qMin(g, b));
+    int delta = max - min;
+
+    int h = 0, s = 0, v = max;
+    if(delta != 0)
+    {
+        s = (delta * 255 * recip[max]) >> 16;
+        int dr = recip[delta];
+        if(max == r)
+            h = ((g - b) * 256 * dr) >> 16;
+        else if(max == g)
+            h = 512 + (((b - r) * 256 * dr) >> 16);
+        else
+            h = 1024 + (((r - g) * 256 * dr) >> 16);
+    }
+
+    h += hueShift;
+    h %= 1536;
+    if(h < 0)
+        h += 1536;
+    s = clamp255((s * satFactor) >> 8);
+    v = clamp255((v * valFactor) >> 8);
+
+    if(s == 0)
+        return (pixel & 0xff000000) | qRgb(v, v, v);
+
+    int sector = h >> 8;
+    int f = h & 0xff;
+    int p = div255(v * (255 - s));
+    int q = div255(v * (255 - div255(s * f)));
+    int t = div255(v * (255 - div255(s * (255 - f))));
+
+    switch(sector)
+    {
+        case 0:  r = v; g = t; b = p; break;
+        case 1:  r = q; g = v; b = p; break;
+        case 2:  r = p; g = v; b = t; break;
+        case 3:  r = p; g = q; b = v; break;
+        case 4:  r = t; g = p; b = v; break;
+        default: r = v; g = p; b = q; break;
+    }
+    return (pixel & 0xff000000) | qRgb(r, g, b);
+}
+
+#ifdef ADJUSTMENTS_AVX2
+/**
+ * @brief lutRowAvx2: Aplica las tres tablas a ocho pixeles por iteracion con "gathers" de AVX2. Las tablas de 32 bits
+ *                    ya tienen cada valor desplazado a la posicion de su canal, solo hay que combinarlas con OR.
+ */
+__attribute__((target("avx2")))
+static int lutRowAvx2(QRgb *line, int count, const quint32 *tables)
+{
+    const __m256i byteMask = _mm256_set1_epi32(0xff);
+    const __m256i alphaMask = _mm256_set1_epi32(int(0xff000000));
+    int x = 0;
+    for(; x + 8 <= count; x += 8)
+    {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + x));
+        __m256i b = _mm256_i32gather_epi32(reinterpret_cast<const int*>(tables),
+                                           _mm256_and_si256(px, byteMask), 4);
+        __m256i g = _mm256_i32gather_epi32(reinterpret_cast<const int*>(tables + 256),
+                                           _mm256_and_si256(_mm256_srli_epi32(px, 8), byteMask), 4);
+        __m256i r = _mm256_i32gather_epi32(reinterpret_cast<const int*>(tables + 512),
+                                           _mm256_and_si256(_mm256_srli_epi32(px, 16), byteMask), 4);
+        __m256i out = _mm256_or_si256(_mm256_or_si256(b, g),
+                                      _mm256_or_si256(r, _mm256_and_si256(px, alphaMask)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(line + x), out);
+    }
+    return x;
+}
+
+static bool hasAvx2()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+/**
+ * @brief ColorPipeline::lutStage: Devuelve la etapa de tablas al final de la secuencia, si la ultima etapa es de HSV
+ *                                 se crea una nueva con tablas identidad.
+ */
+ColorPipeline::Stage& ColorPipeline::lutStage()
+{
+    if(stages.isEmpty() || stages.last().hsv)
+    {
+        Stage stage;
+        stage.hsv = false;
+        stage.hue = 0;
+        stage.saturation = 256;
+        stage.value = 256;
+        for(int c = 0; c < 3; ++c)
+            for(int i = 0; i < 256; ++i)
+                stage.lut[c][i] = uchar(i);
+        stages.append(stage);
+    }
+    return stages.last();
+}
+
+/**
+ * @brief ColorPipeline::composeLut: Compone "table" despues de las tablas actuales de los canales indicados, asi dos
+ *                                   ajustes seguidos cuestan lo mismo que uno al aplicarse.
+ */
+void ColorPipeline::composeLut(int channels, const uchar table[256])
+{
+    Stage &stage = lutStage();
+    for(int c = 0; c < 3; ++c)
+    {
+        if(!(channels & (1 << c)))
+            continue;
+        for(int i = 0; i < 256; ++i)
+            stage.lut[c][i] = table[stage.lut[c][i]];
+    }
+}
+
+/**
+ * @brief ColorPipeline::addBrightness: Suma "value" a cada canal.
+ */
+void ColorPipeline::addBrightness(int value)
+{
+    if(value == 0)
+        return;
+
+    uchar table[256];
+    for(int i = 0; i < 256; ++i)
+        table[i] = uchar(clamp255(i + value));
+    composeLut(all_channels, table);
+}
+
+/**
+ * @brief ColorPipeline::addContrast: Estira o encoge los valores alrededor del gris medio, "value" va de -100
+ *                                    (todo gris) a 100 (el doble de contraste).
+ */
+void ColorPipeline::addContrast(int value)
+{
+    if(value == 0)
+        return;
+
+    double factor = (100.0 + value) / 100.0;
+    uchar table[256];
+    for(int i = 0; i < 256; ++i)
+        table[i] = uchar(clamp255(int(std::floor((i - 128) * factor + 128.5))));
+    composeLut(all_channels, table);
+}
+
+/**
+ * @brief ColorPipeline::addLevels: Lleva el rango [black, white] a [0, 255] con una correccion gamma, "gamma" viene
+ *                                  multiplicado por 100.
+ */
+void ColorPipeline::addLevels(int black, int white, int gamma, int channels)
+{
+    if(black == 0 && white == 255 && gamma == 100)
+        return;
+
+    black = clamp255(black);
+    white = qMax(clamp255(white), black + 1);
+    double exponent = 100.0 / qMax(gamma, 1);
+
+    uchar table[256];
+    for(int i = 0; i < 256; ++i)
+    {
+        double t = double(i - black) / (white - black);
+        t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+        table[i] = uchar(clamp255(int(std::pow(t, exponent) * 255.0 + 0.5)));
+    }
+    composeLut(channels, table);
+}
+
+/**
+ * @brief ColorPipeline::addHueSaturation: Gira el tono "hue" grados y escala la saturacion y el valor en porcentaje
+ *                                         (-100 a 100).
+ */
+void ColorPipeline::addHueSaturation(int hue, int saturation, int lightness)
+{
+    if(hue == 0 && saturation == 0 && lightness == 0)
+        return;
+
+    Stage stage;
+    stage.hsv = true;
+    stage.hue = hue * 1536 / 360;
+    stage.saturation = (100 + saturation) * 256 / 100;
+    stage.value = (100 + lightness) * 256 / 100;
+    stages.append(stage);
+}
+
+/**
+ * @brief ColorPipeline::apply: Aplica todas las etapas al area de la imagen en una sola pasada, repartiendo franjas
+ *                              de filas entre los hilos del pool. La imagen debe estar en ARGB32 o RGB32 (sin
+ *                              premultiplicar) para que los ajustes no dependan del alfa.
+ */
+void ColorPipeline::apply(QImage &image, const QRect &area) const
+{
+    if(isIdentity())
+        return;
+
+    if(image.format() != QImage::Format_ARGB32 && image.format() != QImage::Format_RGB32)
+        image = image.convertToFormat(QImage::Format_ARGB32);
+
+    QRect rect = area.intersected(image.rect());
+    if(rect.isEmpty())
+        return;
+
+    // la imagen se desacopla una sola vez (bits) antes de repartir el trabajo entre hilos
+    QList<QRect> bands;
+    const int bandHeight = 64;
+    for(int y = rect.top(); y <= rect.bottom(); y += bandHeight)
+        bands.append(QRect(rect.left(), y, rect.width(), qMin(bandHeight, rect.bottom() - y + 1)));
+
+    uchar *bits = image.bits();
+    const int stride = image.bytesPerLine();
+    QtConcurrent::blockingMap(bands, [this, bits, stride](const QRect &band) {
+        applyRows(bits, stride, band);
+    });
+}
+
+/**
+ * @brief ColorPipeline::write: Guarda las etapas ya compuestas (tablas y factores HSV) para el registro de operaciones,
+ *                              al leerlas se obtiene exactamente la misma secuencia.
+ */
+void ColorPipeline::write(QDataStream &out) const
+{
+    out << qint32(stages.size());
+    for(const Stage &stage : stages)
+    {
+        out << stage.hsv << qint32(stage.hue) << qint32(stage.saturation) << qint32(stage.value);
+        out.writeRawData(reinterpret_cast<const char*>(stage.lut), sizeof(stage.lut));
+    }
+}
+
+void ColorPipeline::read(QDataStream &in)
+{
+    qint32 count = 0;
+    in >> count;
+    stages.clear();
+    for(int i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        Stage stage;
+        qint32 hue, saturation, value;
+        in >> stage.hsv >> hue >> saturation >> value;
+        in.readRawData(reinterpret_cast<char*>(stage.lut), sizeof(stage.lut));
+        stage.hue = hue;
+        stage.saturation = saturation;
+        stage.value = value;
+        stages.append(stage);
+    }
+}
+
+/**
+ * @brief ColorPipeline::applyRows: Recorre las filas de una franja una sola vez. Cuando toda la secuencia es una sola
+ *                                  tabla se usa el camino vectorial si el procesador lo permite.
+ */
+void ColorPipeline::applyRows(uchar *bits, int stride, const QRect &rows) const
+{
+    const int *recip = reciprocals();
+
+#ifdef ADJUSTMENTS_AVX2
+    quint32 tables[3 * 256];
+    bool vectorLut = stages.size() == 1 && !stages[0].hsv && hasAvx2();
+    if(vectorLut)
+        for(int c = 0; c < 3; ++c)
+            for(int i = 0; i < 256; ++i)
+                tables[c * 256 + i] = quint32(stages[0].lut[c][i]) << (8 * c);
+#endif
+
+    for(int y = rows.top(); y <= rows.bottom(); ++y)
+    {
+        QRgb *line = reinterpret_cast<QRgb*>(bits + y * stride) + rows.left();
+        int x = 0;
+
+#ifdef ADJUSTMENTS_AVX2
+        if(vectorLut)
+            x = lutRowAvx2(line, rows.width(), tables);
+#endif
+
+        for(; x < rows.width(); ++x)
+        {
+            QRgb pixel = line[x];
+            for(const Stage &stage : stages)
+            {
+                if(stage.hsv)
+                    pixel = adjustHsv(pixel, stage.hue, stage.saturation, stage.value, recip);
+                else
+                    pixel = (pixel & 0xff000000)
+                            | (QRgb(stage.lut[2][(pixel >> 16) & 0xff]) << 16)
+                            | (QRgb(stage.lut[1][(pixel >> 8) & 0xff]) << 8)
+                            | QRgb(stage.lut[0][pixel & 0xff]);
+            }
+            line[x] = pixel;
+        }
+    }
+}
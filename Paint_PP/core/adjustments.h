@@ -0,0 +1,50 @@
+#ifndef ADJUSTMENTS_H
+#define ADJUSTMENTS_H
+
+#include <QImage>
+#include <QVector>
+#include <QDataStream>
+
+#include "constants.h"
+
+
+/**
+ * ColorPipeline: Secuencia de ajustes de color que se aplica en una sola pasada sobre los pixeles.
+ * Los ajustes por canal (brillo, contraste, niveles) se componen en tablas de 256 entradas, varios ajustes
+ * seguidos terminan en una sola tabla por canal. Los ajustes en HSV se hacen en punto fijo y solo parten la
+ * secuencia en etapas, pero todas las etapas se aplican al mismo pixel antes de pasar al siguiente.
+ */
+class ColorPipeline
+{
+public:
+    ColorPipeline() {}
+
+    void addBrightness(int value);
+    void addContrast(int value);
+    void addLevels(int black, int white, int gamma, int channels = all_channels);
+    void addHueSaturation(int hue, int saturation, int lightness);
+
+    bool isIdentity() const { return stages.isEmpty(); }
+    void apply(QImage &image, const QRect &area) const;
+
+    void write(QDataStream &out) const;
+    void read(QDataStream &in);
+
+private:
+    struct Stage
+    {
+        bool hsv;
+        uchar lut[3][256];  // tablas en el orden de los bytes en memoria: B, G, R
+        int hue;            // desplazamiento del tono en 1/1536 de vuelta
+        int saturation;     // factores en punto fijo 8.8
+        int value;
+    };
+
+    Stage& lutStage();
+    void composeLut(int channels, const uchar table[256]);
+    void applyRows(uchar *bits, int stride, const QRect &rows) const;
+
+    QVector<Stage> stages;
+};
+
+#endif // ADJUSTMENTS_H
@@ -0,0 +1,289 @@
+#include <QtEndian>
+#include <cstring>
+#include <vector>
+
+#include "bmp_rle.h"
+#include "image_io.h"
+#include "trace.h"
+
+
+static const quint16 BMP_MAGIC = 0x4D42;           // "BM"
+static const int BMP_FILE_HEADER = 14;
+static const int BMP_INFO_HEADER = 40;             // BITMAPINFOHEADER, los encabezados V4 y V5 lo extienden
+static const quint32 BI_RLE8 = 1;
+static const quint32 BI_RLE4 = 2;
+static const int RLE_MAX_RUN = 255;
+
+/**
+ * decodeRle: Decodifica los tramos hasta el fin de la imagen (o del archivo) directo en las filas de "image", que
+ * empiezan abajo. Lo que los saltos y los fines de linea dejan sin escribir queda en el indice 0, los indices fuera
+ * de la paleta tambien.
+ */
+static void decodeRle(StreamReader &in, QImage &image, bool rle4)
+{
+    const int width = image.width();
+    const int colors = image.colorCount();
+    uchar *bits = image.bits();
+    const int stride = image.bytesPerLine();
+
+    int x = 0;
+    int y = image.height() - 1;
+    uchar count, value;
+    while(in.next(&count) && in.next(&value))
+    {
+        uchar *row = y >= 0 && y < image.height() ? bits + qptrdiff(y) * stride : 0;
+        if(count > 0)
+        {
+            // tramo codificado: "count" pixeles de "value" (en RLE4, sus dos nibbles alternados)
+            if(row && !rle4 && x < width)
+                memset(row + x, value < colors ? value : 0, size_t(qMin(int(count), width - x)));
+            else if(row)
+            {
+                for(int i = 0; i < count && x + i < width; ++i)
+                {
+                    int index = i & 1 ? value & 15 : value >> 4;
+                    row[x + i] = uchar(index < colors ? index : 0);
+                }
+            }
+            x += count;
+            continue;
+        }
+
+        if(value == 0)
+        {
+            x = 0;
+            --y;
+        }
+        else if(value == 1)
+            return;
+        else if(value == 2)
+        {
+            uchar dx, dy;
+            if(!in.next(&dx) || !in.next(&dy))
+                return;
+            x += dx;
+            y -= dy;
+        }
+        else
+        {
+            // tramo absoluto: "value" pixeles sueltos, alineados a 16 bits en el archivo
+            const int bytes = rle4 ? (value + 1) / 2 : value;
+            for(int i = 0; i < bytes; ++i)
+            {
+                uchar byte;
+                if(!in.next(&byte))
+                    return;
+                if(!rle4)
+                {
+                    if(row && x + i < width)
+                        row[x + i] = uchar(byte < colors ? byte : 0);
+                    continue;
+                }
+                for(int half = 0; half < 2 && 2 * i + half < value; ++half)
+                {
+                    const int px = x + 2 * i + half;
+                    const int index = half ? byte & 15 : byte >> 4;
+                    if(row && px < width)
+                        row[px] = uchar(index < colors ? index : 0);
+                }
+            }
+            uchar pad;
+            if((bytes & 1) && !in.next(&pad))
+                return;
+            x += value;
+        }
+    }
+}
+
+/**
+ * readRleBmp: Lee un BMP con BI_RLE8 o BI_RLE4. Falso si el archivo no es un BMP, no esta comprimido con RLE o sus
+ * encabezados no se pueden leer.
+ */
+bool readRleBmp(QIODevice *device, QImage *image)
+{
+    QByteArray header = device->read(BMP_FILE_HEADER + BMP_INFO_HEADER);
+    if(header.size() < BMP_FILE_HEADER + BMP_INFO_HEADER)
+        return false;
+
+    const uchar *h = reinterpret_cast<const uchar*>(header.constData());
+    const quint32 dataOffset = qFromLittleEndian<quint32>(h + 10);
+    const quint32 infoSize = qFromLittleEndian<quint32>(h + 14);
+    const qint32 width = qFromLittleEndian<qint32>(h + 18);
+    const qint32 height = qFromLittleEndian<qint32>(h + 22);
+    const quint16 bitCount = qFromLittleEndian<quint16>(h + 28);
+    const quint32 compression = qFromLittleEndian<quint32>(h + 30);
+    const qint32 dotsX = qFromLittleEndian<qint32>(h + 38);
+    const qint32 dotsY = qFromLittleEndian<qint32>(h + 42);
+    const quint32 colorsUsed = qFromLittleEndian<quint32>(h + 46);
+
+    const bool rle8 = compression == BI_RLE8 && bitCount == 8;
+    const bool rle4 = compression == BI_RLE4 && bitCount == 4;
+    if(qFromLittleEndian<quint16>(h) != BMP_MAGIC || infoSize < quint32(BMP_INFO_HEADER) || !(rle8 || rle4))
+        return false;
+    // los BMP con RLE siempre guardan las filas de abajo hacia arriba, la altura no puede ser negativa
+    if(width <= 0 || height <= 0)
+        return false;
+
+    const int maxColors = 1 << bitCount;
+    const int colors = colorsUsed == 0 || colorsUsed > quint32(maxColors) ? maxColors : int(colorsUsed);
+    if(!device->seek(BMP_FILE_HEADER + qint64(infoSize)))
+        return false;
+    QByteArray table = device->read(colors * 4);
+    if(table.size() < colors * 4 || !device->seek(dataOffset))
+        return false;
+
+    QVector<QRgb> palette(colors);
+    const uchar *entry = reinterpret_cast<const uchar*>(table.constData());
+    for(int i = 0; i < colors; ++i, entry += 4)
+        palette[i] = qRgb(entry[2], entry[1], entry[0]);
+
+    QImage decoded(width, height, QImage::Format_Indexed8);
+    if(decoded.isNull())
+        return false;
+
+    TRACE_SCOPE("readRleBmp");
+    decoded.setColorTable(palette);
+    decoded.fill(0);
+    if(dotsX > 0 && dotsY > 0)
+    {
+        decoded.setDotsPerMeterX(dotsX);
+        decoded.setDotsPerMeterY(dotsY);
+    }
+
+    StreamReader in(device);
+    decodeRle(in, decoded, rle4);
+    *image = decoded;
+    return true;
+}
+
+/**
+ * repeatAt: Cuantos pixeles iguales a row[i] hay desde "i", hasta RLE_MAX_RUN.
+ */
+static inline int repeatAt(const uchar *row, int i, int width)
+{
+    int run = 1;
+    while(i + run < width && run < RLE_MAX_RUN && row[i + run] == row[i])
+        ++run;
+    return run;
+}
+
+/**
+ * encodeRow: Codifica una fila en "out". Dos o mas pixeles iguales van en un tramo codificado; los demas se juntan
+ * en tramos absolutos hasta el proximo grupo de tres iguales. Los tramos absolutos necesitan tres pixeles o mas, los
+ * mas cortos se escriben como tramos codificados de un pixel.
+ */
+static void encodeRow(const uchar *row, int width, bool rle4, std::vector<uchar> &out)
+{
+    int i = 0;
+    while(i < width)
+    {
+        const int run = repeatAt(row, i, width);
+        if(run >= 2)
+        {
+            out.push_back(uchar(run));
+            out.push_back(rle4 ? uchar((row[i] & 15) * 0x11) : row[i]);
+            i += run;
+            continue;
+        }
+
+        const int start = i;
+        while(i < width && i - start < RLE_MAX_RUN
+              && !(i + 2 < width && row[i] == row[i + 1] && row[i] == row[i + 2]))
+            ++i;
+
+        const int length = i - start;
+        if(length < 3)
+        {
+            for(int k = start; k < i; ++k)
+            {
+                out.push_back(1);
+                out.push_back(rle4 ? uchar((row[k] & 15) << 4) : row[k]);
+            }
+            continue;
+        }
+
+        out.push_back(0);
+        out.push_back(uchar(length));
+        int bytes = length;
+        if(rle4)
+        {
+            bytes = (length + 1) / 2;
+            for(int k = 0; k < bytes; ++k)
+            {
+                const int px = start + 2 * k;
+                out.push_back(uchar((row[px] & 15) << 4 | (px + 1 < i ? row[px + 1] & 15 : 0)));
+            }
+        }
+        else
+            out.insert(out.end(), row + start, row + i);
+        if(bytes & 1)
+            out.push_back(0);
+    }
+}
+
+/**
+ * writeRleBmp: Escribe "image" (Indexed8) como BMP con RLE. Los tamaños del archivo y de los datos se conocen al
+ * terminar la ultima fila y se escriben volviendo al encabezado.
+ */
+bool writeRleBmp(QIODevice *device, const QImage &image)
+{
+    if(image.isNull() || image.format() != QImage::Format_Indexed8 || device->isSequential())
+        return false;
+
+    TRACE_SCOPE("writeRleBmp");
+    const QVector<QRgb> palette = image.colorTable();
+    const bool rle4 = palette.size() <= 16;
+    const int dataOffset = BMP_FILE_HEADER + BMP_INFO_HEADER + palette.size() * 4;
+
+    QByteArray header(dataOffset, 0);
+    uchar *h = reinterpret_cast<uchar*>(header.data());
+    qToLittleEndian<quint16>(BMP_MAGIC, h);
+    qToLittleEndian<quint32>(quint32(dataOffset), h + 10);
+    qToLittleEndian<quint32>(quint32(BMP_INFO_HEADER), h + 14);
+    qToLittleEndian<qint32>(image.width(), h + 18);
+    qToLittleEndian<qint32>(image.height(), h + 22);
+    qToLittleEndian<quint16>(1, h + 26);
+    qToLittleEndian<quint16>(rle4 ? 4 : 8, h + 28);
+    qToLittleEndian<quint32>(rle4 ? BI_RLE4 : BI_RLE8, h + 30);
+    qToLittleEndian<qint32>(image.dotsPerMeterX(), h + 38);
+    qToLittleEndian<qint32>(image.dotsPerMeterY(), h + 42);
+    qToLittleEndian<quint32>(quint32(palette.size()), h + 46);
+    uchar *entry = h + BMP_FILE_HEADER + BMP_INFO_HEADER;
+    for(QRgb color : palette)
+    {
+        *entry++ = uchar(qBlue(color));
+        *entry++ = uchar(qGreen(color));
+        *entry++ = uchar(qRed(color));
+        *entry++ = 0;
+    }
+
+    const qint64 start = device->pos();
+    StreamWriter writer(device);
+    writer.write(header.constData(), header.size());
+
+    // una fila a la vez, de abajo hacia arriba; el buffer conserva su capacidad entre filas
+    std::vector<uchar> out;
+    out.reserve(size_t(image.width()) * 2 + 4);
+    qint64 dataSize = 0;
+    for(int y = image.height() - 1; y >= 0; --y)
+    {
+        out.clear();
+        encodeRow(image.constScanLine(y), image.width(), rle4, out);
+        out.push_back(0);
+        out.push_back(y > 0 ? 0 : 1);   // fin de linea, o fin de la imagen en la ultima
+        writer.write(out.data(), qint64(out.size()));
+        dataSize += qint64(out.size());
+    }
+    if(!writer.flush())
+        return false;
+
+    uchar size[4];
+    const qint64 end = device->pos();
+    qToLittleEndian<quint32>(quint32(dataOffset + dataSize), size);
+    if(!device->seek(start + 2) || device->write(reinterpret_cast<const char*>(size), 4) != 4)
+        return false;
+    qToLittleEndian<quint32>(quint32(dataSize), size);
+    if(!device->seek(start + 34) || device->write(reinterpret_cast<const char*>(size), 4) != 4)
+        return false;
+    return device->seek(end);
+}
@@ -0,0 +1,23 @@
+#ifndef BMP_RLE_H
+#define BMP_RLE_H
+
+#include <QImage>
+#include <QIODevice>
+
+#include "constants.h"
+
+
+/**
+ * BMP comprimidos con RLE (BI_RLE8 y BI_RLE4). Los dos sentidos trabajan en una sola pasada por el archivo y de a una
+ * fila (image_io): al leer, cada tramo se escribe directo en la imagen; al escribir, cada fila se codifica en un
+ * buffer de una fila y se pasa al StreamWriter. Los tamaños del encabezado se completan al final, el dispositivo
+ * tiene que permitir volver atras (un archivo).
+ *
+ * readRleBmp devuelve falso si el archivo no es un BMP con RLE, quien llama lo abre de la forma normal. La imagen
+ * leida es Indexed8 con la paleta del archivo. writeRleBmp recibe una imagen Indexed8 y usa BI_RLE4 si la paleta
+ * tiene hasta 16 colores.
+ */
+bool readRleBmp(QIODevice *device, QImage *image);
+bool writeRleBmp(QIODevice *device, const QImage &image);
+
+#endif // BMP_RLE_H
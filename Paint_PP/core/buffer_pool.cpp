@@ -0,0 +1,137 @@
+#include <QMutexLocker>
+#include <cstring>
+#include <climits>
+
+#include "buffer_pool.h"
+
+
+/** Cada bloque empieza con su clase de tamaño, los pixeles empiezan despues, alineados a 64 bytes. */
+static const int BLOCK_HEADER = 64;
+
+BufferPool::BufferPool()
+{
+    idleTotal = 0;
+}
+
+/**
+ * @brief BufferPool::instance: La reserva nunca se destruye, las imagenes que se liberan al salir del programa
+ *                              todavia la pueden usar.
+ */
+BufferPool* BufferPool::instance()
+{
+    static BufferPool *pool = new BufferPool;
+    return pool;
+}
+
+/**
+ * @brief BufferPool::sizeClass: Redondea hacia arriba a una de las ocho clases entre la potencia de dos anterior y
+ *                               la siguiente.
+ */
+qint64 BufferPool::sizeClass(qint64 bytes)
+{
+    qint64 power = 1;
+    while(power < bytes)
+        power <<= 1;
+    qint64 step = qMax<qint64>(power / 16, 4096);
+    return (bytes + step - 1) / step * step;
+}
+
+/**
+ * @brief BufferPool::acquire: Imagen sin inicializar de "size" y "format". Las imagenes chicas no pasan por la reserva.
+ */
+QImage BufferPool::acquire(const QSize &size, QImage::Format format)
+{
+    if(size.isEmpty() || format == QImage::Format_Invalid)
+        return QImage();
+
+    int depth = QImage::toPixelFormat(format).bitsPerPixel();
+    qint64 stride = ((qint64(size.width()) * depth + 31) >> 5) << 2;
+    qint64 bytes = stride * size.height();
+    if(bytes < BUFFER_POOL_MIN_BYTES || stride > INT_MAX)
+        return QImage(size, format);
+
+    qint64 klass = sizeClass(bytes);
+    void *block = 0;
+    {
+        QMutexLocker locker(&mutex);
+        QVector<void*> &blocks = idle[klass];
+        if(!blocks.isEmpty())
+        {
+            block = blocks.takeLast();
+            idleTotal -= klass;
+        }
+    }
+
+    if(!block)
+    {
+        block = qMallocAligned(size_t(klass + BLOCK_HEADER), BLOCK_HEADER);
+        if(!block)
+            return QImage(size, format);
+        *static_cast<qint64*>(block) = klass;
+    }
+
+    uchar *bits = static_cast<uchar*>(block) + BLOCK_HEADER;
+    return QImage(bits, size.width(), size.height(), int(stride), format, &BufferPool::release, block);
+}
+
+/**
+ * @brief BufferPool::copy: Copia profunda de "rect" (o de toda la imagen) en un buffer de la reserva, equivale a
+ *                          QImage::copy().
+ */
+QImage BufferPool::copy(const QImage &image, const QRect &rect)
+{
+    QRect area = rect.isNull() ? image.rect() : rect.intersected(image.rect());
+    QImage result = acquire(area.size(), image.format());
+    if(result.isNull())
+        return result;
+
+    int lineBytes = (area.width() * image.depth() + 7) / 8;
+    int offset = area.left() * image.depth() / 8;
+    for(int y = 0; y < area.height(); ++y)
+        memcpy(result.scanLine(y), image.constScanLine(area.top() + y) + offset, size_t(lineBytes));
+
+    if(image.depth() <= 8)
+        result.setColorTable(image.colorTable());
+    result.setDotsPerMeterX(image.dotsPerMeterX());
+    result.setDotsPerMeterY(image.dotsPerMeterY());
+    return result;
+}
+
+/**
+ * @brief BufferPool::release: Lo llama QImage al destruir la ultima copia. El bloque vuelve a la reserva salvo que
+ *                             ya haya BUFFER_POOL_MAX_MB libres.
+ */
+void BufferPool::release(void *block)
+{
+    BufferPool *pool = instance();
+    qint64 klass = *static_cast<qint64*>(block);
+    {
+        QMutexLocker locker(&pool->mutex);
+        if(pool->idleTotal + klass <= qint64(BUFFER_POOL_MAX_MB) * 1024 * 1024)
+        {
+            pool->idle[klass].append(block);
+            pool->idleTotal += klass;
+            return;
+        }
+    }
+    qFreeAligned(block);
+}
+
+qint64 BufferPool::idleBytes() const
+{
+    QMutexLocker locker(&mutex);
+    return idleTotal;
+}
+
+/**
+ * @brief BufferPool::trim: Libera todos los buffers que no se estan usando.
+ */
+void BufferPool::trim()
+{
+    QMutexLocker locker(&mutex);
+    for(QVector<void*> &blocks : idle)
+        for(void *block : blocks)
+            qFreeAligned(block);
+    idle.clear();
+    idleTotal = 0;
+}
@@ -0,0 +1,1323 @@
+#include <QPainter>
+#include <QFile>
+
+#include "canvas.h"
+#include "commands.h"
+#include "perf_stats.h"
+#include "trace.h"
+#include "memory_accountant.h"
+#include "buffer_pool.h"
+#include "span_fill.h"
+#include "pixel_format.h"
+#include "quantize.h"
+#include "bmp_rle.h"
+#include "image_io.h"
+
+
+/**
+ * @brief Canvas::Canvas - Es el constructor del documento que se edita, contiene las capas donde se va dibujar, las
+ * herramientas, la pila de "undo" y "redo" y las variables de estado de los trazos.
+ */
+Canvas::Canvas(QObject *parent)
+    : QObject(parent)
+{
+    // inicializa el objeto undoStack que es un tipo de pila que permite almacenar los diferentes estados de una
+    // imagen que contiene todo lo que se haya editado dentro del programa.
+    undoStack = new UndoStack();
+    undoStack->setUndoLimit(UNDO_LIMIT);
+
+    // registro de operaciones, solo graba cuando se llama a startRecording()
+    opLog = new OpLog();
+
+    // inicializa las capas, "image" siempre apunta a la imagen de la capa activa
+    layers = new LayerStack();
+    image = 0;
+
+    //create the pen, line, eraser, & rect tools
+    createTools();
+
+    // iniciliza los colores por defecto
+    foregroundColor = Qt::black;
+    backgroundColor = Qt::white;
+    syncActiveLayer();
+    // inicializa las variables de los estados de los trazos
+    drawing = false;
+    drawingPoly = false;
+    currentLineMode = single;
+
+    clock.start();
+    replayTime = -1;
+    strokeStart = 0;
+}
+
+Canvas::~Canvas()
+{
+    MemoryAccountant::instance()->remove(this);
+
+    // los comandos guardan punteros a las capas, se eliminan primero
+    delete undoStack;
+    delete opLog;
+    delete layers;
+    delete pencilTool;
+    delete penTool;
+    delete eraserTool;
+    delete shapesTool;
+    delete selectionTool;
+}
+
+/**
+ * @brief Canvas::beginStroke: Inicia un trazo con la herramienta actual en "point" (clic izquierdo).
+ *                             -Lapiz: inicia un trazo continuo.
+ *                             -Lapicero y figuras: guarda el punto inicial.
+ *                             -Seleccion: inicia una seleccion nueva o el movimiento de la seleccion actual.
+ */
+void Canvas::beginStroke(const QPoint &point)
+{
+    if(image->isNull())
+        return;
+
+    if(opLog->isRecording())
+    {
+        logToolState();
+        opLog->writePoint(op_begin, point);
+    }
+
+    drawing = true;
+
+    // La seleccion no modifica el lienzo al presionar, por eso no se copia la imagen.
+    if(currentTool->getType() == selection)
+    {
+        if(selectionTool->isFloating() && selectionTool->contains(point))
+        {
+            selectionTool->beginMove(point);
+            return;
+        }
+        commitPending();
+        if(selectionTool->hasSelection() && selectionTool->contains(point))
+        {
+            selectionTool->beginMove(point);
+            return;
+        }
+        QRect oldRect = selectionTool->getRect();
+        selectionTool->clear();
+        repaint(oldRect.adjusted(-2, -2, +2, +2));
+        selectionTool->setStartPoint(point);
+        return;
+    }
+
+    currentTool->setStartPoint(point);
+    strokeStart = clockTime();
+    strokeRect = QRect();
+    PerfStats::beginStroke();
+
+    // la polilinea del lapicero no toca la capa hasta que termina (commitPolyline), cada trazo agrega un segmento
+    if(currentTool == penTool && currentLineMode == poly)
+    {
+        if(!drawingPoly)
+            penTool->beginPath(point);
+        drawingPoly = true;
+        return;
+    }
+
+    // guarda la anterior imagen a la nueva edicion, la capa pasa a ser una copia en un buffer de la reserva
+    // para que el trazo no reserve memoria nueva.
+    oldImage = *image;
+    *image = BufferPool::instance()->copy(oldImage);
+}
+
+/**
+ * @brief Canvas::moveStroke: Continua el trazo actual hasta "point".
+ *                            -Estira las figuras cuando se estan dibujando.
+ *                            -Estira la linea que se traza con la función lapicero.
+ */
+void Canvas::moveStroke(const QPoint &point)
+{
+    if(!drawing || image->isNull())
+        return;
+
+    if(opLog->isRecording())
+        opLog->writePoint(op_move, point);
+
+    ToolType type = currentTool->getType();
+    if(type == selection)
+    {
+        // La seleccion se despega del lienzo solo cuando realmente se mueve.
+        if(selectionTool->isMoving() && !selectionTool->isFloating())
+            updateCanvas(selectionTool->lift(image, holeColor()));
+        selectionTool->drawTo(point, this, image);
+        return;
+    }
+    if(drawingPoly)
+    {
+        // solo se repinta el segmento activo, encima del lienzo
+        repaint(penTool->moveActive(point));
+        return;
+    }
+    if(type == pen || type == shapes_tool)
+    {
+        // se borra la vista previa anterior copiando solo el area que ocupaba, la capa sigue siendo la misma
+        // copia privada y no se vuelve a duplicar en cada movimiento
+        QRect restore = strokeRect.intersected(image->rect());
+        if(!restore.isEmpty())
+            copyPixels(oldImage, restore, *image, restore.topLeft());
+        layers->invalidate(strokeRect);
+        emit changed(strokeRect);
+        strokeRect = QRect();
+    }
+    currentTool->drawTo(point, this, paintTarget());
+}
+
+/**
+ * @brief Canvas::endStroke: Termina el trazo en "point" y lo guarda en la pila de "undo" y "redo" si cambio la capa.
+ */
+void Canvas::endStroke(const QPoint &point)
+{
+    if(!drawing)
+        return;
+
+    if(opLog->isRecording())
+        opLog->writePoint(op_end, point);
+
+    drawing = false;
+
+    if(image->isNull())
+        return;
+
+    if(currentTool->getType() == selection)
+    {
+        selectionTool->endDrag();
+        return;
+    }
+
+    if(drawingPoly)
+    {
+        // el segmento activo queda fijo donde se solto el boton, la capa no cambia
+        repaint(penTool->moveActive(point));
+        penTool->extendPath(point);
+        PerfStats::endStroke();
+        return;
+    }
+    if(currentTool->getType() == pencil)
+        currentTool->drawTo(point, this, paintTarget());
+    PerfStats::endStroke();
+
+    if(oldImage != *image)
+        saveDrawCommand(oldImage, true);
+    // la imagen anterior ya esta en el comando, no se retiene si el historial la descarta
+    oldImage = QImage();
+}
+
+/**
+ * @brief Canvas::endPolyline: Si en la funcion lapicero se escogio hacer trazos de un poligono, termina la polilinea
+ *                             (doble clic) y la siguiente empieza de nuevo.
+ */
+void Canvas::endPolyline()
+{
+    if(opLog->isRecording())
+        opLog->write(op_end_poly);
+
+    commitPolyline();
+}
+
+/**
+ * @brief Canvas::commitPolyline: Dibuja en la capa la polilinea del lapicero como un solo trazo, con las uniones
+ *                                entre segmentos, y la guarda como un solo paso en la pila de "undo" y "redo".
+ */
+void Canvas::commitPolyline()
+{
+    if(!drawingPoly)
+        return;
+    drawingPoly = false;
+
+    if(image->isNull())
+    {
+        repaint(penTool->clearPath());
+        return;
+    }
+
+    QImage before = *image;
+    *image = BufferPool::instance()->copy(before);
+    QRect dirty = penTool->commitPath(paintTarget());
+    if(dirty.isNull())
+    {
+        *image = before;
+        return;
+    }
+
+    updateCanvas(dirty);
+    saveDrawCommand(before);
+}
+
+/**
+ * @brief Canvas::undo: Devuelve la imagen a su estado antes del utltimo cambio. Cada comando marca sucia solo el
+ *                      area que cambia del cache de la composicion; un giro lo transforma junto con las capas.
+ */
+void Canvas::undo()
+{
+    TRACE_SCOPE("Canvas::undo");
+    if(!undoStack->canUndo())
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_undo);
+
+    commitPending();
+    undoStack->undo();
+    syncActiveLayer();
+    emit changed(QRect());
+}
+
+/**
+ * @brief Canvas::redo: Devuelve la imagen a un estado posterior si se a retrocedido a estados previos.
+ */
+void Canvas::redo()
+{
+    TRACE_SCOPE("Canvas::redo");
+    if(!undoStack->canRedo())
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_redo);
+
+    commitPending();
+    undoStack->redo();
+    syncActiveLayer();
+    emit changed(QRect());
+}
+
+/**
+ * @brief Canvas::copySelection: Devuelve el contenido de la seleccion, una imagen nula si no hay seleccion.
+ */
+QImage Canvas::copySelection()
+{
+    if(image->isNull() || !selectionTool->hasSelection())
+        return QImage();
+
+    return selectionTool->content(*image);
+}
+
+/**
+ * @brief Canvas::cutSelection: Borra la seleccion del lienzo dejando el color de fondo (o transparente fuera del fondo).
+ */
+void Canvas::cutSelection()
+{
+    if(image->isNull() || !selectionTool->hasSelection())
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_cut);
+
+    QRect dirty = selectionTool->lift(image, holeColor());
+    QImage before = selectionTool->takeOriginal();
+    dirty = dirty.united(selectionTool->discard(image));
+    updateCanvas(dirty.adjusted(-2, -2, +2, +2));
+
+    if(!dirty.isNull())
+        saveDrawCommand(before);
+}
+
+/**
+ * @brief Canvas::pasteImage: Pega la imagen como una seleccion flotante en la esquina del lienzo. La imagen se convierte
+ *                            una sola vez al formato de la capa (a su paleta en Indexed8) y se mueve a la seleccion
+ *                            sin copias intermedias, lo cual importa con imagenes grandes.
+ */
+void Canvas::pasteImage(QImage pasted)
+{
+    if(image->isNull() || pasted.isNull())
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_paste) << pasted;
+
+    commitPending();
+
+    pasted = conformTo(std::move(pasted), *image);
+
+    QRect oldRect = selectionTool->getRect();
+    selectionTool->paste(*image, std::move(pasted), QPoint(0, 0));
+    repaint(oldRect.united(selectionTool->getRect()).adjusted(-2, -2, +2, +2));
+}
+
+/**
+ * @brief Canvas::filterArea: Confirma la seleccion flotante y devuelve el area a la que se aplican los filtros y ajustes:
+ *                            la seleccion o, si no hay seleccion, toda la capa.
+ */
+QRect Canvas::filterArea()
+{
+    if(image->isNull())
+        return QRect();
+
+    commitPending();
+    QRect area = selectionTool->hasSelection() ? selectionTool->getRect() : image->rect();
+    return area.intersected(image->rect());
+}
+
+/**
+ * @brief Canvas::applyRegion: Reemplaza un rectangulo de la capa activa y guarda solo ese rectangulo en la pila de
+ *                             "undo" y "redo", al apilarse el comando pinta los pixeles nuevos en la capa. Los
+ *                             filtros y ajustes calculan en 32 bits, en las capas de 8 bits el resultado se reduce
+ *                             al formato de la capa.
+ */
+void Canvas::applyRegion(const QImage &pixels, const QPoint &pos)
+{
+    QRect area(pos, pixels.size());
+    QImage oldPixels = BufferPool::instance()->copy(*image, area);
+    QImage newPixels = conformTo(pixels, *image);
+    undoStack->push(new RegionCommand(oldPixels, newPixels, pos, layers, layers->activeIndex()));
+    updateCanvas(area);
+    updateMemory();
+}
+
+/**
+ * @brief Canvas::applyFilter: Aplica un filtro y espera a que termine. Los mosaicos se siguen procesando en paralelo,
+ *                             la ventana usa FilterJob::start() directamente para no bloquearse.
+ */
+void Canvas::applyFilter(const FilterParams &params)
+{
+    QRect area = filterArea();
+    if(area.isEmpty())
+        return;
+
+    FilterJob job(*image, area, params);
+    job.run();
+    applyFilterResult(job);
+}
+
+/**
+ * @brief Canvas::applyFilterResult: Pinta en la capa activa el resultado de un filtro que ya termino.
+ */
+void Canvas::applyFilterResult(const FilterJob &job)
+{
+    if(opLog->isRecording())
+    {
+        FilterParams params = job.getParams();
+        opLog->write(op_filter) << qint8(params.type) << qint32(params.radius) << qint32(params.amount);
+    }
+
+    applyRegion(job.getResult(), job.getArea().topLeft());
+}
+
+/**
+ * @brief Canvas::applyAdjustments: Aplica los ajustes de color a la seleccion o a todo el lienzo y guarda solo el
+ *                                  rectangulo modificado en la pila de "undo" y "redo".
+ */
+void Canvas::applyAdjustments(const ColorPipeline &pipeline)
+{
+    if(pipeline.isIdentity())
+        return;
+
+    if(opLog->isRecording())
+        pipeline.write(opLog->write(op_adjust));
+
+    QRect area = filterArea();
+    if(area.isEmpty())
+        return;
+
+    QImage pixels = BufferPool::instance()->copy(*image, area).convertToFormat(QImage::Format_ARGB32);
+    pipeline.apply(pixels, pixels.rect());
+    applyRegion(pixels.convertToFormat(QImage::Format_ARGB32_Premultiplied), area.topLeft());
+}
+
+/**
+ * @brief Canvas::repaint: Pide repintar un area sin que haya cambiado ninguna capa (el borde de la seleccion).
+ */
+void Canvas::repaint(const QRect &rect)
+{
+    emit changed(rect);
+}
+
+/**
+ * @brief Canvas::OnPencilSizeConfig:  Este metodo configura el grozor del trazo de la clase "Pencil" que pertenece a la clase
+ *                                       que abstrae la función Lapiz.
+ */
+void Canvas::OnPencilSizeConfig(int value)
+{
+    pencilTool->setWidth(value);
+}
+
+/**
+ * @brief Canvas::OnEraserConfig:  Este metodo configura el grozor de la clase "Eraser" que pertenece a la clase
+ *                                   que abstrae la función Borrador.
+ */
+void Canvas::OnEraserConfig(int value)
+{
+    eraserTool->setWidth(value);
+}
+
+/**
+ * @brief Canvas::OnPenStyleConfig: Cambia el estilo del trazado del objeto Pen
+ *                                   -SolidLine:     linea continua
+ *                                   -DashLine:      linea de lineas espaciadas
+ *                                   -DotLine:       linea punteada
+ *                                   -DashDotLine:   linea de puntos y lineas
+ *                                   -DashDotDotLine:linea de linea-punto-punto-linea
+ *
+ */
+void Canvas::OnPenLineStyleConfig(int lineStyle)
+{
+    switch (lineStyle)
+    {
+        case solid: penTool->setStyle(Qt::SolidLine);                break;
+        case dashed: penTool->setStyle(Qt::DashLine);                break;
+        case dotted: penTool->setStyle(Qt::DotLine);                 break;
+        case dash_dotted: penTool->setStyle(Qt::DashDotLine);        break;
+        case dash_dot_dotted: penTool->setStyle(Qt::DashDotDotLine); break;
+        default:                                                      break;
+    }
+}
+
+/**
+ * @brief Canvas::OnDrawTypeConfig: Configura las dos formas de implementar la funcion Lapicero(Pen)
+ *                                   -single: Traza una linea recta entre dos puntos
+ *                                   -poly: Traza una linea recta entre dos puntos
+ *                                            toomando como punto inicial el ultimo
+ *                                            punto de la ultima recta trazada.
+ */
+void Canvas::OnPenDrawTypeConfig(int drawType)
+{
+    switch (drawType)
+    {
+        case single: setLineMode(single); break;
+        case poly:   setLineMode(poly);   break;
+        default:     break;
+    }
+}
+
+/**
+ * @brief Canvas::OnPenLineThicknessConfig: Configura el grozor del trazo del Objeto Pen.
+ */
+void Canvas::OnPenLineThicknessConfig(int value)
+{
+    penTool->setWidth(value);
+}
+
+/**
+ * @brief Canvas::OnShapesBStyleConfig:  Cambia el estilo del trazado del Objeto Shapes que se encarga de dibujar
+ *                                         alguna de las figuras disponibles.
+ *                                          -SolidLine:     linea continua.
+ *                                          -DashLine:      linea de lineas espaciadas.
+ *                                          -DotLine:       linea punteada.
+ *                                          -DashDotLine:   linea de puntos y lineas.
+ *                                          -DashDotDotLine:linea de linea-punto-punto-linea.
+ */
+void Canvas:: OnShapesBStyleConfig(int boundaryStyle)
+{
+    switch (boundaryStyle)
+    {
+        case solid: shapesTool->setStyle(Qt::SolidLine);                break;
+        case dashed: shapesTool->setStyle(Qt::DashLine);                break;
+        case dotted: shapesTool->setStyle(Qt::DotLine);                 break;
+        case dash_dotted: shapesTool->setStyle(Qt::DashDotLine);        break;
+        case dash_dot_dotted: shapesTool->setStyle(Qt::DashDotDotLine); break;
+        default:                                                      break;
+    }
+}
+
+/**
+ * @brief Canvas::OnSelectShapeTypeConfig: Este metodo se encarga de asignar el tipo de figura
+ *                                           que debe dibujar el objeto Shapes.
+ *
+ */
+void Canvas::OnSelectShapeTypeConfig(int shape)
+{
+    switch (shape)
+    {
+        case rectangle: shapesTool->setShapeType(rectangle);        break;
+        case ellipse: shapesTool->setShapeType(ellipse);        break;
+        case triangle: shapesTool->setShapeType(triangle);        break;
+    default:                                                           break;
+    }
+}
+
+/**
+ * @brief Canvas::OnShapesFillConfig:  Este metodo se encarga de configurar el relleno de las figuras geometricas.
+ *                                       -foregraund: Dibuja una figura rellena de un mismo color al de sus bordes.
+ *                                       -background: Dibuja una figura con el relleno del mismo color del fondo del lienzo.
+ *                                       -no_fil:     Dibuja una figura sin relleno.
+ */
+void Canvas::OnShapesFillConfig(int fillType)
+{
+    switch (fillType)
+    {
+        case foreground: shapesTool->setFillMode(foreground);
+                         syncColors();                                   break;
+        case background: shapesTool->setFillMode(background);
+                         syncColors();                                   break;
+        case no_fill: shapesTool->setFillMode(no_fill);
+                      shapesTool->setFillColor(QColor(Qt::transparent)); break;
+        default:                                                       break;
+    }
+}
+
+/**
+ * @brief Canvas::OnShapesBTypeConfig: - Update rectangle join style
+ *
+ */
+void Canvas::OnShapesBTypeConfig(int boundaryType)
+{
+    switch (boundaryType)
+    {
+        case miter_join: shapesTool->setJoinStyle(Qt::MiterJoin);  break;
+        case bevel_join: shapesTool->setJoinStyle(Qt::BevelJoin);  break;
+        case round_join: shapesTool->setJoinStyle(Qt::RoundJoin);  break;
+        default:                                                 break;
+    }
+}
+
+/**
+ * @brief Canvas::OnShapesLineConfig: Este metodo confugra el grozor del trazo de las figuras.
+ */
+void Canvas::OnShapesLineConfig(int value)
+{
+    shapesTool->setWidth(value);
+}
+
+/**
+ * @brief Canvas::createNewImage: Meto que crea el nuevo lienzo, una sola capa de fondo del tamaño y el formato de
+ *                                  pixeles indicados a la cual apunta la variable "image".
+ */
+void Canvas::createNewImage(const QSize &size, PixelFormat format)
+{
+    if(opLog->isRecording())
+        opLog->write(op_new_image) << size << qint8(format);
+
+    commitPending();
+    selectionTool->clear();
+
+    // guarda el estado de las capas antes del cambio
+    LayerStack::Snapshot before = layers->snapshot();
+    int beforeActive = layers->activeIndex();
+
+    QImage background = createLayerImage(size, format);
+    spanFill(background, background.rect(), backgroundColor);
+    layers->reset(background);
+    syncActiveLayer();
+    emit changed(QRect());
+
+    // for undo/redo
+    if(before.size() != 1 || !imagesEqual(before.first().image, *image))
+        saveStackCommand(before, beforeActive);
+}
+
+/**
+ * @brief Canvas::loadImage: Este metodo se encarga de abrir una imagen que este en el equipo, siempre
+ *                             que esté en un formato que Qt pueda leer. La imagen reemplaza todas las capas.
+ */
+bool Canvas::loadImage(const QString &fileName)
+{
+    TRACE_SCOPE("Canvas::loadImage");
+    // BMP con RLE, PNG y QOI se decodifican mientras se leen, los demas formatos los lee Qt
+    QImage loaded = readImageFile(fileName);
+    if(loaded.isNull())
+        return false;
+
+    openImage(loaded);
+    return true;
+}
+
+/**
+ * @brief Canvas::openImage: Reemplaza todas las capas por la imagen, se puede deshacer.
+ */
+void Canvas::openImage(const QImage &loaded)
+{
+    if(opLog->isRecording())
+        opLog->write(op_load_image) << loaded;
+
+    commitPending();
+    selectionTool->clear();
+
+    // guarda el estado de las capas antes de que se cagrgue la imagen.
+    LayerStack::Snapshot before = layers->snapshot();
+    int beforeActive = layers->activeIndex();
+
+    layers->reset(loaded);
+    syncActiveLayer();
+    emit changed(QRect());
+
+    // Guarda la copia hecha antes, en la lista que almacena
+    //los estados para los comandos "undo" y "redo".
+    if(before.size() != 1 || !imagesEqual(before.first().image, *image))
+        saveStackCommand(before, beforeActive);
+}
+
+/**
+ * @brief Canvas::saveImage: Este metodo guarda todo lo realizado en el editor de imagenes con todas las capas
+ *                           visibles combinadas, en el formato pedido o, si no se pide, en el de la extension
+ *                           del archivo (Bitmap si no tiene). Los formatos sin canal alfa se guardan opacos. Un
+ *                           documento de 8 bits se guarda tal cual, un BMP de 8 bits con su paleta.
+ */
+bool Canvas::saveImage(const QString &fileName, const char *format)
+{
+    TRACE_SCOPE("Canvas::saveImage");
+    commitPending();
+    const QByteArray type = format ? QByteArray(format).toUpper() : imageFormatOf(fileName);
+    QImage flat = layers->flatten();
+    if(flat.depth() == 8)
+        return writeImageFile(fileName, type == "BMP" ? indexedImage(flat) : flat, type);
+    if(type == "BMP" || type == "JPG" || type == "JPEG")
+        flat = flat.convertToFormat(QImage::Format_RGB32);
+    else
+        flat = flat.convertToFormat(QImage::Format_ARGB32);
+    return writeImageFile(fileName, flat, type);
+}
+
+/**
+ * @brief Canvas::exportIndexed: Guarda las capas visibles combinadas en un BMP de 8 bits, con una paleta de
+ *                               PALETTE_SIZE colores calculada para la imagen (quantizeImage) y el tramado pedido.
+ *                               Un documento de 8 bits ya tiene su paleta y se guarda como en saveImage. Con "rle"
+ *                               se comprime con BI_RLE8, o BI_RLE4 si alcanzan 16 colores.
+ */
+bool Canvas::exportIndexed(const QString &fileName, DitherMode dither, bool rle)
+{
+    TRACE_SCOPE("Canvas::exportIndexed");
+    commitPending();
+    QImage flat = layers->flatten();
+    QImage indexed = flat.depth() == 8 ? indexedImage(flat) : quantizeImage(flat, PALETTE_SIZE, dither);
+    if(!rle)
+        return indexed.save(fileName, "BMP");
+
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly) && writeRleBmp(&file, indexed);
+}
+
+/**
+ * @brief Canvas::resizeImage: Este metodo se encarga de reconfigurar las dimensiones de todas las capas
+ *                               que hacen de lienzo.
+ */
+void Canvas::resizeImage(const QSize &size)
+{
+    TRACE_SCOPE("Canvas::resizeImage");
+    if(opLog->isRecording())
+        opLog->write(op_resize) << size;
+
+    commitPending();
+    selectionTool->clear();
+
+    // Se evalua si no hayc cambios algunos en la escogencia del usuario
+    // para no hacer nada.
+    if(image->size() == size)
+    {
+        return;
+    }
+
+    // Guarda el estado de las capas antes de que se realicen los cambios.
+    LayerStack::Snapshot before = layers->snapshot();
+    int beforeActive = layers->activeIndex();
+
+    // "Si no" erealiza los cambios en las dimensiones
+    layers->scale(size);
+    syncActiveLayer();
+    emit changed(QRect());
+    // Guarda la copia hecha antes, en la lista que almacena
+    //los estados para los comandos "undo" y "redo".
+    saveStackCommand(before, beforeActive);
+}
+
+/**
+ * @brief Canvas::transformImage: Gira o refleja todas las capas. El comando de "undo" solo recuerda la transformacion,
+ *                                deshacer aplica la inversa en lugar de restaurar copias de las capas.
+ */
+void Canvas::transformImage(ImageTransform transform)
+{
+    TRACE_SCOPE("Canvas::transformImage");
+    if(opLog->isRecording())
+        opLog->write(op_transform) << qint8(transform);
+
+    commitPending();
+    selectionTool->clear();
+
+    // push() llama a redo(), que aplica la transformacion
+    undoStack->push(new TransformCommand(transform, layers));
+    syncActiveLayer();
+    emit changed(QRect());
+    updateMemory();
+}
+
+/**
+ * @brief Canvas::clearImage: Borra todo lo hecho en la capa activa del editor de imagenes.
+ */
+void Canvas::clearImage()
+{
+    if(opLog->isRecording())
+        opLog->write(op_clear);
+
+    commitPending();
+    selectionTool->clear();
+
+    // Guarda una copia de "image" antes de que se realicen los cambios.
+    oldImage = *image;
+    if(!spanFill(*image, image->rect(), holeColor()))
+        image->fill(holeColor());
+    updateCanvas(image->rect());
+    // Guarda la copia hecha antes, en la lista que almacena
+    //los estados para los comandos "undo" y "redo".
+    if(!imagesEqual(oldImage, *image))
+        saveDrawCommand(oldImage);
+    oldImage = QImage();
+}
+
+/**
+ * @brief Canvas::commitPending: Termina lo que todavia no esta en la capa (la polilinea del lapicero y la seleccion
+ *                               flotante) antes de una operacion que cambia el documento.
+ */
+void Canvas::commitPending()
+{
+    commitPolyline();
+    commitSelection();
+}
+
+/**
+ * @brief Canvas::commitSelection: Si hay una seleccion flotante la pinta en el lienzo y guarda el cambio en la
+ *                                   pila de "undo" y "redo".
+ */
+void Canvas::commitSelection()
+{
+    if(!selectionTool->isFloating())
+        return;
+
+    QImage before = selectionTool->takeOriginal();
+    QRect dirty = selectionTool->commit(image);
+    updateCanvas(dirty.adjusted(-2, -2, +2, +2));
+    saveDrawCommand(before);
+}
+
+/**
+ * @brief Canvas::updateCanvas: Marca sucia el area modificada en el cache de las capas y la repinta. Tambien
+ *                                acumula el area del trazo actual en "strokeRect".
+ */
+void Canvas::updateCanvas(const QRect &rect)
+{
+    strokeRect = strokeRect.united(rect);
+    layers->invalidate(rect);
+    emit changed(rect);
+}
+
+/**
+ * @brief Canvas::syncActiveLayer: Hace que "image" apunte a la imagen de la capa activa, se llama despues
+ *                                   de cualquier cambio en la pila de capas. El formato de la capa puede haber
+ *                                   cambiado, tambien se actualizan los colores de las herramientas.
+ */
+void Canvas::syncActiveLayer()
+{
+    image = &layers->activeLayer()->image;
+    syncColors();
+    emit layersChanged();
+}
+
+/**
+ * @brief Canvas::syncColors: Pasa los colores de frente y fondo a las herramientas. En las capas Indexed8 las
+ *                            herramientas pintan con el indice del color mas cercano de la paleta (inkColor).
+ */
+void Canvas::syncColors()
+{
+    QColor foreInk = inkColor(*image, foregroundColor);
+    QColor backInk = inkColor(*image, backgroundColor);
+    pencilTool->setColor(foreInk);
+    penTool->setColor(foreInk);
+    shapesTool->setColor(foreInk);
+    eraserTool->setColor(backInk);
+
+    if(shapesTool->getFillMode() == foreground)
+        shapesTool->setFillColor(foreInk);
+    else if(shapesTool->getFillMode() == background)
+        shapesTool->setFillColor(backInk);
+}
+
+/**
+ * @brief Canvas::paintTarget: La imagen sobre la que pintan las herramientas: la capa activa o, si es Indexed8
+ *                             (QPainter no pinta sobre ella), sus mismos bytes vistos como Grayscale8 (inkView). Se
+ *                             pide justo antes de pintar, despues de que la capa ya es una copia propia del trazo.
+ */
+QImage* Canvas::paintTarget()
+{
+    if(image->format() != QImage::Format_Indexed8)
+        return image;
+
+    indexView = inkView(*image);
+    return &indexView;
+}
+
+/**
+ * @brief Canvas::paintPolyline: Pinta encima del lienzo la polilinea del lapicero que todavia no esta en la capa,
+ *                               con el color que va a tener en la capa.
+ */
+void Canvas::paintPolyline(QPainter &painter, const QRect &exposed)
+{
+    penTool->paint(painter, exposed, shownColor(*image, foregroundColor));
+}
+
+/**
+ * @brief Canvas::holeColor: Color con el que se borra en la capa activa, el fondo es opaco y las demas
+ *                             capas quedan transparentes.
+ */
+QColor Canvas::holeColor()
+{
+    return layers->activeIndex() == 0 ? backgroundColor : QColor(Qt::transparent);
+}
+
+/**
+ * @brief Canvas::OnAddLayer: Agrega una capa transparente encima de la capa activa. Los documentos de 8 bits tienen
+ *                            una sola capa.
+ */
+void Canvas::OnAddLayer()
+{
+    if(layers->pixelFormat() != rgb_pixels)
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_add_layer);
+
+    commitPending();
+    selectionTool->clear();
+
+    LayerStack::Snapshot before = layers->snapshot();
+    int beforeActive = layers->activeIndex();
+
+    layers->addLayer(tr("Capa %1").arg(layers->count()));
+    syncActiveLayer();
+    emit changed(QRect());
+    saveStackCommand(before, beforeActive);
+}
+
+/**
+ * @brief Canvas::OnRemoveLayer: Elimina la capa activa, el fondo solo se puede eliminar si hay otras capas.
+ */
+void Canvas::OnRemoveLayer()
+{
+    if(layers->count() == 1)
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_remove_layer);
+
+    commitPending();
+    selectionTool->clear();
+
+    LayerStack::Snapshot before = layers->snapshot();
+    int beforeActive = layers->activeIndex();
+
+    layers->removeLayer(beforeActive);
+    syncActiveLayer();
+    emit changed(QRect());
+    saveStackCommand(before, beforeActive);
+}
+
+void Canvas::OnLayerUp()
+{
+    if(layers->activeIndex() + 1 >= layers->count())
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_layer_up);
+
+    commitPending();
+    LayerStack::Snapshot before = layers->snapshot();
+    int beforeActive = layers->activeIndex();
+
+    layers->moveLayer(beforeActive, +1);
+    syncActiveLayer();
+    emit changed(QRect());
+    saveStackCommand(before, beforeActive);
+}
+
+void Canvas::OnLayerDown()
+{
+    if(layers->activeIndex() == 0)
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_layer_down);
+
+    commitPending();
+    LayerStack::Snapshot before = layers->snapshot();
+    int beforeActive = layers->activeIndex();
+
+    layers->moveLayer(beforeActive, -1);
+    syncActiveLayer();
+    emit changed(QRect());
+    saveStackCommand(before, beforeActive);
+}
+
+/**
+ * @brief Canvas::OnSelectLayer: Cambia la capa activa, no se guarda en la pila de "undo".
+ */
+void Canvas::OnSelectLayer(int index)
+{
+    if(index == layers->activeIndex() || index < 0 || index >= layers->count())
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_select_layer) << qint32(index);
+
+    commitPending();
+    selectionTool->clear();
+    layers->setActiveIndex(index);
+    syncActiveLayer();
+    emit changed(QRect());
+}
+
+/**
+ * @brief Canvas::OnLayerOpacity: Cambia la opacidad de la capa activa. El deslizador emite un valor por cada
+ *                                  paso, por eso este cambio no se guarda en la pila de "undo".
+ */
+void Canvas::OnLayerOpacity(int value)
+{
+    Layer *layer = layers->activeLayer();
+    if(layer->opacity == value)
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_layer_opacity) << qint32(value);
+
+    layer->opacity = qBound(0, value, int(MAX_LAYER_OPACITY));
+    layers->invalidateAll();
+    emit changed(QRect());
+}
+
+void Canvas::OnLayerBlendMode(int mode)
+{
+    Layer *layer = layers->activeLayer();
+    if(layer->mode == mode || mode < normal_blend || mode > add_blend)
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_layer_blend) << qint32(mode);
+
+    LayerStack::Snapshot before = layers->snapshot();
+    layer->mode = BlendMode(mode);
+    layers->invalidateAll();
+    emit changed(QRect());
+    saveStackCommand(before, layers->activeIndex());
+}
+
+void Canvas::OnLayerVisibility(bool visible)
+{
+    Layer *layer = layers->activeLayer();
+    if(layer->visible == visible)
+        return;
+
+    if(opLog->isRecording())
+        opLog->write(op_layer_visibility) << visible;
+
+    LayerStack::Snapshot before = layers->snapshot();
+    layer->visible = visible;
+    layers->invalidateAll();
+    emit changed(QRect());
+    saveStackCommand(before, layers->activeIndex());
+}
+
+/**
+ * @brief Canvas::updateColorConfig: Este metodo se encarga de asignar los valores de los calores a las variables que se encargan
+ *                                     tanto del color del fondo del lienzo como del
+ *                                     color de los trazos.
+ *                                     -foreground: variable que almacena el color de los trazos.
+ *                                     -background: variable que almacena el color del fonmdo del lienzo.
+ */
+void Canvas::updateColorConfig(const QColor &color, int which)
+{
+    if(opLog->isRecording())
+        opLog->write(op_color) << color << qint8(which);
+
+    if(which == foreground)
+        foregroundColor = color;
+    else
+        backgroundColor = color;
+    syncColors();
+}
+
+/**
+ * @brief Canvas::setCurrentTool: Este metdo despoues de recibir cual herramienta
+ *                                  se selecciona segun el boton que se encarga de esto
+ *                                  se lo asigna "currentool" que es lña variable que se
+ *                                  encarga de guardar cual herramienta se seleccionó.
+ *
+ */
+Tool* Canvas::setCurrentTool(int newType)
+{
+    // get the current tool's type
+    int currType = currentTool->getType();
+
+    // if no change, return --else cancel poly mode & set tool
+    if(newType == currType)
+        return currentTool;
+
+    if(opLog->isRecording())
+        opLog->write(op_select_tool) << qint8(newType);
+
+    if(currType == pen)
+        commitPolyline();
+
+    if(currType == selection)
+    {
+        commitPending();
+        selectionTool->clear();
+        emit changed(QRect());
+    }
+
+    switch(newType)
+    {
+        case pencil: currentTool = pencilTool;        break;
+        case pen: currentTool = penTool;      break;
+        case eraser: currentTool = eraserTool;  break;
+        case shapes_tool: currentTool = shapesTool; break;
+        case selection: currentTool = selectionTool; break;
+        default:                                break;
+    }
+    return currentTool;
+}
+
+/**
+ * @brief Canvas::setPenMode:
+ */
+void Canvas::setLineMode(const DrawType mode)
+{
+    if(opLog->isRecording())
+        opLog->write(op_line_mode) << qint8(mode);
+
+    if(mode == single)
+        commitPolyline();
+
+    currentLineMode = mode;
+}
+
+/**
+ * @brief Canvas::SaveDrawCommand: Se encarga de apilar objetos de tipo UndoCommand, dentor de la pila undoStack, que es la que se encarga de almacenar los dieferentes estados del lienzo
+ *                                   para hacer las funciones "undo" y "redo".
+ *
+ */
+void Canvas::saveDrawCommand(const QImage &old_image, bool mergeable)
+{
+    TRACE_SCOPE("Canvas::saveDrawCommand");
+    // put the old and new image on the stack for undo/redo
+    DrawCommand *drawCommand = new DrawCommand(old_image, layers, layers->activeIndex());
+    if(mergeable)
+        drawCommand->setMergeInfo(currentTool->getType(), strokeStart, clockTime());
+    undoStack->push(drawCommand);
+    updateMemory();
+}
+
+/**
+ * @brief Canvas::memoryReport: Memoria del documento por categoria. Las imagenes que el historial comparte con las
+ *                              capas solo se cuentan en el lienzo, y la imagen anterior del trazo normalmente es la
+ *                              misma que guarda el ultimo comando.
+ */
+MemoryReport Canvas::memoryReport() const
+{
+    QSet<qint64> seen;
+    MemoryReport report;
+    report.canvas = layers->byteCount(&seen);
+    report.caches = layers->cacheBytes(&seen);
+    report.history = undoStack->byteCount(&seen);
+    report.previews = imageBytes(oldImage, &seen) + selectionTool->byteCount(&seen);
+    return report;
+}
+
+/**
+ * @brief Canvas::updateMemory: Publica la memoria del documento y, si entre todos los documentos se pasa del
+ *                              presupuesto, vacia la reserva de buffers, deja liberar a los otros documentos
+ *                              (overBudget) y, si no alcanza, comprime los comandos mas viejos del historial y por
+ *                              ultimo los descarta.
+ */
+void Canvas::updateMemory()
+{
+    MemoryAccountant *accountant = MemoryAccountant::instance();
+    accountant->update(this, memoryReport());
+
+    if(accountant->overBudget())
+        BufferPool::instance()->trim();
+    if(accountant->overBudget())
+        emit overBudget();
+
+    while(accountant->overBudget())
+    {
+        if(!undoStack->compactOldest() && !undoStack->dropOldest())
+            break;
+        accountant->update(this, memoryReport());
+    }
+}
+
+/**
+ * @brief Canvas::releaseCaches: Libera el cache de la composicion, para los documentos que no se estan mostrando.
+ */
+void Canvas::releaseCaches()
+{
+    if(layers->releaseCache())
+        MemoryAccountant::instance()->update(this, memoryReport());
+}
+
+/**
+ * @brief Canvas::trimMemory: Libera un paso de memoria, primero el cache de la composicion, despues compacta el
+ *                            historial y por ultimo descarta el paso mas antiguo. Devuelve falso si ya no queda nada.
+ */
+bool Canvas::trimMemory()
+{
+    if(!layers->releaseCache() && !undoStack->compactOldest() && !undoStack->dropOldest())
+        return false;
+
+    MemoryAccountant::instance()->update(this, memoryReport());
+    return true;
+}
+
+/**
+ * @brief Canvas::saveStackCommand: Apila un cambio en la estructura de las capas (nueva imagen, cargar, redimensionar,
+ *                                    agregar o quitar capas) guardando el estado anterior completo.
+ */
+void Canvas::saveStackCommand(const LayerStack::Snapshot &before, int beforeActive)
+{
+    // push() llama a redo(), que rearma la lista de capas, por eso "image" se vuelve a enlazar
+    undoStack->push(new StackCommand(before, beforeActive, layers));
+    syncActiveLayer();
+    updateMemory();
+}
+
+/**
+ * @brief Canvas::clockTime: Milisegundos para decidir si dos trazos se unen en la pila de "undo". Mientras se graba se
+ *                           usa el tiempo del registro y al reproducir el tiempo grabado, asi el registro une los
+ *                           mismos trazos al reproducirse a cualquier velocidad.
+ */
+qint64 Canvas::clockTime() const
+{
+    if(replayTime >= 0)
+        return replayTime;
+    if(opLog->isRecording())
+        return opLog->lastTimestamp();
+    return clock.elapsed();
+}
+
+/**
+ * @brief Canvas::startRecording: Empieza a grabar las operaciones. El primer registro es el estado completo del
+ *                                documento para que la reproduccion no dependa de lo que habia antes.
+ */
+void Canvas::startRecording()
+{
+    commitPending();
+    // al reproducir la pila empieza vacia, el primer trazo grabado tampoco se une con los anteriores
+    undoStack->breakMerge();
+    opLog->start();
+    writeSnapshot(opLog->write(op_snapshot));
+}
+
+void Canvas::stopRecording()
+{
+    opLog->stop();
+}
+
+/**
+ * @brief Canvas::writeSnapshot: Guarda las capas, los colores y la herramienta actual.
+ */
+void Canvas::writeSnapshot(QDataStream &out)
+{
+    writeState(out, saveState());
+}
+
+/**
+ * @brief Canvas::saveState: Copia (compartida) de lo que guarda writeSnapshot, se puede escribir en otro hilo mientras
+ *                           se sigue dibujando.
+ */
+Canvas::State Canvas::saveState() const
+{
+    State state;
+    state.layers = layers->snapshot();
+    state.active = layers->activeIndex();
+    state.foreground = foregroundColor;
+    state.background = backgroundColor;
+    state.tool = currentTool->getType();
+    state.lineMode = currentLineMode;
+    return state;
+}
+
+void Canvas::writeState(QDataStream &out, const State &state)
+{
+    out << qint32(state.layers.count()) << qint32(state.active);
+    for(const Layer &layer : state.layers)
+        out << layer.name << layer.image << qint32(layer.opacity) << qint8(layer.mode) << layer.visible;
+    out << state.foreground << state.background << qint8(state.tool) << qint8(state.lineMode);
+}
+
+/**
+ * @brief Canvas::readSnapshot: Vuelve al estado guardado con writeSnapshot(). La pila de "undo" se vacia porque sus
+ *                              comandos ya no corresponden a las capas reproducidas.
+ */
+void Canvas::readSnapshot(QDataStream &in)
+{
+    qint32 count = 0, active = 0;
+    in >> count >> active;
+
+    LayerStack::Snapshot state;
+    for(int i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        Layer layer;
+        qint32 opacity = 0;
+        qint8 mode = 0;
+        in >> layer.name >> layer.image >> opacity >> mode >> layer.visible;
+        layer.image = layerImage(layer.image);
+        layer.opacity = opacity;
+        layer.mode = BlendMode(mode);
+        state.append(layer);
+    }
+
+    QColor foreground, background;
+    qint8 tool = 0, lineMode = 0;
+    in >> foreground >> background >> tool >> lineMode;
+    if(in.status() != QDataStream::Ok || state.isEmpty())
+        return;
+
+    selectionTool->clear();
+    drawing = false;
+    drawingPoly = false;
+    repaint(penTool->clearPath());
+    undoStack->clear();
+    layers->restore(state, active);
+    syncActiveLayer();
+
+    updateColorConfig(foreground, ::foreground);
+    updateColorConfig(background, ::background);
+    setCurrentTool(tool);
+    setLineMode(DrawType(lineMode));
+    emit changed(QRect());
+}
+
+/**
+ * @brief Canvas::logToolState: Graba el tipo de herramienta y su trazo (QPen) antes de cada trazo, asi la
+ *                              reproduccion no depende de los dialogos de configuracion.
+ */
+void Canvas::logToolState()
+{
+    QDataStream &out = opLog->write(op_tool_state);
+    out << qint8(currentTool->getType()) << static_cast<const QPen&>(*currentTool);
+    if(currentTool->getType() == shapes_tool)
+        out << qint8(shapesTool->getShapeType()) << qint8(shapesTool->getFillMode()) << shapesTool->getFillColor();
+}
+
+/**
+ * @brief Canvas::createTools: Este metodo es el que se encarga d e instanciar los objetos
+ *                               que son las herramientas del Paint++.
+ *                               -PencilTool: Objeto que se encarga de la función Lapiz.
+ *                               -PenTool: Objeto que se encarda de la función Lapicero.
+ *                               -EraserTool: Objeto que se encarga de la función Borrador.
+ *                               -ShapesTool: Objeto que se encarga de dibujar las tres diferentes figuras
+ *                                            rectangulo, círculo y triángulo.
+ */
+void Canvas::createTools()
+{
+    // create the tools
+    pencilTool = new PencilTool(QBrush(Qt::black), DEFAULT_PEN_THICKNESS);
+    penTool = new PenTool(QBrush(Qt::black), DEFAULT_PEN_THICKNESS);
+    eraserTool = new EraserTool(QBrush(Qt::white), DEFAULT_ERASER_THICKNESS);
+    shapesTool = new ShapesTool(QBrush(Qt::black), DEFAULT_PEN_THICKNESS);
+    selectionTool = new SelectionTool(QBrush(Qt::black), 1);
+    // set default tool
+    currentTool = static_cast<Tool*>(pencilTool);
+}
+
+/**
+ * @brief imagesEqual: Este metodo antes de agregar el ultimo estado de "image", a la pila que guarda los estados para los
+ *                      comandos "undo" y "redo", que el nuevo esatdo a guardar no sea igual que el ultimo que se guardo,
+ *                      para asi evitar guardarlo dos veces
+**/
+
+bool imagesEqual(const QImage &image1, const QImage &image2)
+{
+    return image1 == image2;
+}
+
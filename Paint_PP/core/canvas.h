@@ -0,0 +1,183 @@
+#ifndef CANVAS_H
+#define CANVAS_H
+
+#include <QObject>
+#include <QImage>
+#include <QColor>
+#include <QElapsedTimer>
+
+#include "constants.h"
+#include "tool.h"
+#include "layers.h"
+#include "filters.h"
+#include "adjustments.h"
+#include "undo_stack.h"
+#include "op_log.h"
+#include "memory_accountant.h"
+
+
+class QPainter;
+
+
+/**
+ * Canvas: El documento que se edita: las capas, las herramientas, la pila de "undo" y "redo" y toda la logica de los
+ * trazos. No depende de QtWidgets, la ventana (DrawArea) solo le pasa los eventos del mouse y repinta lo que indica
+ * la senal "changed", y la herramienta de linea de comandos lo usa sin ventana.
+ */
+class Canvas : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** Estado que guarda un "snapshot" del registro de operaciones. */
+    struct State
+    {
+        LayerStack::Snapshot layers;
+        int active;
+        QColor foreground;
+        QColor background;
+        int tool;
+        int lineMode;
+    };
+
+    Canvas(QObject *parent = 0);
+    ~Canvas();
+
+    QImage* getImage() { return image; }
+    LayerStack* getLayers() { return layers; }
+    UndoStack* getUndoStack() { return undoStack; }
+    OpLog* getOpLog() { return opLog; }
+    Tool* getCurrentTool() const { return currentTool; }
+    bool isIdle() const { return !drawing && !drawingPoly && !selectionTool->hasSelection(); }
+    SelectionTool* getSelectionTool() const { return selectionTool; }
+    PenTool* getPenTool() const { return penTool; }
+    QColor getForegroundColor() { return foregroundColor; }
+    QColor getBackgroundColor() { return backgroundColor; }
+    Tool* setCurrentTool(int);
+    void setLineMode(const DrawType mode);
+    void updateColorConfig(const QColor&, int);
+
+    void beginStroke(const QPoint&);
+    void moveStroke(const QPoint&);
+    void endStroke(const QPoint&);
+    void endPolyline();
+    void paintPolyline(QPainter&, const QRect&);
+
+    void createNewImage(const QSize&, PixelFormat format = rgb_pixels);
+    bool loadImage(const QString&);
+    void openImage(const QImage&);
+    bool saveImage(const QString&, const char *format = 0);
+    bool exportIndexed(const QString&, DitherMode dither = no_dither, bool rle = false);
+    void resizeImage(const QSize&);
+    void transformImage(ImageTransform);
+    void clearImage();
+    void undo();
+    void redo();
+
+    void commitPending();
+    void commitSelection();
+    QImage copySelection();
+    void cutSelection();
+    void pasteImage(QImage);
+
+    QRect filterArea();
+    void applyRegion(const QImage&, const QPoint&);
+    void applyFilter(const FilterParams&);
+    void applyFilterResult(const FilterJob&);
+    void applyAdjustments(const ColorPipeline&);
+
+    MemoryReport memoryReport() const;
+    void updateMemory();
+    void releaseCaches();
+    bool trimMemory();
+
+    void saveDrawCommand(const QImage&, bool mergeable = false);
+    void saveStackCommand(const LayerStack::Snapshot&, int);
+    void updateCanvas(const QRect&);
+    void repaint(const QRect&);
+
+    void setReplayTime(qint64 msecs) { replayTime = msecs; }
+    void startRecording();
+    void stopRecording();
+    void writeSnapshot(QDataStream&);
+    void readSnapshot(QDataStream&);
+    State saveState() const;
+    static void writeState(QDataStream&, const State&);
+
+public slots:
+    void OnAddLayer();
+    void OnRemoveLayer();
+    void OnLayerUp();
+    void OnLayerDown();
+    void OnSelectLayer(int);
+    void OnLayerOpacity(int);
+    void OnLayerBlendMode(int);
+    void OnLayerVisibility(bool);
+
+    void OnPencilSizeConfig(int);
+
+    void OnEraserConfig(int);
+
+    void OnPenLineStyleConfig(int);
+    void OnPenDrawTypeConfig(int);
+    void OnPenLineThicknessConfig(int);
+
+    void OnShapesBStyleConfig(int);
+    void OnSelectShapeTypeConfig(int);
+    void OnShapesFillConfig(int);
+    void OnShapesBTypeConfig(int);
+    void OnShapesLineConfig(int);
+
+signals:
+    /** Un area que hay que repintar, un rectangulo nulo significa todo el lienzo. */
+    void changed(const QRect&);
+    void layersChanged();
+    /** El total paso del presupuesto, antes de reducir su propio historial se deja liberar a otros documentos. */
+    void overBudget();
+
+private:
+    void createTools();
+    void commitPolyline();
+    void syncActiveLayer();
+    void syncColors();
+    QImage* paintTarget();
+    void logToolState();
+    QColor holeColor();
+    qint64 clockTime() const;
+
+    UndoStack* undoStack;
+    OpLog* opLog;
+
+    Tool* currentTool;
+    DrawType currentLineMode;
+
+    LayerStack* layers;
+    QImage* image;
+    QImage oldImage;
+    QImage indexView;       // la capa Indexed8 vista como Grayscale8, ver paintTarget()
+    QRect strokeRect;
+
+    QColor foregroundColor;
+    QColor backgroundColor;
+
+    PencilTool* pencilTool;
+    PenTool* penTool;
+    EraserTool* eraserTool;
+    ShapesTool* shapesTool;
+    SelectionTool* selectionTool;
+
+    bool drawing;
+    bool drawingPoly;
+
+    // para unir trazos seguidos en la pila de "undo"
+    QElapsedTimer clock;
+    qint64 replayTime;
+    qint64 strokeStart;
+
+    Canvas(const Canvas&);
+    Canvas& operator=(const Canvas&);
+};
+
+extern bool imagesEqual(const QImage& image1, const QImage& image2);
+
+#endif // CANVAS_H
@@ -0,0 +1,313 @@
+#include <cstring>
+
+#include "commands.h"
+#include "pixel_format.h"
+#include "qrect.h"
+#include "transform.h"
+
+
+/**
+ * @brief pastePixels: Reemplaza (sin mezclar) los pixeles de la capa en "pos" y marca el area para recomponer. Los
+ *                     pixeles guardados estan en el formato de la capa, se copian fila por fila.
+ */
+static void pastePixels(LayerStack *layers, int index, const QImage &pixels, const QPoint &pos)
+{
+    if(pixels.isNull())
+        return;
+
+    copyPixels(pixels, pixels.rect(), layers->layer(index)->image, pos);
+
+    layers->setActiveIndex(index);
+    layers->invalidate(QRect(pos, pixels.size()));
+}
+
+/**
+ * @brief differenceRect: El menor rectangulo que contiene todos los pixeles distintos entre dos imagenes del mismo
+ *                        tamaño y formato, "Pixel" es quint32 para las capas de 32 bits y quint8 para las de 8.
+ */
+template <typename Pixel>
+static QRect differenceRect(const QImage &first, const QImage &second)
+{
+    int top = -1, bottom = -1, left = first.width(), right = -1;
+    for(int y = 0; y < first.height(); ++y)
+    {
+        const Pixel *a = reinterpret_cast<const Pixel*>(first.constScanLine(y));
+        const Pixel *b = reinterpret_cast<const Pixel*>(second.constScanLine(y));
+        if(memcmp(a, b, first.width() * sizeof(Pixel)) == 0)
+            continue;
+
+        if(top < 0)
+            top = y;
+        bottom = y;
+
+        int x = 0;
+        while(x < left && a[x] == b[x])
+            ++x;
+        left = qMin(left, x);
+
+        x = first.width() - 1;
+        while(x > right && a[x] == b[x])
+            --x;
+        right = qMax(right, x);
+    }
+
+    if(top < 0)
+        return QRect();
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+/**
+ * @brief PackedPixels::pack: Comprime el rectangulo "rect" de la imagen.
+ */
+PackedPixels PackedPixels::pack(const QImage &image, const QRect &rect)
+{
+    PackedPixels packed;
+    packed.rect = rect;
+    packed.format = image.format();
+    if(rect.isEmpty())
+        return packed;
+
+    QImage piece = image.copy(rect);
+    packed.data = qCompress(piece.constBits(), int(piece.sizeInBytes()), 1);
+    return packed;
+}
+
+QImage PackedPixels::unpack() const
+{
+    if(rect.isEmpty())
+        return QImage();
+
+    QByteArray raw = qUncompress(data);
+    QImage image(rect.size(), format);
+    memcpy(image.bits(), raw.constData(), qMin<qint64>(raw.size(), image.sizeInBytes()));
+    return image;
+}
+
+
+/**
+ * @brief DrawCommand::DrawCommand - A command that keeps a copy of the layer image
+ *
+ *                                  before and after something is drawn. QImage is
+ *                                  implicitly shared, so both states only cost memory
+ *                                  once the layer is painted again.
+ *
+ */
+DrawCommand::DrawCommand(const QImage &oldImage, LayerStack *layers, int index)
+{
+    this->layers = layers;
+    this->index = index;
+    this->oldImage = oldImage;
+    newImage = layers->layer(index)->image;
+    tool = -1;
+    started = 0;
+    finished = 0;
+    packed = false;
+}
+
+/**
+ * @brief DrawCommand::setMergeInfo: Hace que el comando se pueda unir con el trazo siguiente de la misma herramienta
+ *                                   si empieza antes de UNDO_MERGE_WINDOW_MS.
+ */
+void DrawCommand::setMergeInfo(int tool, qint64 started, qint64 finished)
+{
+    this->tool = tool;
+    this->started = started;
+    this->finished = finished;
+}
+
+/**
+ * @brief DrawCommand::mergeWith: Absorbe el trazo siguiente: se conserva la imagen de antes de este comando y la de
+ *                                despues del siguiente, la imagen intermedia se libera. Solo se unen trazos seguidos
+ *                                sobre la misma capa (la imagen de antes del siguiente es la de despues de este).
+ */
+bool DrawCommand::mergeWith(const UndoCommand *other)
+{
+    const DrawCommand *next = static_cast<const DrawCommand*>(other);
+    if(tool < 0 || next->tool != tool || next->index != index || packed || next->packed)
+        return false;
+
+    qint64 gap = next->started - finished;
+    if(gap < 0 || gap > UNDO_MERGE_WINDOW_MS)
+        return false;
+
+    if(next->oldImage.cacheKey() != newImage.cacheKey())
+        return false;
+
+    newImage = next->newImage;
+    finished = next->finished;
+    return true;
+}
+
+/**
+ * @brief DrawCommand::undo - Restaura la imagen anterior almacenada en
+ * oldImage que almacena el estado anterior del ultimo cambio hecho en la capa
+ */
+void DrawCommand::undo()
+{
+    if(packed)
+    {
+        pastePixels(layers, index, packedOld.unpack(), packedOld.rect.topLeft());
+        return;
+    }
+
+    layers->layer(index)->image = oldImage;
+    layers->setActiveIndex(index);
+    layers->invalidate(oldImage.rect());
+}
+
+/**
+ * @brief DrawCommand::redo - Almacena cada nuevo cambio en la variable neImage
+ * por si se vuelve algun estado anterior, sea posible regresar al ultimo cambio
+ * nuevamente
+ */
+void DrawCommand::redo()
+{
+    if(packed)
+    {
+        pastePixels(layers, index, packedNew.unpack(), packedNew.rect.topLeft());
+        return;
+    }
+
+    layers->layer(index)->image = newImage;
+    layers->setActiveIndex(index);
+    layers->invalidate(newImage.rect());
+}
+
+qint64 DrawCommand::byteCount(QSet<qint64> *seen) const
+{
+    if(packed)
+        return packedOld.data.size() + packedNew.data.size();
+    return imageBytes(oldImage, seen) + imageBytes(newImage, seen);
+}
+
+/**
+ * @brief DrawCommand::compact: Guarda solo el rectangulo que cambio, comprimido, en lugar de las dos capas completas.
+ *                              Desde ese momento "undo" y "redo" pegan el rectangulo sobre la capa, que siempre esta
+ *                              en el estado de antes o despues de este comando cuando se le llama. En las capas de
+ *                              8 bits el rectangulo guarda un byte por pixel.
+ */
+bool DrawCommand::compact()
+{
+    if(packed || oldImage.size() != newImage.size() || oldImage.format() != newImage.format()
+       || (oldImage.depth() != 32 && oldImage.depth() != 8))
+        return false;
+
+    QRect changed = oldImage.depth() == 8 ? differenceRect<quint8>(oldImage, newImage)
+                                          : differenceRect<quint32>(oldImage, newImage);
+    packedOld = PackedPixels::pack(oldImage, changed);
+    packedNew = PackedPixels::pack(newImage, changed);
+    oldImage = QImage();
+    newImage = QImage();
+    packed = true;
+    return true;
+}
+
+/**
+ * @brief RegionCommand::RegionCommand - Comando que solo guarda el rectangulo modificado (antes y despues) en lugar
+ *                                      de dos copias de la capa completa, se usa en los filtros.
+ */
+RegionCommand::RegionCommand(const QImage &oldPixels, const QImage &newPixels,
+                             const QPoint &pos, LayerStack *layers, int index)
+{
+    this->layers = layers;
+    this->index = index;
+    this->oldPixels = oldPixels;
+    this->newPixels = newPixels;
+    this->pos = pos;
+    packed = false;
+}
+
+/**
+ * @brief RegionCommand::undo - Restaura los pixeles del rectangulo antes del cambio.
+ */
+void RegionCommand::undo()
+{
+    pastePixels(layers, index, packed ? packedOld.unpack() : oldPixels, pos);
+}
+
+/**
+ * @brief RegionCommand::redo - Vuelve a pintar los pixeles del rectangulo despues del cambio.
+ */
+void RegionCommand::redo()
+{
+    pastePixels(layers, index, packed ? packedNew.unpack() : newPixels, pos);
+}
+
+qint64 RegionCommand::byteCount(QSet<qint64> *seen) const
+{
+    if(packed)
+        return packedOld.data.size() + packedNew.data.size();
+    return imageBytes(oldPixels, seen) + imageBytes(newPixels, seen);
+}
+
+/**
+ * @brief RegionCommand::compact: Comprime los dos rectangulos.
+ */
+bool RegionCommand::compact()
+{
+    if(packed)
+        return false;
+
+    packedOld = PackedPixels::pack(oldPixels, oldPixels.rect());
+    packedNew = PackedPixels::pack(newPixels, newPixels.rect());
+    oldPixels = QImage();
+    newPixels = QImage();
+    packed = true;
+    return true;
+}
+
+/**
+ * @brief StackCommand::StackCommand - Comando para los cambios que afectan a toda la pila de capas (nueva imagen,
+ *                                     cargar, redimensionar, agregar, quitar o mover capas). Guarda los dos estados
+ *                                     de la pila, las imagenes de las capas que no cambiaron se comparten.
+ */
+StackCommand::StackCommand(const LayerStack::Snapshot &before, int beforeActive,
+                           LayerStack *layers)
+{
+    this->layers = layers;
+    this->before = before;
+    this->beforeActive = beforeActive;
+    after = layers->snapshot();
+    afterActive = layers->activeIndex();
+}
+
+void StackCommand::undo()
+{
+    layers->restore(before, beforeActive);
+}
+
+void StackCommand::redo()
+{
+    layers->restore(after, afterActive);
+}
+
+qint64 StackCommand::byteCount(QSet<qint64> *seen) const
+{
+    qint64 bytes = 0;
+    for(const Layer &layer : before)
+        bytes += imageBytes(layer.image, seen);
+    for(const Layer &layer : after)
+        bytes += imageBytes(layer.image, seen);
+    return bytes;
+}
+
+/**
+ * @brief TransformCommand::TransformCommand - Comando para girar o reflejar todas las capas. No guarda pixeles:
+ *                                             deshacer aplica la transformacion inversa, que devuelve exactamente
+ *                                             las mismas capas.
+ */
+TransformCommand::TransformCommand(ImageTransform transform, LayerStack *layers)
+{
+    this->layers = layers;
+    this->transform = transform;
+}
+
+void TransformCommand::undo()
+{
+    layers->transform(inverseTransform(transform));
+}
+
+void TransformCommand::redo()
+{
+    layers->transform(transform);
+}
@@ -0,0 +1,101 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <QImage>
+#include <QByteArray>
+
+#include "layers.h"
+#include "undo_stack.h"
+
+
+/**
+ * PackedPixels: Un rectangulo de pixeles comprimido con zlib, asi se guardan los comandos viejos cuando el historial
+ * se pasa del presupuesto de memoria.
+ */
+struct PackedPixels
+{
+    QByteArray data;
+    QRect rect;
+    QImage::Format format = QImage::Format_Invalid;
+
+    static PackedPixels pack(const QImage &image, const QRect &rect);
+    QImage unpack() const;
+};
+
+class DrawCommand : public UndoCommand
+{
+public:
+    DrawCommand(const QImage &oldImage, LayerStack *layers, int index);
+
+    void undo() override;
+    void redo() override;
+    qint64 byteCount(QSet<qint64> *seen) const override;
+    bool compact() override;
+    int id() const override { return DRAW_COMMAND_ID; }
+    bool mergeWith(const UndoCommand *other) override;
+
+    void setMergeInfo(int tool, qint64 started, qint64 finished);
+private:
+    LayerStack* layers;
+    int index;
+    QImage oldImage;
+    QImage newImage;
+    int tool;           // -1: no se une con otros comandos
+    qint64 started;     // milisegundos, reloj del lienzo
+    qint64 finished;
+    bool packed;
+    PackedPixels packedOld;
+    PackedPixels packedNew;
+};
+
+class RegionCommand : public UndoCommand
+{
+public:
+    RegionCommand(const QImage &oldPixels, const QImage &newPixels,
+                  const QPoint &pos, LayerStack *layers, int index);
+
+    void undo() override;
+    void redo() override;
+    qint64 byteCount(QSet<qint64> *seen) const override;
+    bool compact() override;
+private:
+    LayerStack* layers;
+    int index;
+    QImage oldPixels;
+    QImage newPixels;
+    QPoint pos;
+    bool packed;
+    PackedPixels packedOld;
+    PackedPixels packedNew;
+};
+
+class StackCommand : public UndoCommand
+{
+public:
+    StackCommand(const LayerStack::Snapshot &before, int beforeActive,
+                 LayerStack *layers);
+
+    void undo() override;
+    void redo() override;
+    qint64 byteCount(QSet<qint64> *seen) const override;
+private:
+    LayerStack* layers;
+    LayerStack::Snapshot before;
+    LayerStack::Snapshot after;
+    int beforeActive;
+    int afterActive;
+};
+
+class TransformCommand : public UndoCommand
+{
+public:
+    TransformCommand(ImageTransform transform, LayerStack *layers);
+
+    void undo() override;
+    void redo() override;
+private:
+    LayerStack* layers;
+    ImageTransform transform;
+};
+
+#endif // COMMANDS_H
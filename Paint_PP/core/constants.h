@@ -0,0 +1,133 @@
+#ifndef CONSTANTS_H
+#define CONSTANTS_H
+
+#include <QtGlobal>
+
+
+/** Valores por defecto del Lienzo y algunas herramientas*/
+const int DEFAULT_IMG_WIDTH = 640;
+const int DEFAULT_IMG_HEIGHT = 480;
+const int DEFAULT_PEN_THICKNESS = 1;
+const int DEFAULT_ERASER_THICKNESS = 10;
+
+/** Rango de los Sliders para configurar el grosor de los trazos */
+const int MIN_PEN_SIZE = 1;
+const int MAX_PEN_SIZE = 50;
+const int MIN_RECT_CURVE = 0;
+const int MAX_RECT_CURVE = 100;
+
+/**Rango de los SpinBox que definen el tamaño del lienzo*/
+const int MIN_IMG_WIDTH = 1;
+const int MAX_IMG_WIDTH = 2560; // 2560x1440 limit due to undo/redo limitations
+const int MIN_IMG_HEIGHT = 1;
+const int MAX_IMG_HEIGHT = 1440;
+
+/** Rango de los parametros de los filtros */
+const int MIN_FILTER_RADIUS = 1;
+const int MAX_FILTER_RADIUS = 100;
+const int DEFAULT_FILTER_RADIUS = 3;
+const int MIN_SHARPEN_AMOUNT = 10;   // porcentaje
+const int MAX_SHARPEN_AMOUNT = 500;
+const int DEFAULT_SHARPEN_AMOUNT = 100;
+const int BOX_BLUR_MIN_RADIUS = 16;  // a partir de este radio se aproxima el gaussiano con tres "box blur"
+const int FILTER_TILE_SIZE = 128;
+
+/** Rango de los ajustes de color */
+const int MIN_BRIGHTNESS = -255;
+const int MAX_BRIGHTNESS = 255;
+const int MIN_CONTRAST = -100;
+const int MAX_CONTRAST = 100;
+const int MIN_LEVELS_GAMMA = 10;     // gamma * 100
+const int MAX_LEVELS_GAMMA = 1000;
+const int DEFAULT_LEVELS_GAMMA = 100;
+const int MIN_HUE_SHIFT = -180;
+const int MAX_HUE_SHIFT = 180;
+const int MIN_SATURATION = -100;
+const int MAX_SATURATION = 100;
+
+/** Capas */
+const int LAYER_TILE_SIZE = 128;  // tamaño de los mosaicos del cache de la composicion
+const int MAX_LAYER_OPACITY = 255;
+
+/** Documentos de 8 bits por pixel (Indexed8 y Grayscale8) */
+const int PALETTE_SIZE = 256;
+const int PALETTE_CUBE_LEVELS = 6;        // niveles por canal del cubo de la paleta por defecto, el resto son grises
+
+/** Exportacion a BMP de 256 colores */
+const int QUANTIZE_BITS = 5;              // bits por canal del histograma, del octree y de la tabla inversa
+const int QUANTIZE_BAND_ROWS = 64;        // filas por banda al asignar los pixeles; el error del tramado no las cruza
+const int ORDERED_DITHER_SPREAD = 32;     // amplitud del tramado ordenado, en niveles de 8 bits por canal
+
+/** Lectura y escritura de imagenes (BMP con RLE, PNG y QOI) */
+const int STREAM_CHUNK_BYTES = 64 * 1024; // bytes que se leen o se escriben del archivo de una vez
+const int PNG_BLOCK_BYTES = 256 * 1024;   // filas filtradas que comprime cada tarea del deflate en paralelo
+const int PNG_DEFLATE_LEVEL = 6;
+
+/** Giros y reflejos */
+const int TRANSFORM_TILE_SIZE = 64;       // mosaicos de los giros, origen y destino de uno entran en el cache L1
+
+/** Registro de operaciones */
+const quint32 OP_LOG_MAGIC = 0x50504F4C;  // "PPOL"
+const quint16 OP_LOG_VERSION = 2;
+const int REPLAY_FAST_BATCH = 64;         // operaciones por ciclo al reproducir sin esperar
+
+/** Registro de recuperacion (write-ahead log) */
+const int WAL_FLUSH_MS = 1000;            // las operaciones se escriben y se sincronizan al disco en lotes
+const int WAL_CHECKPOINT_OPS = 5000;      // operaciones entre puntos de control, limita el tiempo de recuperacion
+const int WAL_CHECKPOINT_MS = 120000;
+
+/** Navegador (miniatura de todo el lienzo) */
+const int MIP_TILE_SIZE = 128;            // mosaicos del lienzo que se vuelven a reducir cuando cambian
+const int MIP_MIN_SIZE = 32;              // el nivel mas chico de la piramide mide esto o menos por lado
+const int NAVIGATOR_REFRESH_MS = 100;     // los cambios del lienzo se juntan y la miniatura se actualiza a este ritmo
+
+/** Rellenos de rectangulos sin QPainter */
+const int SPAN_PARALLEL_PIXELS = 1 << 20; // desde este area el relleno se reparte por bandas entre los hilos del pool
+const int SPAN_STREAM_BYTES = 8 << 20;   // desde este tamaño (mas que el L2 y casi todo el L3) se escribe sin el cache
+
+/** Vista previa de filtros, ajustes y cambios de tamaño */
+const int PREVIEW_PROXY_SIZE = 512;       // lado mayor del area visible reducida, la vista previa inmediata se calcula ahi
+const int PREVIEW_IDLE_MS = 300;          // si los parametros no cambian en este tiempo se calcula en resolucion completa
+const int PREVIEW_BAND_ROWS = 64;         // filas por banda, entre bandas se revisa si los parametros cambiaron
+
+/** Indicadores de rendimiento (HUD) */
+const int PERF_HUD_REFRESH_MS = 250;      // cada cuanto se actualiza el HUD y se reinicia la ventana de medicion
+
+/** Presupuesto de memoria de todos los documentos abiertos */
+const int DEFAULT_MEMORY_BUDGET_MB = 1024;
+const int MIN_MEMORY_BUDGET_MB = 64;
+const int MAX_MEMORY_BUDGET_MB = 65536;
+const int MEMORY_STATUS_REFRESH_MS = 1000;
+
+/** Reserva de buffers de pixeles */
+const int BUFFER_POOL_MIN_BYTES = 64 * 1024;   // los buffers mas chicos se reservan de la forma normal
+const int BUFFER_POOL_MAX_MB = 256;            // memoria maxima de buffers libres guardados para reusar
+
+/** Trazas (formato de Chrome / Perfetto) */
+const int TRACE_BUFFER_EVENTS = 1 << 16;  // eventos en el buffer circular, al llenarse se pisan los mas viejos
+
+/** Maximo de comandos "undo" y "redo" permitidos */
+const int UNDO_LIMIT = 100;
+const int UNDO_MERGE_WINDOW_MS = 400;   // trazos de la misma herramienta mas seguidos que esto se deshacen juntos
+const int DRAW_COMMAND_ID = 1;
+
+enum ToolType {pencil, pen, eraser, shapes_tool, selection};
+enum LineStyle {solid, dashed, dotted, dash_dotted, dash_dot_dotted};
+enum DrawType {single, poly};
+enum ShapeType {rectangle, ellipse, triangle};
+enum FillColor {foreground, background, no_fill};
+enum BoundaryType {miter_join, bevel_join, round_join};
+enum FilterType {gaussian_blur, unsharp_mask, edge_detect};
+enum PixelFormat {rgb_pixels, indexed_pixels, grayscale_pixels};
+enum DitherMode {no_dither, ordered_dither, diffusion_dither};
+enum ImageTransform {rotate_90, rotate_180, rotate_270, flip_horizontal, flip_vertical};
+enum BlendMode {normal_blend, multiply_blend, screen_blend, overlay_blend,
+                darken_blend, lighten_blend, difference_blend, add_blend};
+enum ColorChannel {blue_channel = 1, green_channel = 2, red_channel = 4, all_channels = 7};
+enum OpCode {op_snapshot, op_tool_state, op_begin, op_move, op_end, op_end_poly, op_select_tool, op_line_mode,
+             op_color, op_new_image, op_load_image, op_resize, op_clear, op_undo, op_redo, op_cut, op_paste,
+             op_filter, op_adjust, op_add_layer, op_remove_layer, op_layer_up, op_layer_down, op_select_layer,
+             op_layer_opacity, op_layer_blend, op_layer_visibility, op_transform};
+enum PerfCounter {perf_paint, perf_compose, perf_tool, perf_counter_count};
+
+#endif // CONSTANTS_H
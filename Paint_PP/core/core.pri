@@ -0,0 +1,11 @@
+# Se incluye desde los proyectos que enlazan con la biblioteca core (app y cli).
+QT += gui concurrent zlib-private
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+CORE_LIB_DIR = $$shadowed($$PWD)
+LIBS += -L$$CORE_LIB_DIR -lcore
+
+win32-msvc*: PRE_TARGETDEPS += $$CORE_LIB_DIR/core.lib
+else: PRE_TARGETDEPS += $$CORE_LIB_DIR/libcore.a
@@ -0,0 +1,65 @@
+QT       = core gui concurrent
+# zlib de Qt para el deflate de png_codec, sin depender de una zlib del sistema
+QT += zlib-private
+
+TEMPLATE = lib
+CONFIG += staticlib c++17
+CONFIG += qt warn_on
+TARGET = core
+
+# la biblioteca queda en la carpeta de compilacion de core sin importar la configuracion (debug o release),
+# core.pri la busca ahi
+DESTDIR = $$OUT_PWD
+
+HEADERS += \
+    constants.h \
+    simd.h \
+    undo_stack.h \
+    layers.h \
+    filters.h \
+    adjustments.h \
+    commands.h \
+    tool.h \
+    canvas.h \
+    op_log.h \
+    perf_stats.h \
+    trace.h \
+    memory_accountant.h \
+    buffer_pool.h \
+    write_ahead_log.h \
+    mip_pyramid.h \
+    proxy_preview.h \
+    span_fill.h \
+    dash_stroker.h \
+    pixel_format.h \
+    quantize.h \
+    bmp_rle.h \
+    image_io.h \
+    png_codec.h \
+    qoi_codec.h \
+    transform.h
+SOURCES += \
+    undo_stack.cpp \
+    layers.cpp \
+    filters.cpp \
+    adjustments.cpp \
+    commands.cpp \
+    tool.cpp \
+    canvas.cpp \
+    op_log.cpp \
+    perf_stats.cpp \
+    trace.cpp \
+    memory_accountant.cpp \
+    buffer_pool.cpp \
+    write_ahead_log.cpp \
+    mip_pyramid.cpp \
+    proxy_preview.cpp \
+    span_fill.cpp \
+    dash_stroker.cpp \
+    pixel_format.cpp \
+    quantize.cpp \
+    bmp_rle.cpp \
+    image_io.cpp \
+    png_codec.cpp \
+    qoi_codec.cpp \
+    transform.cpp
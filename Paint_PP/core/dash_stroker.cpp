@@ -0,0 +1,188 @@
+#include <QPainter>
+#include <cmath>
+
+#include "dash_stroker.h"
+#include "trace.h"
+
+
+static const qreal JOIN_STUB = 0.5;     // largo de los tramos que dibujan una union, menos que cualquier guion
+
+DashStroker::DashStroker()
+{
+    patternLength = 0;
+}
+
+/**
+ * @brief DashStroker::setPen: El patron de QPen esta en unidades del grosor del lapiz. Si cambia el estilo o el
+ *                             grosor, los guiones guardados ya no sirven.
+ */
+void DashStroker::setPen(const QPen &pen)
+{
+    bool samePattern = this->pen.style() == pen.style() && this->pen.widthF() == pen.widthF()
+                       && this->pen.dashOffset() == pen.dashOffset()
+                       && (pen.style() != Qt::CustomDashLine || this->pen.dashPattern() == pen.dashPattern());
+    this->pen = pen;
+    if(samePattern)
+        return;
+
+    segments.clear();
+    pattern.clear();
+    patternLength = 0;
+    if(pen.style() == Qt::SolidLine || pen.style() == Qt::NoPen)
+        return;
+
+    const qreal unit = qMax<qreal>(pen.widthF(), 1.0);
+    for(qreal length : pen.dashPattern())
+    {
+        pattern.append(length * unit);
+        patternLength += length * unit;
+    }
+    if(patternLength <= 0)
+        pattern.clear();
+}
+
+/**
+ * @brief DashStroker::stroke: Traza los segmentos de "points" que tocan "exposed" (todos si es nulo), cada uno con la
+ *                             fase que le toca en toda la polilinea, y despues las uniones. Los guiones se dibujan
+ *                             como lineas solidas con el mismo grosor y terminacion que el lapiz.
+ */
+void DashStroker::stroke(QPainter &painter, const QPolygon &points, const QRect &exposed)
+{
+    TRACE_SCOPE("DashStroker::stroke");
+    if(points.size() < 2)
+        return;
+
+    update(points);
+
+    QPen solid = pen;
+    solid.setStyle(Qt::SolidLine);
+    painter.setPen(solid);
+    for(const Segment &segment : segments)
+        if(exposed.isNull() || segment.bounds.intersects(exposed))
+            painter.drawLines(segment.dashes);
+    strokeJoins(painter, exposed);
+}
+
+/**
+ * @brief DashStroker::strokeJoins: En cada vertice por el que pasa un guion dibuja una polilinea de tres puntos: el
+ *                                  vertice y un punto a JOIN_STUB de el sobre cada segmento, con terminacion plana.
+ *                                  Los tramos quedan dentro de los guiones y lo unico que agregan es la union, igual
+ *                                  a la que dibuja QPainter en una polilinea. Se pintan solo los vertices expuestos.
+ */
+void DashStroker::strokeJoins(QPainter &painter, const QRect &exposed) const
+{
+    if(segments.size() < 2 || pen.widthF() <= 1)
+        return;
+
+    qreal distance = pen.widthF();
+    if(pen.joinStyle() == Qt::MiterJoin)
+        distance *= qMax<qreal>(pen.miterLimit(), 1.0);
+    const int rad = int(distance) + 2;
+
+    QPen join = painter.pen();
+    join.setCapStyle(Qt::FlatCap);
+    painter.setPen(join);
+    for(int i = 1; i < segments.size(); ++i)
+    {
+        const Segment &before = segments.at(i - 1);
+        const Segment &after = segments.at(i);
+        if(!after.joined || before.p0 == before.p1 || after.p0 == after.p1)
+            continue;
+
+        const QPoint vertex = after.p0;
+        if(!exposed.isNull() && !QRect(vertex, vertex).adjusted(-rad, -rad, +rad, +rad).intersects(exposed))
+            continue;
+
+        QLineF in(vertex, before.p0), out(vertex, after.p1);
+        in.setLength(JOIN_STUB);
+        out.setLength(JOIN_STUB);
+        const QPointF stub[3] = {in.p2(), QPointF(vertex), out.p2()};
+        painter.drawPolyline(stub, 3);
+    }
+}
+
+/**
+ * @brief DashStroker::update: Deja en "segments" la descomposicion de cada segmento de "points". Un segmento guardado
+ *                             se usa tal cual si tiene los mismos extremos y empieza con la misma fase, es decir si
+ *                             no cambio nada antes de el.
+ */
+void DashStroker::update(const QPolygon &points)
+{
+    const int count = points.size() - 1;
+    segments.resize(count);
+
+    qreal phase = 0;
+    if(!pattern.isEmpty())
+    {
+        phase = std::fmod(pen.dashOffset() * qMax<qreal>(pen.widthF(), 1.0), patternLength);
+        if(phase < 0)
+            phase += patternLength;
+    }
+
+    for(int i = 0; i < count; ++i)
+    {
+        Segment &segment = segments[i];
+        if(segment.p0 != points.at(i) || segment.p1 != points.at(i + 1) || segment.phase != phase)
+        {
+            segment.p0 = points.at(i);
+            segment.p1 = points.at(i + 1);
+            segment.phase = phase;
+            decompose(segment);
+        }
+        phase = segment.endPhase;
+    }
+}
+
+/**
+ * @brief DashStroker::decompose: Recorre el patron a lo largo del segmento desde su fase: los tramos pares son guiones
+ *                                y los impares espacios. Con un lapiz solido el segmento es un solo guion.
+ */
+void DashStroker::decompose(Segment &segment) const
+{
+    const int rad = int(pen.widthF() / 2) + 2;
+    segment.bounds = QRect(segment.p0, segment.p1).normalized().adjusted(-rad, -rad, +rad, +rad);
+    segment.dashes.clear();
+
+    QLineF line(segment.p0, segment.p1);
+    if(pattern.isEmpty())
+    {
+        segment.endPhase = 0;
+        segment.joined = true;
+        segment.dashes.append(line);
+        return;
+    }
+
+    // el tramo del patron donde empieza el segmento y lo que le falta
+    int index = 0;
+    qreal position = segment.phase;
+    while(position >= pattern.at(index))
+    {
+        position -= pattern.at(index);
+        index = (index + 1) % pattern.size();
+    }
+    qreal remaining = pattern.at(index) - position;
+    segment.joined = index % 2 == 0 && position > 0;
+
+    const qreal length = line.length();
+    segment.endPhase = std::fmod(segment.phase + length, patternLength);
+    if(length <= 0)
+        return;
+
+    const QPointF origin = line.p1();
+    const QPointF direction = (line.p2() - line.p1()) / length;
+    qreal t = 0;
+    while(t < length)
+    {
+        qreal step = qMin(remaining, length - t);
+        if(index % 2 == 0 && step > 0)
+            segment.dashes.append(QLineF(origin + direction * t, origin + direction * (t + step)));
+
+        t += step;
+        remaining -= step;
+        if(remaining <= 0)
+        {
+            index = (index + 1) % pattern.size();
+            remaining = pattern.at(index);
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef DASH_STROKER_H
+#define DASH_STROKER_H
+
+#include <QPen>
+#include <QPolygon>
+#include <QLineF>
+#include <QVector>
+
+
+class QPainter;
+
+/**
+ * DashStroker: Trazo de una polilinea, solida o con guiones. Cada segmento se descompone en sus guiones (lineas
+ * solidas; una sola si el lapiz es solido) una sola vez y se guarda junto con sus extremos y la fase del patron con la
+ * que empieza; al volver a trazar la polilinea solo se recalculan los segmentos cuyos extremos o fase cambiaron, y
+ * solo se dibujan los que tocan el area expuesta. Al arrastrar el ultimo vertice eso es un segmento, sin importar
+ * cuantos tenga la polilinea.
+ *
+ * El patron sigue de un segmento al siguiente, como en un QPainterPath, en vez de empezar de nuevo en cada vertice.
+ * Donde un guion pasa por un vertice se dibuja la union del lapiz (inglete, bisel o redonda) con dos tramos minimos a
+ * cada lado del vertice; las uniones no se guardan, son una por vertice expuesto. La polilinea del lapicero se ve y se
+ * guarda en la capa con el mismo trazo, asi quedan los mismos pixeles que se vieron.
+ */
+class DashStroker
+{
+public:
+    DashStroker();
+
+    void setPen(const QPen &pen);
+    void stroke(QPainter &painter, const QPolygon &points, const QRect &exposed = QRect());
+
+private:
+    struct Segment
+    {
+        Segment() : phase(-1), endPhase(0), joined(false) {}
+
+        QPoint p0;
+        QPoint p1;
+        qreal phase;                // posicion en el patron donde empieza el segmento
+        qreal endPhase;
+        bool joined;                // empieza dentro de un guion: lleva la union con el segmento anterior
+        QRect bounds;               // pixeles que puede tocar el segmento, con el grosor del lapiz
+        QVector<QLineF> dashes;
+    };
+
+    void update(const QPolygon &points);
+    void decompose(Segment &segment) const;
+    void strokeJoins(QPainter &painter, const QRect &exposed) const;
+
+    QPen pen;
+    QVector<qreal> pattern;         // largos de guion y espacio alternados, en pixeles
+    qreal patternLength;
+    QVector<Segment> segments;
+};
+
+#endif // DASH_STROKER_H
@@ -0,0 +1,323 @@
+#include <QtConcurrent>
+#include <cmath>
+#include <vector>
+
+#include "filters.h"
+#include "buffer_pool.h"
+
+
+static inline int clampi(int value, int low, int high)
+{
+    return value < low ? low : (value > high ? high : value);
+}
+
+/**
+ * @brief boxRadii: Calcula los radios de tres "box blur" sucesivos cuya convolucion se aproxima a un gaussiano de
+ *                  desviacion "sigma". Con radios grandes esto cuesta lo mismo sin importar el radio.
+ */
+static void boxRadii(float sigma, int radii[3])
+{
+    const int n = 3;
+    float wIdeal = std::sqrt(12.0f * sigma * sigma / n + 1.0f);
+    int wl = int(std::floor(wIdeal));
+    if(wl % 2 == 0)
+        wl--;
+    int wu = wl + 2;
+    float mIdeal = (12.0f * sigma * sigma - n * wl * wl - 4.0f * n * wl - 3.0f * n) / (-4.0f * wl - 4.0f);
+    int m = int(std::floor(mIdeal + 0.5f));
+
+    for(int i = 0; i < n; ++i)
+        radii[i] = ((i < m ? wl : wu) - 1) / 2;
+}
+
+/**
+ * @brief boxLine: Promedio movil de radio "r" sobre una linea de pixeles, cada pixel de salida cuesta una suma y
+ *                 una resta sin importar el radio. Los extremos repiten el primer y el ultimo pixel.
+ */
+static void boxLine(const Vec4 *in, Vec4 *out, int n, int r)
+{
+    Vec4 scale = vecSet(1.0f / (2 * r + 1));
+    Vec4 acc = vecZero();
+    for(int k = -r; k <= r; ++k)
+        acc = vecAdd(acc, in[clampi(k, 0, n - 1)]);
+
+    for(int i = 0; i < n; ++i)
+    {
+        out[i] = vecMul(acc, scale);
+        acc = vecAdd(acc, in[clampi(i + r + 1, 0, n - 1)]);
+        acc = vecSub(acc, in[clampi(i - r, 0, n - 1)]);
+    }
+}
+
+/**
+ * @brief FilterJob::FilterJob: Prepara el filtro sobre "area" y divide el area en mosaicos de FILTER_TILE_SIZE.
+ *                              Los punteros a los pixeles se obtienen aqui, en un solo hilo, para que los hilos
+ *                              de trabajo nunca llamen metodos de QImage que puedan desacoplar (detach) los datos.
+ */
+FilterJob::FilterJob(const QImage &image, const QRect &rect, const FilterParams &filterParams)
+{
+    source = image.format() == QImage::Format_ARGB32_Premultiplied
+                 ? image : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    area = rect.intersected(source.rect());
+    params = filterParams;
+    params.radius = clampi(params.radius, MIN_FILTER_RADIUS, MAX_FILTER_RADIUS);
+
+    output = BufferPool::instance()->acquire(area.size(), QImage::Format_ARGB32_Premultiplied);
+    srcBits = source.constBits();
+    srcStride = source.bytesPerLine();
+    outBits = output.bits();
+    outStride = output.bytesPerLine();
+
+    for(int y = area.top(); y <= area.bottom(); y += FILTER_TILE_SIZE)
+        for(int x = area.left(); x <= area.right(); x += FILTER_TILE_SIZE)
+            tiles.append(QRect(x, y, FILTER_TILE_SIZE, FILTER_TILE_SIZE).intersected(area));
+}
+
+/**
+ * @brief FilterJob::start: Procesa los mosaicos en segundo plano. El QFuture devuelto informa el progreso por
+ *                          mosaico y se puede cancelar, los mosaicos pendientes ya no se procesan.
+ */
+QFuture<void> FilterJob::start()
+{
+    return QtConcurrent::map(tiles, [this](const QRect &tile) { processTile(tile); });
+}
+
+/**
+ * @brief FilterJob::run: Procesa todos los mosaicos en paralelo y espera a que terminen.
+ */
+void FilterJob::run()
+{
+    QtConcurrent::blockingMap(tiles, [this](const QRect &tile) { processTile(tile); });
+}
+
+/**
+ * @brief FilterJob::processTile: Aplica el filtro a un solo mosaico.
+ *                                -gaussian_blur: desenfoque gaussiano separable.
+ *                                -unsharp_mask:  original + cantidad * (original - desenfoque).
+ *                                -edge_detect:   magnitud del gradiente de Sobel por canal.
+ */
+void FilterJob::processTile(const QRect &tile)
+{
+    switch(params.type)
+    {
+        case gaussian_blur:
+        {
+            std::vector<Vec4> values(tile.width() * tile.height());
+            blurTile(tile, values.data());
+            writeTile(tile, values.data());
+        } break;
+        case unsharp_mask:
+        {
+            std::vector<Vec4> values(tile.width() * tile.height());
+            blurTile(tile, values.data());
+
+            Vec4 amount = vecSet(params.amount / 100.0f);
+            for(int j = 0; j < tile.height(); ++j)
+            {
+                const QRgb *line = sourceLine(tile.top() + j);
+                Vec4 *row = &values[j * tile.width()];
+                for(int i = 0; i < tile.width(); ++i)
+                {
+                    Vec4 original = vecFromPixel(line[tile.left() + i]);
+                    Vec4 detail = vecSub(original, row[i]);
+                    row[i] = vecWithAlpha(vecAdd(original, vecMul(detail, amount)), original);
+                }
+            }
+            writeTile(tile, values.data());
+        } break;
+        case edge_detect:
+            edgeTile(tile);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief FilterJob::blurTile: Con radios pequeños se usa el kernel gaussiano exacto, con radios grandes la
+ *                             aproximacion de tres "box blur" para que el costo no crezca con el radio.
+ */
+void FilterJob::blurTile(const QRect &tile, Vec4 *out) const
+{
+    if(params.radius >= BOX_BLUR_MIN_RADIUS)
+        boxTile(tile, out);
+    else
+        gaussianTile(tile, out);
+}
+
+/**
+ * @brief FilterJob::gaussianTile: Convolucion separable: primero horizontal sobre las filas del mosaico mas el halo
+ *                                 de arriba y abajo, luego vertical sobre ese resultado intermedio.
+ */
+void FilterJob::gaussianTile(const QRect &tile, Vec4 *out) const
+{
+    const int r = params.radius;
+    const int tw = tile.width();
+    const int th = tile.height();
+    const int maxX = source.width() - 1;
+    const int maxY = source.height() - 1;
+
+    float sigma = qMax(r / 3.0f, 0.5f);
+    std::vector<float> weights(r + 1);
+    float sum = 0.0f;
+    for(int k = 0; k <= r; ++k)
+    {
+        weights[k] = std::exp(-(k * k) / (2.0f * sigma * sigma));
+        sum += k ? 2.0f * weights[k] : weights[k];
+    }
+    std::vector<Vec4> w(r + 1);
+    for(int k = 0; k <= r; ++k)
+        w[k] = vecSet(weights[k] / sum);
+
+    // pasada horizontal, la linea se copia con los bordes repetidos para no evaluar limites en el ciclo interno
+    const int rows = th + 2 * r;
+    std::vector<Vec4> tmp(rows * tw);
+    std::vector<Vec4> line(tw + 2 * r);
+    for(int j = 0; j < rows; ++j)
+    {
+        const QRgb *src = sourceLine(clampi(tile.top() - r + j, 0, maxY));
+        for(int i = 0; i < tw + 2 * r; ++i)
+            line[i] = vecFromPixel(src[clampi(tile.left() - r + i, 0, maxX)]);
+
+        Vec4 *dst = &tmp[j * tw];
+        for(int i = 0; i < tw; ++i)
+        {
+            const Vec4 *c = &line[i + r];
+            Vec4 acc = vecMul(c[0], w[0]);
+            for(int k = 1; k <= r; ++k)
+                acc = vecAdd(acc, vecMul(vecAdd(c[-k], c[k]), w[k]));
+            dst[i] = acc;
+        }
+    }
+
+    // pasada vertical, fila por fila para recorrer la memoria en orden
+    for(int j = 0; j < th; ++j)
+    {
+        Vec4 *dst = &out[j * tw];
+        const Vec4 *center = &tmp[(j + r) * tw];
+        for(int i = 0; i < tw; ++i)
+            dst[i] = vecMul(center[i], w[0]);
+
+        for(int k = 1; k <= r; ++k)
+        {
+            const Vec4 *above = &tmp[(j + r - k) * tw];
+            const Vec4 *below = &tmp[(j + r + k) * tw];
+            for(int i = 0; i < tw; ++i)
+                dst[i] = vecAdd(dst[i], vecMul(vecAdd(above[i], below[i]), w[k]));
+        }
+    }
+}
+
+/**
+ * @brief FilterJob::boxTile: Aproximacion del gaussiano con tres promedios moviles horizontales y tres verticales.
+ *                            El halo es la suma de los tres radios, asi el centro del mosaico no depende de donde
+ *                            se corto la imagen.
+ */
+void FilterJob::boxTile(const QRect &tile, Vec4 *out) const
+{
+    int radii[3];
+    boxRadii(params.radius / 3.0f, radii);
+    const int halo = radii[0] + radii[1] + radii[2];
+
+    const int tw = tile.width();
+    const int th = tile.height();
+    const int bw = tw + 2 * halo;
+    const int bh = th + 2 * halo;
+    const int maxX = source.width() - 1;
+    const int maxY = source.height() - 1;
+
+    std::vector<Vec4> buffer(bw * bh);
+    for(int j = 0; j < bh; ++j)
+    {
+        const QRgb *src = sourceLine(clampi(tile.top() - halo + j, 0, maxY));
+        Vec4 *dst = &buffer[j * bw];
+        for(int i = 0; i < bw; ++i)
+            dst[i] = vecFromPixel(src[clampi(tile.left() - halo + i, 0, maxX)]);
+    }
+
+    std::vector<Vec4> lineA(qMax(bw, bh));
+    std::vector<Vec4> lineB(qMax(bw, bh));
+
+    for(int j = 0; j < bh; ++j)
+    {
+        Vec4 *row = &buffer[j * bw];
+        boxLine(row, lineA.data(), bw, radii[0]);
+        boxLine(lineA.data(), lineB.data(), bw, radii[1]);
+        boxLine(lineB.data(), row, bw, radii[2]);
+    }
+
+    // solo hace falta la pasada vertical en las columnas que quedan dentro del mosaico
+    for(int i = 0; i < tw; ++i)
+    {
+        for(int j = 0; j < bh; ++j)
+            lineA[j] = buffer[j * bw + halo + i];
+
+        boxLine(lineA.data(), lineB.data(), bh, radii[0]);
+        boxLine(lineB.data(), lineA.data(), bh, radii[1]);
+        boxLine(lineA.data(), lineB.data(), bh, radii[2]);
+
+        for(int j = 0; j < th; ++j)
+            out[j * tw + i] = lineB[j + halo];
+    }
+}
+
+/**
+ * @brief FilterJob::edgeTile: Deteccion de bordes con el operador de Sobel. Se calcula por canal y se conserva el alfa
+ *                             original del pixel.
+ */
+void FilterJob::edgeTile(const QRect &tile)
+{
+    const int maxX = source.width() - 1;
+    const int maxY = source.height() - 1;
+    const Vec4 two = vecSet(2.0f);
+
+    for(int y = tile.top(); y <= tile.bottom(); ++y)
+    {
+        const QRgb *above = sourceLine(clampi(y - 1, 0, maxY));
+        const QRgb *center = sourceLine(y);
+        const QRgb *below = sourceLine(clampi(y + 1, 0, maxY));
+        QRgb *dst = reinterpret_cast<QRgb*>(outBits + (y - area.top()) * outStride);
+
+        for(int x = tile.left(); x <= tile.right(); ++x)
+        {
+            int xm = clampi(x - 1, 0, maxX);
+            int xp = clampi(x + 1, 0, maxX);
+
+            Vec4 left = vecAdd(vecAdd(vecFromPixel(above[xm]), vecFromPixel(below[xm])),
+                               vecMul(vecFromPixel(center[xm]), two));
+            Vec4 right = vecAdd(vecAdd(vecFromPixel(above[xp]), vecFromPixel(below[xp])),
+                                vecMul(vecFromPixel(center[xp]), two));
+            Vec4 top = vecAdd(vecAdd(vecFromPixel(above[xm]), vecFromPixel(above[xp])),
+                              vecMul(vecFromPixel(above[x]), two));
+            Vec4 bottom = vecAdd(vecAdd(vecFromPixel(below[xm]), vecFromPixel(below[xp])),
+                                 vecMul(vecFromPixel(below[x]), two));
+
+            Vec4 gx = vecSub(right, left);
+            Vec4 gy = vecSub(bottom, top);
+            Vec4 magnitude = vecSqrt(vecAdd(vecMul(gx, gx), vecMul(gy, gy)));
+
+            Vec4 pixel = vecWithAlpha(magnitude, vecFromPixel(center[x]));
+            dst[x - area.left()] = vecToPixel(vecClampPremultiplied(pixel));
+        }
+    }
+}
+
+/**
+ * @brief FilterJob::writeTile: Convierte los valores del mosaico a pixeles y los escribe en el resultado.
+ */
+void FilterJob::writeTile(const QRect &tile, const Vec4 *values)
+{
+    for(int j = 0; j < tile.height(); ++j)
+    {
+        QRgb *dst = reinterpret_cast<QRgb*>(outBits + (tile.top() - area.top() + j) * outStride)
+                    + (tile.left() - area.left());
+        const Vec4 *row = &values[j * tile.width()];
+        for(int i = 0; i < tile.width(); ++i)
+            dst[i] = vecToPixel(vecClampPremultiplied(row[i]));
+    }
+}
+
+const QRgb* FilterJob::sourceLine(int y) const
+{
+    return reinterpret_cast<const QRgb*>(srcBits + y * srcStride);
+}
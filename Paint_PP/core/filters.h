@@ -0,0 +1,62 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <QImage>
+#include <QList>
+#include <QFuture>
+
+#include "constants.h"
+#include "simd.h"
+
+
+struct FilterParams
+{
+    FilterType type;
+    int radius;     // radio del kernel en pixeles
+    int amount;     // intensidad de la mascara de enfoque en porcentaje
+};
+
+
+/**
+ * FilterJob: Aplica un filtro sobre un area de la imagen dividiendola en mosaicos (tiles) que se procesan en paralelo
+ * en el pool de hilos de QtConcurrent. Cada mosaico lee su vecindario (halo) directamente de la imagen original, que
+ * no se modifica, y escribe solo sus propios pixeles en el resultado, por eso los mosaicos no necesitan sincronizarse.
+ */
+class FilterJob
+{
+public:
+    FilterJob(const QImage &source, const QRect &area, const FilterParams &params);
+
+    QFuture<void> start();
+    void run();
+    void processTile(const QRect &tile);
+
+    QRect getArea() const { return area; }
+    FilterParams getParams() const { return params; }
+    QImage getResult() const { return output; }
+    int tileCount() const { return tiles.size(); }
+
+private:
+    void blurTile(const QRect &tile, Vec4 *out) const;
+    void gaussianTile(const QRect &tile, Vec4 *out) const;
+    void boxTile(const QRect &tile, Vec4 *out) const;
+    void edgeTile(const QRect &tile);
+    void writeTile(const QRect &tile, const Vec4 *values);
+    const QRgb* sourceLine(int y) const;
+
+    QImage source;
+    QImage output;
+    QRect area;
+    FilterParams params;
+    QList<QRect> tiles;
+
+    const uchar *srcBits;
+    int srcStride;
+    uchar *outBits;
+    int outStride;
+
+    FilterJob(const FilterJob&);
+    FilterJob& operator=(const FilterJob&);
+};
+
+#endif // FILTERS_H
@@ -0,0 +1,129 @@
+#include <QFile>
+#include <QFileInfo>
+#include <cstring>
+
+#include "image_io.h"
+#include "bmp_rle.h"
+#include "png_codec.h"
+#include "qoi_codec.h"
+#include "trace.h"
+
+
+/**
+ * imageFormatOf: El formato de "fileName" segun su extension, en mayusculas como lo espera QImage::save. Sin
+ * extension es BMP, el formato de siempre del editor.
+ */
+QByteArray imageFormatOf(const QString &fileName)
+{
+    QByteArray suffix = QFileInfo(fileName).suffix().toUpper().toLatin1();
+    return suffix.isEmpty() ? QByteArray("BMP") : suffix;
+}
+
+QImage readImageFile(const QString &fileName)
+{
+    TRACE_SCOPE("readImageFile");
+    const QByteArray format = imageFormatOf(fileName);
+    QFile file(fileName);
+    if(file.open(QIODevice::ReadOnly))
+    {
+        QImage image;
+        if((format == "BMP" && readRleBmp(&file, &image)) || (format == "PNG" && readPng(&file, &image))
+           || (format == "QOI" && readQoi(&file, &image)))
+            return image;
+    }
+    return QImage(fileName);
+}
+
+bool writeImageFile(const QString &fileName, const QImage &image, const QByteArray &format)
+{
+    TRACE_SCOPE("writeImageFile");
+    if(format != "PNG" && format != "QOI")
+        return image.save(fileName, format.constData());
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+    return format == "PNG" ? writePng(&file, image) : writeQoi(&file, image);
+}
+
+StreamReader::StreamReader(QIODevice *device)
+    : device(device), buffer(STREAM_CHUNK_BYTES)
+{
+    position = 0;
+    size = 0;
+}
+
+bool StreamReader::refill()
+{
+    qint64 read = device->read(reinterpret_cast<char*>(buffer.data()), qint64(buffer.size()));
+    if(read <= 0)
+        return false;
+    size = int(read);
+    position = 0;
+    return true;
+}
+
+/**
+ * @brief StreamReader::read: Copia "count" bytes a "data", falso si el archivo termina antes.
+ */
+bool StreamReader::read(uchar *data, qint64 count)
+{
+    while(count > 0)
+    {
+        if(position == size && !refill())
+            return false;
+        int part = int(qMin(count, qint64(size - position)));
+        memcpy(data, buffer.data() + position, size_t(part));
+        position += part;
+        data += part;
+        count -= part;
+    }
+    return true;
+}
+
+bool StreamReader::skip(qint64 count)
+{
+    while(count > 0)
+    {
+        if(position == size && !refill())
+            return false;
+        int part = int(qMin(count, qint64(size - position)));
+        position += part;
+        count -= part;
+    }
+    return true;
+}
+
+StreamWriter::StreamWriter(QIODevice *device)
+    : device(device), buffer(STREAM_CHUNK_BYTES)
+{
+    size = 0;
+    failed = false;
+}
+
+/**
+ * @brief StreamWriter::write: Los bloques mas grandes que el buffer van directo al dispositivo.
+ */
+void StreamWriter::write(const void *data, qint64 count)
+{
+    if(size + count > qint64(buffer.size()))
+    {
+        flush();
+        if(count >= qint64(buffer.size()))
+        {
+            if(!failed && device->write(static_cast<const char*>(data), count) != count)
+                failed = true;
+            return;
+        }
+    }
+    memcpy(buffer.data() + size, data, size_t(count));
+    size += int(count);
+}
+
+bool StreamWriter::flush()
+{
+    if(size > 0 && !failed && device->write(reinterpret_cast<const char*>(buffer.data()), size) != size)
+        failed = true;
+    size = 0;
+    return !failed;
+}
@@ -0,0 +1,78 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <QImage>
+#include <QIODevice>
+#include <vector>
+
+#include "constants.h"
+
+
+/**
+ * Lectura y escritura de imagenes. El formato se elige por la extension del archivo: los BMP comprimidos con RLE,
+ * los PNG y los QOI usan los codecs propios (bmp_rle, png_codec, qoi_codec), el resto lo lee y lo escribe Qt. Al leer,
+ * si el codec propio no reconoce el archivo (otra variante del formato) se lo pasa a Qt.
+ *
+ * Los codecs propios leen y escriben el archivo de a STREAM_CHUNK_BYTES por medio de StreamReader y StreamWriter, de
+ * a una fila o un bloque de filas a la vez, sin armar el archivo completo en memoria.
+ */
+QByteArray imageFormatOf(const QString &fileName);
+QImage readImageFile(const QString &fileName);
+bool writeImageFile(const QString &fileName, const QImage &image, const QByteArray &format);
+
+/**
+ * StreamReader: Lee el dispositivo de a STREAM_CHUNK_BYTES; los decodificadores piden de a un byte (next) o de a
+ * unos pocos (read) sin llamar al dispositivo cada vez.
+ */
+class StreamReader
+{
+public:
+    explicit StreamReader(QIODevice *device);
+
+    bool next(uchar *byte)
+    {
+        if(position == size && !refill())
+            return false;
+        *byte = buffer[position++];
+        return true;
+    }
+
+    bool read(uchar *data, qint64 count);
+    bool skip(qint64 count);
+
+private:
+    bool refill();
+
+    QIODevice *device;
+    std::vector<uchar> buffer;
+    int position;
+    int size;
+};
+
+/**
+ * StreamWriter: Junta lo que escriben los codificadores y lo manda al dispositivo de a STREAM_CHUNK_BYTES. Un error
+ * de escritura se recuerda y lo devuelve flush(), que hay que llamar al terminar.
+ */
+class StreamWriter
+{
+public:
+    explicit StreamWriter(QIODevice *device);
+
+    void put(uchar byte)
+    {
+        if(size == int(buffer.size()))
+            flush();
+        buffer[size++] = byte;
+    }
+
+    void write(const void *data, qint64 count);
+    bool flush();
+
+private:
+    QIODevice *device;
+    std::vector<uchar> buffer;
+    int size;
+    bool failed;
+};
+
+#endif // IMAGE_IO_H
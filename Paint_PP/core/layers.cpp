@@ -0,0 +1,489 @@
+#include <QCoreApplication>
+#include <QPainter>
+#include <algorithm>
+
+#include "layers.h"
+#include "perf_stats.h"
+#include "trace.h"
+#include "buffer_pool.h"
+#include "transform.h"
+
+
+static inline int div255(int x)
+{
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+/** Multiplica los cuatro canales de un pixel por "a" / 255, dos canales por multiplicacion. */
+static inline QRgb byteMul(QRgb x, int a)
+{
+    QRgb t = (x & 0xff00ff) * a;
+    t = (t + ((t >> 8) & 0xff00ff) + 0x800080) >> 8;
+    t &= 0xff00ff;
+
+    x = ((x >> 8) & 0xff00ff) * a;
+    x = (x + ((x >> 8) & 0xff00ff) + 0x800080);
+    x &= 0xff00ff00;
+    return x | t;
+}
+
+/**
+ * BlendOp: Formula de cada modo de mezcla para un canal en formato premultiplicado, "s" y "d" son el canal de la capa
+ * y del fondo, "sa" y "da" sus alfas. Cada modo es una especializacion distinta, asi el ciclo de cada modo se compila
+ * por separado y no pregunta por el modo en cada pixel.
+ */
+template <BlendMode Mode> struct BlendOp;
+
+template <> struct BlendOp<multiply_blend>
+{
+    static inline int apply(int s, int d, int sa, int da)
+    { return div255(s * d) + div255(s * (255 - da)) + div255(d * (255 - sa)); }
+};
+
+template <> struct BlendOp<screen_blend>
+{
+    static inline int apply(int s, int d, int, int)
+    { return s + d - div255(s * d); }
+};
+
+template <> struct BlendOp<overlay_blend>
+{
+    static inline int apply(int s, int d, int sa, int da)
+    {
+        int outside = div255(s * (255 - da)) + div255(d * (255 - sa));
+        if(2 * d <= da)
+            return 2 * div255(s * d) + outside;
+        return div255(sa * da) - 2 * div255((da - d) * (sa - s)) + outside;
+    }
+};
+
+template <> struct BlendOp<darken_blend>
+{
+    static inline int apply(int s, int d, int sa, int da)
+    { return div255(qMin(s * da, d * sa)) + div255(s * (255 - da)) + div255(d * (255 - sa)); }
+};
+
+template <> struct BlendOp<lighten_blend>
+{
+    static inline int apply(int s, int d, int sa, int da)
+    { return div255(qMax(s * da, d * sa)) + div255(s * (255 - da)) + div255(d * (255 - sa)); }
+};
+
+template <> struct BlendOp<difference_blend>
+{
+    static inline int apply(int s, int d, int sa, int da)
+    { return s + d - 2 * div255(qMin(s * da, d * sa)); }
+};
+
+template <> struct BlendOp<add_blend>
+{
+    static inline int apply(int s, int d, int, int)
+    { return s + d; }
+};
+
+static inline int clampChannel(int value, int alpha)
+{
+    return value < 0 ? 0 : (value > alpha ? alpha : value);
+}
+
+/**
+ * @brief blendRow: Mezcla una fila de la capa sobre una fila de la composicion con el modo "Mode".
+ */
+template <BlendMode Mode>
+static void blendRow(QRgb *dst, const QRgb *src, int count, int opacity)
+{
+    for(int i = 0; i < count; ++i)
+    {
+        QRgb s = src[i];
+        if(opacity != MAX_LAYER_OPACITY)
+            s = byteMul(s, opacity);
+        int sa = qAlpha(s);
+        if(sa == 0)
+            continue;
+
+        QRgb d = dst[i];
+        int da = qAlpha(d);
+        int a = sa + da - div255(sa * da);
+        int r = BlendOp<Mode>::apply(qRed(s), qRed(d), sa, da);
+        int g = BlendOp<Mode>::apply(qGreen(s), qGreen(d), sa, da);
+        int b = BlendOp<Mode>::apply(qBlue(s), qBlue(d), sa, da);
+        dst[i] = qRgba(clampChannel(r, a), clampChannel(g, a), clampChannel(b, a), a);
+    }
+}
+
+/**
+ * @brief blendRow<normal_blend>: El modo normal es "source over", se resuelve con dos multiplicaciones por pixel.
+ */
+template <>
+void blendRow<normal_blend>(QRgb *dst, const QRgb *src, int count, int opacity)
+{
+    for(int i = 0; i < count; ++i)
+    {
+        QRgb s = src[i];
+        if(opacity != MAX_LAYER_OPACITY)
+            s = byteMul(s, opacity);
+        int sa = qAlpha(s);
+        if(sa == 255)
+            dst[i] = s;
+        else if(sa != 0)
+            dst[i] = s + byteMul(dst[i], 255 - sa);
+    }
+}
+
+typedef void (*BlendRowFunction)(QRgb*, const QRgb*, int, int);
+
+/** En el mismo orden que BlendMode. */
+static const BlendRowFunction blendRowFunctions[] = {
+    &blendRow<normal_blend>,
+    &blendRow<multiply_blend>,
+    &blendRow<screen_blend>,
+    &blendRow<overlay_blend>,
+    &blendRow<darken_blend>,
+    &blendRow<lighten_blend>,
+    &blendRow<difference_blend>,
+    &blendRow<add_blend>
+};
+
+
+/**
+ * @brief LayerStack::LayerStack: Inicia con una sola capa vacia.
+ */
+LayerStack::LayerStack()
+{
+    tilesX = 0;
+    tilesY = 0;
+    reset(QImage());
+}
+
+/**
+ * @brief LayerStack::reset: Deja una sola capa de fondo con la imagen indicada. Una imagen de 8 bits deja un documento
+ *                           de 8 bits (layerImage).
+ */
+void LayerStack::reset(const QImage &background)
+{
+    Layer base;
+    base.name = QCoreApplication::translate("LayerStack", "Background");
+    base.image = layerImage(background);
+    base.opacity = MAX_LAYER_OPACITY;
+    base.mode = normal_blend;
+    base.visible = true;
+
+    layers.clear();
+    layers.append(base);
+    active = 0;
+    resetCache();
+}
+
+void LayerStack::setActiveIndex(int index)
+{
+    if(index >= 0 && index < layers.size())
+        active = index;
+}
+
+/**
+ * @brief LayerStack::addLayer: Agrega una capa transparente encima de la capa activa y la deja activa. Los documentos
+ *                              de 8 bits no tienen transparencia, tienen una sola capa.
+ */
+void LayerStack::addLayer(const QString &name)
+{
+    if(rect().isEmpty() || pixelFormat() != rgb_pixels)
+        return;
+
+    Layer layer;
+    layer.name = name;
+    layer.image = BufferPool::instance()->acquire(size(), QImage::Format_ARGB32_Premultiplied);
+    layer.image.fill(Qt::transparent);
+    layer.opacity = MAX_LAYER_OPACITY;
+    layer.mode = normal_blend;
+    layer.visible = true;
+
+    layers.insert(active + 1, layer);
+    active++;
+    invalidateAll();
+}
+
+/**
+ * @brief LayerStack::removeLayer: Elimina una capa, siempre queda al menos una.
+ */
+void LayerStack::removeLayer(int index)
+{
+    if(layers.size() == 1 || index < 0 || index >= layers.size())
+        return;
+
+    layers.removeAt(index);
+    if(active >= layers.size() || active > index)
+        active--;
+    active = qMax(active, 0);
+    invalidateAll();
+}
+
+/**
+ * @brief LayerStack::moveLayer: Sube (delta positivo) o baja una capa en la pila.
+ */
+void LayerStack::moveLayer(int index, int delta)
+{
+    int target = index + delta;
+    if(index < 0 || index >= layers.size() || target < 0 || target >= layers.size())
+        return;
+
+    layers.move(index, target);
+    if(active == index)
+        active = target;
+    else if(active == target)
+        active = index;
+    invalidateAll();
+}
+
+/**
+ * @brief LayerStack::scale: Redimensiona todas las capas, cada una queda en su formato (y con su paleta).
+ */
+void LayerStack::scale(const QSize &size)
+{
+    for(int i = 0; i < layers.size(); ++i)
+        layers[i].image = conformTo(layers[i].image.scaled(size, Qt::IgnoreAspectRatio), layers[i].image);
+    resetCache();
+}
+
+/**
+ * @brief LayerStack::transform: Gira o refleja todas las capas. El cache de la composicion se transforma igual que
+ *                               las capas en lugar de volver a componerse, y cada mosaico sucio marca los mosaicos
+ *                               que ocupa despues de la transformacion.
+ */
+void LayerStack::transform(ImageTransform transform)
+{
+    const QSize before = size();
+    const QVector<bool> dirty = dirtyTiles;
+    const int columns = tilesX;
+    for(int i = 0; i < layers.size(); ++i)
+        layers[i].image = transformImage(layers[i].image, transform);
+
+    QImage composed = cache.size() == before ? transformImage(cache, transform) : QImage();
+    resetCache();
+    if(composed.isNull())
+        return;
+
+    cache = composed;
+    dirtyTiles.fill(false);
+    for(int i = 0; i < dirty.size(); ++i)
+    {
+        if(!dirty[i])
+            continue;
+        QRect tile((i % columns) * LAYER_TILE_SIZE, (i / columns) * LAYER_TILE_SIZE, LAYER_TILE_SIZE, LAYER_TILE_SIZE);
+        invalidate(transformRect(tile.intersected(QRect(QPoint(), before)), before, transform));
+    }
+}
+
+/**
+ * @brief LayerStack::snapshot: Copia el estado de las capas para la pila de "undo". Las imagenes se comparten
+ *                              (QImage es implicitamente compartido), solo se duplican si despues se modifican.
+ *                              La lista se arma elemento por elemento para que no comparta nodos con "layers".
+ */
+LayerStack::Snapshot LayerStack::snapshot() const
+{
+    Snapshot state;
+    for(const Layer &layer : layers)
+        state.append(layer);
+    return state;
+}
+
+/**
+ * @brief LayerStack::restore: Vuelve a un estado guardado con snapshot().
+ */
+void LayerStack::restore(const Snapshot &state, int activeIndex)
+{
+    layers.clear();
+    for(const Layer &layer : state)
+        layers.append(layer);
+    active = qBound(0, activeIndex, layers.size() - 1);
+    resetCache();
+}
+
+/**
+ * @brief LayerStack::invalidate: Marca sucios los mosaicos del cache que tocan "rect".
+ */
+void LayerStack::invalidate(const QRect &rect)
+{
+    QRect area = rect.intersected(this->rect());
+    if(area.isEmpty() || dirtyTiles.isEmpty())
+        return;
+
+    for(int ty = area.top() / LAYER_TILE_SIZE; ty <= area.bottom() / LAYER_TILE_SIZE; ++ty)
+        for(int tx = area.left() / LAYER_TILE_SIZE; tx <= area.right() / LAYER_TILE_SIZE; ++tx)
+            dirtyTiles[ty * tilesX + tx] = true;
+}
+
+void LayerStack::invalidateAll()
+{
+    dirtyTiles.fill(true);
+}
+
+/**
+ * @brief LayerStack::releaseCache: Devuelve el cache de la composicion a la reserva, se vuelve a componer completo en
+ *                                  el siguiente repintado. Devuelve falso si no habia cache.
+ */
+bool LayerStack::releaseCache()
+{
+    if(cache.isNull())
+        return false;
+
+    cache = QImage();
+    dirtyTiles.fill(true);
+    return true;
+}
+
+/**
+ * @brief LayerStack::paint: Dibuja la composicion del area expuesta. Con una sola capa normal se dibuja directamente,
+ *                           si no, se recomponen solo los mosaicos sucios y el resto sale del cache.
+ */
+void LayerStack::paint(QPainter &painter, const QRect &exposed)
+{
+    QRect area = exposed.intersected(rect());
+    if(area.isEmpty())
+        return;
+
+    if(isTrivial())
+    {
+        painter.drawImage(area, layers.first().image, area);
+        return;
+    }
+
+    if(cache.size() != size())
+    {
+        cache = BufferPool::instance()->acquire(size(), QImage::Format_ARGB32_Premultiplied);
+        dirtyTiles.fill(true);
+    }
+
+    {
+        TRACE_SCOPE("LayerStack::compose");
+        ScopedTimer timer(perf_compose);
+        for(int ty = area.top() / LAYER_TILE_SIZE; ty <= area.bottom() / LAYER_TILE_SIZE; ++ty)
+        {
+            for(int tx = area.left() / LAYER_TILE_SIZE; tx <= area.right() / LAYER_TILE_SIZE; ++tx)
+            {
+                if(!dirtyTiles[ty * tilesX + tx])
+                    continue;
+
+                QRect tile(tx * LAYER_TILE_SIZE, ty * LAYER_TILE_SIZE, LAYER_TILE_SIZE, LAYER_TILE_SIZE);
+                compose(cache, tile.intersected(rect()));
+                dirtyTiles[ty * tilesX + tx] = false;
+            }
+        }
+    }
+
+    // la composicion parte de transparente, debajo se pinta blanco como en un lienzo nuevo
+    painter.fillRect(area, Qt::white);
+    painter.drawImage(area, cache, area);
+}
+
+/**
+ * @brief LayerStack::flatten: Devuelve todas las capas visibles mezcladas en una sola imagen.
+ */
+QImage LayerStack::flatten() const
+{
+    if(isTrivial())
+        return layers.first().image;
+
+    QImage result(size(), QImage::Format_ARGB32_Premultiplied);
+    compose(result, result.rect());
+    return result;
+}
+
+/**
+ * @brief LayerStack::composeRect: La composicion del rectangulo "rect" escrita en "target" desde (0, 0), sin tocar el
+ *                                 cache. "target" tiene que medir por lo menos lo mismo que "rect". Una capa de 8
+ *                                 bits se expande directamente en "target".
+ */
+void LayerStack::composeRect(QImage &target, const QRect &rect) const
+{
+    if(isTrivial())
+    {
+        const QImage &base = layers.first().image;
+        for(int y = 0; y < rect.height(); ++y)
+        {
+            QRgb *dst = reinterpret_cast<QRgb*>(target.scanLine(y));
+            const QRgb *src = fetchRow(base, rect.top() + y, rect.left(), rect.width(), dst);
+            if(src != dst)
+                std::copy_n(src, rect.width(), dst);
+        }
+        return;
+    }
+
+    compose(target, rect, rect.topLeft());
+}
+
+/**
+ * @brief LayerStack::byteCount: Memoria de las capas. Las imagenes compartidas se cuentan una sola vez, "seen"
+ *                               acumula las que ya se contaron.
+ */
+qint64 LayerStack::byteCount(QSet<qint64> *seen) const
+{
+    qint64 bytes = 0;
+    for(const Layer &layer : layers)
+        bytes += imageBytes(layer.image, seen);
+    return bytes;
+}
+
+/**
+ * @brief LayerStack::cacheBytes: Memoria del cache de la composicion (solo existe con mas de una capa o mezclas).
+ */
+qint64 LayerStack::cacheBytes(QSet<qint64> *seen) const
+{
+    return imageBytes(cache, seen);
+}
+
+/**
+ * @brief imageBytes: Tamaño de los pixeles de "image" si todavia no se conto. QImage comparte los datos entre
+ *                    copias, y todas las copias que comparten los datos tienen la misma "cacheKey".
+ */
+qint64 imageBytes(const QImage &image, QSet<qint64> *seen)
+{
+    if(image.isNull() || seen->contains(image.cacheKey()))
+        return 0;
+
+    seen->insert(image.cacheKey());
+    return image.sizeInBytes();
+}
+
+bool LayerStack::isTrivial() const
+{
+    const Layer &base = layers.first();
+    return layers.size() == 1 && base.visible && base.mode == normal_blend
+           && base.opacity == MAX_LAYER_OPACITY;
+}
+
+/**
+ * @brief LayerStack::compose: Mezcla las capas visibles en el rectangulo de "target" partiendo de transparente. Se
+ *                             recorre fila por fila y, en cada fila, capa por capa para que la fila destino se
+ *                             mantenga en cache mientras se mezclan todas las capas. "origin" es el punto del
+ *                             lienzo que corresponde a (0, 0) en "target". Las capas de 8 bits se expanden fila por
+ *                             fila en "row".
+ */
+void LayerStack::compose(QImage &target, const QRect &rect, const QPoint &origin) const
+{
+    QVector<const Layer*> visibleLayers;
+    for(const Layer &layer : layers)
+        if(layer.visible && layer.opacity > 0 && !layer.image.isNull())
+            visibleLayers.append(&layer);
+    QVector<QRgb> row(rect.width());
+
+    for(int y = rect.top(); y <= rect.bottom(); ++y)
+    {
+        QRgb *dst = reinterpret_cast<QRgb*>(target.scanLine(y - origin.y())) + rect.left() - origin.x();
+        std::fill(dst, dst + rect.width(), QRgb(0));
+
+        for(const Layer *layer : visibleLayers)
+        {
+            const QRgb *src = fetchRow(layer->image, y, rect.left(), rect.width(), row.data());
+            blendRowFunctions[layer->mode](dst, src, rect.width(), layer->opacity);
+        }
+    }
+}
+
+void LayerStack::resetCache()
+{
+    QSize canvas = size();
+    tilesX = (canvas.width() + LAYER_TILE_SIZE - 1) / LAYER_TILE_SIZE;
+    tilesY = (canvas.height() + LAYER_TILE_SIZE - 1) / LAYER_TILE_SIZE;
+    dirtyTiles = QVector<bool>(tilesX * tilesY, true);
+    cache = QImage();
+}
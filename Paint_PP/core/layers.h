@@ -0,0 +1,83 @@
+#ifndef LAYERS_H
+#define LAYERS_H
+
+#include <QImage>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <QSet>
+
+#include "constants.h"
+#include "pixel_format.h"
+
+
+class QPainter;
+
+struct Layer
+{
+    QString name;
+    QImage image;       // ARGB32_Premultiplied, o Indexed8 / Grayscale8 en los documentos de 8 bits
+    int opacity;        // 0 a MAX_LAYER_OPACITY
+    BlendMode mode;
+    bool visible;
+};
+
+
+/**
+ * LayerStack: Las capas del documento y el cache de su composicion. El cache esta dividido en mosaicos, cuando una
+ * capa cambia solo se marcan sucios los mosaicos del area modificada y al repintar solo esos se vuelven a componer,
+ * los demas se copian del cache sin importar cuantas capas haya.
+ */
+class LayerStack
+{
+public:
+    typedef QList<Layer> Snapshot;
+
+    LayerStack();
+
+    void reset(const QImage &background);
+    int count() const { return layers.size(); }
+    Layer* layer(int index) { return &layers[index]; }
+    const Layer* layer(int index) const { return &layers.at(index); }
+    Layer* activeLayer() { return &layers[active]; }
+    int activeIndex() const { return active; }
+    void setActiveIndex(int index);
+    QSize size() const { return layers.first().image.size(); }
+    QRect rect() const { return layers.first().image.rect(); }
+    PixelFormat pixelFormat() const { return pixelFormatOf(layers.first().image); }
+
+    void addLayer(const QString &name);
+    void removeLayer(int index);
+    void moveLayer(int index, int delta);
+    void scale(const QSize &size);
+    void transform(ImageTransform transform);
+
+    Snapshot snapshot() const;
+    void restore(const Snapshot &state, int activeIndex);
+
+    void invalidate(const QRect &rect);
+    void invalidateAll();
+    bool releaseCache();
+    void paint(QPainter &painter, const QRect &exposed);
+    QImage flatten() const;
+    void composeRect(QImage &target, const QRect &rect) const;
+    qint64 byteCount(QSet<qint64> *seen) const;
+    qint64 cacheBytes(QSet<qint64> *seen) const;
+
+private:
+    bool isTrivial() const;
+    void compose(QImage &target, const QRect &rect, const QPoint &origin = QPoint()) const;
+    void resetCache();
+
+    QList<Layer> layers;
+    int active;
+
+    QImage cache;
+    QVector<bool> dirtyTiles;
+    int tilesX;
+    int tilesY;
+};
+
+qint64 imageBytes(const QImage &image, QSet<qint64> *seen);
+
+#endif // LAYERS_H
@@ -0,0 +1,72 @@
+#include <QMutexLocker>
+
+#include "memory_accountant.h"
+#include "buffer_pool.h"
+
+
+MemoryReport& MemoryReport::operator+=(const MemoryReport &other)
+{
+    canvas += other.canvas;
+    caches += other.caches;
+    history += other.history;
+    previews += other.previews;
+    return *this;
+}
+
+MemoryAccountant::MemoryAccountant()
+{
+    limit = qint64(DEFAULT_MEMORY_BUDGET_MB) * 1024 * 1024;
+}
+
+MemoryAccountant* MemoryAccountant::instance()
+{
+    static MemoryAccountant accountant;
+    return &accountant;
+}
+
+/**
+ * @brief MemoryAccountant::update: Reemplaza lo que tenia registrado "owner" por su medicion actual.
+ */
+void MemoryAccountant::update(const void *owner, const MemoryReport &report)
+{
+    QMutexLocker locker(&mutex);
+    owners.insert(owner, report);
+}
+
+void MemoryAccountant::remove(const void *owner)
+{
+    QMutexLocker locker(&mutex);
+    owners.remove(owner);
+}
+
+/**
+ * @brief MemoryAccountant::report: Suma de todos los documentos por categoria, los buffers libres de la reserva se
+ *                                  cuentan como cache.
+ */
+MemoryReport MemoryAccountant::report() const
+{
+    MemoryReport total;
+    total.caches = BufferPool::instance()->idleBytes();
+
+    QMutexLocker locker(&mutex);
+    for(const MemoryReport &report : owners)
+        total += report;
+    return total;
+}
+
+qint64 MemoryAccountant::budget() const
+{
+    QMutexLocker locker(&mutex);
+    return limit;
+}
+
+void MemoryAccountant::setBudget(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    limit = bytes;
+}
+
+bool MemoryAccountant::overBudget() const
+{
+    return report().total() > budget();
+}
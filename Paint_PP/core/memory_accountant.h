@@ -0,0 +1,56 @@
+#ifndef MEMORY_ACCOUNTANT_H
+#define MEMORY_ACCOUNTANT_H
+
+#include <QHash>
+#include <QMutex>
+
+#include "constants.h"
+
+
+/**
+ * MemoryReport: Bytes de pixeles que retiene un documento, por categoria. Cada buffer compartido se cuenta una sola
+ * vez, en la primera categoria que lo usa (lienzo, caches, historial, vistas previas).
+ */
+struct MemoryReport
+{
+    qint64 canvas = 0;      // capas
+    qint64 caches = 0;      // cache de la composicion y buffers libres de la reserva
+    qint64 history = 0;     // pila de "undo", sin lo que ya comparte con las capas
+    qint64 previews = 0;    // imagen anterior del trazo, seleccion flotante
+
+    qint64 total() const { return canvas + caches + history + previews; }
+    MemoryReport& operator+=(const MemoryReport &other);
+};
+
+/**
+ * MemoryAccountant: Suma la memoria de todos los documentos abiertos y aplica un presupuesto global. Cada documento
+ * publica su propio MemoryReport con update() y, si el total pasa del presupuesto, es el mismo documento el que
+ * reduce su historial: asi nunca se toca un documento desde otro hilo (el procesamiento por lotes usa uno por hilo).
+ * Antes avisa con la senal Canvas::overBudget, la ventana la usa para liberar primero los documentos que estan en
+ * segundo plano, que viven en su mismo hilo.
+ */
+class MemoryAccountant
+{
+public:
+    static MemoryAccountant* instance();
+
+    void update(const void *owner, const MemoryReport &report);
+    void remove(const void *owner);
+
+    MemoryReport report() const;
+    qint64 budget() const;
+    void setBudget(qint64 bytes);
+    bool overBudget() const;
+
+private:
+    MemoryAccountant();
+
+    mutable QMutex mutex;
+    QHash<const void*, MemoryReport> owners;
+    qint64 limit;
+
+    MemoryAccountant(const MemoryAccountant&);
+    MemoryAccountant& operator=(const MemoryAccountant&);
+};
+
+#endif // MEMORY_ACCOUNTANT_H
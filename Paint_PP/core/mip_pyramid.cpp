@@ -0,0 +1,178 @@
+#include <algorithm>
+
+#include "mip_pyramid.h"
+#include "layers.h"
+#include "trace.h"
+
+
+QImage MipPyramid::empty;
+
+/**
+ * average4: Promedio de cuatro pixeles premultiplicados, dos canales por suma: cada canal ocupa 16 bits y la suma de
+ * cuatro valores de 8 bits no se desborda.
+ */
+static inline QRgb average4(QRgb a, QRgb b, QRgb c, QRgb d)
+{
+    quint32 rb = (a & 0x00ff00ff) + (b & 0x00ff00ff) + (c & 0x00ff00ff) + (d & 0x00ff00ff);
+    quint32 ag = ((a >> 8) & 0x00ff00ff) + ((b >> 8) & 0x00ff00ff) + ((c >> 8) & 0x00ff00ff)
+                 + ((d >> 8) & 0x00ff00ff);
+    return (((rb + 0x00020002) >> 2) & 0x00ff00ff) | ((((ag + 0x00020002) >> 2) & 0x00ff00ff) << 8);
+}
+
+/**
+ * downsample: Escribe en "dst" el area "rect" (en coordenadas de "dst") como el promedio de cada bloque de 2x2 del
+ * nivel anterior. "source" es la parte de ese nivel que esta en "src", empezando en (0, 0). En los bordes impares se
+ * repite la ultima fila o columna.
+ */
+static void downsample(const QImage &src, const QRect &source, QImage &dst, const QRect &rect)
+{
+    for(int y = rect.top(); y <= rect.bottom(); ++y)
+    {
+        int y0 = 2 * y - source.top();
+        int y1 = qMin(2 * y + 1, source.bottom()) - source.top();
+        const QRgb *row0 = reinterpret_cast<const QRgb*>(src.constScanLine(y0));
+        const QRgb *row1 = reinterpret_cast<const QRgb*>(src.constScanLine(y1));
+        QRgb *out = reinterpret_cast<QRgb*>(dst.scanLine(y));
+
+        for(int x = rect.left(); x <= rect.right(); ++x)
+        {
+            int x0 = 2 * x - source.left();
+            int x1 = qMin(2 * x + 1, source.right()) - source.left();
+            out[x] = average4(row0[x0], row0[x1], row1[x0], row1[x1]);
+        }
+    }
+}
+
+MipPyramid::MipPyramid()
+{
+    tilesX = 0;
+    tilesY = 0;
+    anyDirty = false;
+}
+
+void MipPyramid::invalidate(const QRect &rect)
+{
+    QRect area = rect.intersected(QRect(QPoint(0, 0), canvasSize));
+    if(area.isEmpty())
+        return;
+
+    for(int ty = area.top() / MIP_TILE_SIZE; ty <= area.bottom() / MIP_TILE_SIZE; ++ty)
+        for(int tx = area.left() / MIP_TILE_SIZE; tx <= area.right() / MIP_TILE_SIZE; ++tx)
+            dirtyTiles[ty * tilesX + tx] = true;
+    anyDirty = true;
+}
+
+void MipPyramid::invalidateAll()
+{
+    dirtyTiles.fill(true);
+    anyDirty = !dirtyTiles.isEmpty();
+}
+
+/**
+ * @brief MipPyramid::update: Vuelve a reducir los mosaicos marcados. Si el lienzo cambio de tamaño se rearma toda la
+ *                            piramide. Devuelve verdadero si cambio algun nivel.
+ */
+bool MipPyramid::update(const LayerStack &layers)
+{
+    if(layers.size() != canvasSize)
+        reset(layers.size());
+    if(!anyDirty)
+        return false;
+
+    TRACE_SCOPE("MipPyramid::update");
+    for(int ty = 0; ty < tilesY; ++ty)
+        for(int tx = 0; tx < tilesX; ++tx)
+            if(dirtyTiles[ty * tilesX + tx])
+            {
+                updateTile(layers, tx, ty);
+                dirtyTiles[ty * tilesX + tx] = false;
+            }
+
+    anyDirty = false;
+    return true;
+}
+
+/**
+ * @brief MipPyramid::levelFor: El nivel mas chico que todavia mide por lo menos "size" en algun lado, asi la miniatura
+ *                              solo escala una imagen pequeña.
+ */
+const QImage& MipPyramid::levelFor(const QSize &size) const
+{
+    if(mips.isEmpty())
+        return empty;
+
+    for(int i = mips.size() - 1; i > 0; --i)
+    {
+        const QImage &mip = mips.at(i);
+        if(mip.width() >= size.width() || mip.height() >= size.height())
+            return mip;
+    }
+    return mips.first();
+}
+
+qint64 MipPyramid::byteCount(QSet<qint64> *seen) const
+{
+    qint64 bytes = imageBytes(scratch, seen);
+    for(const QImage &mip : mips)
+        bytes += imageBytes(mip, seen);
+    return bytes;
+}
+
+/**
+ * @brief MipPyramid::reset: Niveles para un lienzo de "size", cada uno la mitad del anterior (redondeando hacia
+ *                           arriba) hasta que los dos lados miden MIP_MIN_SIZE o menos. Todo queda marcado.
+ */
+void MipPyramid::reset(const QSize &size)
+{
+    canvasSize = size;
+    mips.clear();
+
+    QSize mipSize = size;
+    while(mipSize.width() > MIP_MIN_SIZE || mipSize.height() > MIP_MIN_SIZE)
+    {
+        mipSize = QSize((mipSize.width() + 1) / 2, (mipSize.height() + 1) / 2);
+        mips.append(QImage(mipSize, QImage::Format_ARGB32_Premultiplied));
+    }
+    if(mips.isEmpty() && !size.isEmpty())
+        mips.append(QImage(size, QImage::Format_ARGB32_Premultiplied));
+
+    tilesX = (size.width() + MIP_TILE_SIZE - 1) / MIP_TILE_SIZE;
+    tilesY = (size.height() + MIP_TILE_SIZE - 1) / MIP_TILE_SIZE;
+    dirtyTiles = QVector<bool>(tilesX * tilesY, true);
+    anyDirty = !dirtyTiles.isEmpty();
+
+    if(scratch.isNull())
+        scratch = QImage(MIP_TILE_SIZE, MIP_TILE_SIZE, QImage::Format_ARGB32_Premultiplied);
+}
+
+/**
+ * @brief MipPyramid::updateTile: Compone el mosaico, lo reduce al primer nivel y sube por los demas recalculando solo
+ *                                el area que cubre el mosaico en cada uno.
+ */
+void MipPyramid::updateTile(const LayerStack &layers, int tx, int ty)
+{
+    QRect tile = QRect(tx * MIP_TILE_SIZE, ty * MIP_TILE_SIZE, MIP_TILE_SIZE, MIP_TILE_SIZE)
+                 .intersected(QRect(QPoint(0, 0), canvasSize));
+
+    // un lienzo mas chico que MIP_MIN_SIZE se muestra tal cual
+    if(mips.first().size() == canvasSize)
+    {
+        QImage &mip = mips.first();
+        layers.composeRect(scratch, tile);
+        for(int y = 0; y < tile.height(); ++y)
+            std::copy_n(reinterpret_cast<const QRgb*>(scratch.constScanLine(y)), tile.width(),
+                        reinterpret_cast<QRgb*>(mip.scanLine(tile.top() + y)) + tile.left());
+        return;
+    }
+
+    layers.composeRect(scratch, tile);
+    QRect area(tile.left() / 2, tile.top() / 2, (tile.width() + 1) / 2, (tile.height() + 1) / 2);
+    downsample(scratch, tile, mips[0], area);
+
+    for(int i = 1; i < mips.size(); ++i)
+    {
+        QRect next(QPoint(area.left() / 2, area.top() / 2), QPoint(area.right() / 2, area.bottom() / 2));
+        downsample(mips.at(i - 1), mips.at(i - 1).rect(), mips[i], next);
+        area = next;
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef MIP_PYRAMID_H
+#define MIP_PYRAMID_H
+
+#include <QImage>
+#include <QVector>
+#include <QSet>
+
+#include "constants.h"
+
+
+class LayerStack;
+
+/**
+ * MipPyramid: Reducciones sucesivas a la mitad de la composicion del lienzo, para el navegador. El lienzo se divide en
+ * mosaicos de MIP_TILE_SIZE; invalidate() solo los marca y update() vuelve a reducir los marcados, subiendo por todos
+ * los niveles solo el area que cubre cada mosaico. Un trazo nunca reduce la imagen completa.
+ */
+class MipPyramid
+{
+public:
+    MipPyramid();
+
+    void invalidate(const QRect &rect);
+    void invalidateAll();
+    bool update(const LayerStack &layers);
+
+    int levels() const { return mips.size(); }
+    const QImage& level(int index) const { return mips.at(index); }
+    const QImage& levelFor(const QSize &size) const;
+    qint64 byteCount(QSet<qint64> *seen) const;
+
+private:
+    void reset(const QSize &size);
+    void updateTile(const LayerStack &layers, int tx, int ty);
+
+    QSize canvasSize;
+    QVector<QImage> mips;       // mips[0] es la mitad del lienzo
+    QVector<bool> dirtyTiles;
+    int tilesX;
+    int tilesY;
+    bool anyDirty;
+    QImage scratch;             // composicion de un mosaico
+
+    static QImage empty;
+};
+
+#endif // MIP_PYRAMID_H
@@ -0,0 +1,303 @@
+#include <QFile>
+#include <QImage>
+#include <QPen>
+
+#include "op_log.h"
+#include "canvas.h"
+
+
+OpLog::OpLog()
+    : out(&buffer, QIODevice::WriteOnly)
+{
+    lastTime = 0;
+    records = 0;
+    journalStart = 0;
+    journalRecords = 0;
+    recording = false;
+    journaling = false;
+}
+
+/**
+ * @brief OpLog::start: Descarta lo grabado y escribe el encabezado. La version de QDataStream se fija para que el
+ *                      archivo se lea igual con cualquier version de Qt.
+ */
+void OpLog::start()
+{
+    // lo que el diario todavia no se llevo se guarda aparte antes de descartar el buffer
+    if(journaling)
+        journal += buffer.mid(journalStart);
+
+    buffer.clear();
+    out.device()->seek(0);
+    out.resetStatus();
+    out.setVersion(QDataStream::Qt_5_0);
+    out << OP_LOG_MAGIC << OP_LOG_VERSION;
+    journalStart = buffer.size();
+
+    clock.start();
+    lastTime = 0;
+    records = 0;
+    recording = true;
+}
+
+/**
+ * @brief OpLog::stop: Lo grabado queda en "recorded" para guardarlo, el buffer puede seguir usandose para el diario.
+ */
+void OpLog::stop()
+{
+    recorded = buffer;
+    recording = false;
+}
+
+/**
+ * @brief OpLog::setJournaling: Activa o desactiva el diario. Si no se estaba grabando el buffer empieza vacio, sin
+ *                              encabezado, y el reloj arranca de cero.
+ */
+void OpLog::setJournaling(bool on)
+{
+    if(on && !isRecording())
+    {
+        buffer.clear();
+        out.device()->seek(0);
+        out.resetStatus();
+        out.setVersion(QDataStream::Qt_5_0);
+        clock.start();
+        lastTime = 0;
+    }
+
+    journal.clear();
+    journalStart = buffer.size();
+    journalRecords = 0;
+    journaling = on;
+}
+
+/**
+ * @brief OpLog::takeJournal: Devuelve los registros escritos desde la ultima llamada. Se llama entre operaciones, asi
+ *                            el ultimo registro ya tiene todos sus argumentos. Si el usuario no esta grabando el buffer
+ *                            se vacia para que no crezca durante toda la sesion. "count" recibe cuantos registros
+ *                            se entregan.
+ */
+QByteArray OpLog::takeJournal(int *count)
+{
+    QByteArray taken = journal + buffer.mid(journalStart);
+    journal.clear();
+    if(count)
+        *count = journalRecords;
+    journalRecords = 0;
+
+    if(recording)
+    {
+        journalStart = buffer.size();
+        return taken;
+    }
+
+    buffer.clear();
+    out.device()->seek(0);
+    journalStart = 0;
+    return taken;
+}
+
+/**
+ * @brief OpLog::write: Escribe el encabezado de un registro (codigo y tiempo) y devuelve el flujo para que quien
+ *                      llama agregue los argumentos.
+ */
+QDataStream& OpLog::write(OpCode code)
+{
+    qint64 now = clock.elapsed();
+    quint32 delay = quint32(qMin<qint64>(now - lastTime, 0xffffffff));
+    lastTime = now;
+    records++;
+    if(journaling)
+        journalRecords++;
+
+    out << quint8(code) << delay;
+    return out;
+}
+
+/**
+ * @brief OpLog::writePoint: Registro de un punto del trazo, las coordenadas se limitan a 16 bits.
+ */
+void OpLog::writePoint(OpCode code, const QPoint &point)
+{
+    write(code) << qint16(qBound(-32768, point.x(), 32767)) << qint16(qBound(-32768, point.y(), 32767));
+}
+
+/**
+ * @brief OpLog::save: Guarda la grabacion (la que sigue en curso o la ultima terminada). No se usa "buffer": despues de
+ *                     stop() el diario lo vacia en cada takeJournal().
+ */
+bool OpLog::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+
+    const QByteArray &recording = data();
+    return file.write(recording) == recording.size();
+}
+
+bool OpLog::load(const QString &fileName, QByteArray *data)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    *data = file.readAll();
+    return true;
+}
+
+
+/**
+ * @brief OpPlayer::OpPlayer: Verifica el encabezado y lee el primer registro.
+ */
+OpPlayer::OpPlayer(Canvas *canvas, const QByteArray &data)
+    : buffer(data), in(&buffer, QIODevice::ReadOnly)
+{
+    this->canvas = canvas;
+    steps = 0;
+    pending = false;
+    pendingCode = op_snapshot;
+    pendingDelay = 0;
+    elapsed = 0;
+
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    valid = magic == OP_LOG_MAGIC && version == OP_LOG_VERSION;
+
+    if(valid)
+        readHeader();
+}
+
+/**
+ * @brief OpPlayer::~OpPlayer: El lienzo vuelve a usar su propio reloj.
+ */
+OpPlayer::~OpPlayer()
+{
+    canvas->setReplayTime(-1);
+}
+
+void OpPlayer::readHeader()
+{
+    quint8 code = 0;
+    quint32 delay = 0;
+    in >> code >> delay;
+
+    pending = in.status() == QDataStream::Ok && code <= op_transform;
+    pendingCode = OpCode(code);
+    pendingDelay = delay;
+}
+
+/**
+ * @brief OpPlayer::step: Ejecuta el siguiente registro sobre el lienzo. Devuelve falso al terminar o si el registro
+ *                        esta dañado.
+ */
+bool OpPlayer::step()
+{
+    if(!pending)
+        return false;
+
+    qint16 x = 0, y = 0;
+    qint8 value8 = 0;
+    qint32 value = 0;
+    bool flag = false;
+    QSize size;
+    QColor color;
+    QImage image;
+
+    // el lienzo usa el tiempo grabado de cada operacion para unir los trazos igual que al grabar
+    elapsed += pendingDelay;
+    canvas->setReplayTime(elapsed);
+
+    switch(pendingCode)
+    {
+        case op_snapshot: canvas->readSnapshot(in);   break;
+        case op_tool_state: applyToolState();         break;
+        case op_begin: in >> x >> y; canvas->beginStroke(QPoint(x, y)); break;
+        case op_move:  in >> x >> y; canvas->moveStroke(QPoint(x, y));  break;
+        case op_end:   in >> x >> y; canvas->endStroke(QPoint(x, y));   break;
+        case op_end_poly: canvas->endPolyline();      break;
+        case op_select_tool: in >> value8; canvas->setCurrentTool(value8);        break;
+        case op_line_mode:   in >> value8; canvas->setLineMode(DrawType(value8)); break;
+        case op_color: in >> color >> value8; canvas->updateColorConfig(color, value8); break;
+        case op_new_image: in >> size >> value8; canvas->createNewImage(size, PixelFormat(value8)); break;
+        case op_load_image: in >> image; canvas->openImage(image);    break;
+        case op_resize: in >> size; canvas->resizeImage(size);        break;
+        case op_clear: canvas->clearImage();                          break;
+        case op_undo: canvas->undo();                                 break;
+        case op_redo: canvas->redo();                                 break;
+        case op_cut: canvas->cutSelection();                          break;
+        case op_paste: in >> image; canvas->pasteImage(image);        break;
+        case op_filter:
+        {
+            FilterParams params;
+            qint32 radius = 0, amount = 0;
+            in >> value8 >> radius >> amount;
+            params.type = FilterType(value8);
+            params.radius = radius;
+            params.amount = amount;
+            canvas->applyFilter(params);
+        } break;
+        case op_adjust:
+        {
+            ColorPipeline pipeline;
+            pipeline.read(in);
+            canvas->applyAdjustments(pipeline);
+        } break;
+        case op_add_layer: canvas->OnAddLayer();       break;
+        case op_remove_layer: canvas->OnRemoveLayer(); break;
+        case op_layer_up: canvas->OnLayerUp();         break;
+        case op_layer_down: canvas->OnLayerDown();     break;
+        case op_select_layer: in >> value; canvas->OnSelectLayer(value);       break;
+        case op_layer_opacity: in >> value; canvas->OnLayerOpacity(value);     break;
+        case op_layer_blend: in >> value; canvas->OnLayerBlendMode(value);     break;
+        case op_layer_visibility: in >> flag; canvas->OnLayerVisibility(flag); break;
+        case op_transform: in >> value8; canvas->transformImage(ImageTransform(value8)); break;
+        default: break;
+    }
+
+    if(in.status() != QDataStream::Ok)
+    {
+        pending = false;
+        return false;
+    }
+
+    steps++;
+    readHeader();
+    return true;
+}
+
+/**
+ * @brief OpPlayer::runAll: Reproduce todo el registro sin esperas (modo sin ventana).
+ */
+void OpPlayer::runAll()
+{
+    while(step())
+        ;
+}
+
+/**
+ * @brief OpPlayer::applyToolState: Deja la herramienta con el mismo trazo (QPen) y relleno que tenia al grabar.
+ */
+void OpPlayer::applyToolState()
+{
+    qint8 type = 0;
+    QPen pen;
+    in >> type >> pen;
+
+    Tool *tool = canvas->setCurrentTool(type);
+    static_cast<QPen&>(*tool) = pen;
+
+    if(type == shapes_tool)
+    {
+        qint8 shape = 0, fill = 0;
+        QColor fillColor;
+        in >> shape >> fill >> fillColor;
+
+        ShapesTool *shapes = static_cast<ShapesTool*>(tool);
+        shapes->setShapeType(ShapeType(shape));
+        shapes->setFillMode(FillColor(fill));
+        shapes->setFillColor(fillColor);
+    }
+}
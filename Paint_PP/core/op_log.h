@@ -0,0 +1,96 @@
+#ifndef OP_LOG_H
+#define OP_LOG_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QPoint>
+
+#include "constants.h"
+
+
+class Canvas;
+
+/**
+ * OpLog: Registro binario de las operaciones hechas sobre el lienzo (no de los pixeles). Cada registro es el codigo
+ * de la operacion, los milisegundos desde el registro anterior y sus argumentos; los puntos se guardan en 16 bits.
+ * Al iniciar se guarda el estado completo del documento, asi el registro se puede reproducir desde cero.
+ * Con el diario activo (setJournaling) se registra siempre y takeJournal() entrega los registros nuevos, sin
+ * encabezado, al registro de recuperacion; la grabacion del usuario sigue funcionando igual al mismo tiempo.
+ */
+class OpLog
+{
+public:
+    OpLog();
+
+    void start();
+    void stop();
+    bool isRecording() const { return recording || journaling; }
+    void setJournaling(bool on);
+    QByteArray takeJournal(int *count = 0);
+    int count() const { return records; }
+    qint64 lastTimestamp() const { return lastTime; }
+
+    QDataStream& write(OpCode code);
+    void writePoint(OpCode code, const QPoint &point);
+
+    const QByteArray& data() const { return recording ? buffer : recorded; }
+    bool save(const QString &fileName) const;
+    static bool load(const QString &fileName, QByteArray *data);
+
+private:
+    QByteArray buffer;
+    QByteArray recorded;
+    QByteArray journal;
+    int journalStart;
+    int journalRecords;
+    QDataStream out;
+    QElapsedTimer clock;
+    qint64 lastTime;
+    int records;
+    bool recording;
+    bool journaling;
+
+    OpLog(const OpLog&);
+    OpLog& operator=(const OpLog&);
+};
+
+
+/**
+ * OpPlayer: Reproduce un registro sobre un Canvas. Las operaciones se ejecutan con los mismos metodos que usa la
+ * ventana, por eso el resultado es el mismo que al grabarlo. nextDelay() devuelve la espera original antes de la
+ * siguiente operacion para reproducir a la misma velocidad; sin ventana se llama a runAll().
+ */
+class OpPlayer
+{
+public:
+    OpPlayer(Canvas *canvas, const QByteArray &data);
+    ~OpPlayer();
+
+    bool isValid() const { return valid; }
+    bool atEnd() const { return !pending; }
+    qint64 nextDelay() const { return pendingDelay; }
+    int played() const { return steps; }
+
+    bool step();
+    void runAll();
+
+private:
+    void readHeader();
+    void applyToolState();
+
+    Canvas* canvas;
+    QByteArray buffer;
+    QDataStream in;
+    bool valid;
+    bool pending;
+    OpCode pendingCode;
+    qint64 pendingDelay;
+    qint64 elapsed;
+    int steps;
+
+    OpPlayer(const OpPlayer&);
+    OpPlayer& operator=(const OpPlayer&);
+};
+
+#endif // OP_LOG_H
@@ -0,0 +1,69 @@
+#include "perf_stats.h"
+
+
+bool PerfStats::enabled = false;
+PerfStats::Sample PerfStats::samples[perf_counter_count] = {};
+qint64 PerfStats::lastArea = 0;
+qint64 PerfStats::currentStroke = 0;
+qint64 PerfStats::lastStroke = 0;
+
+/**
+ * @brief PerfStats::setEnabled: Activa o desactiva las mediciones, al activarlas se empieza desde cero.
+ */
+void PerfStats::setEnabled(bool enabled)
+{
+    PerfStats::enabled = enabled;
+    reset();
+    lastArea = 0;
+    currentStroke = 0;
+    lastStroke = 0;
+}
+
+void PerfStats::add(PerfCounter counter, qint64 nsecs)
+{
+    Sample &sample = samples[counter];
+    sample.last = nsecs;
+    sample.worst = qMax(sample.worst, nsecs);
+    sample.total += nsecs;
+    sample.count++;
+
+    if(counter == perf_tool)
+        currentStroke += nsecs;
+}
+
+/**
+ * @brief PerfStats::addPaintArea: Pixeles repintados en el ultimo cuadro.
+ */
+void PerfStats::addPaintArea(qint64 pixels)
+{
+    if(enabled)
+        lastArea = pixels;
+}
+
+/**
+ * @brief PerfStats::beginStroke: Empieza a sumar el tiempo de la herramienta de un trazo completo.
+ */
+void PerfStats::beginStroke()
+{
+    currentStroke = 0;
+}
+
+void PerfStats::endStroke()
+{
+    if(enabled)
+        lastStroke = currentStroke;
+}
+
+/**
+ * @brief PerfStats::reset: Empieza una nueva ventana de medicion (peor caso y promedio), la ultima medicion se
+ *                          conserva.
+ */
+void PerfStats::reset()
+{
+    for(int i = 0; i < perf_counter_count; i++)
+    {
+        samples[i].worst = 0;
+        samples[i].total = 0;
+        samples[i].count = 0;
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef PERF_STATS_H
+#define PERF_STATS_H
+
+#include <QElapsedTimer>
+
+#include "constants.h"
+
+
+/**
+ * PerfStats: Tiempos de las rutas criticas para el HUD de rendimiento. Cada contador guarda la ultima medicion, la
+ * peor y el promedio desde el ultimo reset(). Solo se usa desde el hilo de la interfaz, y deshabilitado no mide nada:
+ * ScopedTimer solo consulta un bool.
+ */
+class PerfStats
+{
+public:
+    struct Sample
+    {
+        qint64 last;
+        qint64 worst;
+        qint64 total;
+        int count;
+    };
+
+    static bool isEnabled() { return enabled; }
+    static void setEnabled(bool enabled);
+
+    static void add(PerfCounter counter, qint64 nsecs);
+    static void addPaintArea(qint64 pixels);
+    static void beginStroke();
+    static void endStroke();
+
+    static Sample sample(PerfCounter counter) { return samples[counter]; }
+    static qint64 paintArea() { return lastArea; }
+    static qint64 strokeTime() { return lastStroke; }
+    static void reset();
+
+private:
+    static bool enabled;
+    static Sample samples[perf_counter_count];
+    static qint64 lastArea;
+    static qint64 currentStroke;
+    static qint64 lastStroke;
+};
+
+/**
+ * ScopedTimer: Mide el tiempo hasta el final del bloque y lo suma al contador, si el HUD esta activo.
+ */
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(PerfCounter counter)
+        : counter(counter), active(PerfStats::isEnabled())
+    {
+        if(active)
+            timer.start();
+    }
+
+    ~ScopedTimer()
+    {
+        if(active)
+            PerfStats::add(counter, timer.nsecsElapsed());
+    }
+
+private:
+    PerfCounter counter;
+    bool active;
+    QElapsedTimer timer;
+
+    ScopedTimer(const ScopedTimer&);
+    ScopedTimer& operator=(const ScopedTimer&);
+};
+
+#endif // PERF_STATS_H
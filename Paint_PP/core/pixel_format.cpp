@@ -0,0 +1,245 @@
+#include <climits>
+#include <cstring>
+#include <utility>
+
+#include "pixel_format.h"
+
+
+PixelFormat pixelFormatOf(const QImage &image)
+{
+    switch(image.format())
+    {
+        case QImage::Format_Indexed8:   return indexed_pixels;
+        case QImage::Format_Grayscale8: return grayscale_pixels;
+        default:                        return rgb_pixels;
+    }
+}
+
+/**
+ * createLayerImage: Imagen sin inicializar para la capa de un documento nuevo. Los documentos Indexed8 empiezan con
+ * defaultPalette().
+ */
+QImage createLayerImage(const QSize &size, PixelFormat format)
+{
+    switch(format)
+    {
+        case indexed_pixels:
+        {
+            QImage image(size, QImage::Format_Indexed8);
+            image.setColorTable(defaultPalette());
+            return image;
+        }
+        case grayscale_pixels: return QImage(size, QImage::Format_Grayscale8);
+        default:               return QImage(size, QImage::Format_ARGB32_Premultiplied);
+    }
+}
+
+/**
+ * layerImage: Una imagen abierta en el formato de las capas. Las imagenes de 8 bits o menos (BMP con paleta) se
+ * quedan en 8 bits: en Grayscale8 si la paleta es de grises y en Indexed8 con su misma paleta si no. Las demas pasan
+ * a ARGB32 premultiplicado.
+ */
+QImage layerImage(const QImage &image)
+{
+    if(image.isNull())
+        return image;
+
+    switch(image.format())
+    {
+        case QImage::Format_Grayscale8:
+            return image;
+        case QImage::Format_Indexed8:
+        case QImage::Format_Mono:
+        case QImage::Format_MonoLSB:
+            if(image.isGrayscale())
+                return image.convertToFormat(QImage::Format_Grayscale8);
+            return image.format() == QImage::Format_Indexed8 ? image : image.convertToFormat(QImage::Format_Indexed8);
+        case QImage::Format_ARGB32_Premultiplied:
+            return image;
+        default:
+            return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+}
+
+/**
+ * conformTo: "pixels" en el formato de "layer", para reemplazar pixeles de la capa (filtros, ajustes, pegar). En
+ * Indexed8 cada color pasa al mas cercano de la paleta de la capa.
+ */
+QImage conformTo(QImage pixels, const QImage &layer)
+{
+    if(pixels.isNull() || layer.isNull())
+        return pixels;
+
+    if(layer.format() == QImage::Format_Indexed8)
+    {
+        if(pixels.format() == QImage::Format_Indexed8 && pixels.colorTable() == layer.colorTable())
+            return pixels;
+        return pixels.convertToFormat(QImage::Format_Indexed8, layer.colorTable());
+    }
+
+    if(pixels.format() == layer.format())
+        return pixels;
+    return std::move(pixels).convertToFormat(layer.format());
+}
+
+/**
+ * indexedImage: Una capa de 8 bits como Indexed8, para los formatos que guardan una paleta (BMP). Grayscale8 usa los
+ * mismos bytes con una paleta de 256 grises, sin convertir ningun pixel.
+ */
+QImage indexedImage(const QImage &image)
+{
+    if(image.format() != QImage::Format_Grayscale8)
+        return image;
+
+    QVector<QRgb> ramp(PALETTE_SIZE);
+    for(int i = 0; i < ramp.size(); ++i)
+        ramp[i] = qRgb(i, i, i);
+
+    QImage indexed(image.size(), QImage::Format_Indexed8);
+    copyPixels(image, image.rect(), indexed, QPoint(0, 0));
+    indexed.setColorTable(ramp);
+    return indexed;
+}
+
+/**
+ * inkView: Los bytes de una capa de 8 bits vistos como Grayscale8, sin copiarlos. Pintar sobre la vista modifica la
+ * capa; la vista deja de ser valida si la capa se desacopla o se reemplaza.
+ */
+QImage inkView(QImage &layer)
+{
+    return QImage(layer.bits(), layer.width(), layer.height(), layer.bytesPerLine(), QImage::Format_Grayscale8);
+}
+
+/**
+ * inkColor: El color con el que pintan las herramientas sobre "layer". En Indexed8 es el gris del indice del color
+ * mas cercano de la paleta, para pintar sobre inkView(); en los demas formatos es el mismo color.
+ */
+QColor inkColor(const QImage &layer, const QColor &color)
+{
+    if(layer.format() != QImage::Format_Indexed8)
+        return color;
+
+    int index = nearestIndex(layer.colorTable(), color.rgba());
+    return QColor(index, index, index);
+}
+
+/**
+ * shownColor: Como se ve "color" una vez pintado en "layer", para las vistas previas que se pintan encima del lienzo.
+ */
+QColor shownColor(const QImage &layer, const QColor &color)
+{
+    switch(layer.format())
+    {
+        case QImage::Format_Indexed8:
+        {
+            QVector<QRgb> palette = layer.colorTable();
+            return QColor::fromRgba(palette.value(nearestIndex(palette, color.rgba())));
+        }
+        case QImage::Format_Grayscale8:
+        {
+            int gray = qGray(color.rgb());
+            return QColor(gray, gray, gray);
+        }
+        default:
+            return color;
+    }
+}
+
+/**
+ * defaultPalette: La paleta de los documentos Indexed8 nuevos: un cubo de PALETTE_CUBE_LEVELS niveles por canal
+ * (incluye el negro, el blanco y los colores primarios) y grises intermedios hasta completar PALETTE_SIZE colores.
+ */
+QVector<QRgb> defaultPalette()
+{
+    static const QVector<QRgb> palette = [] {
+        QVector<QRgb> colors;
+        colors.reserve(PALETTE_SIZE);
+        const int step = 255 / (PALETTE_CUBE_LEVELS - 1);
+        for(int r = 0; r < PALETTE_CUBE_LEVELS; ++r)
+            for(int g = 0; g < PALETTE_CUBE_LEVELS; ++g)
+                for(int b = 0; b < PALETTE_CUBE_LEVELS; ++b)
+                    colors.append(qRgb(r * step, g * step, b * step));
+
+        const int grays = PALETTE_SIZE - colors.size();
+        for(int i = 1; i <= grays; ++i)
+        {
+            int value = i * 255 / (grays + 1);
+            colors.append(qRgb(value, value, value));
+        }
+        return colors;
+    }();
+    return palette;
+}
+
+/**
+ * nearestIndex: El indice del color de "palette" mas cercano a "color" (distancia euclidiana en RGBA).
+ */
+int nearestIndex(const QVector<QRgb> &palette, QRgb color)
+{
+    int best = 0;
+    int bestDistance = INT_MAX;
+    for(int i = 0; i < palette.size(); ++i)
+    {
+        QRgb entry = palette.at(i);
+        int dr = qRed(entry) - qRed(color);
+        int dg = qGreen(entry) - qGreen(color);
+        int db = qBlue(entry) - qBlue(color);
+        int da = qAlpha(entry) - qAlpha(color);
+        int distance = dr * dr + dg * dg + db * db + da * da;
+        if(distance < bestDistance)
+        {
+            best = i;
+            bestDistance = distance;
+            if(distance == 0)
+                break;
+        }
+    }
+    return best;
+}
+
+/**
+ * fetchRow: "count" pixeles de la fila "y" desde "x" en ARGB32 premultiplicado. Las imagenes de 32 bits se leen en su
+ * lugar; las de 8 bits se expanden en "buffer", que tiene que tener lugar para "count" pixeles.
+ */
+const QRgb* fetchRow(const QImage &image, int y, int x, int count, QRgb *buffer)
+{
+    const uchar *src = image.constScanLine(y) + x;
+    switch(image.format())
+    {
+        case QImage::Format_Grayscale8:
+            for(int i = 0; i < count; ++i)
+                buffer[i] = 0xff000000 | (src[i] * 0x010101u);
+            return buffer;
+        case QImage::Format_Indexed8:
+        {
+            const QVector<QRgb> palette = image.colorTable();
+            for(int i = 0; i < count; ++i)
+                buffer[i] = qPremultiply(palette.value(src[i]));
+            return buffer;
+        }
+        default:
+            return reinterpret_cast<const QRgb*>(image.constScanLine(y)) + x;
+    }
+}
+
+/**
+ * copyPixels: Reemplaza (sin mezclar) los pixeles de "target" en "to" por el rectangulo "from" de "source", fila por
+ * fila. Las dos imagenes tienen que tener el mismo formato; lo que queda fuera de alguna de las dos no se copia.
+ */
+void copyPixels(const QImage &source, const QRect &from, QImage &target, const QPoint &to)
+{
+    if(source.depth() != target.depth() || target.depth() < 8)
+        return;
+
+    QPoint delta = to - from.topLeft();
+    QRect area = from.intersected(source.rect()).translated(delta).intersected(target.rect());
+    if(area.isEmpty())
+        return;
+
+    const int bytes = target.depth() / 8;
+    const int stride = target.bytesPerLine();
+    uchar *bits = target.bits();
+    for(int y = area.top(); y <= area.bottom(); ++y)
+        memcpy(bits + qptrdiff(y) * stride + area.left() * bytes,
+               source.constScanLine(y - delta.y()) + (area.left() - delta.x()) * bytes, size_t(area.width()) * bytes);
+}
@@ -0,0 +1,34 @@
+#ifndef PIXEL_FORMAT_H
+#define PIXEL_FORMAT_H
+
+#include <QImage>
+#include <QColor>
+#include <QVector>
+
+#include "constants.h"
+
+
+/**
+ * Formatos de los pixeles de un documento. Un documento RGB guarda sus capas en ARGB32 premultiplicado; los de 8 bits
+ * guardan un byte por pixel, en Indexed8 (indices a una paleta de hasta PALETTE_SIZE colores) o en Grayscale8, y
+ * tienen una sola capa porque no tienen canal alfa. Los trazos, el historial y los BMP de 8 bits mueven la cuarta
+ * parte de los bytes.
+ *
+ * QPainter pinta sobre Grayscale8 pero no sobre Indexed8: las herramientas pintan sobre inkView(), los mismos bytes
+ * vistos como Grayscale8, con el gris cuyo valor es el indice del color (inkColor). Las herramientas no usan
+ * antialiasing y sus colores son opacos, asi cada pixel pintado recibe exactamente ese indice.
+ */
+PixelFormat pixelFormatOf(const QImage &image);
+QImage createLayerImage(const QSize &size, PixelFormat format);
+QImage layerImage(const QImage &image);
+QImage conformTo(QImage pixels, const QImage &layer);
+QImage indexedImage(const QImage &image);
+QImage inkView(QImage &layer);
+QColor inkColor(const QImage &layer, const QColor &color);
+QColor shownColor(const QImage &layer, const QColor &color);
+QVector<QRgb> defaultPalette();
+int nearestIndex(const QVector<QRgb> &palette, QRgb color);
+const QRgb* fetchRow(const QImage &image, int y, int x, int count, QRgb *buffer);
+void copyPixels(const QImage &source, const QRect &from, QImage &target, const QPoint &to);
+
+#endif // PIXEL_FORMAT_H
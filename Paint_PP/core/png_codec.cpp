@@ -0,0 +1,513 @@
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <QtEndian>
+#include <QtZlib/zlib.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "png_codec.h"
+#include "image_io.h"
+#include "trace.h"
+
+
+static const uchar PNG_SIGNATURE[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+static const uchar ZLIB_HEADER[2] = {0x78, 0x9c};   // deflate con ventana de 32 KB, sin diccionario
+static const int DEFLATE_WINDOW = 32768;
+
+static const int PNG_GRAY = 0;
+static const int PNG_RGB = 2;
+static const int PNG_PALETTE = 3;
+static const int PNG_GRAY_ALPHA = 4;
+static const int PNG_RGBA = 6;
+
+static int channelsOf(int colorType)
+{
+    switch(colorType)
+    {
+        case PNG_GRAY:       return 1;
+        case PNG_RGB:        return 3;
+        case PNG_PALETTE:    return 1;
+        case PNG_GRAY_ALPHA: return 2;
+        case PNG_RGBA:       return 4;
+        default:             return 0;
+    }
+}
+
+static inline int paeth(int left, int up, int upLeft)
+{
+    const int p = left + up - upLeft;
+    const int pa = abs(p - left), pb = abs(p - up), pc = abs(p - upLeft);
+    return pa <= pb && pa <= pc ? left : (pb <= pc ? up : upLeft);
+}
+
+/**
+ * unfilterRow: Deshace el filtro de una fila (el primer byte es el tipo de filtro) con la fila anterior ya
+ * reconstruida, que tiene el mismo formato. Falso si el tipo no existe.
+ */
+static bool unfilterRow(uchar *row, const uchar *prior, int bytes, int bpp)
+{
+    uchar *current = row + 1;
+    const uchar *up = prior + 1;
+    switch(row[0])
+    {
+        case 0:
+            return true;
+        case 1:
+            for(int i = bpp; i < bytes; ++i)
+                current[i] = uchar(current[i] + current[i - bpp]);
+            return true;
+        case 2:
+            for(int i = 0; i < bytes; ++i)
+                current[i] = uchar(current[i] + up[i]);
+            return true;
+        case 3:
+            for(int i = 0; i < bytes; ++i)
+                current[i] = uchar(current[i] + (((i >= bpp ? current[i - bpp] : 0) + up[i]) >> 1));
+            return true;
+        case 4:
+            for(int i = 0; i < bytes; ++i)
+                current[i] = uchar(current[i] + paeth(i >= bpp ? current[i - bpp] : 0, up[i],
+                                                      i >= bpp ? up[i - bpp] : 0));
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * storeRow: Pasa una fila reconstruida a la imagen. Gris y paleta se copian tal cual, los demas se arman en QRgb.
+ */
+static void storeRow(const uchar *source, int colorType, int width, uchar *target)
+{
+    QRgb *pixels = reinterpret_cast<QRgb*>(target);
+    switch(colorType)
+    {
+        case PNG_GRAY:
+        case PNG_PALETTE:
+            memcpy(target, source, size_t(width));
+            break;
+        case PNG_RGB:
+            for(int x = 0; x < width; ++x, source += 3)
+                pixels[x] = qRgb(source[0], source[1], source[2]);
+            break;
+        case PNG_GRAY_ALPHA:
+            for(int x = 0; x < width; ++x, source += 2)
+                pixels[x] = qRgba(source[0], source[0], source[0], source[1]);
+            break;
+        default:
+            for(int x = 0; x < width; ++x, source += 4)
+                pixels[x] = qRgba(source[0], source[1], source[2], source[3]);
+            break;
+    }
+}
+
+/**
+ * Inflater: El flujo zlib de los IDAT, se libera en todas las salidas de readPng.
+ */
+struct Inflater
+{
+    z_stream stream;
+    bool ready;
+
+    Inflater()
+    {
+        memset(&stream, 0, sizeof(stream));
+        ready = inflateInit(&stream) == Z_OK;
+    }
+    ~Inflater()
+    {
+        if(ready)
+            inflateEnd(&stream);
+    }
+};
+
+bool readPng(QIODevice *device, QImage *image)
+{
+    StreamReader in(device);
+    uchar signature[8];
+    if(!in.read(signature, 8) || memcmp(signature, PNG_SIGNATURE, 8) != 0)
+        return false;
+
+    uchar header[8 + 13 + 4];   // largo y tipo, IHDR y su CRC
+    if(!in.read(header, sizeof(header)) || qFromBigEndian<quint32>(header) != 13 || memcmp(header + 4, "IHDR", 4) != 0)
+        return false;
+
+    const uchar *ihdr = header + 8;
+    const qint32 width = qFromBigEndian<qint32>(ihdr);
+    const qint32 height = qFromBigEndian<qint32>(ihdr + 4);
+    const int bitDepth = ihdr[8];
+    const int colorType = ihdr[9];
+    const int channels = channelsOf(colorType);
+    if(width <= 0 || height <= 0 || bitDepth != 8 || channels == 0 || ihdr[10] != 0 || ihdr[11] != 0 || ihdr[12] != 0)
+        return false;
+
+    QImage::Format format = colorType == PNG_GRAY ? QImage::Format_Grayscale8
+                          : colorType == PNG_PALETTE ? QImage::Format_Indexed8
+                          : colorType == PNG_RGB ? QImage::Format_RGB32 : QImage::Format_ARGB32;
+    QImage decoded(width, height, format);
+    Inflater inflater;
+    if(decoded.isNull() || !inflater.ready)
+        return false;
+
+    TRACE_SCOPE("readPng");
+    const int rowBytes = width * channels;
+    std::vector<uchar> current(size_t(rowBytes) + 1), prior(size_t(rowBytes) + 1, 0);
+    std::vector<uchar> input(STREAM_CHUNK_BYTES);
+    uchar *bits = decoded.bits();
+    const int stride = decoded.bytesPerLine();
+    QVector<QRgb> palette;
+    int y = 0;
+    int filled = 0;
+    bool ended = false;
+
+    uchar chunk[8];
+    while(in.read(chunk, 8))
+    {
+        const quint32 length = qFromBigEndian<quint32>(chunk);
+        const uchar *type = chunk + 4;
+        if(memcmp(type, "IEND", 4) == 0)
+            break;
+
+        if(memcmp(type, "IDAT", 4) == 0)
+        {
+            for(qint64 remaining = length; remaining > 0; )
+            {
+                const int part = int(qMin(remaining, qint64(input.size())));
+                if(!in.read(input.data(), part))
+                    return false;
+                remaining -= part;
+
+                z_stream &zs = inflater.stream;
+                zs.next_in = input.data();
+                zs.avail_in = uInt(part);
+                while(zs.avail_in > 0 && !ended && y < height)
+                {
+                    zs.next_out = current.data() + filled;
+                    zs.avail_out = uInt(rowBytes + 1 - filled);
+                    const int result = inflate(&zs, Z_NO_FLUSH);
+                    if(result != Z_OK && result != Z_STREAM_END)
+                        return false;
+                    ended = result == Z_STREAM_END;
+                    filled = rowBytes + 1 - int(zs.avail_out);
+                    if(filled == rowBytes + 1)
+                    {
+                        if(!unfilterRow(current.data(), prior.data(), rowBytes, channels))
+                            return false;
+                        storeRow(current.data() + 1, colorType, width, bits + qptrdiff(y) * stride);
+                        current.swap(prior);
+                        filled = 0;
+                        ++y;
+                    }
+                }
+            }
+        }
+        else if(memcmp(type, "PLTE", 4) == 0 || memcmp(type, "tRNS", 4) == 0)
+        {
+            if(length > 3 * PALETTE_SIZE)   // ninguno de los dos pasa de 256 entradas
+                return false;
+            std::vector<uchar> data(length);
+            if(!in.read(data.data(), length))
+                return false;
+            if(type[0] == 'P')
+            {
+                palette.resize(int(length / 3));
+                for(int i = 0; i < palette.size(); ++i)
+                    palette[i] = qRgb(data[3 * i], data[3 * i + 1], data[3 * i + 2]);
+            }
+            else if(colorType == PNG_PALETTE)
+            {
+                for(int i = 0; i < palette.size() && i < int(length); ++i)
+                    palette[i] = qRgba(qRed(palette[i]), qGreen(palette[i]), qBlue(palette[i]), data[i]);
+            }
+            else
+                return false;   // color transparente en gris o RGB, lo resuelve Qt
+        }
+        else if(!in.skip(length))
+            return false;
+
+        if(!in.skip(4))         // CRC
+            return false;
+    }
+
+    if(y < height || (colorType == PNG_PALETTE && palette.isEmpty()))
+        return false;
+    if(colorType == PNG_PALETTE)
+        decoded.setColorTable(palette);
+    *image = decoded;
+    return true;
+}
+
+/**
+ * PngBlock: Filas [first, first + count) comprimidas. "data" es deflate crudo; el primer bloque lleva delante el
+ * encabezado zlib. "adler" y "length" son los de las filas filtradas, para combinar el Adler-32 del flujo completo.
+ */
+struct PngBlock
+{
+    int first;
+    int count;
+    QByteArray data;
+    uLong adler;
+    uLong length;
+    bool ok;
+};
+
+/**
+ * rawRow: Una fila de la imagen en el orden de bytes de PNG.
+ */
+static void rawRow(const QImage &image, int y, int colorType, uchar *out)
+{
+    const int width = image.width();
+    if(colorType == PNG_GRAY || colorType == PNG_PALETTE)
+    {
+        memcpy(out, image.constScanLine(y), size_t(width));
+        return;
+    }
+
+    const QRgb *row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+    for(int x = 0; x < width; ++x)
+    {
+        *out++ = uchar(qRed(row[x]));
+        *out++ = uchar(qGreen(row[x]));
+        *out++ = uchar(qBlue(row[x]));
+        if(colorType == PNG_RGBA)
+            *out++ = uchar(qAlpha(row[x]));
+    }
+}
+
+/**
+ * filterRow: Filtra una fila con el filtro que deja la menor suma de diferencias absolutas (la heuristica de libpng).
+ * Las imagenes con paleta no se filtran. "prior" es nulo en la primera fila.
+ */
+static void filterRow(const uchar *raw, const uchar *prior, int bytes, int bpp, bool adaptive, uchar *out,
+                      uchar *scratch)
+{
+    out[0] = 0;
+    memcpy(out + 1, raw, size_t(bytes));
+    if(!adaptive)
+        return;
+
+    long best = 0;
+    for(int i = 0; i < bytes; ++i)
+        best += abs(int(qint8(raw[i])));
+
+    for(int filter = 1; filter <= 4; ++filter)
+    {
+        scratch[0] = uchar(filter);
+        uchar *target = scratch + 1;
+        long sum = 0;
+        for(int i = 0; i < bytes && sum < best; ++i)
+        {
+            const int left = i >= bpp ? raw[i - bpp] : 0;
+            const int up = prior ? prior[i] : 0;
+            const int upLeft = prior && i >= bpp ? prior[i - bpp] : 0;
+            int predicted = 0;
+            switch(filter)
+            {
+                case 1: predicted = left; break;
+                case 2: predicted = up; break;
+                case 3: predicted = (left + up) >> 1; break;
+                default: predicted = paeth(left, up, upLeft); break;
+            }
+            target[i] = uchar(raw[i] - predicted);
+            sum += abs(int(qint8(target[i])));
+        }
+        if(sum < best)
+        {
+            best = sum;
+            memcpy(out, scratch, size_t(bytes) + 1);
+        }
+    }
+}
+
+/**
+ * compressBlock: Filtra las filas del bloque y las comprime. Tambien filtra las ultimas filas del bloque anterior
+ * (hasta 32 KB) para usarlas como diccionario: el decodificador ya las tiene en su ventana cuando llega a este bloque.
+ */
+static void compressBlock(const QImage &image, int colorType, int bpp, PngBlock &block, bool last)
+{
+    const int rowBytes = image.width() * bpp;
+    const int stride = rowBytes + 1;
+    const bool adaptive = colorType != PNG_PALETTE;
+    const int dictionaryRows = qMin(block.first, (DEFLATE_WINDOW + stride - 1) / stride);
+    const int start = block.first - dictionaryRows;
+
+    std::vector<uchar> filtered(size_t(dictionaryRows + block.count) * stride);
+    std::vector<uchar> previous(rowBytes), current(rowBytes), scratch(stride);
+    if(start > 0)
+        rawRow(image, start - 1, colorType, previous.data());
+    for(int y = start; y < block.first + block.count; ++y)
+    {
+        rawRow(image, y, colorType, current.data());
+        filterRow(current.data(), y > 0 ? previous.data() : 0, rowBytes, bpp, adaptive,
+                  filtered.data() + size_t(y - start) * stride, scratch.data());
+        current.swap(previous);
+    }
+
+    const uchar *input = filtered.data() + size_t(dictionaryRows) * stride;
+    block.length = uLong(block.count) * uLong(stride);
+    block.adler = adler32(adler32(0L, Z_NULL, 0), input, uInt(block.length));
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    block.ok = deflateInit2(&zs, PNG_DEFLATE_LEVEL, Z_DEFLATED, -15, 8,
+                            adaptive ? Z_FILTERED : Z_DEFAULT_STRATEGY) == Z_OK;
+    if(!block.ok)
+        return;
+
+    const uInt dictionary = uInt(qMin(dictionaryRows * stride, DEFLATE_WINDOW));
+    if(dictionary > 0)
+        deflateSetDictionary(&zs, input - dictionary, dictionary);
+
+    const int headerBytes = block.first == 0 ? int(sizeof(ZLIB_HEADER)) : 0;
+    block.data.resize(headerBytes + int(deflateBound(&zs, block.length)) + 16);
+    if(headerBytes)
+        memcpy(block.data.data(), ZLIB_HEADER, sizeof(ZLIB_HEADER));
+
+    zs.next_in = const_cast<Bytef*>(input);
+    zs.avail_in = uInt(block.length);
+    zs.next_out = reinterpret_cast<Bytef*>(block.data.data()) + headerBytes;
+    zs.avail_out = uInt(block.data.size() - headerBytes);
+    const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    forever
+    {
+        const int result = deflate(&zs, flush);
+        if(result == Z_STREAM_ERROR)
+        {
+            block.ok = false;
+            break;
+        }
+        if(last ? result == Z_STREAM_END : (zs.avail_in == 0 && zs.avail_out > 0))
+            break;
+
+        // deflateBound alcanza casi siempre, si no se agranda la salida y se sigue
+        const int used = block.data.size() - int(zs.avail_out);
+        block.data.resize(block.data.size() * 2);
+        zs.next_out = reinterpret_cast<Bytef*>(block.data.data()) + used;
+        zs.avail_out = uInt(block.data.size() - used);
+    }
+    block.data.resize(headerBytes + int(zs.total_out));
+    deflateEnd(&zs);
+}
+
+static void writeChunk(StreamWriter &out, const char *type, const uchar *data, quint32 length)
+{
+    uchar header[8];
+    qToBigEndian<quint32>(length, header);
+    memcpy(header + 4, type, 4);
+    out.write(header, 8);
+    uLong crc = crc32(crc32(0L, Z_NULL, 0), header + 4, 4);
+    if(length > 0)
+    {
+        out.write(data, length);
+        crc = crc32(crc, data, length);
+    }
+
+    uchar tail[4];
+    qToBigEndian<quint32>(quint32(crc), tail);
+    out.write(tail, 4);
+}
+
+static bool isOpaque(const QImage &image)
+{
+    for(int y = 0; y < image.height(); ++y)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for(int x = 0; x < image.width(); ++x)
+            if(qAlpha(row[x]) != 255)
+                return false;
+    }
+    return true;
+}
+
+/**
+ * writePng: Gris y paleta se guardan con un byte por pixel; las imagenes de 32 bits en RGBA, o en RGB si son opacas.
+ */
+bool writePng(QIODevice *device, const QImage &source)
+{
+    if(source.isNull())
+        return false;
+
+    TRACE_SCOPE("writePng");
+    QImage image = source;
+    int colorType = PNG_RGB;
+    if(image.format() == QImage::Format_Grayscale8)
+        colorType = PNG_GRAY;
+    else if(image.format() == QImage::Format_Indexed8)
+        colorType = PNG_PALETTE;
+    else if(image.format() != QImage::Format_RGB32)
+    {
+        image = image.convertToFormat(QImage::Format_ARGB32);
+        colorType = isOpaque(image) ? PNG_RGB : PNG_RGBA;
+    }
+
+    StreamWriter out(device);
+    out.write(PNG_SIGNATURE, sizeof(PNG_SIGNATURE));
+
+    uchar ihdr[13] = {};
+    qToBigEndian<quint32>(quint32(image.width()), ihdr);
+    qToBigEndian<quint32>(quint32(image.height()), ihdr + 4);
+    ihdr[8] = 8;
+    ihdr[9] = uchar(colorType);
+    writeChunk(out, "IHDR", ihdr, sizeof(ihdr));
+
+    if(colorType == PNG_PALETTE)
+    {
+        const QVector<QRgb> palette = image.colorTable();
+        std::vector<uchar> plte, alpha;
+        for(QRgb color : palette)
+        {
+            plte.push_back(uchar(qRed(color)));
+            plte.push_back(uchar(qGreen(color)));
+            plte.push_back(uchar(qBlue(color)));
+            alpha.push_back(uchar(qAlpha(color)));
+        }
+        while(!alpha.empty() && alpha.back() == 255)
+            alpha.pop_back();
+        writeChunk(out, "PLTE", plte.data(), quint32(plte.size()));
+        if(!alpha.empty())
+            writeChunk(out, "tRNS", alpha.data(), quint32(alpha.size()));
+    }
+
+    if(image.dotsPerMeterX() > 0 && image.dotsPerMeterY() > 0)
+    {
+        uchar phys[9];
+        qToBigEndian<quint32>(quint32(image.dotsPerMeterX()), phys);
+        qToBigEndian<quint32>(quint32(image.dotsPerMeterY()), phys + 4);
+        phys[8] = 1;    // pixeles por metro
+        writeChunk(out, "pHYs", phys, sizeof(phys));
+    }
+
+    const int bpp = channelsOf(colorType);
+    const int blockRows = qMax(1, PNG_BLOCK_BYTES / (image.width() * bpp + 1));
+    const int threads = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+    const int waveRows = blockRows * threads * 2;
+    uLong adler = adler32(0L, Z_NULL, 0);
+
+    // tandas de dos bloques por hilo: se comprimen en paralelo y se escriben en orden antes de la siguiente
+    for(int first = 0; first < image.height(); first += waveRows)
+    {
+        QVector<PngBlock> wave;
+        for(int y = first; y < image.height() && y < first + waveRows; y += blockRows)
+            wave.append(PngBlock{y, qMin(blockRows, image.height() - y), QByteArray(), 0, 0, false});
+
+        const int height = image.height();
+        QtConcurrent::blockingMap(wave, [&image, colorType, bpp, height](PngBlock &block) {
+            compressBlock(image, colorType, bpp, block, block.first + block.count == height);
+        });
+
+        for(const PngBlock &block : wave)
+        {
+            if(!block.ok)
+                return false;
+            writeChunk(out, "IDAT", reinterpret_cast<const uchar*>(block.data.constData()), quint32(block.data.size()));
+            adler = adler32_combine(adler, block.adler, z_off_t(block.length));
+        }
+    }
+
+    uchar trailer[4];
+    qToBigEndian<quint32>(quint32(adler), trailer);
+    writeChunk(out, "IDAT", trailer, sizeof(trailer));
+    writeChunk(out, "IEND", 0, 0);
+    return out.flush();
+}
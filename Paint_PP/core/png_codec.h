@@ -0,0 +1,23 @@
+#ifndef PNG_CODEC_H
+#define PNG_CODEC_H
+
+#include <QImage>
+#include <QIODevice>
+
+#include "constants.h"
+
+
+/**
+ * PNG de 8 bits por canal. Al escribir, las filas se reparten en bloques de unos PNG_BLOCK_BYTES que se filtran y se
+ * comprimen en paralelo, cada uno con su propio deflate: los bloques terminan en un limite de byte (Z_SYNC_FLUSH) y
+ * empiezan con los ultimos 32 KB del bloque anterior como diccionario, asi se concatenan en un solo flujo zlib casi
+ * del mismo tamaño que el de un solo hilo. Los bloques se comprimen por tandas y cada tanda se escribe en orden.
+ *
+ * Al leer, el flujo se descomprime a medida que llegan los IDAT, de a una fila, directo en la imagen. Se leen los PNG
+ * de 8 bits sin entrelazar (gris, gris con alfa, RGB, RGBA y con paleta); para las demas variantes readPng devuelve
+ * falso y el archivo lo abre Qt.
+ */
+bool readPng(QIODevice *device, QImage *image);
+bool writePng(QIODevice *device, const QImage &image);
+
+#endif // PNG_CODEC_H
@@ -0,0 +1,286 @@
+#include <QtConcurrent>
+#include <QTimer>
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+
+#include "proxy_preview.h"
+#include "trace.h"
+
+
+/**
+ * subImage: Los pixeles de "rect" sin copiarlos. La imagen resultante es de solo lectura, no desacopla "image".
+ */
+static QImage subImage(const QImage &image, const QRect &rect)
+{
+    return QImage(image.constScanLine(rect.top()) + rect.left() * sizeof(QRgb), rect.width(), rect.height(),
+                  image.bytesPerLine(), image.format());
+}
+
+/**
+ * scaledRect: El rectangulo que cubre "rect" despues de reducirlo por "scale", nunca vacio si "rect" no lo es.
+ */
+static QRect scaledRect(const QRect &rect, qreal scale)
+{
+    return QRect(QPoint(int(std::floor(rect.left() * scale)), int(std::floor(rect.top() * scale))),
+                 QPoint(int(std::ceil((rect.right() + 1) * scale)) - 1, int(std::ceil((rect.bottom() + 1) * scale)) - 1));
+}
+
+/**
+ * @brief FilterPreview::sourceRect: El filtro lee hasta "radius" pixeles alrededor de cada pixel.
+ */
+QRect FilterPreview::sourceRect(const QRect &target) const
+{
+    int halo = params.type == edge_detect ? 1 : params.radius;
+    return target.adjusted(-halo, -halo, halo, halo);
+}
+
+/**
+ * @brief FilterPreview::render: En el "proxy" el radio se reduce con la imagen, asi el desenfoque se ve igual que en
+ *                               resolucion completa.
+ */
+QImage FilterPreview::render(const QImage &source, const QRect &target, qreal scale) const
+{
+    FilterParams scaled = params;
+    scaled.radius = qMax(MIN_FILTER_RADIUS, qRound(params.radius * scale));
+
+    FilterJob job(source, target, scaled);
+    job.run();
+    return job.getResult();
+}
+
+QImage AdjustmentsPreview::render(const QImage &source, const QRect &target, qreal) const
+{
+    QImage pixels = source.copy(target).convertToFormat(QImage::Format_ARGB32);
+    pipeline.apply(pixels, pixels.rect());
+    return pixels.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+/**
+ * @brief ResizePreview::sourceRect: El area del lienzo original que termina en "target" al cambiar el tamaño.
+ */
+QRect ResizePreview::sourceRect(const QRect &target) const
+{
+    qreal sx = qreal(from.width()) / to.width();
+    qreal sy = qreal(from.height()) / to.height();
+    return QRect(QPoint(int(std::floor(target.left() * sx)), int(std::floor(target.top() * sy))),
+                 QPoint(int(std::ceil((target.right() + 1) * sx)) - 1, int(std::ceil((target.bottom() + 1) * sy)) - 1));
+}
+
+/**
+ * @brief ResizePreview::render: Se escala igual que LayerStack::scale, solo importa el tamaño de "target".
+ */
+QImage ResizePreview::render(const QImage &source, const QRect &target, qreal) const
+{
+    return source.scaled(target.size(), Qt::IgnoreAspectRatio);
+}
+
+ProxyPreview::ProxyPreview(const QImage &source, QObject *parent)
+    : QObject(parent)
+{
+    this->source = source;
+    scale = 1.0;
+    refined = false;
+    running = 0;
+
+    idleTimer = new QTimer(this);
+    idleTimer->setSingleShot(true);
+    idleTimer->setInterval(PREVIEW_IDLE_MS);
+    connect(idleTimer, SIGNAL(timeout()), this, SLOT(OnIdle()));
+
+    watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(OnRefined()));
+}
+
+/**
+ * @brief ProxyPreview::~ProxyPreview: El calculo en curso ve la generacion nueva y termina en la banda siguiente.
+ */
+ProxyPreview::~ProxyPreview()
+{
+    cancel();
+    watcher->waitForFinished();
+}
+
+/**
+ * @brief ProxyPreview::setRegion: Area visible del lienzo. Define la escala del "proxy" y descarta el anterior.
+ */
+void ProxyPreview::setRegion(const QRect &region)
+{
+    this->region = region;
+    int side = qMax(region.width(), region.height());
+    scale = side > PREVIEW_PROXY_SIZE ? qreal(PREVIEW_PROXY_SIZE) / side : 1.0;
+    proxy = QImage();
+    proxyRect = QRect();
+}
+
+/**
+ * @brief ProxyPreview::request: Muestra "effect" sobre el "proxy" y programa el calculo en resolucion completa para
+ *                               cuando los parametros dejen de cambiar. Si el area visible ya es pequeña se calcula
+ *                               en resolucion completa de una vez.
+ */
+void ProxyPreview::request(const QSharedPointer<const PreviewEffect> &next)
+{
+    TRACE_SCOPE("ProxyPreview::request");
+    current.fetchAndAddOrdered(1);
+    QRect before = shownArea();
+
+    effect = next;
+    refined = false;
+    result = QImage();
+    resultRect = region.intersected(effect->bounds());
+
+    QRect sourceRect = effect->sourceRect(resultRect).intersected(source.rect());
+    if(!resultRect.isEmpty() && !sourceRect.isEmpty())
+    {
+        if(scale == 1.0)
+        {
+            result = effect->render(subImage(source, sourceRect), resultRect.translated(-sourceRect.topLeft()), 1.0);
+            refined = true;
+        }
+        else
+        {
+            QImage pixels = proxyOf(sourceRect);
+            QRect target = scaledRect(resultRect.translated(-proxyRect.topLeft()), scale)
+                           .translated(-scaledRect(sourceRect.translated(-proxyRect.topLeft()), scale).topLeft());
+            result = effect->render(pixels, target, scale);
+            idleTimer->start();
+        }
+    }
+
+    emit updated(before.united(shownArea()));
+}
+
+/**
+ * @brief ProxyPreview::cancel: Quita la vista previa y descarta el calculo pendiente.
+ */
+void ProxyPreview::cancel()
+{
+    current.fetchAndAddOrdered(1);
+    idleTimer->stop();
+
+    QRect before = shownArea();
+    effect.clear();
+    result = QImage();
+    resultRect = QRect();
+    refined = false;
+    if(!before.isEmpty())
+        emit updated(before);
+}
+
+/**
+ * @brief ProxyPreview::paint: Pinta el resultado encima del lienzo. El "proxy" se amplia suavizado; lo que el efecto
+ *                             deja fuera del lienzo nuevo (al reducirlo) se pinta con "outside".
+ */
+void ProxyPreview::paint(QPainter &painter, const QRect &exposed, const QBrush &outside) const
+{
+    if(!effect)
+        return;
+
+    QRegion uncovered = QRegion(source.rect().intersected(region).intersected(exposed)) - effect->bounds();
+    for(const QRect &rect : uncovered.rects())
+        painter.fillRect(rect, outside);
+
+    if(result.isNull())
+        return;
+
+    if(refined)
+    {
+        QRect part = resultRect.intersected(exposed);
+        painter.drawImage(part, result, part.translated(-resultRect.topLeft()));
+        return;
+    }
+
+    painter.save();
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(resultRect, result);
+    painter.restore();
+}
+
+/**
+ * @brief ProxyPreview::OnIdle: Los parametros dejaron de cambiar, empieza el calculo en resolucion completa. Se
+ *                              calcula una sola generacion a la vez: si sigue la anterior, OnRefined empieza esta.
+ */
+void ProxyPreview::OnIdle()
+{
+    if(!effect || refined || resultRect.isEmpty() || watcher->isRunning())
+        return;
+
+    running = current.loadAcquire();
+    QSharedPointer<const PreviewEffect> job = effect;
+    QRect target = resultRect;
+    int expected = running;
+    watcher->setFuture(QtConcurrent::run([this, job, target, expected]() { return refine(job, target, expected); }));
+}
+
+void ProxyPreview::OnRefined()
+{
+    QImage pixels = watcher->result();
+    if(running == current.loadAcquire() && !pixels.isNull())
+    {
+        result = pixels;
+        refined = true;
+        emit updated(resultRect);
+    }
+    else if(!idleTimer->isActive())
+        OnIdle();
+}
+
+/**
+ * @brief ProxyPreview::proxyOf: Los pixeles de "rect" reducidos. El "proxy" solo se vuelve a reducir si "rect" no
+ *                               estaba incluido, normalmente una vez por dialogo.
+ */
+QImage ProxyPreview::proxyOf(const QRect &rect)
+{
+    if(!proxyRect.contains(rect))
+    {
+        TRACE_SCOPE("ProxyPreview::proxyOf");
+        proxyRect = proxyRect.united(rect).intersected(source.rect());
+        QSize size = scaledRect(QRect(QPoint(0, 0), proxyRect.size()), scale).size();
+        proxy = subImage(source, proxyRect).scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    return proxy.copy(scaledRect(rect.translated(-proxyRect.topLeft()), scale));
+}
+
+/**
+ * @brief ProxyPreview::refine: Calcula "target" en resolucion completa, en otro hilo. Entre banda y banda revisa la
+ *                              generacion y, si llego otro pedido, devuelve una imagen nula sin terminar.
+ */
+QImage ProxyPreview::refine(const QSharedPointer<const PreviewEffect> &effect, const QRect &target,
+                            int expected) const
+{
+    TRACE_SCOPE("ProxyPreview::refine");
+    QImage pixels(target.size(), QImage::Format_ARGB32_Premultiplied);
+    pixels.fill(Qt::transparent);
+
+    for(int y = target.top(); y <= target.bottom(); y += PREVIEW_BAND_ROWS)
+    {
+        if(current.loadAcquire() != expected)
+            return QImage();
+
+        QRect band(target.left(), y, target.width(), qMin(PREVIEW_BAND_ROWS, target.bottom() - y + 1));
+        QRect sourceRect = effect->sourceRect(band).intersected(source.rect());
+        if(sourceRect.isEmpty())
+            continue;
+
+        QImage part = effect->render(subImage(source, sourceRect), band.translated(-sourceRect.topLeft()), 1.0);
+        int width = qMin(part.width(), pixels.width());
+        for(int j = 0; j < qMin(part.height(), band.height()); ++j)
+            std::copy_n(reinterpret_cast<const QRgb*>(part.constScanLine(j)), width,
+                        reinterpret_cast<QRgb*>(pixels.scanLine(y - target.top() + j)));
+    }
+
+    return current.loadAcquire() == expected ? pixels : QImage();
+}
+
+/**
+ * @brief ProxyPreview::shownArea: Lo que pinta la vista previa: el resultado y, si el efecto achica el lienzo, todo el
+ *                                 lienzo visible.
+ */
+QRect ProxyPreview::shownArea() const
+{
+    if(!effect)
+        return QRect();
+
+    QRect canvasRect = region.intersected(source.rect());
+    return effect->bounds().contains(canvasRect) ? resultRect : resultRect.united(canvasRect);
+}
@@ -0,0 +1,128 @@
+#ifndef PROXY_PREVIEW_H
+#define PROXY_PREVIEW_H
+
+#include <QObject>
+#include <QImage>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+
+#include "constants.h"
+#include "filters.h"
+#include "adjustments.h"
+
+
+class QTimer;
+class QPainter;
+class QBrush;
+
+/**
+ * PreviewEffect: Una operacion que se puede mostrar en vista previa. El resultado cubre bounds() en coordenadas del
+ * lienzo; para calcular un rectangulo "target" del resultado se necesitan los pixeles de sourceRect(target) en la
+ * imagen original. render() puede correr en cualquier hilo y recibe esos pixeles reducidos por "scale" (1 en
+ * resolucion completa), con "target" en las coordenadas de "source".
+ */
+class PreviewEffect
+{
+public:
+    virtual ~PreviewEffect() {}
+
+    virtual QRect bounds() const = 0;
+    virtual QRect sourceRect(const QRect &target) const { return target; }
+    virtual QImage render(const QImage &source, const QRect &target, qreal scale) const = 0;
+};
+
+class FilterPreview : public PreviewEffect
+{
+public:
+    FilterPreview(const FilterParams &params, const QRect &area) : params(params), area(area) {}
+
+    QRect bounds() const override { return area; }
+    QRect sourceRect(const QRect &target) const override;
+    QImage render(const QImage &source, const QRect &target, qreal scale) const override;
+
+private:
+    FilterParams params;
+    QRect area;
+};
+
+class AdjustmentsPreview : public PreviewEffect
+{
+public:
+    AdjustmentsPreview(const ColorPipeline &pipeline, const QRect &area) : pipeline(pipeline), area(area) {}
+
+    QRect bounds() const override { return area; }
+    QImage render(const QImage &source, const QRect &target, qreal scale) const override;
+
+private:
+    ColorPipeline pipeline;
+    QRect area;
+};
+
+class ResizePreview : public PreviewEffect
+{
+public:
+    ResizePreview(const QSize &from, const QSize &to) : from(from), to(to) {}
+
+    QRect bounds() const override { return QRect(QPoint(0, 0), to); }
+    QRect sourceRect(const QRect &target) const override;
+    QImage render(const QImage &source, const QRect &target, qreal scale) const override;
+
+private:
+    QSize from;
+    QSize to;
+};
+
+/**
+ * ProxyPreview: Vista previa progresiva de una operacion cara sobre la capa activa. Cada pedido se calcula al instante
+ * sobre una copia reducida del area visible (el "proxy", PREVIEW_PROXY_SIZE pixeles en el lado mayor) y, si no llega
+ * otro pedido en PREVIEW_IDLE_MS, se vuelve a calcular en resolucion completa en el pool de hilos, por bandas de
+ * PREVIEW_BAND_ROWS filas. Cada pedido aumenta la generacion: el calculo de una generacion anterior se detiene en la
+ * banda siguiente y su resultado se descarta.
+ */
+class ProxyPreview : public QObject
+{
+    Q_OBJECT
+
+public:
+    ProxyPreview(const QImage &source, QObject *parent = 0);
+    ~ProxyPreview();
+
+    void setRegion(const QRect &region);
+    void request(const QSharedPointer<const PreviewEffect> &effect);
+    void cancel();
+    void paint(QPainter &painter, const QRect &exposed, const QBrush &outside) const;
+
+signals:
+    void updated(const QRect &area);
+
+private slots:
+    void OnIdle();
+    void OnRefined();
+
+private:
+    QImage proxyOf(const QRect &rect);
+    QImage refine(const QSharedPointer<const PreviewEffect> &effect, const QRect &target, int expected) const;
+    QRect shownArea() const;
+
+    QImage source;              // la capa activa, compartida: si se modifica se desacopla y este hilo no la ve cambiar
+    QRect region;               // area visible, en coordenadas del lienzo
+    qreal scale;                // del lienzo al "proxy"
+    QImage proxy;               // "proxyRect" reducido por "scale"
+    QRect proxyRect;
+
+    QSharedPointer<const PreviewEffect> effect;
+    QImage result;
+    QRect resultRect;
+    bool refined;
+
+    QAtomicInt current;
+    int running;                // generacion que se esta calculando en "watcher"
+    QTimer* idleTimer;
+    QFutureWatcher<QImage>* watcher;
+
+    ProxyPreview(const ProxyPreview&);
+    ProxyPreview& operator=(const ProxyPreview&);
+};
+
+#endif // PROXY_PREVIEW_H
@@ -0,0 +1,195 @@
+#include <QtEndian>
+#include <climits>
+#include <cstring>
+
+#include "qoi_codec.h"
+#include "image_io.h"
+#include "trace.h"
+
+
+static const uchar QOI_OP_INDEX = 0x00;
+static const uchar QOI_OP_DIFF = 0x40;
+static const uchar QOI_OP_LUMA = 0x80;
+static const uchar QOI_OP_RUN = 0xc0;
+static const uchar QOI_OP_RGB = 0xfe;
+static const uchar QOI_OP_RGBA = 0xff;
+static const uchar QOI_OP_MASK = 0xc0;
+static const int QOI_HEADER = 14;
+static const int QOI_MAX_RUN = 62;
+static const uchar QOI_END[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+static inline int qoiHash(QRgb pixel)
+{
+    return (qRed(pixel) * 3 + qGreen(pixel) * 5 + qBlue(pixel) * 7 + qAlpha(pixel) * 11) % 64;
+}
+
+/**
+ * readQoi: Decodifica los pixeles en orden directo en las filas de la imagen. Los marcadores del final no se revisan,
+ * un archivo cortado antes del ultimo pixel es un error.
+ */
+bool readQoi(QIODevice *device, QImage *image)
+{
+    StreamReader in(device);
+    uchar header[QOI_HEADER];
+    if(!in.read(header, QOI_HEADER) || memcmp(header, "qoif", 4) != 0)
+        return false;
+
+    const quint32 width = qFromBigEndian<quint32>(header + 4);
+    const quint32 height = qFromBigEndian<quint32>(header + 8);
+    const int channels = header[12];
+    if(width == 0 || height == 0 || width > INT_MAX || height > INT_MAX || (channels != 3 && channels != 4))
+        return false;
+
+    QImage decoded(int(width), int(height), channels == 4 ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    if(decoded.isNull())
+        return false;
+
+    TRACE_SCOPE("readQoi");
+    const QRgb opaque = channels == 4 ? 0 : 0xff000000;
+    QRgb seen[64] = {};
+    QRgb pixel = qRgba(0, 0, 0, 255);
+    int run = 0;
+    uchar *bits = decoded.bits();
+    const int stride = decoded.bytesPerLine();
+    for(int y = 0; y < decoded.height(); ++y)
+    {
+        QRgb *row = reinterpret_cast<QRgb*>(bits + qptrdiff(y) * stride);
+        for(int x = 0; x < decoded.width(); ++x)
+        {
+            if(run > 0)
+            {
+                --run;
+                row[x] = pixel | opaque;
+                continue;
+            }
+
+            uchar op;
+            if(!in.next(&op))
+                return false;
+
+            if(op == QOI_OP_RGB || op == QOI_OP_RGBA)
+            {
+                uchar color[4] = {0, 0, 0, uchar(qAlpha(pixel))};
+                if(!in.read(color, op == QOI_OP_RGB ? 3 : 4))
+                    return false;
+                pixel = qRgba(color[0], color[1], color[2], color[3]);
+            }
+            else if((op & QOI_OP_MASK) == QOI_OP_INDEX)
+                pixel = seen[op];
+            else if((op & QOI_OP_MASK) == QOI_OP_DIFF)
+            {
+                pixel = qRgba((qRed(pixel) + ((op >> 4) & 3) - 2) & 255, (qGreen(pixel) + ((op >> 2) & 3) - 2) & 255,
+                              (qBlue(pixel) + (op & 3) - 2) & 255, qAlpha(pixel));
+            }
+            else if((op & QOI_OP_MASK) == QOI_OP_LUMA)
+            {
+                uchar next;
+                if(!in.next(&next))
+                    return false;
+                const int green = (op & 0x3f) - 32;
+                pixel = qRgba((qRed(pixel) + green - 8 + (next >> 4)) & 255, (qGreen(pixel) + green) & 255,
+                              (qBlue(pixel) + green - 8 + (next & 15)) & 255, qAlpha(pixel));
+            }
+            else
+                run = op & 0x3f;
+
+            seen[qoiHash(pixel)] = pixel;
+            row[x] = pixel | opaque;
+        }
+    }
+
+    *image = decoded;
+    return true;
+}
+
+/**
+ * writeQoi: Codifica los pixeles en una sola pasada. Las repeticiones siguen de una fila a la otra, como en el
+ * formato.
+ */
+bool writeQoi(QIODevice *device, const QImage &source)
+{
+    if(source.isNull())
+        return false;
+
+    TRACE_SCOPE("writeQoi");
+    QImage image = source;
+    if(image.format() != QImage::Format_ARGB32 && image.format() != QImage::Format_RGB32)
+        image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    const bool alpha = image.format() == QImage::Format_ARGB32;
+
+    StreamWriter out(device);
+    uchar header[QOI_HEADER] = {'q', 'o', 'i', 'f'};
+    qToBigEndian<quint32>(quint32(image.width()), header + 4);
+    qToBigEndian<quint32>(quint32(image.height()), header + 8);
+    header[12] = alpha ? 4 : 3;
+    header[13] = 0;     // sRGB con alfa lineal
+    out.write(header, QOI_HEADER);
+
+    QRgb seen[64] = {};
+    QRgb previous = qRgba(0, 0, 0, 255);
+    int run = 0;
+    for(int y = 0; y < image.height(); ++y)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for(int x = 0; x < image.width(); ++x)
+        {
+            const QRgb pixel = alpha ? row[x] : row[x] | 0xff000000;
+            if(pixel == previous)
+            {
+                if(++run == QOI_MAX_RUN)
+                {
+                    out.put(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if(run > 0)
+            {
+                out.put(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            const int hash = qoiHash(pixel);
+            if(seen[hash] == pixel)
+                out.put(QOI_OP_INDEX | hash);
+            else if(qAlpha(pixel) != qAlpha(previous))
+            {
+                seen[hash] = pixel;
+                out.put(QOI_OP_RGBA);
+                out.put(uchar(qRed(pixel)));
+                out.put(uchar(qGreen(pixel)));
+                out.put(uchar(qBlue(pixel)));
+                out.put(uchar(qAlpha(pixel)));
+            }
+            else
+            {
+                seen[hash] = pixel;
+                const int red = qint8(qRed(pixel) - qRed(previous));
+                const int green = qint8(qGreen(pixel) - qGreen(previous));
+                const int blue = qint8(qBlue(pixel) - qBlue(previous));
+                const int redGreen = red - green;
+                const int blueGreen = blue - green;
+                if(red > -3 && red < 2 && green > -3 && green < 2 && blue > -3 && blue < 2)
+                    out.put(uchar(QOI_OP_DIFF | (red + 2) << 4 | (green + 2) << 2 | (blue + 2)));
+                else if(redGreen > -9 && redGreen < 8 && green > -33 && green < 32 && blueGreen > -9 && blueGreen < 8)
+                {
+                    out.put(uchar(QOI_OP_LUMA | (green + 32)));
+                    out.put(uchar((redGreen + 8) << 4 | (blueGreen + 8)));
+                }
+                else
+                {
+                    out.put(QOI_OP_RGB);
+                    out.put(uchar(qRed(pixel)));
+                    out.put(uchar(qGreen(pixel)));
+                    out.put(uchar(qBlue(pixel)));
+                }
+            }
+            previous = pixel;
+        }
+    }
+    if(run > 0)
+        out.put(QOI_OP_RUN | (run - 1));
+
+    out.write(QOI_END, sizeof(QOI_END));
+    return out.flush();
+}
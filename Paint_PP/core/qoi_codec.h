@@ -0,0 +1,22 @@
+#ifndef QOI_CODEC_H
+#define QOI_CODEC_H
+
+#include <QImage>
+#include <QIODevice>
+
+#include "constants.h"
+
+
+/**
+ * QOI ("Quite OK Image", qoiformat.org): formato sin perdida de una sola pasada, cada pixel se codifica como una
+ * repeticion del anterior, una referencia a una tabla de 64 colores vistos, una diferencia chica con el anterior o el
+ * color completo. Comprime algo menos que PNG pero es varias veces mas rapido en los dos sentidos, sirve para archivos
+ * temporales y de intercambio.
+ *
+ * readQoi devuelve falso si el archivo no es QOI; la imagen leida es ARGB32 (4 canales) o RGB32 (3 canales).
+ * writeQoi escribe 4 canales si la imagen tiene alfa y 3 si no.
+ */
+bool readQoi(QIODevice *device, QImage *image);
+bool writeQoi(QIODevice *device, const QImage &image);
+
+#endif // QOI_CODEC_H
@@ -0,0 +1,406 @@
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <QHash>
+#include <QSet>
+#include <algorithm>
+#include <vector>
+
+#include "quantize.h"
+#include "pixel_format.h"
+#include "trace.h"
+
+
+static const int LEVELS = 1 << QUANTIZE_BITS;     // valores por canal del histograma
+static const int BINS = LEVELS * LEVELS * LEVELS;
+static const int SHIFT = 8 - QUANTIZE_BITS;
+
+/** Matriz de Bayer 8x8, umbrales en [0, 64) del tramado ordenado. */
+static const int bayer[8][8] = {
+    { 0, 32,  8, 40,  2, 34, 10, 42},
+    {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44,  4, 36, 14, 46,  6, 38},
+    {60, 28, 52, 20, 62, 30, 54, 22},
+    { 3, 35, 11, 43,  1, 33,  9, 41},
+    {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47,  7, 39, 13, 45,  5, 37},
+    {63, 31, 55, 23, 61, 29, 53, 21}
+};
+
+/**
+ * Bin: Los pixeles de un color del histograma y la suma de cada canal, para que el color de la paleta sea el promedio
+ * exacto y no el centro del color reducido.
+ */
+struct Bin
+{
+    quint64 count;
+    quint64 red, green, blue;
+};
+
+/**
+ * OctreeNode: Un nodo del octree. Cada nodo acumula los pixeles de todo su subarbol; al reducirlo se marca como hoja
+ * y sus hijos se ignoran.
+ */
+struct OctreeNode
+{
+    quint64 count = 0;
+    quint64 red = 0, green = 0, blue = 0;
+    int children[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+    int childCount = 0;
+    bool leaf = false;
+    int index = -1;             // entrada de la paleta de las hojas
+};
+
+static inline int binOf(int r, int g, int b)
+{
+    return ((r >> SHIFT) << (2 * QUANTIZE_BITS)) | ((g >> SHIFT) << QUANTIZE_BITS) | (b >> SHIFT);
+}
+
+static inline int clampChannel(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/**
+ * histogram: Cuenta los pixeles de "image" (RGB32), una banda por hilo con su propio histograma; al final se suman
+ * en el de la primera banda.
+ */
+static std::vector<Bin> histogram(const QImage &image)
+{
+    const int threads = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+    const int bandHeight = (image.height() + threads - 1) / threads;
+    QList<QRect> bands;
+    for(int y = 0; y < image.height(); y += bandHeight)
+        bands.append(QRect(0, y, image.width(), qMin(bandHeight, image.height() - y)));
+
+    std::vector<Bin> partial(size_t(bands.size()) * BINS, Bin());
+    Bin *first = partial.data();
+    QtConcurrent::blockingMap(bands, [&image, first, bandHeight](const QRect &band) {
+        Bin *bins = first + size_t(band.top() / bandHeight) * BINS;
+        for(int y = band.top(); y <= band.bottom(); ++y)
+        {
+            const QRgb *row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+            for(int x = 0; x < band.width(); ++x)
+            {
+                int r = qRed(row[x]), g = qGreen(row[x]), b = qBlue(row[x]);
+                Bin &bin = bins[binOf(r, g, b)];
+                ++bin.count;
+                bin.red += r;
+                bin.green += g;
+                bin.blue += b;
+            }
+        }
+    });
+
+    for(int band = 1; band < bands.size(); ++band)
+    {
+        const Bin *bins = first + size_t(band) * BINS;
+        for(int i = 0; i < BINS; ++i)
+        {
+            first[i].count += bins[i].count;
+            first[i].red += bins[i].red;
+            first[i].green += bins[i].green;
+            first[i].blue += bins[i].blue;
+        }
+    }
+    partial.resize(BINS);
+    return partial;
+}
+
+/**
+ * octreePalette: Paleta de hasta "colors" colores para el histograma. Cada color del histograma es una hoja a
+ * profundidad QUANTIZE_BITS; mientras sobren hojas se reducen los nodos del nivel mas profundo, empezando por los de
+ * menos pixeles, y despues los del nivel de arriba (cuyos hijos ya son todos hojas). En "table" deja, para cada color
+ * que aparece en la imagen, la entrada de la hoja que lo contiene. Los colores que caen en el mismo color del
+ * histograma se juntan aunque sobren entradas; las imagenes con pocos colores no llegan aca (exactColors).
+ */
+static QVector<QRgb> octreePalette(const Bin *bins, int colors, uchar *table)
+{
+    std::vector<OctreeNode> nodes(1);
+    std::vector<std::vector<int>> levels(QUANTIZE_BITS);   // nodos internos de cada nivel
+    levels[0].push_back(0);
+    int leaves = 0;
+
+    for(int color = 0; color < BINS; ++color)
+    {
+        const Bin &bin = bins[color];
+        if(bin.count == 0)
+            continue;
+
+        const int r = color >> (2 * QUANTIZE_BITS);
+        const int g = (color >> QUANTIZE_BITS) & (LEVELS - 1);
+        const int b = color & (LEVELS - 1);
+        int node = 0;
+        for(int level = 0; ; ++level)
+        {
+            nodes[node].count += bin.count;
+            nodes[node].red += bin.red;
+            nodes[node].green += bin.green;
+            nodes[node].blue += bin.blue;
+            if(level == QUANTIZE_BITS)
+            {
+                nodes[node].leaf = true;
+                ++leaves;
+                break;
+            }
+
+            const int bit = QUANTIZE_BITS - 1 - level;
+            const int child = ((r >> bit) & 1) << 2 | ((g >> bit) & 1) << 1 | ((b >> bit) & 1);
+            if(nodes[node].children[child] < 0)
+            {
+                const int created = int(nodes.size());
+                nodes[node].children[child] = created;
+                ++nodes[node].childCount;
+                nodes.emplace_back();
+                if(level + 1 < QUANTIZE_BITS)
+                    levels[level + 1].push_back(created);
+            }
+            node = nodes[node].children[child];
+        }
+    }
+
+    for(int level = QUANTIZE_BITS - 1; level >= 0 && leaves > colors; --level)
+    {
+        std::vector<int> &reducible = levels[level];
+        std::stable_sort(reducible.begin(), reducible.end(),
+                         [&nodes](int a, int b) { return nodes[a].count < nodes[b].count; });
+        for(int node : reducible)
+        {
+            if(leaves <= colors)
+                break;
+            leaves -= nodes[node].childCount - 1;
+            nodes[node].leaf = true;
+        }
+    }
+
+    QVector<QRgb> palette;
+    palette.reserve(leaves);
+    std::vector<int> pending(1, 0);
+    while(!pending.empty())
+    {
+        OctreeNode &node = nodes[pending.back()];
+        pending.pop_back();
+        if(node.count == 0)
+            continue;
+        if(node.leaf)
+        {
+            const quint64 half = node.count / 2;
+            node.index = palette.size();
+            palette.append(qRgb(int((node.red + half) / node.count), int((node.green + half) / node.count),
+                                int((node.blue + half) / node.count)));
+            continue;
+        }
+        for(int child = 7; child >= 0; --child)
+            if(node.children[child] >= 0)
+                pending.push_back(node.children[child]);
+    }
+
+    if(palette.isEmpty())
+        palette.append(qRgb(0, 0, 0));
+
+    for(int color = 0; color < BINS; ++color)
+    {
+        if(bins[color].count == 0)
+            continue;
+
+        const int r = color >> (2 * QUANTIZE_BITS);
+        const int g = (color >> QUANTIZE_BITS) & (LEVELS - 1);
+        const int b = color & (LEVELS - 1);
+        int node = 0;
+        for(int bit = QUANTIZE_BITS - 1; !nodes[node].leaf; --bit)
+            node = nodes[node].children[((r >> bit) & 1) << 2 | ((g >> bit) & 1) << 1 | ((b >> bit) & 1)];
+        table[color] = uchar(nodes[node].index);
+    }
+    return palette;
+}
+
+/**
+ * exactColors: Los colores distintos de "image" (RGB32), ordenados, si no son mas de "colors"; si son mas devuelve
+ * una paleta vacia apenas aparece el que sobra, asi una foto se abandona enseguida. Solo se busca en el conjunto
+ * cuando el pixel cambia respecto del anterior, un dibujo de colores lisos se recorre casi sin buscar.
+ */
+static QVector<QRgb> exactColors(const QImage &image, int colors)
+{
+    QSet<QRgb> seen;
+    QRgb last = 0;              // alfa cero: distinto de cualquier pixel RGB32
+    for(int y = 0; y < image.height(); ++y)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for(int x = 0; x < image.width(); ++x)
+        {
+            if(row[x] == last)
+                continue;
+            last = row[x];
+            seen.insert(last);
+            if(seen.size() > colors)
+                return QVector<QRgb>();
+        }
+    }
+
+    QVector<QRgb> palette;
+    palette.reserve(seen.size());
+    for(QRgb color : seen)
+        palette.append(color);
+    std::sort(palette.begin(), palette.end());
+    return palette;
+}
+
+/**
+ * mapExact: Asigna a los pixeles de "band" la entrada de la paleta exacta con su mismo color. No hay tramado: el
+ * error es siempre cero.
+ */
+static void mapExact(const QImage &image, const QRect &band, const QHash<QRgb, int> &indices, uchar *bits, int stride)
+{
+    QRgb last = 0;
+    uchar index = 0;
+    for(int y = band.top(); y <= band.bottom(); ++y)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        uchar *dst = bits + qptrdiff(y) * stride;
+        for(int x = 0; x < band.width(); ++x)
+        {
+            if(row[x] != last)
+            {
+                last = row[x];
+                index = uchar(indices.value(last));
+            }
+            dst[x] = index;
+        }
+    }
+}
+
+/**
+ * inverseTable: Completa "table" con el indice de la paleta mas cercano al centro de cada color que no aparece en la
+ * imagen, a los que solo se llega con tramado. Se calcula en paralelo, una capa de rojo por tarea.
+ */
+static void inverseTable(const QVector<QRgb> &palette, const Bin *bins, uchar *entries)
+{
+    QList<int> reds;
+    for(int r = 0; r < LEVELS; ++r)
+        reds.append(r);
+
+    QtConcurrent::blockingMap(reds, [&palette, bins, entries](const int &r) {
+        const int center = (1 << SHIFT) / 2;
+        for(int g = 0; g < LEVELS; ++g)
+            for(int b = 0; b < LEVELS; ++b)
+            {
+                const int entry = (r << (2 * QUANTIZE_BITS)) | (g << QUANTIZE_BITS) | b;
+                if(bins[entry].count > 0)
+                    continue;
+                QRgb color = qRgb((r << SHIFT) + center, (g << SHIFT) + center, (b << SHIFT) + center);
+                entries[entry] = uchar(nearestIndex(palette, color));
+            }
+    });
+}
+
+/**
+ * mapRows: Asigna el indice de la paleta a los pixeles de "band". El error de Floyd-Steinberg se guarda en
+ * dieciseisavos en dos filas (la actual y la siguiente) y empieza en cero en cada banda.
+ */
+static void mapRows(const QImage &image, const QRect &band, const uchar *table, const QVector<QRgb> &palette,
+                    DitherMode dither, uchar *bits, int stride)
+{
+    const int width = band.width();
+    if(dither == diffusion_dither)
+    {
+        std::vector<int> current(size_t(width + 2) * 3, 0), next(size_t(width + 2) * 3, 0);
+        for(int y = band.top(); y <= band.bottom(); ++y)
+        {
+            const QRgb *row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+            uchar *dst = bits + qptrdiff(y) * stride;
+            for(int x = 0; x < width; ++x)
+            {
+                int *error = &current[size_t(x + 1) * 3];
+                int r = clampChannel(qRed(row[x]) + error[0] / 16);
+                int g = clampChannel(qGreen(row[x]) + error[1] / 16);
+                int b = clampChannel(qBlue(row[x]) + error[2] / 16);
+
+                const uchar index = table[binOf(r, g, b)];
+                dst[x] = index;
+                const QRgb chosen = palette.at(index);
+                const int diff[3] = {r - qRed(chosen), g - qGreen(chosen), b - qBlue(chosen)};
+                int *below = &next[size_t(x + 1) * 3];
+                for(int c = 0; c < 3; ++c)
+                {
+                    error[3 + c] += diff[c] * 7;
+                    below[c - 3] += diff[c] * 3;
+                    below[c] += diff[c] * 5;
+                    below[c + 3] += diff[c];
+                }
+            }
+            current.swap(next);
+            std::fill(next.begin(), next.end(), 0);
+        }
+        return;
+    }
+
+    for(int y = band.top(); y <= band.bottom(); ++y)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        uchar *dst = bits + qptrdiff(y) * stride;
+        if(dither == ordered_dither)
+        {
+            const int *thresholds = bayer[y & 7];
+            for(int x = 0; x < width; ++x)
+            {
+                const int offset = (thresholds[x & 7] * 2 - 63) * ORDERED_DITHER_SPREAD / 128;
+                dst[x] = table[binOf(clampChannel(qRed(row[x]) + offset), clampChannel(qGreen(row[x]) + offset),
+                                     clampChannel(qBlue(row[x]) + offset))];
+            }
+        }
+        else
+        {
+            for(int x = 0; x < width; ++x)
+                dst[x] = table[binOf(qRed(row[x]), qGreen(row[x]), qBlue(row[x]))];
+        }
+    }
+}
+
+/**
+ * quantizeImage: "image" en Indexed8 con una paleta de hasta "colors" colores. Si la imagen no tiene mas colores
+ * distintos que esos, la paleta son esos colores y cada pixel queda exacto; si no, la elige el octree.
+ */
+QImage quantizeImage(const QImage &image, int colors, DitherMode dither)
+{
+    if(image.isNull())
+        return QImage();
+
+    TRACE_SCOPE("quantizeImage");
+    const QImage source = image.convertToFormat(QImage::Format_RGB32);
+    const int limit = qBound(1, colors, PALETTE_SIZE);
+    QVector<QRgb> palette = exactColors(source, limit);
+    const bool exact = !palette.isEmpty();
+    QHash<QRgb, int> indices;
+    std::vector<uchar> table;
+    if(exact)
+    {
+        for(int i = 0; i < palette.size(); ++i)
+            indices.insert(palette.at(i), i);
+    }
+    else
+    {
+        const std::vector<Bin> bins = histogram(source);
+        table.resize(BINS);
+        palette = octreePalette(bins.data(), limit, table.data());
+        inverseTable(palette, bins.data(), table.data());
+    }
+
+    QImage result(source.size(), QImage::Format_Indexed8);
+    result.setColorTable(palette);
+
+    // el resultado se desacopla una sola vez (bits) antes de repartir las bandas entre hilos
+    uchar *bits = result.bits();
+    const int stride = result.bytesPerLine();
+    const uchar *entries = table.data();
+    QList<QRect> bands;
+    for(int y = 0; y < source.height(); y += QUANTIZE_BAND_ROWS)
+        bands.append(QRect(0, y, source.width(), qMin(QUANTIZE_BAND_ROWS, source.height() - y)));
+
+    QtConcurrent::blockingMap(bands, [&source, &palette, &indices, exact, entries, dither, bits,
+                                      stride](const QRect &band) {
+        if(exact)
+            mapExact(source, band, indices, bits, stride);
+        else
+            mapRows(source, band, entries, palette, dither, bits, stride);
+    });
+    return result;
+}
@@ -0,0 +1,24 @@
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+#include <QImage>
+
+#include "constants.h"
+
+
+/**
+ * Cuantizacion a una paleta de hasta PALETTE_SIZE colores, para exportar BMP de 8 bits. Si la imagen no tiene mas
+ * colores distintos que la paleta (un dibujo de colores lisos) se guardan exactos, sin tramado. Si no, los pixeles se
+ * cuentan en un histograma de QUANTIZE_BITS bits por canal (en paralelo, por bandas); los colores del histograma
+ * forman un octree que se reduce juntando primero las hojas mas profundas y con menos pixeles hasta que quedan
+ * "colors" hojas, cada una con el promedio exacto de sus pixeles. Una tabla inversa por color del histograma (la hoja
+ * que lo contiene, o el indice mas cercano para los colores a los que solo llega el tramado) hace que asignar cada
+ * pixel cueste una lectura.
+ *
+ * La asignacion se reparte por bandas de QUANTIZE_BAND_ROWS filas entre los hilos del pool, tambien con tramado: el
+ * ordenado (Bayer 8x8) no depende de los vecinos y el de difusion (Floyd-Steinberg) reparte el error solo dentro de
+ * cada banda. El alfa se ignora, como en los BMP de 24 bits.
+ */
+QImage quantizeImage(const QImage &image, int colors = PALETTE_SIZE, DitherMode dither = no_dither);
+
+#endif // QUANTIZE_H
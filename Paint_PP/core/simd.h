@@ -0,0 +1,111 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <QRgb>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PAINTPP_SSE2
+#endif
+
+
+/**
+ * Vec4: Un pixel ARGB32 expandido a cuatro flotantes (un canal por carril) para los kernels de filtros.
+ * Con SSE2 cada operacion es una sola instruccion sobre los cuatro canales, sin SSE2 se usa el mismo
+ * codigo escalar. El orden de los carriles es el de la memoria (B, G, R, A).
+ */
+#ifdef PAINTPP_SSE2
+
+typedef __m128 Vec4;
+
+inline Vec4 vecZero() { return _mm_setzero_ps(); }
+inline Vec4 vecSet(float f) { return _mm_set1_ps(f); }
+inline Vec4 vecAdd(Vec4 a, Vec4 b) { return _mm_add_ps(a, b); }
+inline Vec4 vecSub(Vec4 a, Vec4 b) { return _mm_sub_ps(a, b); }
+inline Vec4 vecMul(Vec4 a, Vec4 b) { return _mm_mul_ps(a, b); }
+inline Vec4 vecSqrt(Vec4 a) { return _mm_sqrt_ps(a); }
+
+inline Vec4 vecFromPixel(QRgb pixel)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_cvtsi32_si128(int(pixel));
+    v = _mm_unpacklo_epi8(v, zero);
+    v = _mm_unpacklo_epi16(v, zero);
+    return _mm_cvtepi32_ps(v);
+}
+
+/** Redondea, satura a [0, 255] y empaqueta de nuevo en un QRgb. */
+inline QRgb vecToPixel(Vec4 a)
+{
+    __m128i v = _mm_cvtps_epi32(a);
+    v = _mm_packs_epi32(v, v);
+    v = _mm_packus_epi16(v, v);
+    return QRgb(_mm_cvtsi128_si32(v));
+}
+
+/** Limita los canales de color al valor del alfa para mantener el formato premultiplicado valido. */
+inline Vec4 vecClampPremultiplied(Vec4 a)
+{
+    Vec4 alpha = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3));
+    Vec4 clamped = _mm_min_ps(a, alpha);
+    // se conserva el carril del alfa tal como estaba
+    Vec4 mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, clamped));
+}
+
+/** Devuelve "color" con el carril del alfa tomado de "alpha". */
+inline Vec4 vecWithAlpha(Vec4 color, Vec4 alpha)
+{
+    Vec4 mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    return _mm_or_ps(_mm_and_ps(mask, alpha), _mm_andnot_ps(mask, color));
+}
+
+#else
+
+#include <cmath>
+
+struct Vec4 { float v[4]; };
+
+inline Vec4 vecZero() { Vec4 r = {{0.f, 0.f, 0.f, 0.f}}; return r; }
+inline Vec4 vecSet(float f) { Vec4 r = {{f, f, f, f}}; return r; }
+inline Vec4 vecAdd(Vec4 a, Vec4 b) { for(int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+inline Vec4 vecSub(Vec4 a, Vec4 b) { for(int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+inline Vec4 vecMul(Vec4 a, Vec4 b) { for(int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+inline Vec4 vecSqrt(Vec4 a) { for(int i = 0; i < 4; ++i) a.v[i] = std::sqrt(a.v[i]); return a; }
+
+inline Vec4 vecFromPixel(QRgb pixel)
+{
+    Vec4 r = {{float(pixel & 0xff), float((pixel >> 8) & 0xff),
+               float((pixel >> 16) & 0xff), float(pixel >> 24)}};
+    return r;
+}
+
+inline QRgb vecToPixel(Vec4 a)
+{
+    QRgb pixel = 0;
+    for(int i = 0; i < 4; ++i)
+    {
+        int c = int(a.v[i] + 0.5f);
+        c = c < 0 ? 0 : (c > 255 ? 255 : c);
+        pixel |= QRgb(c) << (8 * i);
+    }
+    return pixel;
+}
+
+inline Vec4 vecClampPremultiplied(Vec4 a)
+{
+    for(int i = 0; i < 3; ++i)
+        if(a.v[i] > a.v[3])
+            a.v[i] = a.v[3];
+    return a;
+}
+
+inline Vec4 vecWithAlpha(Vec4 color, Vec4 alpha)
+{
+    color.v[3] = alpha.v[3];
+    return color;
+}
+
+#endif
+
+#endif // SIMD_H
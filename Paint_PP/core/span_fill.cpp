@@ -0,0 +1,170 @@
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <algorithm>
+#include <cstring>
+
+#include "span_fill.h"
+#include "pixel_format.h"
+#include "simd.h"
+#include "trace.h"
+
+
+/**
+ * pixelFor: El valor de "color" en el formato de "image": 32 bits, o el byte de los formatos de 8 bits (el gris, o el
+ * indice del color mas cercano de la paleta). Falso si el formato no es ninguno de esos.
+ */
+static bool pixelFor(const QImage &image, const QColor &color, QRgb *pixel)
+{
+    switch(image.format())
+    {
+        case QImage::Format_ARGB32_Premultiplied: *pixel = qPremultiply(color.rgba()); return true;
+        case QImage::Format_ARGB32:               *pixel = color.rgba();               return true;
+        case QImage::Format_RGB32:                *pixel = color.rgba() | 0xff000000;  return true;
+        case QImage::Format_Grayscale8:           *pixel = QRgb(qGray(color.rgb()));   return true;
+        case QImage::Format_Indexed8:
+            *pixel = QRgb(nearestIndex(image.colorTable(), color.rgba()));
+            return true;
+        default:                                                                        return false;
+    }
+}
+
+/**
+ * fillRow: Escribe "count" veces "pixel". Hasta llegar a una direccion alineada a 16 bytes se escribe de a un pixel,
+ * despues de a cuatro.
+ */
+static inline void fillRow(QRgb *dst, int count, QRgb pixel, bool stream)
+{
+#ifdef PAINTPP_SSE2
+    while(count > 0 && (quintptr(dst) & 15))
+    {
+        *dst++ = pixel;
+        --count;
+    }
+
+    __m128i value = _mm_set1_epi32(int(pixel));
+    if(stream)
+    {
+        for(; count >= 4; count -= 4, dst += 4)
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst), value);
+    }
+    else
+    {
+        for(; count >= 4; count -= 4, dst += 4)
+            _mm_store_si128(reinterpret_cast<__m128i*>(dst), value);
+    }
+#else
+    Q_UNUSED(stream);
+#endif
+    std::fill_n(dst, count, pixel);
+}
+
+static inline void storePixel(uchar *row, int depth, int x, QRgb pixel)
+{
+    if(depth == 8)
+        row[x] = uchar(pixel);
+    else
+        reinterpret_cast<QRgb*>(row)[x] = pixel;
+}
+
+/**
+ * fillRows: Rellena "rect" en una imagen de "depth" bits por pixel. Las filas de 8 bits son memset, que ya escribe por
+ * bloques alineados.
+ */
+static void fillRows(uchar *bits, int stride, int depth, const QRect &rect, QRgb pixel, bool stream)
+{
+    if(depth == 8)
+    {
+        for(int y = rect.top(); y <= rect.bottom(); ++y)
+            memset(bits + qptrdiff(y) * stride + rect.left(), int(pixel), size_t(rect.width()));
+        return;
+    }
+
+    for(int y = rect.top(); y <= rect.bottom(); ++y)
+        fillRow(reinterpret_cast<QRgb*>(bits + qptrdiff(y) * stride) + rect.left(), rect.width(), pixel, stream);
+
+#ifdef PAINTPP_SSE2
+    // los stores no temporales se ordenan antes de que otro hilo lea las filas
+    if(stream)
+        _mm_sfence();
+#endif
+}
+
+/**
+ * spanFill: Rellena "rect" (recortado a la imagen) con "color".
+ */
+bool spanFill(QImage &image, const QRect &rect, const QColor &color)
+{
+    QRgb pixel;
+    if(!pixelFor(image, color, &pixel))
+        return false;
+
+    QRect area = rect.normalized().intersected(image.rect());
+    if(area.isEmpty())
+        return true;
+
+    TRACE_SCOPE("spanFill");
+    const qint64 pixels = qint64(area.width()) * area.height();
+    const int depth = image.depth();
+    const bool stream = pixels * (depth / 8) >= SPAN_STREAM_BYTES;
+
+    // la imagen se desacopla una sola vez (bits) antes de repartir las filas entre hilos
+    uchar *bits = image.bits();
+    const int stride = image.bytesPerLine();
+    if(pixels < SPAN_PARALLEL_PIXELS)
+    {
+        fillRows(bits, stride, depth, area, pixel, stream);
+        return true;
+    }
+
+    // una banda por hilo, cada una ya es lo bastante grande para que repartir valga la pena
+    const int threads = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+    const int bandHeight = (area.height() + threads - 1) / threads;
+    QList<QRect> bands;
+    for(int y = area.top(); y <= area.bottom(); y += bandHeight)
+        bands.append(QRect(area.left(), y, area.width(), qMin(bandHeight, area.bottom() - y + 1)));
+
+    QtConcurrent::blockingMap(bands, [bits, stride, depth, pixel, stream](const QRect &band) {
+        fillRows(bits, stride, depth, band, pixel, stream);
+    });
+    return true;
+}
+
+/**
+ * spanOutline: Borde de un pixel de "rect" con "color". Cubre los mismos pixeles que QPainter::drawRect con un lapiz de
+ * un pixel sin antialiasing, que incluye la fila y la columna siguientes al borde inferior derecho.
+ */
+bool spanOutline(QImage &image, const QRect &rect, const QColor &color)
+{
+    QRgb pixel;
+    if(!pixelFor(image, color, &pixel))
+        return false;
+
+    QRect outline = rect.normalized().adjusted(0, 0, 1, 1);
+    QRect clip = image.rect();
+    if(!outline.intersects(clip))
+        return true;
+
+    uchar *bits = image.bits();
+    const int stride = image.bytesPerLine();
+    const int depth = image.depth();
+
+    // las filas de arriba y abajo son tramos, los lados un pixel por fila
+    QRect top = QRect(outline.left(), outline.top(), outline.width(), 1).intersected(clip);
+    QRect bottom = QRect(outline.left(), outline.bottom(), outline.width(), 1).intersected(clip);
+    if(!top.isEmpty())
+        fillRows(bits, stride, depth, top, pixel, false);
+    if(!bottom.isEmpty())
+        fillRows(bits, stride, depth, bottom, pixel, false);
+
+    const int first = qMax(outline.top() + 1, clip.top());
+    const int last = qMin(outline.bottom() - 1, clip.bottom());
+    for(int y = first; y <= last; ++y)
+    {
+        uchar *row = bits + qptrdiff(y) * stride;
+        if(clip.left() <= outline.left() && outline.left() <= clip.right())
+            storePixel(row, depth, outline.left(), pixel);
+        if(clip.left() <= outline.right() && outline.right() <= clip.right())
+            storePixel(row, depth, outline.right(), pixel);
+    }
+    return true;
+}
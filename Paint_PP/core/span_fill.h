@@ -0,0 +1,23 @@
+#ifndef SPAN_FILL_H
+#define SPAN_FILL_H
+
+#include <QImage>
+#include <QColor>
+
+#include "constants.h"
+
+
+/**
+ * Rellenos de tramos (spans): rectangulos alineados con los ejes, de un solo color, escritos fila por fila sin pasar
+ * por QPainter. Cada fila es una serie de stores de 16 bytes (SSE2); las areas grandes se reparten por bandas de filas
+ * entre los hilos del pool y, si no caben en el cache, se escriben con stores no temporales, asi llenar todo el lienzo
+ * cuesta lo que tarda la memoria en recibir los bytes.
+ *
+ * El color reemplaza a los pixeles (como QImage::fill). Sirven para imagenes de 32 bits (RGB32, ARGB32 y ARGB32
+ * premultiplicado) y para las capas de 8 bits (Grayscale8 e Indexed8, con el color mas cercano de la paleta); con
+ * otro formato no escriben nada y devuelven falso, quien llama usa QPainter.
+ */
+bool spanFill(QImage &image, const QRect &rect, const QColor &color);
+bool spanOutline(QImage &image, const QRect &rect, const QColor &color);
+
+#endif // SPAN_FILL_H
@@ -0,0 +1,474 @@
+#include <QPainter>
+
+#include "tool.h"
+#include "canvas.h"
+#include "perf_stats.h"
+#include "span_fill.h"
+#include "pixel_format.h"
+#include "trace.h"
+
+
+/**
+ * @brief PencilTool::drawTo: Este es el metodo que se usa para dibujar con el objeto PencilTool el cual es la herramienta que se usa para ejecutar la función
+ *                            lapiz donde va dibujar desd el primer pounto donde se hace clic un trazo continuo mientras se tenga presionado el mouse, hasta el ultimo
+ *                            punto donde se deje de poresionar.
+ */
+void PencilTool::drawTo(const QPoint &endPoint, Canvas *canvas, QImage *image)
+{
+    TRACE_SCOPE("PencilTool::drawTo");
+    ScopedTimer timer(perf_tool);
+    QPainter painter(image);
+    painter.setPen(static_cast<QPen>(*this));
+    painter.drawLine(getStartPoint(), endPoint);
+
+    int rad = (this->width() / 2) + 2;
+    canvas->updateCanvas(QRect(getStartPoint(), endPoint).normalized()
+                                .adjusted(-rad, -rad, +rad, +rad));
+    setStartPoint(endPoint);
+}
+
+/**
+ * @brief PenTool::drawTo: Este es el metodo que se usa para dibujar con el objeto PenTool el cual es la herramienta que se usa para ejecutar la función
+ *                            lapicero donde va dibujar una linea recta desde el primer punto donde se haga clic hasta donde se mueva el mouse y se deje de presionar.
+ *                            La polilinea del modo poly no pasa por aqui, se dibuja completa con commitPath().
+ */
+void PenTool::drawTo(const QPoint &endPoint,  Canvas *canvas, QImage *image)
+{
+    TRACE_SCOPE("PenTool::drawTo");
+    ScopedTimer timer(perf_tool);
+    QPainter painter(image);
+    dashes.setPen(*this);
+    dashes.stroke(painter, QPolygon() << getStartPoint() << endPoint);
+
+    canvas->updateCanvas(segmentRect(getStartPoint(), endPoint));
+}
+
+/**
+ * @brief PenTool::beginPath: Empieza una polilinea en "point". Hasta commitPath() solo existe como lista de vertices
+ *                            que se pinta encima del lienzo.
+ */
+void PenTool::beginPath(const QPoint &point)
+{
+    path = QPolygon() << point;
+    active = false;
+}
+
+/**
+ * @brief PenTool::moveActive: Mueve el extremo del segmento activo. Devuelve el area a repintar: donde estaba y donde
+ *                             queda ese segmento, y la union con el ultimo segmento fijo, que cambia con la direccion
+ *                             del activo. Los demas segmentos no cambian.
+ */
+QRect PenTool::moveActive(const QPoint &point)
+{
+    if(path.isEmpty())
+        return QRect();
+
+    QRect dirty = active ? segmentRect(path.last(), activeEnd) : QRect();
+    activeEnd = point;
+    active = true;
+    dirty = dirty.united(segmentRect(path.last(), activeEnd));
+    if(path.size() >= 2)
+    {
+        int rad = reach();
+        dirty = dirty.united(QRect(path.last(), path.last()).adjusted(-rad, -rad, +rad, +rad));
+    }
+    return dirty;
+}
+
+/**
+ * @brief PenTool::extendPath: El segmento activo termina en "point" y pasa a ser un segmento fijo, la polilinea sigue
+ *                             desde ahi. Canvas::endStroke siempre mueve antes el segmento activo, asi que cada clic
+ *                             agrega un vertice, salvo que caiga sobre el ultimo. No hay nada que repintar: el
+ *                             segmento fijo se ve igual que cuando era el activo.
+ */
+void PenTool::extendPath(const QPoint &point)
+{
+    if(!active || path.isEmpty())
+        return;
+
+    active = false;
+    if(path.last() != point)
+        path << point;
+}
+
+/**
+ * @brief PenTool::commitPath: Dibuja toda la polilinea en "image" como un solo trazo, con las uniones del lapiz entre
+ *                             segmentos y el patron continuo, y la descarta. Devuelve el area modificada, nula si la
+ *                             polilinea no tenia segmentos.
+ */
+QRect PenTool::commitPath(QImage *image)
+{
+    TRACE_SCOPE("PenTool::commitPath");
+    QRect dirty;
+    if(path.size() >= 2)
+    {
+        QPainter painter(image);
+        dashes.setPen(*this);
+        dashes.stroke(painter, path);
+
+        int rad = reach();
+        dirty = path.boundingRect().adjusted(-rad, -rad, +rad, +rad);
+    }
+    clearPath();
+    return dirty;
+}
+
+/**
+ * @brief PenTool::clearPath: Descarta la polilinea sin dibujarla. Devuelve el area donde se veia.
+ */
+QRect PenTool::clearPath()
+{
+    QRect shown;
+    if(!path.isEmpty())
+    {
+        int rad = reach();
+        shown = path.boundingRect().adjusted(-rad, -rad, +rad, +rad);
+        if(active)
+            shown = shown.united(segmentRect(path.last(), activeEnd));
+    }
+
+    path.clear();
+    active = false;
+    return shown;
+}
+
+/**
+ * @brief PenTool::paint: Pinta la polilinea encima del lienzo con "color", solo los segmentos y uniones que tocan
+ *                        "exposed". Los guiones de los segmentos fijos se calculan una sola vez, al arrastrar solo
+ *                        cambia el activo. commitPath usa el mismo trazo, la capa queda con los pixeles que se vieron.
+ */
+void PenTool::paint(QPainter &painter, const QRect &exposed, const QColor &color)
+{
+    if(path.isEmpty())
+        return;
+
+    QPen shown = *this;
+    shown.setColor(color);
+    dashes.setPen(shown);
+    if(active)
+        path << activeEnd;
+    dashes.stroke(painter, path, exposed);
+    if(active)
+        path.removeLast();
+}
+
+QRect PenTool::segmentRect(const QPoint &p0, const QPoint &p1) const
+{
+    int rad = (this->width() / 2) + 2;
+    return QRect(p0, p1).normalized().adjusted(-rad, -rad, +rad, +rad);
+}
+
+/**
+ * @brief PenTool::reach: Hasta donde puede llegar el trazo de la polilinea desde un vertice: las uniones en inglete
+ *                        llegan a miterLimit() veces el grosor, las demas (y las terminaciones cuadradas en diagonal)
+ *                        a menos de un grosor.
+ */
+int PenTool::reach() const
+{
+    qreal distance = widthF();
+    if(joinStyle() == Qt::MiterJoin)
+        distance *= qMax<qreal>(miterLimit(), 1.0);
+    return int(distance) + 2;
+}
+
+/**
+ * @brief ShapesTool::ShapesTool: Es el constructor de ShapesTool que es el objeto que se encarga de dibujar las Figuras.
+ */
+ShapesTool::ShapesTool(const QBrush &brush, qreal width, Qt::PenStyle s,
+                   Qt::PenCapStyle c, Qt::PenJoinStyle j, QColor fill,
+                   ShapeType shape, FillColor mode)
+    : Tool(brush, width, s, c, j)
+{
+    fillColor = fill;
+    fillMode = mode;
+    shapeType = shape;
+}
+
+/**
+ * @brief ShapesTool::drawTo:  Este es el metodo que se usa para dibujar con el objeto ShapesTool el cual es la herramienta que se usa para ejecutar la función
+ *                            que dibuja las figuras donde toma como referencia una linea recta desde el primer punto donde se haga clic hasta donde se mueva
+ *                            el mouse y se deje de presionar, dicha recta se va usar de forma diferente segun sea la figura que se vaya a dibujar pero en todas
+ *                            se usa como referencia.
+ */
+void ShapesTool::drawTo(const QPoint &endPoint,  Canvas *canvas, QImage *image)
+{
+    TRACE_SCOPE("ShapesTool::drawTo");
+    ScopedTimer timer(perf_tool);
+    QRect rect = adjustPoints(endPoint);
+    int rad = (this->width() / 2) + 2;
+
+    // el rectangulo va de esquina a esquina hacia donde se arrastre: adjustPoints solo ordena las x, y con las y al
+    // reves QRect tendria alto negativo, que QPainter y los tramos no recorren igual
+    if(shapeType == rectangle)
+        rect = QRect(QPoint(rect.left(), qMin(rect.top(), rect.bottom())),
+                     QPoint(rect.right(), qMax(rect.top(), rect.bottom())));
+
+    // rectangulo de colores opacos con borde solido de un pixel: se escriben las filas, sin QPainter
+    if(shapeType == rectangle && drawSpans(rect, image))
+    {
+        canvas->updateCanvas(rect.adjusted(-rad, -rad, +rad, +rad));
+        return;
+    }
+
+    QPainter painter(image);
+    painter.setPen(static_cast<QPen>(*this));
+    QPoint temp_point = endPoint;
+    QRect bounds = rect;
+
+    switch(shapeType)
+    {   //La recta que se traza con los eventos del mouse se susa como la diagonal del rectangulo
+        case rectangle:
+        {
+            if(fillMode != no_fill)
+                painter.fillRect(rect, fillColor);
+            painter.drawRect(rect);
+        } break;
+        //La recta que se traza con los eventos del mouse se susa de referencia de esta forma:
+        // -Primer punto de la base del triangulo:se usa el primer punto de lña recta.
+        // -Segundo punto de la base del triangulo: se usa el eje x del ultimo punto de la recta, con el eje y del primer punto de la recta.
+        // -Tercer punto (altura del triangulo): Se usa como eje x el punto medio de la base y como eje y el mismo de ultimo punto de la recta.
+        case triangle:
+        {
+            if(fillMode != no_fill){
+                painter.setBrush(QBrush(fillColor));}
+            if(rect.topLeft().rx()!=temp_point.rx()){
+            polygon << QPoint(rect.topLeft()) << QPoint(rect.center().rx(),temp_point.ry()) << QPoint(rect.topRight());}
+            else{
+                polygon  << QPoint(temp_point) << QPoint(rect.center().rx(),rect.center().ry()-(rect.topRight().rx()-rect.center().rx()))<< QPoint(rect.topRight());
+            }
+
+            painter.drawPolygon(polygon);
+            bounds = bounds.united(polygon.boundingRect());
+            polygon.clear();
+
+        } break;
+        //La recta que se traza con los eventos del mouse se susa como el diametro del circulo.
+        case ellipse:
+        {
+            if(fillMode != no_fill)
+                painter.setBrush(QBrush(fillColor));
+            painter.drawEllipse(rect);
+        }
+        break;
+        default:
+          break;
+    }
+
+    canvas->updateCanvas(bounds.normalized().adjusted(-rad, -rad, +rad, +rad));
+}
+
+/**
+ * @brief ShapesTool::drawSpans: Rectangulo con spanFill y spanOutline. Solo cuando el resultado es el mismo que con
+ *                               QPainter: colores opacos (reemplazar es igual que mezclar) y un borde solido de un
+ *                               pixel, sin guiones ni esquinas biseladas. Si no, devuelve falso sin dibujar.
+ */
+bool ShapesTool::drawSpans(const QRect &rect, QImage *image) const
+{
+    bool fill = fillMode != no_fill;
+    if(style() != Qt::SolidLine || width() > 1 || brush().style() != Qt::SolidPattern || color().alpha() != 255
+       || (fill && fillColor.alpha() != 255))
+        return false;
+
+    if(fill && !spanFill(*image, rect, fillColor))
+        return false;
+    return spanOutline(*image, rect, color());
+}
+
+/**
+ * @brief RectTool::adjustPoints: Este metodo instancia una recta entre el primer punto donde se recibio el evento de que se presiono el boton izquierdo del mouse
+ *                                y el ultimo punto donde se recibe este evento.
+ */
+QRect ShapesTool::adjustPoints(const QPoint &endPoint)
+{
+    QRect rect;
+    if(endPoint.x() < getStartPoint().x())
+        rect = QRect(endPoint, getStartPoint());
+    else
+        rect = QRect(getStartPoint(), endPoint);
+    return rect;
+}
+
+/**
+ * @brief SelectionTool::SelectionTool: Constructor de la herramienta de seleccion rectangular, el trazo del objeto
+ *                                      (QPen) es el que se usa para dibujar el borde punteado de la seleccion.
+ */
+SelectionTool::SelectionTool(const QBrush &brush, qreal width, Qt::PenStyle s,
+                             Qt::PenCapStyle c, Qt::PenJoinStyle j)
+    : Tool(brush, width, s, c, j)
+{
+    floating = false;
+    moving = false;
+}
+
+/**
+ * @brief SelectionTool::drawTo: Mientras se arrastra el mouse estira el rectangulo de seleccion desde el punto inicial o,
+ *                               si se esta moviendo una seleccion flotante, solo cambia su posicion. Nunca se toca el lienzo,
+ *                               solo se repinta la union de la posicion anterior y la nueva.
+ */
+void SelectionTool::drawTo(const QPoint &endPoint, Canvas *canvas, QImage*)
+{
+    TRACE_SCOPE("SelectionTool::drawTo");
+    QRect oldRect = selRect;
+
+    if(moving)
+        selRect.moveTopLeft(endPoint - grabOffset);
+    else
+        selRect = QRect(getStartPoint(), endPoint).normalized();
+
+    int rad = (this->width() / 2) + 2;
+    canvas->repaint(oldRect.united(selRect).adjusted(-rad, -rad, +rad, +rad));
+}
+
+/**
+ * @brief SelectionTool::beginMove: Guarda la distancia entre el punto donde se hizo clic y la esquina de la seleccion
+ *                                  para que esta siga al cursor sin saltos.
+ */
+void SelectionTool::beginMove(const QPoint &point)
+{
+    moving = true;
+    grabOffset = point - selRect.topLeft();
+}
+
+/**
+ * @brief SelectionTool::lift: Convierte la seleccion en una capa flotante. La capa flotante no copia pixeles: es una
+ *                             referencia compartida a la capa anterior ("original", que tambien se guarda para el
+ *                             "undo") y el rectangulo de donde sale. El hueco se borra en la capa con "background"
+ *                             (el color de fondo o transparente); eso desacopla la capa de "original", es la unica
+ *                             copia completa y es la misma que hace cualquier trazo. Devuelve el area modificada.
+ */
+QRect SelectionTool::lift(QImage *canvas, const QColor &background)
+{
+    if(floating || !hasSelection())
+        return QRect();
+
+    selRect = selRect.intersected(canvas->rect());
+    original = *canvas;
+    source = original;
+    sourceRect = selRect;
+    hole = selRect;
+    floating = true;
+
+    if(!spanFill(*canvas, hole, background))
+    {
+        QPainter painter(canvas);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.fillRect(hole, background);
+    }
+    return hole;
+}
+
+/**
+ * @brief SelectionTool::paste: Crea una seleccion flotante con el contenido pegado en la posicion indicada.
+ */
+void SelectionTool::paste(const QImage &canvas, const QImage &pixels, const QPoint &pos)
+{
+    original = canvas;
+    source = pixels;
+    sourceRect = pixels.rect();
+    selRect = QRect(pos, pixels.size());
+    hole = QRect();
+    floating = true;
+    moving = false;
+}
+
+/**
+ * @brief SelectionTool::content: Devuelve los pixeles de la seleccion, ya sea desde la capa flotante o desde el lienzo.
+ */
+QImage SelectionTool::content(const QImage &canvas) const
+{
+    if(floating)
+        return sourceRect == source.rect() ? source : source.copy(sourceRect);
+
+    return canvas.copy(selRect.intersected(canvas.rect()));
+}
+
+/**
+ * @brief SelectionTool::takeOriginal: Devuelve la capa como estaba antes de despegar o pegar la seleccion y suelta
+ *                                     la referencia, para guardarla en la pila de "undo".
+ */
+QImage SelectionTool::takeOriginal()
+{
+    QImage before = original;
+    original = QImage();
+    return before;
+}
+
+/**
+ * @brief SelectionTool::commit: Pinta la capa flotante en el lienzo y devuelve el area modificada.
+ */
+QRect SelectionTool::commit(QImage *image)
+{
+    if(!floating)
+        return QRect();
+
+    // las capas de 8 bits no tienen transparencia, pegar es reemplazar los pixeles
+    if(image->depth() == 8)
+        copyPixels(source, sourceRect, *image, selRect.topLeft());
+    else
+    {
+        QPainter painter(image);
+        painter.drawImage(selRect.topLeft(), source, sourceRect);
+    }
+
+    QRect dirty = hole.united(selRect);
+    source = QImage();
+    sourceRect = QRect();
+    original = QImage();
+    floating = false;
+    moving = false;
+    hole = QRect();
+    return dirty;
+}
+
+/**
+ * @brief SelectionTool::discard: Descarta la capa flotante (funcion cortar), el hueco ya quedo borrado en la capa.
+ */
+QRect SelectionTool::discard(QImage*)
+{
+    QRect dirty = hole;
+    clear();
+    return dirty;
+}
+
+/**
+ * @brief SelectionTool::clear: Elimina la seleccion sin modificar el lienzo.
+ */
+void SelectionTool::clear()
+{
+    selRect = QRect();
+    source = QImage();
+    sourceRect = QRect();
+    original = QImage();
+    hole = QRect();
+    floating = false;
+    moving = false;
+}
+
+/**
+ * @brief SelectionTool::paint: Dibuja encima del lienzo la capa flotante y el borde de la seleccion, limitado al area
+ *                              que se esta repintando.
+ */
+void SelectionTool::paint(QPainter &painter, const QRect &exposed) const
+{
+    if(!hasSelection())
+        return;
+
+    if(floating)
+    {
+        QRect target = selRect.intersected(exposed);
+        if(!target.isEmpty())
+            painter.drawImage(target, source, target.translated(sourceRect.topLeft() - selRect.topLeft()));
+    }
+
+    painter.setPen(static_cast<QPen>(*this));
+    painter.drawRect(selRect.adjusted(0, 0, -1, -1));
+}
+
+/**
+ * @brief SelectionTool::byteCount: Memoria de la capa flotante y de la copia de la capa que se guarda para el "undo",
+ *                                  despues de despegar son la misma imagen y se cuenta una vez.
+ */
+qint64 SelectionTool::byteCount(QSet<qint64> *seen) const
+{
+    return imageBytes(source, seen) + imageBytes(original, seen);
+}
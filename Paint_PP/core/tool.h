@@ -1,13 +1,16 @@
 #ifndef TOOL_H
 #define TOOL_H
 
-#include <QWidget>
+#include <QImage>
 #include <QPen>
+#include <QSet>
 
 #include "constants.h"
+#include "dash_stroker.h"
 
 
-class DrawArea;
+class Canvas;
+class QPainter;
 
 
 class Tool : public QPen
@@ -20,7 +23,7 @@ public:
     virtual ~Tool() {}
 
     virtual ToolType getType() const = 0;
-    virtual void drawTo(const QPoint&, DrawArea*, QPixmap*) {}
+    virtual void drawTo(const QPoint&, Canvas*, QImage*) {}
 
     QPoint getStartPoint() const { return startPoint; }
     void setStartPoint(QPoint point) { startPoint = point; }
@@ -46,7 +49,7 @@ public:
        : Tool(brush, width, s, c, j) {}
 
     virtual ToolType getType() const { return pencil; }
-    virtual void drawTo(const QPoint&, DrawArea*, QPixmap*);
+    virtual void drawTo(const QPoint&, Canvas*, QImage*);
 
 private:
     PencilTool(const PencilTool&);
@@ -65,11 +68,27 @@ public:
     PenTool(const QBrush &brush, qreal width, Qt::PenStyle s = Qt::SolidLine,
              Qt::PenCapStyle c = Qt::RoundCap,
              Qt::PenJoinStyle j = Qt::BevelJoin)
-       : Tool(brush, width, s, c, j) {}
+       : Tool(brush, width, s, c, j), active(false) {}
     virtual ToolType getType() const { return pen; }
-    virtual void drawTo(const QPoint&, DrawArea*, QPixmap*);
+    virtual void drawTo(const QPoint&, Canvas*, QImage*);
+
+    bool hasPath() const { return !path.isEmpty(); }
+    void beginPath(const QPoint &point);
+    QRect moveActive(const QPoint &point);
+    void extendPath(const QPoint &point);
+    QRect commitPath(QImage *image);
+    QRect clearPath();
+    void paint(QPainter &painter, const QRect &exposed, const QColor &color);
 
 private:
+    QRect segmentRect(const QPoint &p0, const QPoint &p1) const;
+    int reach() const;
+
+    QPolygon path;          // vertices fijos de la polilinea (modo poly), todavia fuera de la capa
+    QPoint activeEnd;       // extremo del segmento que se esta arrastrando desde path.last()
+    bool active;
+    DashStroker dashes;
+
     /** Don't allow copying */
     PenTool(const PenTool&);
     PenTool& operator=(const PenTool&);
@@ -114,17 +133,21 @@ public:
              FillColor mode = no_fill);
 
     virtual ToolType getType() const { return shapes_tool; }
-    virtual void drawTo(const QPoint&, DrawArea*, QPixmap*);
+    virtual void drawTo(const QPoint&, Canvas*, QImage*);
 
     FillColor getFillMode() const { return fillMode; }
     void setFillMode(FillColor mode) { fillMode = mode; }
+    ShapeType getShapeType() const { return shapeType; }
     void setShapeType(ShapeType shape) { shapeType = shape; }
+    QColor getFillColor() const { return fillColor; }
     void setFillColor(QColor color) { fillColor = color; }
     void setCurve(int value) { roundedCurve = value; }
     QRect adjustPoints(const QPoint&);
 
     QPolygon polygon;
 private:
+    bool drawSpans(const QRect &rect, QImage *image) const;
+
     QColor fillColor;
     FillColor fillMode;
     int roundedCurve;
@@ -133,4 +156,52 @@ private:
     ShapesTool& operator=(const ShapesTool&);
 };
 
+
+
+/**
+ * Herramienta de Seleccion rectangular
+ */
+
+class SelectionTool : public Tool
+{
+public:
+    SelectionTool(const QBrush &brush, qreal width, Qt::PenStyle s = Qt::DashLine,
+                  Qt::PenCapStyle c = Qt::FlatCap,
+                  Qt::PenJoinStyle j = Qt::MiterJoin);
+
+    virtual ToolType getType() const { return selection; }
+    virtual void drawTo(const QPoint&, Canvas*, QImage*);
+
+    bool hasSelection() const { return !selRect.isEmpty(); }
+    bool isFloating() const { return floating; }
+    bool isMoving() const { return moving; }
+    bool contains(const QPoint &point) const { return selRect.contains(point); }
+    QRect getRect() const { return selRect; }
+
+    void beginMove(const QPoint&);
+    void endDrag() { moving = false; }
+    QRect lift(QImage*, const QColor&);
+    void paste(const QImage&, const QImage&, const QPoint&);
+    QImage content(const QImage&) const;
+    QImage takeOriginal();
+    QRect commit(QImage*);
+    QRect discard(QImage*);
+    void clear();
+    void paint(QPainter&, const QRect&) const;
+    qint64 byteCount(QSet<qint64> *seen) const;
+
+private:
+    QRect selRect;
+    QImage source;          // pixeles de la capa flotante: la capa anterior al despegar, lo pegado al pegar
+    QRect sourceRect;       // parte de "source" que flota
+    QImage original;
+    QRect hole;
+    bool floating;
+    bool moving;
+    QPoint grabOffset;
+
+    SelectionTool(const SelectionTool&);
+    SelectionTool& operator=(const SelectionTool&);
+};
+
 #endif // TOOL_H
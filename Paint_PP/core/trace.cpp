@@ -0,0 +1,134 @@
+#include <QFile>
+#include <QVector>
+#include <QThread>
+#include <QTextStream>
+#include <QCoreApplication>
+#include <atomic>
+
+#include "trace.h"
+
+
+QAtomicInt Trace::enabled(0);
+QElapsedTimer Trace::clock;
+QAtomicInteger<qint64> Trace::origin(0);
+Trace::Event* Trace::buffer = 0;
+QAtomicInteger<quint32> Trace::next(0);
+
+static QString environmentFile;
+
+/**
+ * @brief Trace::start: Vacia el buffer y empieza a registrar. El buffer se reserva y el reloj arranca solo la primera
+ *                      vez; despues vaciar es mover el origen y el contador, registrar un evento no reserva memoria.
+ */
+void Trace::start()
+{
+    enabled.storeRelease(0);
+    if(!buffer)
+    {
+        buffer = new Event[TRACE_BUFFER_EVENTS];
+        clock.start();
+    }
+    origin.store(clock.nsecsElapsed());
+    next.store(0);
+    enabled.storeRelease(1);
+}
+
+void Trace::stop()
+{
+    enabled.storeRelease(0);
+}
+
+/**
+ * @brief Trace::record: Toma la siguiente posicion del buffer y escribe el evento. El numero de secuencia se pone en
+ *                       cero antes de escribir y se guarda al final, como en un seqlock.
+ */
+void Trace::record(const char *name, qint64 start, qint64 duration)
+{
+    const quint32 position = next.fetchAndAddRelaxed(1);
+    Event &event = buffer[position % TRACE_BUFFER_EVENTS];
+    event.sequence.store(0);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name);
+    event.start.store(start);
+    event.duration.store(duration);
+    event.thread.store(quint64(quintptr(QThread::currentThreadId())));
+    event.sequence.storeRelease(position + 1);
+}
+
+/**
+ * @brief Trace::dump: Guarda los eventos del buffer, del mas viejo al mas nuevo, como eventos completos ("ph": "X")
+ *                     del formato de Chrome. El registro se pausa mientras se escribe; los bloques que ya estaban
+ *                     abiertos pueden seguir escribiendo, por eso se saltan los eventos a medio escribir o pisados
+ *                     durante la lectura (su secuencia no es la esperada antes y despues de leerlos).
+ */
+bool Trace::dump(const QString &fileName)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+
+    const int wasEnabled = enabled.fetchAndStoreOrdered(0);
+
+    const quint32 written = next.load();
+    const quint32 count = qMin<quint32>(written, TRACE_BUFFER_EVENTS);
+    const quint32 first = written - count;
+    const qint64 since = origin.load();
+
+    // los hilos se numeran en orden de aparicion, son mas faciles de leer que los punteros
+    QVector<quint64> threads;
+
+    QTextStream out(&file);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool separator = false;
+    for(quint32 i = 0; i < count; i++)
+    {
+        const quint32 position = first + i;
+        Event &event = buffer[position % TRACE_BUFFER_EVENTS];
+        if(event.sequence.loadAcquire() != position + 1)
+            continue;
+        const char *name = event.name.load();
+        const qint64 start = event.start.load();
+        const qint64 duration = event.duration.load();
+        const quint64 thread = event.thread.load();
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(event.sequence.load() != position + 1 || start < since)
+            continue;
+
+        int tid = threads.indexOf(thread);
+        if(tid < 0)
+        {
+            tid = threads.size();
+            threads << thread;
+        }
+
+        out << (separator ? ",\n" : "\n")
+            << "{\"name\":\"" << name << "\",\"cat\":\"paintpp\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+            << ",\"ts\":" << QString::number((start - since) / 1000.0, 'f', 3)
+            << ",\"dur\":" << QString::number(duration / 1000.0, 'f', 3) << "}";
+        separator = true;
+    }
+    out << "\n]}\n";
+
+    enabled.storeRelease(wasEnabled);
+    return out.status() == QTextStream::Ok;
+}
+
+static void dumpAtExit()
+{
+    Trace::stop();
+    Trace::dump(environmentFile);
+}
+
+/**
+ * @brief Trace::startFromEnvironment: Si la variable PAINTPP_TRACE tiene un nombre de archivo empieza a registrar y
+ *                                     guarda la traza en ese archivo al salir de la aplicacion.
+ */
+void Trace::startFromEnvironment()
+{
+    environmentFile = QString::fromLocal8Bit(qgetenv("PAINTPP_TRACE"));
+    if(environmentFile.isEmpty())
+        return;
+
+    start();
+    qAddPostRoutine(dumpAtExit);
+}
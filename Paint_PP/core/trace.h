@@ -0,0 +1,88 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QElapsedTimer>
+#include <QString>
+
+#include "constants.h"
+
+
+/**
+ * Trace: Registro en memoria de cuanto tardan las rutas criticas (eventos del mouse, herramientas, comandos, abrir,
+ * guardar...). Los eventos se escriben en un buffer circular de TRACE_BUFFER_EVENTS y se pueden guardar en el
+ * formato JSON de Chrome (chrome://tracing, ui.perfetto.dev). Se puede escribir desde varios hilos a la vez.
+ *
+ * El buffer se reserva en el primer start() y no cambia nunca, asi los bloques que siguen abiertos al parar o volver
+ * a empezar escriben siempre en memoria valida. Cada evento lleva el numero de escritura que le toco, guardado al
+ * final con orden "release": dump() solo guarda los eventos completos y que nadie piso mientras se leian.
+ *
+ * Deshabilitado, TRACE_SCOPE solo lee un entero atomico. Compilando con PAINTPP_NO_TRACE desaparece por completo.
+ */
+class Trace
+{
+public:
+    struct Event
+    {
+        QAtomicPointer<const char> name;    // siempre una cadena literal, no se copia
+        QAtomicInteger<qint64> start;       // nanosegundos del reloj de la traza
+        QAtomicInteger<qint64> duration;
+        QAtomicInteger<quint64> thread;
+        QAtomicInteger<quint32> sequence;   // numero de escritura + 1 con el evento completo, 0 mientras se escribe
+    };
+
+    static bool isEnabled() { return enabled.loadAcquire() != 0; }
+    static void start();
+    static void stop();
+    static bool dump(const QString &fileName);
+    static void startFromEnvironment();
+
+    static qint64 now() { return clock.nsecsElapsed(); }
+    static void record(const char *name, qint64 start, qint64 duration);
+
+private:
+    static QAtomicInt enabled;
+    static QElapsedTimer clock;             // arranca una sola vez, con el buffer
+    static QAtomicInteger<qint64> origin;   // momento del ultimo start(), los eventos anteriores no se guardan
+    static Event *buffer;
+    static QAtomicInteger<quint32> next;
+};
+
+/**
+ * TraceScope: Registra el bloque donde se declara, de su creacion al final del bloque.
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : name(Trace::isEnabled() ? name : 0)
+    {
+        if(this->name)
+            start = Trace::now();
+    }
+
+    ~TraceScope()
+    {
+        if(name)
+            Trace::record(name, start, Trace::now() - start);
+    }
+
+private:
+    const char* name;
+    qint64 start;
+
+    TraceScope(const TraceScope&);
+    TraceScope& operator=(const TraceScope&);
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef PAINTPP_NO_TRACE
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#endif
+
+#endif // TRACE_H
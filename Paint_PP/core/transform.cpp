@@ -0,0 +1,226 @@
+#include <QtConcurrent>
+#include <cstring>
+
+#include "transform.h"
+#include "simd.h"
+#include "trace.h"
+
+
+/**
+ * Mapping: Donde esta en el original el pixel (0, 0) del resultado, y cuantos bytes se avanza en el original por cada
+ * pixel hacia la derecha (stepX) o fila hacia abajo (stepY) en el resultado. En los reflejos y el giro de 180 stepX es
+ * un pixel; en los giros de 90 y 270 es una fila del original.
+ */
+struct Mapping
+{
+    const uchar *origin;
+    qptrdiff stepX;
+    qptrdiff stepY;
+};
+
+static Mapping mappingOf(const QImage &source, ImageTransform transform)
+{
+    const qptrdiff bpp = source.depth() / 8;
+    const qptrdiff stride = source.bytesPerLine();
+    const qptrdiff right = (source.width() - 1) * bpp;
+    const qptrdiff bottom = (source.height() - 1) * stride;
+    const uchar *bits = source.constBits();
+    switch(transform)
+    {
+        case rotate_90:       return {bits + bottom, -stride, bpp};
+        case rotate_180:      return {bits + bottom + right, -bpp, -stride};
+        case rotate_270:      return {bits + right, stride, -bpp};
+        case flip_horizontal: return {bits + right, -bpp, stride};
+        default:              return {bits + bottom, bpp, -stride};
+    }
+}
+
+/**
+ * reverseRow32: Copia "width" pixeles de 32 bits leyendo hacia la izquierda desde "last".
+ */
+static void reverseRow32(const uchar *last, uchar *target, int width)
+{
+    const quint32 *source = reinterpret_cast<const quint32*>(last);
+    quint32 *row = reinterpret_cast<quint32*>(target);
+    int x = 0;
+#ifdef PAINTPP_SSE2
+    for(; x + 4 <= width; x += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source - x - 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+#endif
+    for(; x < width; ++x)
+        row[x] = source[-x];
+}
+
+/**
+ * reverseRow8: Como reverseRow32 para pixeles de un byte. SSE2 no tiene una instruccion para invertir bytes: se
+ * invierten los bytes de cada palabra, las palabras de cada mitad y por ultimo las dos mitades.
+ */
+static void reverseRow8(const uchar *last, uchar *target, int width)
+{
+    int x = 0;
+#ifdef PAINTPP_SSE2
+    for(; x + 16 <= width; x += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last - x - 15));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    }
+#endif
+    for(; x < width; ++x)
+        target[x] = last[-x];
+}
+
+/**
+ * copyRows: Las filas de "band" cuando cada fila del resultado es una fila del original, al derecho o invertida.
+ */
+static void copyRows(const Mapping &map, int bpp, uchar *bits, int stride, const QRect &band)
+{
+    for(int y = band.top(); y <= band.bottom(); ++y)
+    {
+        const uchar *source = map.origin + y * map.stepY;
+        uchar *target = bits + qptrdiff(y) * stride;
+        if(map.stepX > 0)
+            memcpy(target, source, size_t(band.width()) * size_t(bpp));
+        else if(bpp == 4)
+            reverseRow32(source, target, band.width());
+        else
+            reverseRow8(source, target, band.width());
+    }
+}
+
+/**
+ * mapPixels: Cualquier rectangulo del resultado, de a un pixel. Es el camino de los giros en 8 bits y de los bordes
+ * de los mosaicos que no completan un bloque de 4x4.
+ */
+template<typename Pixel>
+static void mapPixels(const Mapping &map, uchar *bits, int stride, const QRect &rect)
+{
+    for(int y = rect.top(); y <= rect.bottom(); ++y)
+    {
+        const uchar *source = map.origin + y * map.stepY;
+        Pixel *row = reinterpret_cast<Pixel*>(bits + qptrdiff(y) * stride);
+        for(int x = rect.left(); x <= rect.right(); ++x)
+            row[x] = *reinterpret_cast<const Pixel*>(source + x * map.stepX);
+    }
+}
+
+/**
+ * transposeTile32: Un mosaico de un giro de 90 o 270 en 32 bits. Con SSE2 se leen cuatro filas del original de a
+ * cuatro pixeles (invertidas si el giro las recorre hacia la izquierda), se trasponen y quedan cuatro filas del
+ * resultado.
+ */
+static void transposeTile32(const Mapping &map, uchar *bits, int stride, const QRect &tile)
+{
+#ifdef PAINTPP_SSE2
+    const int blockWidth = tile.width() & ~3;
+    const int blockHeight = tile.height() & ~3;
+    const bool backward = map.stepY < 0;
+    for(int y = tile.top(); y < tile.top() + blockHeight; y += 4)
+    {
+        uchar *target = bits + qptrdiff(y) * stride;
+        for(int x = tile.left(); x < tile.left() + blockWidth; x += 4)
+        {
+            __m128i a[4];
+            for(int i = 0; i < 4; ++i)
+            {
+                const uchar *source = map.origin + (x + i) * map.stepX + y * map.stepY;
+                if(backward)
+                {
+                    a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source - 12));
+                    a[i] = _mm_shuffle_epi32(a[i], _MM_SHUFFLE(0, 1, 2, 3));
+                }
+                else
+                    a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+            }
+
+            const __m128i t0 = _mm_unpacklo_epi32(a[0], a[1]);
+            const __m128i t1 = _mm_unpacklo_epi32(a[2], a[3]);
+            const __m128i t2 = _mm_unpackhi_epi32(a[0], a[1]);
+            const __m128i t3 = _mm_unpackhi_epi32(a[2], a[3]);
+            uchar *block = target + qptrdiff(x) * 4;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(block), _mm_unpacklo_epi64(t0, t1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(block + stride), _mm_unpackhi_epi64(t0, t1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(block + 2 * stride), _mm_unpacklo_epi64(t2, t3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(block + 3 * stride), _mm_unpackhi_epi64(t2, t3));
+        }
+    }
+
+    // lo que no completa un bloque: la franja de la derecha y la de abajo
+    if(blockWidth < tile.width())
+        mapPixels<quint32>(map, bits, stride, QRect(tile.left() + blockWidth, tile.top(),
+                                                    tile.width() - blockWidth, blockHeight));
+    if(blockHeight < tile.height())
+        mapPixels<quint32>(map, bits, stride, QRect(tile.left(), tile.top() + blockHeight,
+                                                    tile.width(), tile.height() - blockHeight));
+#else
+    mapPixels<quint32>(map, bits, stride, tile);
+#endif
+}
+
+/**
+ * transformImage: Las bandas de TRANSFORM_TILE_SIZE filas del resultado se reparten entre los hilos; en los giros cada
+ * banda se recorre de a un mosaico.
+ */
+QImage transformImage(const QImage &image, ImageTransform transform)
+{
+    if(image.isNull())
+        return QImage();
+    if(image.depth() != 32 && image.depth() != 8)
+        return transformImage(image.convertToFormat(QImage::Format_ARGB32), transform);
+
+    const bool turn = transform == rotate_90 || transform == rotate_270;
+    QImage result(turn ? image.height() : image.width(), turn ? image.width() : image.height(), image.format());
+    if(result.isNull())
+        return QImage();
+    result.setColorTable(image.colorTable());
+
+    TRACE_SCOPE("transformImage");
+    const Mapping map = mappingOf(image, transform);
+    const int bpp = image.depth() / 8;
+    uchar *bits = result.bits();
+    const int stride = result.bytesPerLine();
+    QList<QRect> bands;
+    for(int y = 0; y < result.height(); y += TRANSFORM_TILE_SIZE)
+        bands.append(QRect(0, y, result.width(), qMin(TRANSFORM_TILE_SIZE, result.height() - y)));
+
+    QtConcurrent::blockingMap(bands, [&map, bpp, bits, stride, turn](const QRect &band) {
+        if(!turn)
+        {
+            copyRows(map, bpp, bits, stride, band);
+            return;
+        }
+        for(int x = 0; x < band.width(); x += TRANSFORM_TILE_SIZE)
+        {
+            const QRect tile(x, band.top(), qMin(TRANSFORM_TILE_SIZE, band.width() - x), band.height());
+            if(bpp == 4)
+                transposeTile32(map, bits, stride, tile);
+            else
+                mapPixels<uchar>(map, bits, stride, tile);
+        }
+    });
+    return result;
+}
+
+QRect transformRect(const QRect &rect, const QSize &size, ImageTransform transform)
+{
+    const int right = size.width() - 1 - rect.right();
+    const int bottom = size.height() - 1 - rect.bottom();
+    switch(transform)
+    {
+        case rotate_90:       return QRect(bottom, rect.left(), rect.height(), rect.width());
+        case rotate_180:      return QRect(right, bottom, rect.width(), rect.height());
+        case rotate_270:      return QRect(rect.top(), right, rect.height(), rect.width());
+        case flip_horizontal: return QRect(right, rect.top(), rect.width(), rect.height());
+        default:              return QRect(rect.left(), bottom, rect.width(), rect.height());
+    }
+}
+
+ImageTransform inverseTransform(ImageTransform transform)
+{
+    return transform == rotate_90 ? rotate_270 : (transform == rotate_270 ? rotate_90 : transform);
+}
@@ -0,0 +1,24 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <QImage>
+
+#include "constants.h"
+
+
+/**
+ * Giros de 90, 180 y 270 grados (en el sentido del reloj) y reflejos de imagenes de 32 u 8 bits, sin interpolar: cada
+ * pixel del resultado es un pixel del original. El reflejo vertical copia filas enteras; el horizontal y el giro de
+ * 180 invierten cada fila, de a 4 pixeles (o 16 bytes) por instruccion con SSE2. Los giros de 90 y 270 recorren el
+ * original por columnas, por eso se hacen por mosaicos de TRANSFORM_TILE_SIZE para que las filas de origen de un
+ * mosaico sigan en el cache, y con SSE2 se trasponen bloques de 4x4 pixeles. Las bandas de mosaicos se reparten entre
+ * los hilos del pool. La imagen de 8 bits conserva su paleta.
+ *
+ * transformRect da el lugar de un rectangulo del original (de tamaño "size") en el resultado, y inverseTransform la
+ * transformacion que deshace otra.
+ */
+QImage transformImage(const QImage &image, ImageTransform transform);
+QRect transformRect(const QRect &rect, const QSize &size, ImageTransform transform);
+ImageTransform inverseTransform(ImageTransform transform);
+
+#endif // TRANSFORM_H
@@ -0,0 +1,124 @@
+#include "undo_stack.h"
+
+
+UndoStack::UndoStack()
+{
+    index = 0;
+    limit = 0;
+    enabled = true;
+    mergeable = true;
+}
+
+UndoStack::~UndoStack()
+{
+    clear();
+}
+
+/**
+ * @brief UndoStack::push: Ejecuta el comando y lo apila. Los comandos que se podian rehacer se descartan, si el
+ *                         comando de arriba lo absorbe (mergeWith) se elimina y, si se pasa del limite, se elimina el
+ *                         mas antiguo.
+ */
+void UndoStack::push(UndoCommand *command)
+{
+    command->redo();
+
+    if(!enabled)
+    {
+        delete command;
+        return;
+    }
+
+    while(commands.size() > index)
+        delete commands.takeLast();
+
+    UndoCommand *top = index > 0 ? commands.at(index - 1) : 0;
+    bool merge = mergeable && top && command->id() != -1 && top->id() == command->id();
+    mergeable = true;
+    if(merge && top->mergeWith(command))
+    {
+        delete command;
+        return;
+    }
+
+    commands.append(command);
+    index++;
+
+    if(limit > 0 && commands.size() > limit)
+    {
+        delete commands.takeFirst();
+        index--;
+    }
+}
+
+void UndoStack::undo()
+{
+    if(!canUndo())
+        return;
+
+    index--;
+    commands.at(index)->undo();
+    mergeable = false;
+}
+
+void UndoStack::redo()
+{
+    if(!canRedo())
+        return;
+
+    commands.at(index)->redo();
+    index++;
+    mergeable = false;
+}
+
+void UndoStack::clear()
+{
+    qDeleteAll(commands);
+    commands.clear();
+    index = 0;
+    mergeable = true;
+}
+
+/**
+ * @brief UndoStack::setUndoLimit: Igual que en QUndoStack, solo se puede cambiar con la pila vacia.
+ */
+void UndoStack::setUndoLimit(int limit)
+{
+    if(commands.isEmpty())
+        this->limit = limit;
+}
+
+/**
+ * @brief UndoStack::byteCount: Memoria que retienen todos los comandos, deshechos o no.
+ */
+qint64 UndoStack::byteCount(QSet<qint64> *seen) const
+{
+    qint64 bytes = 0;
+    for(const UndoCommand *command : commands)
+        bytes += command->byteCount(seen);
+    return bytes;
+}
+
+/**
+ * @brief UndoStack::compactOldest: Compacta el comando mas antiguo que todavia se pueda compactar.
+ */
+bool UndoStack::compactOldest()
+{
+    for(UndoCommand *command : commands)
+        if(command->compact())
+            return true;
+    return false;
+}
+
+/**
+ * @brief UndoStack::dropOldest: Descarta el comando mas antiguo que se podia deshacer, como cuando se pasa del limite.
+ */
+bool UndoStack::dropOldest()
+{
+    if(index == 0)
+        return false;
+
+    delete commands.takeFirst();
+    index--;
+    return true;
+}
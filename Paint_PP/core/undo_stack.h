@@ -0,0 +1,72 @@
+#ifndef UNDO_STACK_H
+#define UNDO_STACK_H
+
+#include <QList>
+#include <QSet>
+
+
+/**
+ * UndoCommand: Un cambio que se puede deshacer y rehacer. Reemplaza a QUndoCommand, que en Qt5 pertenece a QtWidgets,
+ * para que el nucleo solo dependa de QtGui.
+ */
+class UndoCommand
+{
+public:
+    UndoCommand() {}
+    virtual ~UndoCommand() {}
+
+    virtual void undo() = 0;
+    virtual void redo() = 0;
+    /** Memoria de las imagenes que guarda el comando, sin contar las que ya estan en "seen". */
+    virtual qint64 byteCount(QSet<qint64>*) const { return 0; }
+    /** Reduce la memoria del comando (por ejemplo comprimiendo). Devuelve false si ya no se puede reducir. */
+    virtual bool compact() { return false; }
+    /** Como en QUndoCommand: comandos con el mismo id (distinto de -1) pueden absorber al comando siguiente. */
+    virtual int id() const { return -1; }
+    virtual bool mergeWith(const UndoCommand*) { return false; }
+
+private:
+    UndoCommand(const UndoCommand&);
+    UndoCommand& operator=(const UndoCommand&);
+};
+
+
+/**
+ * UndoStack: Pila de comandos con la misma semantica que QUndoStack: push() ejecuta redo() del comando, apilar
+ * despues de deshacer descarta los comandos que se podian rehacer, y un limite de 0 significa sin limite.
+ * Deshabilitada (procesamiento por lotes) los comandos se ejecutan y se eliminan sin guardarse. Un comando nuevo se
+ * une al anterior si los dos tienen el mismo id() y mergeWith() lo acepta.
+ */
+class UndoStack
+{
+public:
+    UndoStack();
+    ~UndoStack();
+
+    void push(UndoCommand *command);
+    void undo();
+    void redo();
+    void clear();
+
+    bool canUndo() const { return index > 0; }
+    bool canRedo() const { return index < commands.size(); }
+    int count() const { return commands.size(); }
+    void setUndoLimit(int limit);
+    qint64 byteCount(QSet<qint64> *seen) const;
+    bool compactOldest();
+    void breakMerge() { mergeable = false; }
+    bool dropOldest();
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+
+private:
+    QList<UndoCommand*> commands;
+    int index;
+    int limit;
+    bool enabled;
+    bool mergeable;
+
+    UndoStack(const UndoStack&);
+    UndoStack& operator=(const UndoStack&);
+};
+
+#endif // UNDO_STACK_H
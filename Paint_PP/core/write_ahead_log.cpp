@@ -0,0 +1,316 @@
+#include <QtConcurrent>
+#include <QTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QCoreApplication>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "write_ahead_log.h"
+#include "canvas.h"
+#include "trace.h"
+
+
+static const char *LOG_SUFFIX = ".ppwal";
+
+/**
+ * checkpointData: Un registro de operaciones completo que solo tiene el "snapshot" del estado, las operaciones
+ * siguientes se agregan detras. Se puede llamar desde otro hilo.
+ */
+static QByteArray checkpointData(const Canvas::State &state)
+{
+    TRACE_SCOPE("WriteAheadLog::checkpointData");
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << OP_LOG_MAGIC << OP_LOG_VERSION << quint8(op_snapshot) << quint32(0);
+    Canvas::writeState(out, state);
+    return data;
+}
+
+static QString recoveryDir()
+{
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/recovery";
+    QDir().mkpath(dir);
+    return dir;
+}
+
+WriteAheadLog::WriteAheadLog(Canvas *canvas, QObject *parent)
+    : QObject(parent)
+{
+    this->canvas = canvas;
+    operations = 0;
+    checkpointing = false;
+
+    timer = new QTimer(this);
+    timer->setInterval(WAL_FLUSH_MS);
+    connect(timer, SIGNAL(timeout()), this, SLOT(flush()));
+
+    watcher = new QFutureWatcher<QByteArray>(this);
+    connect(watcher, SIGNAL(finished()), this, SLOT(OnCheckpointWritten()));
+}
+
+/**
+ * @brief WriteAheadLog::~WriteAheadLog: No borra el archivo, el dueño llama a close() cuando el documento se cierra
+ *                                       normalmente.
+ */
+WriteAheadLog::~WriteAheadLog()
+{
+    watcher->waitForFinished();
+}
+
+/**
+ * @brief WriteAheadLog::open: Cierra el registro anterior y empieza uno nuevo para "document" (vacio si no tiene
+ *                             nombre) con el estado actual como primer punto de control. Si no se puede escribir
+ *                             junto al documento se usa la carpeta de datos de la aplicacion.
+ */
+bool WriteAheadLog::open(const QString &document)
+{
+    close();
+
+    QStringList candidates;
+    if(!document.isEmpty())
+        candidates << logFor(document);
+    candidates << logFor(QString());
+
+    for(const QString &path : candidates)
+    {
+        lock.reset(new QLockFile(path + ".lock"));
+        // solo se considera abandonado si el proceso que lo tomo ya no existe
+        lock->setStaleLockTime(0);
+        if(!lock->tryLock(0))
+            continue;
+
+        file.setFileName(path);
+        QByteArray data = checkpointData(canvas->saveState());
+        if(file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(data) == data.size() && sync())
+            break;
+
+        file.close();
+        lock.reset();
+    }
+
+    if(!file.isOpen())
+        return false;
+
+    registerLog(file.fileName(), true);
+    canvas->getOpLog()->setJournaling(true);
+    operations = 0;
+    sinceCheckpoint.start();
+    timer->start();
+    return true;
+}
+
+/**
+ * @brief WriteAheadLog::close: Cierre normal, el documento ya no necesita recuperarse y el archivo se borra.
+ */
+void WriteAheadLog::close()
+{
+    if(!file.isOpen())
+        return;
+
+    timer->stop();
+    watcher->waitForFinished();
+    checkpointing = false;
+    canvas->getOpLog()->setJournaling(false);
+
+    QString path = file.fileName();
+    file.close();
+    QFile::remove(path);
+    registerLog(path, false);
+    lock.reset();
+    tail.clear();
+}
+
+/**
+ * @brief WriteAheadLog::flush: Agrega al archivo las operaciones nuevas y las sincroniza al disco, una sola vez por
+ *                              lote. Si ya toca, empieza un punto de control.
+ */
+void WriteAheadLog::flush()
+{
+    if(!file.isOpen())
+        return;
+
+    int count = 0;
+    QByteArray records = canvas->getOpLog()->takeJournal(&count);
+    if(!records.isEmpty())
+    {
+        TRACE_SCOPE("WriteAheadLog::flush");
+        file.write(records);
+        sync();
+        operations += count;
+        // mientras se escribe el punto de control lo nuevo tambien va al archivo que lo va a reemplazar
+        if(checkpointing)
+            tail += records;
+    }
+
+    if(operations >= WAL_CHECKPOINT_OPS || (operations > 0 && sinceCheckpoint.elapsed() >= WAL_CHECKPOINT_MS))
+        checkpoint();
+}
+
+/**
+ * @brief WriteAheadLog::checkpoint: Copia el estado del documento y lo codifica en otro hilo. Solo se hace entre
+ *                                   trazos y sin seleccion, el "snapshot" no guarda un trazo a medias ni la seleccion.
+ */
+void WriteAheadLog::checkpoint()
+{
+    if(!file.isOpen() || checkpointing || !canvas->isIdle())
+        return;
+
+    checkpointing = true;
+    flush();
+    tail.clear();
+
+    Canvas::State state = canvas->saveState();
+    watcher->setFuture(QtConcurrent::run([state]() { return checkpointData(state); }));
+    operations = 0;
+    sinceCheckpoint.start();
+}
+
+/**
+ * @brief WriteAheadLog::OnCheckpointWritten: El punto de control y las operaciones que llegaron mientras tanto
+ *                                            reemplazan al archivo en un solo paso (QSaveFile sincroniza y renombra),
+ *                                            si algo falla el archivo anterior sigue completo.
+ */
+void WriteAheadLog::OnCheckpointWritten()
+{
+    // un punto de control de un registro que ya se cerro no se usa
+    if(!checkpointing || !file.isOpen())
+        return;
+    checkpointing = false;
+
+    QByteArray data = watcher->result();
+    int count = 0;
+    QByteArray records = canvas->getOpLog()->takeJournal(&count);
+    operations += count;
+    tail += records;
+
+    TRACE_SCOPE("WriteAheadLog::replaceLog");
+    QSaveFile replacement(file.fileName());
+    bool written = replacement.open(QIODevice::WriteOnly) && replacement.write(data) == data.size()
+                   && replacement.write(tail) == tail.size();
+    tail.clear();
+
+    // en Windows no se puede reemplazar un archivo abierto
+    file.close();
+    bool replaced = written && replacement.commit();
+    file.open(QIODevice::WriteOnly | QIODevice::Append);
+
+    // si no se pudo reemplazar, lo ultimo va al archivo anterior que sigue completo
+    if(!replaced && !records.isEmpty())
+    {
+        file.write(records);
+        sync();
+    }
+}
+
+/**
+ * @brief WriteAheadLog::sync: Lleva lo escrito hasta el disco, no solo al cache del sistema operativo.
+ */
+bool WriteAheadLog::sync()
+{
+    if(!file.flush())
+        return false;
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+/**
+ * @brief WriteAheadLog::logFor: Archivo de recuperacion de un documento. Los documentos sin nombre usan uno distinto
+ *                               por proceso y por llamada.
+ */
+QString WriteAheadLog::logFor(const QString &document)
+{
+    if(!document.isEmpty())
+        return document + LOG_SUFFIX;
+
+    static int untitled = 0;
+    return QString("%1/untitled-%2-%3%4").arg(recoveryDir()).arg(QCoreApplication::applicationPid())
+                                         .arg(++untitled).arg(LOG_SUFFIX);
+}
+
+/**
+ * @brief WriteAheadLog::documentFor: Documento al que pertenece un archivo de recuperacion, vacio si no tenia nombre.
+ */
+QString WriteAheadLog::documentFor(const QString &log)
+{
+    if(QFileInfo(log).absolutePath() == QFileInfo(recoveryDir()).absoluteFilePath() || !log.endsWith(LOG_SUFFIX))
+        return QString();
+    return log.left(log.size() - int(strlen(LOG_SUFFIX)));
+}
+
+/**
+ * @brief WriteAheadLog::pending: Archivos de recuperacion que quedaron de una sesion que no cerro bien. Los que tiene
+ *                                abiertos otra instancia que sigue corriendo no aparecen.
+ */
+QStringList WriteAheadLog::pending()
+{
+    QSettings settings;
+    QStringList found;
+    for(const QString &log : settings.value("recovery/logs").toStringList())
+    {
+        if(!QFile::exists(log))
+        {
+            registerLog(log, false);
+            continue;
+        }
+
+        QLockFile lock(log + ".lock");
+        lock.setStaleLockTime(0);
+        if(lock.tryLock(0))
+            found << log;
+    }
+    return found;
+}
+
+/**
+ * @brief WriteAheadLog::recover: Carga el ultimo punto de control de "log" y reproduce las operaciones que le siguen,
+ *                                sin esperas. Un registro cortado a la mitad por la caida se descarta.
+ */
+bool WriteAheadLog::recover(Canvas *canvas, const QString &log)
+{
+    TRACE_SCOPE("WriteAheadLog::recover");
+    QByteArray data;
+    const int headerSize = 6;
+    if(!OpLog::load(log, &data) || data.size() <= headerSize || quint8(data.at(headerSize)) != op_snapshot)
+        return false;
+
+    OpPlayer player(canvas, data);
+    if(!player.isValid())
+        return false;
+
+    player.runAll();
+    return player.played() > 0;
+}
+
+void WriteAheadLog::discard(const QString &log)
+{
+    QFile::remove(log);
+    QFile::remove(log + ".lock");
+    registerLog(log, false);
+}
+
+/**
+ * @brief WriteAheadLog::registerLog: Lista de archivos de recuperacion abiertos, en la configuracion de la aplicacion,
+ *                                    para encontrarlos al iniciar aunque esten junto a documentos en cualquier carpeta.
+ */
+void WriteAheadLog::registerLog(const QString &log, bool active)
+{
+    QSettings settings;
+    QStringList logs = settings.value("recovery/logs").toStringList();
+    logs.removeAll(log);
+    if(active)
+        logs << log;
+    settings.setValue("recovery/logs", logs);
+}
@@ -0,0 +1,74 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <QObject>
+#include <QFile>
+#include <QLockFile>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QScopedPointer>
+#include <QStringList>
+
+#include "constants.h"
+
+
+class Canvas;
+class QTimer;
+
+/**
+ * WriteAheadLog: Registro de recuperacion de un documento. Es un registro de operaciones (OpLog) que se escribe al
+ * disco mientras se dibuja: las operaciones se agregan al archivo y se sincronizan (fsync) en lotes cada
+ * WAL_FLUSH_MS. Cada WAL_CHECKPOINT_OPS operaciones, o WAL_CHECKPOINT_MS, el archivo se reemplaza por un punto de
+ * control (el "snapshot" del documento) seguido de las operaciones nuevas, asi recuperar nunca reproduce mas que
+ * eso. El "snapshot" se codifica en otro hilo y el archivo viejo sigue recibiendo operaciones hasta que el nuevo
+ * esta completo en el disco.
+ *
+ * El archivo queda junto al documento ("imagen.bmp.ppwal"), o en la carpeta de datos de la aplicacion si el
+ * documento no tiene nombre. Se borra al cerrar normalmente; si el programa termina antes, pending() lo encuentra
+ * al iniciar y recover() lo reproduce sobre un lienzo.
+ */
+class WriteAheadLog : public QObject
+{
+    Q_OBJECT
+
+public:
+    WriteAheadLog(Canvas *canvas, QObject *parent = 0);
+    ~WriteAheadLog();
+
+    bool open(const QString &document = QString());
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    QString fileName() const { return file.fileName(); }
+
+    static QString logFor(const QString &document);
+    static QString documentFor(const QString &log);
+    static QStringList pending();
+    static bool recover(Canvas *canvas, const QString &log);
+    static void discard(const QString &log);
+
+public slots:
+    void flush();
+    void checkpoint();
+
+private slots:
+    void OnCheckpointWritten();
+
+private:
+    bool sync();
+    static void registerLog(const QString &log, bool active);
+
+    Canvas* canvas;
+    QFile file;
+    QScopedPointer<QLockFile> lock;
+    QTimer* timer;
+    QFutureWatcher<QByteArray>* watcher;
+    QElapsedTimer sinceCheckpoint;
+    QByteArray tail;
+    int operations;
+    bool checkpointing;
+
+    WriteAheadLog(const WriteAheadLog&);
+    WriteAheadLog& operator=(const WriteAheadLog&);
+};
+
+#endif // WRITE_AHEAD_LOG_H
@@ -8,20 +8,79 @@
 #include "dialog_windows.h"
 #include "main_window.h"
 #include "draw_area.h"
+#include "proxy_preview.h"
 
 
+/**
+ * createPreview: Vista previa, hija de "dialog", sobre la parte visible del lienzo de "drawArea". Las capas de 8 bits
+ *                se expanden una vez, los efectos calculan en 32 bits.
+ */
+static ProxyPreview* createPreview(QDialog* dialog, DrawArea* drawArea)
+{
+    const QImage &image = *drawArea->getImage();
+    ProxyPreview* preview = new ProxyPreview(image.depth() == 32 ? image
+                                             : image.convertToFormat(QImage::Format_ARGB32_Premultiplied), dialog);
+    preview->setRegion(drawArea->visibleRegion().boundingRect());
+    drawArea->setPreview(preview);
+    return preview;
+}
+
+/**
+ * previewArea: Area que modifican los filtros y ajustes (Canvas::filterArea), sin confirmar la seleccion flotante
+ *              por si el usuario cancela.
+ */
+static QRect previewArea(DrawArea* drawArea)
+{
+    QImage* image = drawArea->getImage();
+    SelectionTool* selection = drawArea->getCanvas()->getSelectionTool();
+    return (selection->hasSelection() ? selection->getRect() : image->rect()).intersected(image->rect());
+}
+
 /**
  * @brief CanvasSizeDialog::CanvasSizeDialog: Este metodo es el constructor del objeto QDialog que muestra las opciones para
- *                                            redefinir el tamaño del lienzo del editor de imagenes.
+ *                                            redefinir el tamaño del lienzo del editor de imagenes. Si recibe
+ *                                            "drawArea" muestra el cambio de tamaño en vista previa; si no,
+ *                                            es un lienzo nuevo y tambien se elige el formato de sus pixeles.
  */
-CanvasSizeDialog::CanvasSizeDialog(QWidget* parent, const char* name, int width, int height)
+CanvasSizeDialog::CanvasSizeDialog(QWidget* parent, const char* name, int width, int height, DrawArea* drawArea)
     :QDialog(parent)
 {
+    this->drawArea = drawArea;
+    preview = 0;
+    formatBox = 0;
+
     QVBoxLayout *layout = new QVBoxLayout(this);
     layout->addWidget(createSpinBoxes(width,height));
     setLayout(layout);
 
     setWindowTitle(tr(name));
+
+    if(drawArea)
+    {
+        preview = createPreview(this, drawArea);
+        connect(widthSpinBox, SIGNAL(valueChanged(int)), this, SLOT(OnSizeChanged()));
+        connect(heightSpinBox, SIGNAL(valueChanged(int)), this, SLOT(OnSizeChanged()));
+    }
+}
+
+CanvasSizeDialog::~CanvasSizeDialog()
+{
+    if(drawArea)
+        drawArea->setPreview(0);
+}
+
+/**
+ * @brief CanvasSizeDialog::OnSizeChanged: Muestra el lienzo con el tamaño nuevo, mientras sea el mismo no hay nada
+ *                                         que mostrar.
+ */
+void CanvasSizeDialog::OnSizeChanged()
+{
+    QSize from = drawArea->getImage()->size();
+    QSize to(getWidthValue(), getHeightValue());
+    if(from == to)
+        preview->cancel();
+    else
+        preview->request(QSharedPointer<const PreviewEffect>(new ResizePreview(from, to)));
 }
 
 /**
@@ -57,6 +116,15 @@ QGroupBox* CanvasSizeDialog::createSpinBoxes(int width, int height)
     QFormLayout *spinBoxLayout = new QFormLayout(spinBoxesGroup);
     spinBoxLayout->addRow(tr("Width: "), widthSpinBox);
     spinBoxLayout->addRow(tr("Height: "), heightSpinBox);
+    if(!drawArea)
+    {
+        // En el orden de PixelFormat.
+        formatBox = new QComboBox(this);
+        formatBox->addItem(tr("RGB"));
+        formatBox->addItem(tr("Indexed 8-bit"));
+        formatBox->addItem(tr("Grayscale 8-bit"));
+        spinBoxLayout->addRow(tr("Pixels: "), formatBox);
+    }
     spinBoxLayout->addRow(okButton);
     spinBoxLayout->addRow(cancelButton);
     spinBoxesGroup->setLayout(spinBoxLayout);
@@ -82,7 +150,7 @@ PencilDialog::PencilDialog(QWidget* parent, DrawArea* drawArea, int size)
     pencilSizeSlider->setSliderPosition(size);
     pencilSizeSlider->setTracking(false);
     connect(pencilSizeSlider, SIGNAL(valueChanged(int)),
-            drawArea, SLOT(OnPencilSizeConfig(int)));
+            drawArea->getCanvas(), SLOT(OnPencilSizeConfig(int)));
 
     QVBoxLayout *vbox = new QVBoxLayout(this);
     vbox->addWidget(penSizeLabel);
@@ -122,7 +190,7 @@ PenDialog::PenDialog(QWidget* parent, DrawArea* drawArea,
     lineThicknessSlider->setMaximum(MAX_PEN_SIZE);
     lineThicknessSlider->setSliderPosition(thickness);
     lineThicknessSlider->setTracking(false);
-    connect(lineThicknessSlider, SIGNAL(valueChanged(int)), drawArea, SLOT(OnPenLineThicknessConfig(int)));
+    connect(lineThicknessSlider, SIGNAL(valueChanged(int)), drawArea->getCanvas(), SLOT(OnPenLineThicknessConfig(int)));
 
     QGridLayout *grid = new QGridLayout(this);
     grid->addWidget(left, 0,0);
@@ -156,7 +224,7 @@ QGroupBox* PenDialog::createLineStyle(LineStyle lineStyle)
     penStyleG->addButton(dashDottedButton, 3);
     penStyleG->addButton(dashDotDottedButton, 4);
 
-    connect(penStyleG, SIGNAL(buttonClicked(int)), drawArea, SLOT(OnPenLineStyleConfig(int)));
+    connect(penStyleG, SIGNAL(buttonClicked(int)), drawArea->getCanvas(), SLOT(OnPenLineStyleConfig(int)));
 
     switch(lineStyle)
     {
@@ -196,7 +264,7 @@ QGroupBox* PenDialog::createDrawType(DrawType drawType)
     drawTypeG->addButton(singleButton, 0);
     drawTypeG->addButton(polyButton, 1);
 
-    connect(drawTypeG, SIGNAL(buttonClicked(int)), drawArea, SLOT(OnPenDrawTypeConfig(int)));
+    connect(drawTypeG, SIGNAL(buttonClicked(int)), drawArea->getCanvas(), SLOT(OnPenDrawTypeConfig(int)));
 
     switch(drawType)
     {
@@ -230,7 +298,7 @@ EraserDialog::EraserDialog(QWidget* parent, DrawArea* drawArea, int thickness)
     eraserThicknessSlider->setMaximum(MAX_PEN_SIZE);
     eraserThicknessSlider->setSliderPosition(thickness);
     eraserThicknessSlider->setTracking(false);
-    connect(eraserThicknessSlider, SIGNAL(valueChanged(int)), drawArea, SLOT(OnEraserConfig(int)));
+    connect(eraserThicknessSlider, SIGNAL(valueChanged(int)), drawArea->getCanvas(), SLOT(OnEraserConfig(int)));
 
     QVBoxLayout *vbox = new QVBoxLayout(this);
     vbox->addWidget(eraserThicknessLabel);
@@ -271,7 +339,7 @@ ShapesDialog::ShapesDialog(QWidget* parent, DrawArea* drawArea,
     lineThicknessSlider->setSliderPosition(thickness);
     lineThicknessSlider->setTracking(false);
 
-    connect(lineThicknessSlider, SIGNAL(valueChanged(int)), drawArea, SLOT(OnShapesLineConfig(int)));
+    connect(lineThicknessSlider, SIGNAL(valueChanged(int)), drawArea->getCanvas(), SLOT(OnShapesLineConfig(int)));
 
     QGridLayout *grid = new QGridLayout(this);
     grid->addWidget(left, 0,0);
@@ -305,7 +373,7 @@ QGroupBox* ShapesDialog::createBoundaryStyle(LineStyle boundaryStyle)
     boundaryStyleG->addButton(dashDottedButton, 3);
     boundaryStyleG->addButton(dashDotDottedButton, 4);
 
-    connect(boundaryStyleG, SIGNAL(buttonClicked(int)), drawArea, SLOT(OnShapesBStyleConfig(int)));
+    connect(boundaryStyleG, SIGNAL(buttonClicked(int)), drawArea->getCanvas(), SLOT(OnShapesBStyleConfig(int)));
 
     switch(boundaryStyle)
     {
@@ -346,7 +414,7 @@ QGroupBox* ShapesDialog::createFillColor(FillColor fillColor)
     fillColorG->addButton(backgroundButton, 1);
     fillColorG->addButton(noFillButton, 2);
 
-    connect(fillColorG, SIGNAL(buttonClicked(int)), drawArea, SLOT(OnShapesFillConfig(int)));
+    connect(fillColorG, SIGNAL(buttonClicked(int)), drawArea->getCanvas(), SLOT(OnShapesFillConfig(int)));
 
     switch(fillColor)
     {
@@ -366,3 +434,161 @@ QGroupBox* ShapesDialog::createFillColor(FillColor fillColor)
 }
 
 
+
+/**
+ * @brief FilterDialog::FilterDialog: Este metodo es el constructor del QDialog que muestra las opciones de los filtros,
+ *                                    el radio del desenfoque y, para la mascara de enfoque, la intensidad. El filtro
+ *                                    se ve en vista previa mientras se mueven los "sliders".
+ */
+FilterDialog::FilterDialog(QWidget* parent, DrawArea* drawArea, FilterType type)
+    :QDialog(parent)
+{
+    this->drawArea = drawArea;
+    this->type = type;
+    setWindowTitle(type == unsharp_mask ? tr("Sharpen") : tr("Gaussian Blur"));
+
+    QLabel *radiusLabel = new QLabel(tr("Radius"), this);
+    radiusSlider = new QSlider(Qt::Horizontal, this);
+    radiusSlider->setMinimum(MIN_FILTER_RADIUS);
+    radiusSlider->setMaximum(MAX_FILTER_RADIUS);
+    radiusSlider->setSliderPosition(DEFAULT_FILTER_RADIUS);
+
+    QLabel *amountLabel = new QLabel(tr("Amount"), this);
+    amountSlider = new QSlider(Qt::Horizontal, this);
+    amountSlider->setMinimum(MIN_SHARPEN_AMOUNT);
+    amountSlider->setMaximum(MAX_SHARPEN_AMOUNT);
+    amountSlider->setSliderPosition(DEFAULT_SHARPEN_AMOUNT);
+
+    // Se agregan los botones.
+    QPushButton *okButton = new QPushButton(tr("OK"), this);
+    QPushButton *cancelButton = new QPushButton(tr("Cancel"), this);
+    connect(okButton, SIGNAL(clicked()), this, SLOT(accept()));
+    connect(cancelButton, SIGNAL(clicked()), this, SLOT(reject()));
+
+    QVBoxLayout *vbox = new QVBoxLayout(this);
+    vbox->addWidget(radiusLabel);
+    vbox->addWidget(radiusSlider);
+    if(type == unsharp_mask)
+    {
+        vbox->addWidget(amountLabel);
+        vbox->addWidget(amountSlider);
+    }
+    else
+    {
+        amountLabel->hide();
+        amountSlider->hide();
+    }
+    vbox->addWidget(okButton);
+    vbox->addWidget(cancelButton);
+    setLayout(vbox);
+
+    preview = createPreview(this, drawArea);
+    connect(radiusSlider, SIGNAL(valueChanged(int)), this, SLOT(OnParamsChanged()));
+    connect(amountSlider, SIGNAL(valueChanged(int)), this, SLOT(OnParamsChanged()));
+    OnParamsChanged();
+}
+
+FilterDialog::~FilterDialog()
+{
+    drawArea->setPreview(0);
+}
+
+void FilterDialog::OnParamsChanged()
+{
+    preview->request(QSharedPointer<const PreviewEffect>(new FilterPreview(getParams(), previewArea(drawArea))));
+}
+
+/**
+ * @brief FilterDialog::getParams: Devuelve los parametros escogidos por el usuario.
+ */
+FilterParams FilterDialog::getParams() const
+{
+    FilterParams params;
+    params.type = type;
+    params.radius = radiusSlider->value();
+    params.amount = amountSlider->value();
+    return params;
+}
+
+/**
+ * @brief AdjustmentsDialog::AdjustmentsDialog: Este metodo es el constructor del QDialog que muestra los ajustes de
+ *                                              color: brillo, contraste, niveles y tono/saturacion, en vista previa
+ *                                              sobre el lienzo.
+ */
+AdjustmentsDialog::AdjustmentsDialog(QWidget* parent, DrawArea* drawArea)
+    :QDialog(parent)
+{
+    setWindowTitle(tr("Color Adjustments"));
+
+    this->drawArea = drawArea;
+    preview = createPreview(this, drawArea);
+
+    brightnessSlider = createSlider(MIN_BRIGHTNESS, MAX_BRIGHTNESS, 0);
+    contrastSlider = createSlider(MIN_CONTRAST, MAX_CONTRAST, 0);
+    blackSlider = createSlider(0, 254, 0);
+    whiteSlider = createSlider(1, 255, 255);
+    gammaSlider = createSlider(MIN_LEVELS_GAMMA, MAX_LEVELS_GAMMA, DEFAULT_LEVELS_GAMMA);
+    hueSlider = createSlider(MIN_HUE_SHIFT, MAX_HUE_SHIFT, 0);
+    saturationSlider = createSlider(MIN_SATURATION, MAX_SATURATION, 0);
+    lightnessSlider = createSlider(MIN_SATURATION, MAX_SATURATION, 0);
+
+    // Se agregan los botones.
+    QPushButton *okButton = new QPushButton(tr("OK"), this);
+    QPushButton *cancelButton = new QPushButton(tr("Cancel"), this);
+    connect(okButton, SIGNAL(clicked()), this, SLOT(accept()));
+    connect(cancelButton, SIGNAL(clicked()), this, SLOT(reject()));
+
+    QFormLayout *form = new QFormLayout(this);
+    form->addRow(tr("Brightness: "), brightnessSlider);
+    form->addRow(tr("Contrast: "), contrastSlider);
+    form->addRow(tr("Levels black: "), blackSlider);
+    form->addRow(tr("Levels white: "), whiteSlider);
+    form->addRow(tr("Levels gamma: "), gammaSlider);
+    form->addRow(tr("Hue: "), hueSlider);
+    form->addRow(tr("Saturation: "), saturationSlider);
+    form->addRow(tr("Lightness: "), lightnessSlider);
+    form->addRow(okButton);
+    form->addRow(cancelButton);
+    setLayout(form);
+}
+
+AdjustmentsDialog::~AdjustmentsDialog()
+{
+    drawArea->setPreview(0);
+}
+
+QSlider* AdjustmentsDialog::createSlider(int min, int max, int value)
+{
+    QSlider* slider = new QSlider(Qt::Horizontal, this);
+    slider->setMinimum(min);
+    slider->setMaximum(max);
+    slider->setSliderPosition(value);
+    connect(slider, SIGNAL(valueChanged(int)), this, SLOT(OnParamsChanged()));
+    return slider;
+}
+
+/**
+ * @brief AdjustmentsDialog::OnParamsChanged: Con todos los "sliders" en cero no hay nada que mostrar.
+ */
+void AdjustmentsDialog::OnParamsChanged()
+{
+    ColorPipeline pipeline = getPipeline();
+    if(pipeline.isIdentity())
+        preview->cancel();
+    else
+        preview->request(QSharedPointer<const PreviewEffect>(new AdjustmentsPreview(pipeline, previewArea(drawArea))));
+}
+
+/**
+ * @brief AdjustmentsDialog::getPipeline: Construye la secuencia de ajustes. Niveles, brillo y contraste terminan en
+ *                                        una sola tabla por canal, el tono/saturacion se aplica en la misma pasada.
+ */
+ColorPipeline AdjustmentsDialog::getPipeline() const
+{
+    ColorPipeline pipeline;
+    pipeline.addLevels(blackSlider->value(), whiteSlider->value(), gammaSlider->value());
+    pipeline.addBrightness(brightnessSlider->value());
+    pipeline.addContrast(contrastSlider->value());
+    pipeline.addHueSaturation(hueSlider->value(), saturationSlider->value(), lightnessSlider->value());
+    return pipeline;
+}
@@ -6,12 +6,16 @@
 #include <QDialog>
 #include <QSlider>
 #include <QButtonGroup>
+#include <QComboBox>
 
 #include "constants.h"
 #include "tool.h"
+#include "filters.h"
+#include "adjustments.h"
 
 
 class DrawArea;
+class ProxyPreview;
 
 class CanvasSizeDialog : public QDialog
 {
@@ -20,16 +24,25 @@ class CanvasSizeDialog : public QDialog
 public:
     CanvasSizeDialog(QWidget* parent, const char* name = 0,
                      int width = DEFAULT_IMG_WIDTH,
-                     int height = DEFAULT_IMG_HEIGHT);
+                     int height = DEFAULT_IMG_HEIGHT,
+                     DrawArea* drawArea = 0);
+    ~CanvasSizeDialog();
 
     int getWidthValue() const { return widthSpinBox->value(); }
     int getHeightValue() const { return heightSpinBox->value(); }
+    PixelFormat getPixelFormat() const { return formatBox ? PixelFormat(formatBox->currentIndex()) : rgb_pixels; }
+
+private slots:
+    void OnSizeChanged();
 
 private:
     QGroupBox* createSpinBoxes(int,int);
 
+    DrawArea* drawArea;
+    ProxyPreview* preview;
     QSpinBox *widthSpinBox;
     QSpinBox *heightSpinBox;
+    QComboBox *formatBox;
     QGroupBox *spinBoxesGroup;
 };
 
@@ -100,4 +113,54 @@ private:
     QSlider* lineThicknessSlider;
 };
 
+class FilterDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    FilterDialog(QWidget* parent, DrawArea* drawArea, FilterType type);
+    ~FilterDialog();
+
+    FilterParams getParams() const;
+
+private slots:
+    void OnParamsChanged();
+
+private:
+    DrawArea* drawArea;
+    ProxyPreview* preview;
+    FilterType type;
+    QSlider* radiusSlider;
+    QSlider* amountSlider;
+};
+
+class AdjustmentsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    AdjustmentsDialog(QWidget* parent, DrawArea* drawArea);
+    ~AdjustmentsDialog();
+
+    ColorPipeline getPipeline() const;
+
+private slots:
+    void OnParamsChanged();
+
+private:
+    QSlider* createSlider(int, int, int);
+
+    DrawArea* drawArea;
+    ProxyPreview* preview;
+
+    QSlider* brightnessSlider;
+    QSlider* contrastSlider;
+    QSlider* blackSlider;
+    QSlider* whiteSlider;
+    QSlider* gammaSlider;
+    QSlider* hueSlider;
+    QSlider* saturationSlider;
+    QSlider* lightnessSlider;
+};
+
 #endif // DIALOGS_H
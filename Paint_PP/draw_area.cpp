@@ -1,39 +1,39 @@
+#include <QApplication>
+#include <QClipboard>
 #include <QPainter>
 #include <QPaintEvent>
 
-#include "commands.h"
 #include "draw_area.h"
 #include "main_window.h"
+#include "perf_hud.h"
+#include "proxy_preview.h"
+#include "perf_stats.h"
+#include "trace.h"
 
 
 /**
- * @brief DrawArea::DrawArea - Es el constructor del objeto drawArea que vendria a ser una super clase
- * que contiene el lienzo donde se va dibujar, ademas de distintos atributos de este, como de las funciones, ademas
- * de variables de estado de ciertos eventos que se pueden desarrollar en el programa que tienen que ver directamente
- * con todo lo de la edicion de las imagenes en sí.
+ * @brief DrawArea::DrawArea - Es el constructor del objeto drawArea, el widget que muestra el lienzo. El documento
+ * (capas, herramientas, pila de "undo" y "redo") es el objeto "canvas", cada vez que cambia un area del lienzo
+ * se repinta solo esa area.
  */
 DrawArea::DrawArea(QWidget *parent)
     : QWidget(parent)
 {
-    // inicializa el objeto undoStack que es un tipo de pila que permite almacenar los diferentes estados de una
-    // imagen que contiene todo lo que se haya editado dentro del programa.
-    undoStack = new QUndoStack(this);
-    undoStack->setUndoLimit(UNDO_LIMIT);
+    canvas = new Canvas(this);
+    connect(canvas, SIGNAL(changed(QRect)), this, SLOT(OnCanvasChanged(QRect)));
 
-    // inicializa la imagen que vendria a ser el lienzo
-    image = new QPixmap();
+    // indicadores de rendimiento, ocultos hasta que se activan desde el menu
+    hud = new PerfHud(this, canvas);
+    preview = 0;
 
-    //create the pen, line, eraser, & rect tools
-    createTools();
+    // los filtros se ejecutan en segundo plano, el resultado se aplica cuando terminan
+    filterJob = 0;
+    filterLayer = 0;
+    filterWatcher = new QFutureWatcher<void>(this);
+    connect(filterWatcher, SIGNAL(finished()), this, SLOT(OnFilterFinished()));
 
-    // iniciliza los colores por defecto
-    foregroundColor = Qt::black;
-    backgroundColor = Qt::white;
     // inicializa las variables de los estados de ciertos eventos o funciones que se estan ejecutando
-    drawing = false;
-    drawingPoly = false;
     dropperState = false;
-    currentLineMode = single;
 
     setAttribute(Qt::WA_OpaquePaintEvent);
     setAttribute(Qt::WA_StaticContents);
@@ -41,63 +41,69 @@ DrawArea::DrawArea(QWidget *parent)
 
 DrawArea::~DrawArea()
 {
-    delete image;
-    delete pencilTool;
-    delete penTool;
-    delete eraserTool;
-    delete shapesTool;
+    if(filterJob)
+    {
+        filterWatcher->cancel();
+        filterWatcher->waitForFinished();
+        delete filterJob;
+    }
 }
 
 void DrawArea::paintEvent(QPaintEvent *e)
 
 {
+    TRACE_SCOPE("DrawArea::paintEvent");
+    ScopedTimer timer(perf_paint);
     QPainter painter(this);
     QRect modifiedArea = e->rect(); // only need to redraw a small area
-    painter.drawPixmap(modifiedArea, *image, modifiedArea);
+    PerfStats::addPaintArea(qint64(modifiedArea.width()) * modifiedArea.height());
+    canvas->getLayers()->paint(painter, modifiedArea);
+    if(preview)
+        preview->paint(painter, modifiedArea, palette().window());
+    canvas->paintPolyline(painter, modifiedArea);
+    canvas->getSelectionTool()->paint(painter, modifiedArea);
 }
 
 /**
  * @brief DrawArea::mousePressEvent Este metodo maneja los eventos correspondientes a ejecutarse, según la función
  *                                  del program en ejecucion cuando cuando se presiona algun bonton en el mouse.
- *                                  - clic-izquierdo inicia a dibujar con la funcion lapiz un trazo continuo.
- *                                  -clic-izquierdo ingresa el punto inicial y final en la función lapicero.
- *                                  -clic-izquierdo ingresa el punto inicial y final en la funciones que
- *                                   dibujan las figuras.
+ *                                  - clic-izquierdo inicia el trazo de la herramienta actual en el lienzo, o
+ *                                  toma el color del pixel si esta activo el gotero.
  *                                  - clic-derecho abre un "dialog" que tien las propiedades de la función
  *                                  seleccionada por el usuario.
  *
  */
 void DrawArea::mousePressEvent(QMouseEvent *e)
 {
+    TRACE_SCOPE("DrawArea::mousePressEvent");
 
     if(e->button() == Qt::RightButton)
     {
-        // Abre el "dialog menu" segun la función seleccionada por el usuario.
-        static_cast<MainWindow*>(parent())->mousePressEvent(e);
+        // Abre el "dialog menu" segun la función seleccionada por el usuario. El DrawArea esta dentro de una
+        // pestaña, la ventana principal es window()
+        if(MainWindow* mainWindow = qobject_cast<MainWindow*>(window()))
+            mainWindow->mousePressEvent(e);
     }
     else if (e->button() == Qt::LeftButton)
     {
+        QImage *image = canvas->getImage();
         if(image->isNull())
             return;
         if (dropperState){
             punto =e->pos();
-            QColor color_temp = this->getImage()->toImage().pixelColor(this->getPOINT());
+            if (!image->rect().contains(punto))
+                return;
+            QColor color_temp = image->pixelColor(this->getPOINT());
             if (color_temp.isValid())
                 this->updateColorConfig(color_temp, foreground);
-            static_cast<MainWindow*>(parent())->OnGetPixelColor();
+            if(MainWindow* mainWindow = qobject_cast<MainWindow*>(window()))
+                mainWindow->OnGetPixelColor();
             return;
         }
-        drawing = true;
-
-        if (dropperState){
-            punto =e->pos();
-        }
-
-        if(!drawingPoly)
-            currentTool->setStartPoint(e->pos());
-
-        // guarda una copia de la anterior imagen a la nueva edicion.
-        oldImage = image->copy(QRect());
+        // mientras corre un filtro el lienzo no recibe trazos, el resultado se pega sobre la capa de cuando empezo
+        if(filterJob)
+            return;
+        canvas->beginStroke(e->pos());
     }
 }
 
@@ -109,22 +115,9 @@ void DrawArea::mousePressEvent(QMouseEvent *e)
  */
 void DrawArea::mouseMoveEvent(QMouseEvent *e)
 {
-    if (e->buttons() & Qt::LeftButton && drawing)
-    {
-        if(image->isNull())
-            return;
-
-        ToolType type = currentTool->getType();
-        if(type == pen || type == shapes_tool)
-        {
-            *image = oldImage;
-            if(type == pen && currentLineMode == poly)
-            {
-                drawingPoly = true;
-            }
-        }
-        currentTool->drawTo(e->pos(), this, image);
-    }
+    TRACE_SCOPE("DrawArea::mouseMoveEvent");
+    if (!filterJob && (e->buttons() & Qt::LeftButton))
+        canvas->moveStroke(e->pos());
 }
 
 /**
@@ -133,39 +126,42 @@ void DrawArea::mouseMoveEvent(QMouseEvent *e)
  */
 void DrawArea::mouseReleaseEvent(QMouseEvent *e)
 {
-    if (e->button() == Qt::LeftButton && drawing)
-    {
-        drawing = false;
-
-        if(image->isNull())
-            return;
-
-        if(drawingPoly)
-        {
-            currentTool->setStartPoint(e->pos());
-            //return;
-        }
-        if(currentTool->getType() == pencil)
-            currentTool->drawTo(e->pos(), this, image);
-
-        if(oldImage.toImage() != image->toImage())
-            saveDrawCommand(oldImage);
-    }
+    TRACE_SCOPE("DrawArea::mouseReleaseEvent");
+    if (!filterJob && e->button() == Qt::LeftButton)
+        canvas->endStroke(e->pos());
 }
 
 /**
  * @brief DrawArea::mouseDoubleClickEvent:  Si en la funcion lapicero se escogio hacer trazos de un poligono
- *                                          al hacer doble clic se vuelve al trazo normal de una simple
- *                                          linea recta.
+ *                                          al hacer doble clic se termina la polilinea y se dibuja en el
+ *                                          lienzo de una sola vez.
  */
 void DrawArea::mouseDoubleClickEvent(QMouseEvent *e)
 {
-    if (e->button() == Qt::LeftButton)
-    {
-        if(drawingPoly)
-            drawingPoly = false;
-    }
+    TRACE_SCOPE("DrawArea::mouseDoubleClickEvent");
+    if (!filterJob && e->button() == Qt::LeftButton)
+        canvas->endPolyline();
 }
+
+/**
+ * @brief DrawArea::OnCanvasChanged: Repinta el area del lienzo que cambio, un rectangulo nulo repinta todo el widget.
+ */
+void DrawArea::OnCanvasChanged(const QRect &rect)
+{
+    if(rect.isNull())
+        update();
+    else
+        update(rect);
+}
+
+/**
+ * @brief DrawArea::OnShowHud: Muestra u oculta los indicadores de rendimiento sobre el lienzo.
+ */
+void DrawArea::OnShowHud(bool show)
+{
+    hud->setActive(show);
+}
+
 /**
  * @brief DrawArea::OnSaveImage: Este metode devuleve a su estado original la imagen antes del utltimo cambio
  *                              -Función "undo"
@@ -173,11 +169,7 @@ void DrawArea::mouseDoubleClickEvent(QMouseEvent *e)
  */
 void DrawArea::OnUndo()
 {
-    if(!undoStack->canUndo())
-        return;
-
-    undoStack->undo();
-    update();
+    canvas->undo();
 }
 
 /**
@@ -188,11 +180,7 @@ void DrawArea::OnUndo()
  */
 void DrawArea::OnRedo()
 {
-    if(!undoStack->canRedo())
-        return;
-
-    undoStack->redo();
-    update();
+    canvas->redo();
 }
 
 /**
@@ -202,266 +190,96 @@ void DrawArea::OnRedo()
  */
 void DrawArea::OnClearAll()
 {
-    if(image->isNull())
+    if(canvas->getImage()->isNull())
         return;
 
-    clearImage();
-}
-
-/**
- * @brief DrawArea::OnPencilSizeConfig:  Este metodo configura el grozor del trazo de la clase "Pencil" que pertenece a la clase
- *                                       que abstrae la función Lapiz.
- */
-void DrawArea::OnPencilSizeConfig(int value)
-{
-    pencilTool->setWidth(value);
+    canvas->clearImage();
 }
 
 /**
- * @brief DrawArea::OnEraserConfig:  Este metodo configura el grozor de la clase "Eraser" que pertenece a la clase
- *                                   que abstrae la función Borrador.
+ * @brief DrawArea::OnCopy: Copia al portapapeles el contenido de la seleccion.
  */
-void DrawArea::OnEraserConfig(int value)
+void DrawArea::OnCopy()
 {
-    eraserTool->setWidth(value);
-}
-
-/**
- * @brief DrawArea::OnPenStyleConfig: Cambia el estilo del trazado del objeto Pen
- *                                   -SolidLine:     linea continua
- *                                   -DashLine:      linea de lineas espaciadas
- *                                   -DotLine:       linea punteada
- *                                   -DashDotLine:   linea de puntos y lineas
- *                                   -DashDotDotLine:linea de linea-punto-punto-linea
- *
- */
-void DrawArea::OnPenLineStyleConfig(int lineStyle)
-{
-    switch (lineStyle)
-    {
-        case solid: penTool->setStyle(Qt::SolidLine);                break;
-        case dashed: penTool->setStyle(Qt::DashLine);                break;
-        case dotted: penTool->setStyle(Qt::DotLine);                 break;
-        case dash_dotted: penTool->setStyle(Qt::DashDotLine);        break;
-        case dash_dot_dotted: penTool->setStyle(Qt::DashDotDotLine); break;
-        default:                                                      break;
-    }
-}
-/**
- * @brief DrawArea::OnDrawTypeConfig: Configura las dos formas de implementar la funcion Lapicero(Pen)
- *                                   -single: Traza una linea recta entre dos puntos
- *                                   -poly: Traza una linea recta entre dos puntos
- *                                            toomando como punto inicial el ultimo
- *                                            punto de la ultima recta trazada.
- */
-void DrawArea::OnPenDrawTypeConfig(int drawType)
-{
-    switch (drawType)
-    {
-        case single: setLineMode(single); break;
-        case poly:   setLineMode(poly);   break;
-        default:     break;
-    }
-}
-
-/**
- * @brief DrawArea::OnPenLineThicknessConfig: Configura el grozor del trazo del Objeto Pen.
- */
-void DrawArea::OnPenLineThicknessConfig(int value)
-{
-    penTool->setWidth(value);
-}
-
-/**
- * @brief DrawArea::OnShapesBStyleConfig:  Cambia el estilo del trazado del Objeto Shapes que se encarga de dibujar
- *                                         alguna de las figuras disponibles.
- *                                          -SolidLine:     linea continua.
- *                                          -DashLine:      linea de lineas espaciadas.
- *                                          -DotLine:       linea punteada.
- *                                          -DashDotLine:   linea de puntos y lineas.
- *                                          -DashDotDotLine:linea de linea-punto-punto-linea.
- */
-void DrawArea:: OnShapesBStyleConfig(int boundaryStyle)
-{
-    switch (boundaryStyle)
-    {
-        case solid: shapesTool->setStyle(Qt::SolidLine);                break;
-        case dashed: shapesTool->setStyle(Qt::DashLine);                break;
-        case dotted: shapesTool->setStyle(Qt::DotLine);                 break;
-        case dash_dotted: shapesTool->setStyle(Qt::DashDotLine);        break;
-        case dash_dot_dotted: shapesTool->setStyle(Qt::DashDotDotLine); break;
-        default:                                                      break;
-    }
-}
+    QImage content = canvas->copySelection();
+    if(content.isNull())
+        return;
 
-/**
- * @brief DrawArea::OnSelectShapeTypeConfig: Este metodo se encarga de asignar el tipo de figura
- *                                           que debe dibujar el objeto Shapes.
- *
- */
-void DrawArea::OnSelectShapeTypeConfig(int shape)
-{
-    switch (shape)
-    {
-        case rectangle: shapesTool->setShapeType(rectangle);        break;
-        case ellipse: shapesTool->setShapeType(ellipse);        break;
-        case triangle: shapesTool->setShapeType(triangle);        break;
-    default:                                                           break;
-    }
+    QApplication::clipboard()->setImage(content);
 }
 
 /**
- * @brief DrawArea::OnShapesFillConfig:  Este metodo se encarga de configurar el relleno de las figuras geometricas.
- *                                       -foregraund: Dibuja una figura rellena de un mismo color al de sus bordes.
- *                                       -background: Dibuja una figura con el relleno del mismo color del fondo del lienzo.
- *                                       -no_fil:     Dibuja una figura sin relleno.
+ * @brief DrawArea::OnCut: Copia la seleccion al portapapeles y la borra del lienzo dejando el color de fondo.
  */
-void DrawArea::OnShapesFillConfig(int fillType)
+void DrawArea::OnCut()
 {
-    switch (fillType)
-    {
-        case foreground: shapesTool->setFillMode(foreground);
-                         shapesTool->setFillColor(foregroundColor);      break;
-        case background: shapesTool->setFillMode(background);
-                         shapesTool->setFillColor(backgroundColor);      break;
-        case no_fill: shapesTool->setFillMode(no_fill);
-                      shapesTool->setFillColor(QColor(Qt::transparent)); break;
-        default:                                                       break;
-    }
-}
+    QImage content = canvas->copySelection();
+    if(content.isNull())
+        return;
 
-/**
- * @brief DrawArea::OnShapesBTypeConfig: - Update rectangle join style
- *
- */
-void DrawArea::OnShapesBTypeConfig(int boundaryType)
-{
-    switch (boundaryType)
-    {
-        case miter_join: shapesTool->setJoinStyle(Qt::MiterJoin);  break;
-        case bevel_join: shapesTool->setJoinStyle(Qt::BevelJoin);  break;
-        case round_join: shapesTool->setJoinStyle(Qt::RoundJoin);  break;
-        default:                                                 break;
-    }
+    QApplication::clipboard()->setImage(content);
+    canvas->cutSelection();
 }
 
 /**
- * @brief DrawArea::OnShapesLineConfig: Este metodo confugra el grozor del trazo de las figuras.
+ * @brief DrawArea::OnPaste: Pega la imagen del portapapeles como una seleccion flotante en la esquina del lienzo.
  */
-void DrawArea::OnShapesLineConfig(int value)
+void DrawArea::OnPaste()
 {
-    shapesTool->setWidth(value);
+    canvas->pasteImage(QApplication::clipboard()->image());
 }
 
-
 /**
- * @brief DrawArea::createNewImage: Meto que crea el nuevo objeto de timo QPixmap que sera de lienzo
- *                                  el cual se le asigna a la variable "image".
+ * @brief DrawArea::applyFilter: Inicia un filtro sobre la seleccion o, si no hay seleccion, sobre todo el lienzo.
+ *                               El filtro corre en el pool de hilos y se puede cancelar desde "filterWatcher",
+ *                               devuelve falso si no se pudo iniciar.
  */
-void DrawArea::createNewImage(const QSize &size)
+bool DrawArea::applyFilter(const FilterParams &params)
 {
-    // save a copy of the old image
-    oldImage = image->copy();
+    if(filterJob)
+        return false;
 
-    *image = QPixmap(size);
-    image->fill(backgroundColor);
-    update();
+    QRect area = canvas->filterArea();
+    if(area.isEmpty())
+        return false;
 
-    // for undo/redo
-    if(!imagesEqual(oldImage, *image))
-        saveDrawCommand(oldImage);
+    filterJob = new FilterJob(*canvas->getImage(), area, params);
+    filterLayer = canvas->getImage()->cacheKey();
+    filterWatcher->setFuture(filterJob->start());
+    return true;
 }
 
 /**
- * @brief DrawArea::loadImage: Este metodo se encarga de abrir una imagen que este en el equipo, siempre
- *                             que esté en formato BitMap.
+ * @brief DrawArea::setPreview: Muestra la vista previa de un dialogo encima del lienzo, cero la quita.
  */
-void DrawArea::loadImage(const QString &fileName)
+void DrawArea::setPreview(ProxyPreview *preview)
 {
-    // guarda una copia de "image" antes de que se cagrgue la imagen.
-    oldImage = image->copy();
+    if(this->preview)
+        disconnect(this->preview, 0, this, 0);
 
-    image->load(fileName);
+    this->preview = preview;
+    if(preview)
+        connect(preview, SIGNAL(updated(QRect)), this, SLOT(OnCanvasChanged(QRect)));
     update();
-
-    // Guarda la copia hecha antes, en la lista que almacena
-    //los estados para los comandos "undo" y "redo".
-    if(!imagesEqual(oldImage, *image))
-        saveDrawCommand(oldImage);
 }
 
 /**
- * @brief DrawArea::saveImage: Este metodo guarda todo lo realizado en el editor de imagenes
- *                             en un archivo en formato Bitmap.
+ * @brief DrawArea::OnFilterFinished: Cuando el filtro termina se guarda solo el rectangulo modificado en la pila de
+ *                                    "undo" y "redo", al apilarse el comando pinta el resultado en el lienzo.
+ *                                    Si el filtro se cancelo se descarta el resultado, y tambien si la capa ya no
+ *                                    es la misma de cuando empezo (otra capa activa, "undo", redimensionar, girar o
+ *                                    cualquier cambio la desacopla y cambia su cacheKey): pegarlo la pisaria.
  */
-void DrawArea::saveImage(const QString &fileName)
+void DrawArea::OnFilterFinished()
 {
-    image->save(fileName, "BMP");
-}
-
-/**
- * @brief DrawArea::resizeImage: Este metodo se encarga de reconfigurar las dimensiones de "image"
- *                               que hace de lienzo.
- */
-void DrawArea::resizeImage(const QSize &size)
-{
-    // Guarda una copia de "image" antes de que se realicen los cambios.
-    oldImage = image->copy();
-
-    // Se evalua si no hayc cambios algunos en la escogencia del usuario
-    // para no hacer nada.
-    if(image->size() == size)
-    {
+    if(!filterJob)
         return;
-    }
-
-    // "Si no" erealiza los cambios en las dimensiones
-    *image = image->scaled(size, Qt::IgnoreAspectRatio);
-    update();
-    // Guarda la copia hecha antes, en la lista que almacena
-    //los estados para los comandos "undo" y "redo".
-    saveDrawCommand(oldImage);
-}
-/**
- * @brief DrawArea::clearImage: Borra todo lo hecho en elñ editor de imagenes.
- */
-void DrawArea::clearImage()
-{
-    // Guarda una copia de "image" antes de que se realicen los cambios.
-    oldImage = image->copy();
-    image->fill(backgroundColor);
-    update(image->rect());
-    // Guarda la copia hecha antes, en la lista que almacena
-    //los estados para los comandos "undo" y "redo".    if(!imagesEqual(oldImage, *image))
-    saveDrawCommand(oldImage);
-}
-/**
- * @brief DrawArea::updateColorConfig: Este metodo se encarga de asignar los valores de los calores a las variables que se encargan
- *                                     tanto del color del fondo del lienzo como del
- *                                     color de los trazos.
- *                                     -foreground: variable que almacena el color de los trazos.
- *                                     -background: variable que almacena el color del fonmdo del lienzo.
- */
-void DrawArea::updateColorConfig(const QColor &color, int which)
-{
-    if(which == foreground)
-    {
-         foregroundColor = color;
-         pencilTool->setColor(foregroundColor);
-         penTool->setColor(foregroundColor);
-         shapesTool->setColor(foregroundColor);
 
-         if(shapesTool->getFillMode() == foreground)
-             shapesTool->setFillColor(foregroundColor);
-    }
-    else
-    {
-        backgroundColor = color;
-        eraserTool->setColor(backgroundColor);
+    if(!filterWatcher->isCanceled() && canvas->getImage()->cacheKey() == filterLayer)
+        canvas->applyFilterResult(*filterJob);
 
-        if(shapesTool->getFillMode() == background)
-            shapesTool->setFillColor(backgroundColor);
-    }
+    delete filterJob;
+    filterJob = 0;
 }
 
 /**
@@ -473,85 +291,3 @@ void DrawArea::updateColorConfig(const QColor &color, int which)
 void DrawArea::setDropperState(bool state){
     dropperState = state;
 }
-/**
- * @brief DrawArea::setCurrentTool: Este metdo despoues de recibir cual herramienta
- *                                  se selecciona segun el boton que se encarga de esto
- *                                  se lo asigna "currentool" que es lña variable que se
- *                                  encarga de guardar cual herramienta se seleccionó.
- *
- */
-Tool* DrawArea::setCurrentTool(int newType)
-{
-    // get the current tool's type
-    int currType = currentTool->getType();
-
-    // if no change, return --else cancel poly mode & set tool
-    if(newType == currType)
-        return currentTool;
-
-    if(currType == pen)
-        drawingPoly = false;
-
-    switch(newType)
-    {
-        case pencil: currentTool = pencilTool;        break;
-        case pen: currentTool = penTool;      break;
-        case eraser: currentTool = eraserTool;  break;
-        case shapes_tool: currentTool = shapesTool; break;
-        default:                                break;
-    }
-    return currentTool;
-}
-
-/**
- * @brief DrawArea::setPenMode:
- */
-void DrawArea::setLineMode(const DrawType mode)
-{
-    if(mode == single)
-        drawingPoly = false;
-
-    currentLineMode = mode;
-}
-
-/**
- * @brief DrawArea::SaveDrawCommand: Se encarga de apilar objetos de tipo QUndoComand, dentor de la pila undoStack, que es la que se encarga de almacenar los dieferentes estados del lienzo
- *                                   para hacer las funciones "undo" y "redo".
- *
- */
-void DrawArea::saveDrawCommand(const QPixmap &old_image)
-{
-    // put the old and new image on the stack for undo/redo
-    QUndoCommand *drawCommand = new DrawCommand(old_image, image);
-    undoStack->push(drawCommand);
-}
-
-/**
- * @brief DrawArea::createTools: Este metodo es el que se encarga d e instanciar los objetos
- *                               que son las herramientas del Paint++.
- *                               -PencilTool: Objeto que se encarga de la función Lapiz.
- *                               -PenTool: Objeto que se encarda de la función Lapicero.
- *                               -EraserTool: Objeto que se encarga de la función Borrador.
- *                               -ShapesTool: Objeto que se encarga de dibujar las tres diferentes figuras
- *                                            rectangulo, círculo y triángulo.
- */
-void DrawArea::createTools()
-{
-    // create the tools
-    pencilTool = new PencilTool(QBrush(Qt::black), DEFAULT_PEN_THICKNESS);
-    penTool = new PenTool(QBrush(Qt::black), DEFAULT_PEN_THICKNESS);
-    eraserTool = new EraserTool(QBrush(Qt::white), DEFAULT_ERASER_THICKNESS);
-    shapesTool = new ShapesTool(QBrush(Qt::black), DEFAULT_PEN_THICKNESS);
-    // set default tool
-    currentTool = static_cast<Tool*>(pencilTool);
-}
-/**
- * @brief imagesEqual: Este metodo antes de agregar el ultimo estado de "image", a la pila que guarda los estados para los
- *                      comandos "undo" y "redo", que el nuevo esatdo a guardar no sea igual que el ultimo que se guardo,
- *                      para asi evitar guardarlo dos veces
-**/
-
-bool imagesEqual(const QPixmap &image1, const QPixmap &image2)
-{
-    return image1.toImage() == image2.toImage();
-}
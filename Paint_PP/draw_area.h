@@ -1,13 +1,23 @@
 #ifndef DRAW_AREA_H
 #define DRAW_AREA_H
 
-#include <QUndoStack>
+#include <QWidget>
+#include <QFutureWatcher>
 
 
 #include "constants.h"
-#include "tool.h"
+#include "canvas.h"
 
 
+class PerfHud;
+class ProxyPreview;
+
+
+/**
+ * DrawArea: El widget donde se muestra y se edita el lienzo. Toda la logica de edicion esta en "canvas" (nucleo sin
+ * QtWidgets), aqui solo se traducen los eventos del mouse, se repinta y se maneja lo que depende de la ventana:
+ * el portapapeles, el gotero y los filtros en segundo plano.
+ */
 class DrawArea : public QWidget
 {
     Q_OBJECT
@@ -15,42 +25,43 @@ class DrawArea : public QWidget
 public:
     DrawArea(QWidget *parent);
     ~DrawArea();
-    QPixmap* getImage() { return image; }
-    Tool* getCurrentTool() const { return currentTool; }
-    QColor getForegroundColor() { return foregroundColor; }
-    QColor getBackgroundColor() { return backgroundColor; }
+    Canvas* getCanvas() { return canvas; }
+    QImage* getImage() { return canvas->getImage(); }
+    LayerStack* getLayers() { return canvas->getLayers(); }
+    Tool* getCurrentTool() const { return canvas->getCurrentTool(); }
+    QColor getForegroundColor() { return canvas->getForegroundColor(); }
+    QColor getBackgroundColor() { return canvas->getBackgroundColor(); }
     QPoint getPOINT(){ return punto;}
     void setDropperState(bool);
-    Tool* setCurrentTool(int);
-    void setLineMode(const DrawType mode);
-
-    void createNewImage(const QSize&);
-    void loadImage(const QString&);
-    void saveImage(const QString&);
-    void resizeImage(const QSize&);
-    void clearImage();
-    void updateColorConfig(const QColor&, int);
-
-    void saveDrawCommand(const QPixmap&);
+    Tool* setCurrentTool(int type) { return canvas->setCurrentTool(type); }
+    void setLineMode(const DrawType mode) { canvas->setLineMode(mode); }
+
+    void createNewImage(const QSize &size, PixelFormat format = rgb_pixels) { canvas->createNewImage(size, format); }
+    bool loadImage(const QString &fileName) { return canvas->loadImage(fileName); }
+    bool saveImage(const QString &fileName) { return canvas->saveImage(fileName); }
+    bool exportIndexed(const QString &fileName, DitherMode dither, bool rle = false)
+    {
+        return canvas->exportIndexed(fileName, dither, rle);
+    }
+    void resizeImage(const QSize &size) { canvas->resizeImage(size); }
+    void transformImage(ImageTransform transform) { canvas->transformImage(transform); }
+    void updateColorConfig(const QColor &color, int which) { canvas->updateColorConfig(color, which); }
+
+    bool applyFilter(const FilterParams&);
+    void applyAdjustments(const ColorPipeline &pipeline) { canvas->applyAdjustments(pipeline); }
+    QFutureWatcher<void>* getFilterWatcher() { return filterWatcher; }
+    void setPreview(ProxyPreview *preview);
 
 public slots:
     void OnUndo();
     void OnRedo();
     void OnClearAll();
-
-    void OnPencilSizeConfig(int);
-
-    void OnEraserConfig(int);
-
-    void OnPenLineStyleConfig(int);
-    void OnPenDrawTypeConfig(int);
-    void OnPenLineThicknessConfig(int);
-
-    void OnShapesBStyleConfig(int);
-    void OnSelectShapeTypeConfig(int);
-    void OnShapesFillConfig(int);
-    void OnShapesBTypeConfig(int);
-    void OnShapesLineConfig(int);
+    void OnCopy();
+    void OnCut();
+    void OnPaste();
+    void OnFilterFinished();
+    void OnCanvasChanged(const QRect&);
+    void OnShowHud(bool);
 
 protected:
     void virtual mousePressEvent(QMouseEvent *event) override;
@@ -61,32 +72,18 @@ protected:
     void virtual paintEvent(QPaintEvent *event) override;
 
 private:
-    void createTools();
-
-    QUndoStack* undoStack;
-
-    Tool* currentTool;
-    DrawType currentLineMode;
+    Canvas* canvas;
+    PerfHud* hud;
+    ProxyPreview* preview;
 
-    QPixmap* image;
-    QPixmap oldImage;
+    FilterJob* filterJob;
+    qint64 filterLayer;         // cacheKey de la capa sobre la que corre el filtro
+    QFutureWatcher<void>* filterWatcher;
 
-    QColor foregroundColor;
-    QColor backgroundColor;
-
-    PencilTool* pencilTool;
-    PenTool* penTool;
-    EraserTool* eraserTool;
-    ShapesTool* shapesTool;
-
-    bool drawing;
-    bool drawingPoly;
     bool dropperState;
     QPoint punto;
     DrawArea(const DrawArea&);
     DrawArea& operator=(const DrawArea&);
 };
 
-extern bool imagesEqual(const QPixmap& image1, const QPixmap& image2);
-
 #endif // DRAW_AREA_H
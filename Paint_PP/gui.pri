@@ -0,0 +1,26 @@
+# Ventana del editor (QtWidgets). La usan la aplicacion (app.pro) y el arnes de latencia (latency/),
+# cada proyecto agrega su propio main.cpp.
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+HEADERS += \
+    $$PWD/main_window.h \
+    $$PWD/dialog_windows.h \
+    $$PWD/draw_area.h \
+    $$PWD/toolbar.h \
+    $$PWD/layer_panel.h \
+    $$PWD/perf_hud.h \
+    $$PWD/navigator.h
+SOURCES += \
+    $$PWD/main_window.cpp \
+    $$PWD/dialog_windows.cpp \
+    $$PWD/toolbar.cpp \
+    $$PWD/draw_area.cpp \
+    $$PWD/layer_panel.cpp \
+    $$PWD/perf_hud.cpp \
+    $$PWD/navigator.cpp
+
+RESOURCES += \
+    $$PWD/icons.qrc
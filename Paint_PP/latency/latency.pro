@@ -0,0 +1,17 @@
+# Arnes de latencia de evento a pantalla: envia eventos del mouse al DrawArea de la aplicacion y mide
+# cuanto tarda el "paintEvent" que muestra cada cambio. Sin pantalla: ./paintpp-latency -platform offscreen
+QT       = core gui concurrent testlib
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+CONFIG += qt warn_on
+
+TARGET = paintpp-latency
+
+include(../core/core.pri)
+include(../gui.pri)
+
+HEADERS += \
+    latency_harness.h
+SOURCES += main.cpp \
+    latency_harness.cpp
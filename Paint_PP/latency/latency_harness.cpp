@@ -0,0 +1,211 @@
+#include <QApplication>
+#include <QMouseEvent>
+#include <QMap>
+#include <QtMath>
+#include <QtTest>
+#include <algorithm>
+
+#include "latency_harness.h"
+#include "op_log.h"
+
+
+ProbeArea::ProbeArea(const QElapsedTimer *clock)
+    : DrawArea(0)
+{
+    this->clock = clock;
+    paintCount = 0;
+    paintEnd = 0;
+}
+
+void ProbeArea::paintEvent(QPaintEvent *event)
+{
+    DrawArea::paintEvent(event);
+    paintEnd = clock->nsecsElapsed();
+    paintCount++;
+}
+
+/**
+ * @brief LatencyResult::percentile: Percentil "p" por rango mas cercano, 0 si no hay muestras.
+ */
+qint64 LatencyResult::percentile(int p) const
+{
+    if(samples.isEmpty())
+        return 0;
+
+    QVector<qint64> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    int rank = (p * sorted.size() + 99) / 100;
+    return sorted.at(qBound(0, rank - 1, sorted.size() - 1));
+}
+
+qint64 LatencyResult::worst() const
+{
+    return samples.isEmpty() ? 0 : *std::max_element(samples.begin(), samples.end());
+}
+
+/**
+ * @brief LatencyHarness::LatencyHarness: "fps" define la duracion de un cuadro para contar los cuadros perdidos y
+ *                                        "events" el numero de movimientos del mouse por herramienta y tamaño.
+ */
+LatencyHarness::LatencyHarness(int fps, int events)
+{
+    frameNs = 1000000000LL / qMax(1, fps);
+    timeoutNs = 1000000000LL;
+    this->events = events;
+    changes = 0;
+    clock.start();
+}
+
+QString LatencyHarness::toolName(int type)
+{
+    switch(type)
+    {
+        case pencil:      return "pencil";
+        case pen:         return "pen";
+        case eraser:      return "eraser";
+        case shapes_tool: return "shapes";
+        case selection:   return "selection";
+        default:          return "unknown";
+    }
+}
+
+void LatencyHarness::OnCanvasChanged(const QRect&)
+{
+    changes++;
+}
+
+/**
+ * @brief LatencyHarness::runTool: Trazos de 50 movimientos sobre una curva que recorre todo el lienzo, se mide
+ *                                 cada evento (presionar, mover y soltar) que cambia el lienzo.
+ */
+LatencyResult LatencyHarness::runTool(ToolType type, const QSize &size)
+{
+    LatencyResult result;
+    result.tool = toolName(type);
+    result.size = size;
+
+    ProbeArea area(&clock);
+    area.createNewImage(size);
+    area.setCurrentTool(type);
+    area.resize(size);
+    area.show();
+    QTest::qWaitForWindowExposed(&area);
+    connect(area.getCanvas(), SIGNAL(changed(QRect)), this, SLOT(OnCanvasChanged(QRect)));
+    settle();
+
+    const int strokeLength = 50;
+    for(int i = 0; i < events; i++)
+    {
+        QPoint point = pathPoint(i, size);
+
+        if(i % strokeLength == 0)
+            record(result, measure(&area, [&]() {
+                QTest::mousePress(&area, Qt::LeftButton, Qt::NoModifier, point);
+            }));
+
+        // QTest::mouseMove no lleva el boton presionado en Qt 5, por eso el evento se arma aqui
+        QMouseEvent move(QEvent::MouseMove, point, area.mapToGlobal(point),
+                         Qt::NoButton, Qt::LeftButton, Qt::NoModifier);
+        record(result, measure(&area, [&]() { QApplication::sendEvent(&area, &move); }));
+
+        if(i % strokeLength == strokeLength - 1 || i == events - 1)
+            record(result, measure(&area, [&]() {
+                QTest::mouseRelease(&area, Qt::LeftButton, Qt::NoModifier, point);
+            }));
+    }
+
+    return result;
+}
+
+/**
+ * @brief LatencyHarness::runLog: Reproduce un registro de operaciones paso a paso sin las esperas originales y
+ *                                agrupa las latencias por herramienta y tamaño del lienzo.
+ */
+QList<LatencyResult> LatencyHarness::runLog(const QByteArray &data, bool *ok)
+{
+    ProbeArea area(&clock);
+    OpPlayer player(area.getCanvas(), data);
+    *ok = player.isValid();
+    if(!*ok)
+        return QList<LatencyResult>();
+
+    area.show();
+    QTest::qWaitForWindowExposed(&area);
+    connect(area.getCanvas(), SIGNAL(changed(QRect)), this, SLOT(OnCanvasChanged(QRect)));
+
+    QMap<QString, LatencyResult> results;
+    while(!player.atEnd())
+    {
+        qint64 latency = measure(&area, [&]() { player.step(); });
+
+        QSize size = area.getImage()->size();
+        if(area.size() != size)
+        {
+            area.resize(size);
+            settle();
+        }
+
+        QString tool = toolName(area.getCurrentTool()->getType());
+        QString key = tool + QString(" %1x%2").arg(size.width()).arg(size.height());
+        LatencyResult &result = results[key];
+        result.tool = tool;
+        result.size = size;
+        record(result, latency);
+    }
+
+    return results.values();
+}
+
+/**
+ * @brief LatencyHarness::measure: Ejecuta "action" y, si cambio el lienzo, procesa eventos hasta que termina el
+ *                                 siguiente "paintEvent". Devuelve la latencia en nanosegundos, -1 si no habia nada
+ *                                 que repintar, o el limite de espera si el cuadro nunca llego.
+ */
+qint64 LatencyHarness::measure(ProbeArea *area, const std::function<void()> &action)
+{
+    int changesBefore = changes;
+    int paintsBefore = area->paints();
+    qint64 start = clock.nsecsElapsed();
+
+    action();
+
+    if(changes == changesBefore)
+        return -1;
+
+    while(area->paints() == paintsBefore && clock.nsecsElapsed() - start < timeoutNs)
+        QApplication::processEvents();
+
+    if(area->paints() == paintsBefore)
+        return timeoutNs;
+    return area->lastPaintEnd() - start;
+}
+
+void LatencyHarness::record(LatencyResult &result, qint64 latency)
+{
+    if(latency < 0)
+        return;
+
+    result.samples << latency;
+    result.droppedFrames += int(latency / frameNs);
+}
+
+/**
+ * @brief LatencyHarness::settle: Vacia la cola de eventos para que la medicion no incluya repintados anteriores.
+ */
+void LatencyHarness::settle()
+{
+    for(int i = 0; i < 10; i++)
+        QApplication::processEvents();
+}
+
+/**
+ * @brief LatencyHarness::pathPoint: Curva de Lissajous que cruza todo el lienzo, asi los trazos tocan muchos
+ *                                   mosaicos distintos en lugar de repetir la misma zona.
+ */
+QPoint LatencyHarness::pathPoint(int i, const QSize &size) const
+{
+    qreal rx = size.width() / 2 - 8;
+    qreal ry = size.height() / 2 - 8;
+    return QPoint(int(size.width() / 2 + rx * qSin(i * 0.05)),
+                  int(size.height() / 2 + ry * qSin(i * 0.07)));
+}
@@ -0,0 +1,83 @@
+#ifndef LATENCY_HARNESS_H
+#define LATENCY_HARNESS_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QList>
+#include <functional>
+
+#include "constants.h"
+#include "draw_area.h"
+
+
+/**
+ * ProbeArea: DrawArea que anota cuando termina cada "paintEvent", es decir, cuando el cambio ya esta en pantalla.
+ */
+class ProbeArea : public DrawArea
+{
+    Q_OBJECT
+
+public:
+    ProbeArea(const QElapsedTimer *clock);
+
+    int paints() const { return paintCount; }
+    qint64 lastPaintEnd() const { return paintEnd; }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    const QElapsedTimer* clock;
+    int paintCount;
+    qint64 paintEnd;
+};
+
+/**
+ * LatencyResult: Latencias (en nanosegundos) de los eventos de una herramienta en un tamaño de lienzo.
+ */
+struct LatencyResult
+{
+    QString tool;
+    QSize size;
+    QVector<qint64> samples;
+    int droppedFrames = 0;
+
+    qint64 percentile(int p) const;
+    qint64 worst() const;
+};
+
+/**
+ * LatencyHarness: Entrega eventos del mouse sinteticos (o un registro de operaciones) a un ProbeArea y mide, para
+ * cada evento que cambia el lienzo, el tiempo desde la entrega hasta el final del "paintEvent" que lo muestra.
+ * Un evento que tarda mas de un cuadro (1/fps) cuenta los cuadros que se perdieron.
+ */
+class LatencyHarness : public QObject
+{
+    Q_OBJECT
+
+public:
+    LatencyHarness(int fps = 60, int events = 200);
+
+    LatencyResult runTool(ToolType, const QSize&);
+    QList<LatencyResult> runLog(const QByteArray&, bool *ok);
+
+    static QString toolName(int type);
+
+private slots:
+    void OnCanvasChanged(const QRect&);
+
+private:
+    qint64 measure(ProbeArea*, const std::function<void()>&);
+    void record(LatencyResult&, qint64);
+    void settle();
+    QPoint pathPoint(int i, const QSize&) const;
+
+    QElapsedTimer clock;
+    qint64 frameNs;
+    qint64 timeoutNs;
+    int events;
+    int changes;
+};
+
+#endif // LATENCY_HARNESS_H
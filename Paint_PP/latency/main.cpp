@@ -0,0 +1,157 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QFile>
+
+#include "latency_harness.h"
+#include "op_log.h"
+
+
+static bool parseSize(const QString &text, QSize *size)
+{
+    QStringList parts = text.split('x');
+    if(parts.size() != 2)
+        return false;
+
+    bool okWidth = false, okHeight = false;
+    int width = parts.at(0).toInt(&okWidth);
+    int height = parts.at(1).toInt(&okHeight);
+    if(!okWidth || !okHeight || width < 16 || height < 16 || width > MAX_IMG_WIDTH || height > MAX_IMG_HEIGHT)
+        return false;
+
+    *size = QSize(width, height);
+    return true;
+}
+
+static QString ms(qint64 nsecs)
+{
+    return QString::number(nsecs / 1000000.0, 'f', 2);
+}
+
+/**
+ * @brief writeReport: Tabla legible y, si se pidio, el mismo resultado en CSV.
+ */
+static void writeReport(const QList<LatencyResult> &results, QTextStream &out, QTextStream *csv)
+{
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8")
+           .arg("tool", -10).arg("size", -10).arg("events", 7).arg("p50 ms", 8).arg("p95 ms", 8)
+           .arg("p99 ms", 8).arg("max ms", 8).arg("dropped", 8) << endl;
+
+    if(csv)
+        *csv << "tool,width,height,events,p50_ms,p95_ms,p99_ms,max_ms,dropped_frames" << endl;
+
+    for(const LatencyResult &result : results)
+    {
+        QString size = QString("%1x%2").arg(result.size.width()).arg(result.size.height());
+        out << QString("%1 %2 %3 %4 %5 %6 %7 %8")
+               .arg(result.tool, -10).arg(size, -10).arg(result.samples.size(), 7)
+               .arg(ms(result.percentile(50)), 8).arg(ms(result.percentile(95)), 8)
+               .arg(ms(result.percentile(99)), 8).arg(ms(result.worst()), 8)
+               .arg(result.droppedFrames, 8) << endl;
+
+        if(csv)
+            *csv << result.tool << ',' << result.size.width() << ',' << result.size.height() << ','
+                 << result.samples.size() << ',' << ms(result.percentile(50)) << ','
+                 << ms(result.percentile(95)) << ',' << ms(result.percentile(99)) << ','
+                 << ms(result.worst()) << ',' << result.droppedFrames << endl;
+    }
+}
+
+/**
+ * Arnes de latencia: mide el tiempo desde que el DrawArea recibe un evento del mouse hasta que termina el
+ * "paintEvent" que muestra el cambio, por herramienta y tamaño de lienzo.
+ *
+ *   paintpp-latency -platform offscreen
+ *   paintpp-latency --sizes 640x480,2560x1440 --tools pencil,pen --events 500 --csv latency.csv
+ *   paintpp-latency --log sesion.ppol
+ */
+int main(int argc, char* argv[])
+{
+    QApplication a(argc, argv);
+    QApplication::setApplicationName("paintpp-latency");
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Mide la latencia de evento a pantalla del lienzo de Paint++.");
+    parser.addHelpOption();
+
+    QCommandLineOption sizesOption(QStringList() << "sizes", "Tamaños de lienzo separados por comas.", "tamaños",
+                                   QString("%1x%2,1280x720,1920x1080,%3x%4").arg(DEFAULT_IMG_WIDTH)
+                                   .arg(DEFAULT_IMG_HEIGHT).arg(MAX_IMG_WIDTH).arg(MAX_IMG_HEIGHT));
+    QCommandLineOption toolsOption(QStringList() << "tools", "Herramientas separadas por comas.", "herramientas",
+                                   "pencil,pen,eraser,shapes,selection");
+    QCommandLineOption eventsOption(QStringList() << "events", "Movimientos del mouse por prueba.", "n", "200");
+    QCommandLineOption fpsOption(QStringList() << "fps", "Cuadros por segundo de referencia.", "n", "60");
+    QCommandLineOption logOption(QStringList() << "log", "Mide un registro de operaciones en lugar de los trazos "
+                                 "sinteticos.", "archivo");
+    QCommandLineOption csvOption(QStringList() << "csv", "Guarda los resultados en CSV.", "archivo");
+    parser.addOption(sizesOption);
+    parser.addOption(toolsOption);
+    parser.addOption(eventsOption);
+    parser.addOption(fpsOption);
+    parser.addOption(logOption);
+    parser.addOption(csvOption);
+    parser.process(a);
+
+    LatencyHarness harness(parser.value(fpsOption).toInt(), qMax(1, parser.value(eventsOption).toInt()));
+    QList<LatencyResult> results;
+
+    if(parser.isSet(logOption))
+    {
+        QByteArray data;
+        bool ok = OpLog::load(parser.value(logOption), &data);
+        if(ok)
+            results = harness.runLog(data, &ok);
+        if(!ok)
+        {
+            err << parser.value(logOption) << " no es un registro de operaciones" << endl;
+            return 1;
+        }
+    }
+    else
+    {
+        QList<QSize> sizes;
+        for(const QString &text : parser.value(sizesOption).split(',', QString::SkipEmptyParts))
+        {
+            QSize size;
+            if(!parseSize(text, &size))
+            {
+                err << "tamaño invalido: " << text << endl;
+                return 1;
+            }
+            sizes << size;
+        }
+
+        QList<ToolType> tools;
+        for(const QString &name : parser.value(toolsOption).split(',', QString::SkipEmptyParts))
+        {
+            int type = pencil;
+            while(type <= selection && LatencyHarness::toolName(type) != name)
+                type++;
+            if(type > selection)
+            {
+                err << "herramienta desconocida: " << name << endl;
+                return 1;
+            }
+            tools << ToolType(type);
+        }
+
+        for(ToolType tool : tools)
+            for(const QSize &size : sizes)
+                results << harness.runTool(tool, size);
+    }
+
+    QFile csvFile(parser.value(csvOption));
+    QTextStream csv(&csvFile);
+    bool writeCsv = parser.isSet(csvOption);
+    if(writeCsv && !csvFile.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        err << "no se pudo escribir " << csvFile.fileName() << endl;
+        return 2;
+    }
+
+    writeReport(results, out, writeCsv ? &csv : 0);
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <QListWidget>
+#include <QSlider>
+#include <QComboBox>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+
+#include "layer_panel.h"
+#include "draw_area.h"
+
+
+/**
+ * @brief LayerPanel::LayerPanel: Crea la lista de capas, los botones para agregar, eliminar y mover capas y los
+ *                                controles de la capa activa. Todas las acciones se envian al lienzo.
+ */
+LayerPanel::LayerPanel(QWidget* parent, DrawArea* drawArea)
+    : QWidget(parent)
+{
+    this->drawArea = 0;
+    layerList = new QListWidget(this);
+
+    addButton = new QPushButton(tr("+"), this);
+    removeButton = new QPushButton(tr("-"), this);
+    upButton = new QPushButton(tr("Subir"), this);
+    downButton = new QPushButton(tr("Bajar"), this);
+
+    QHBoxLayout* buttons = new QHBoxLayout;
+    buttons->addWidget(addButton);
+    buttons->addWidget(removeButton);
+    buttons->addWidget(upButton);
+    buttons->addWidget(downButton);
+
+    opacitySlider = new QSlider(Qt::Horizontal, this);
+    opacitySlider->setRange(0, MAX_LAYER_OPACITY);
+
+    // en el mismo orden que BlendMode
+    blendCombo = new QComboBox(this);
+    blendCombo->addItem(tr("Normal"));
+    blendCombo->addItem(tr("Multiplicar"));
+    blendCombo->addItem(tr("Trama"));
+    blendCombo->addItem(tr("Superponer"));
+    blendCombo->addItem(tr("Oscurecer"));
+    blendCombo->addItem(tr("Aclarar"));
+    blendCombo->addItem(tr("Diferencia"));
+    blendCombo->addItem(tr("Sumar"));
+
+    visibleCheck = new QCheckBox(tr("Visible"), this);
+
+    QFormLayout* properties = new QFormLayout;
+    properties->addRow(tr("Opacidad"), opacitySlider);
+    properties->addRow(tr("Mezcla"), blendCombo);
+    properties->addRow(visibleCheck);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addWidget(layerList);
+    layout->addLayout(buttons);
+    layout->addLayout(properties);
+
+    connect(layerList, SIGNAL(currentRowChanged(int)), this, SLOT(OnRowChanged(int)));
+
+    setDrawArea(drawArea);
+}
+
+/**
+ * @brief LayerPanel::setDrawArea: Conecta los controles al lienzo de "drawArea" y los desconecta del anterior.
+ */
+void LayerPanel::setDrawArea(DrawArea* drawArea)
+{
+    if(this->drawArea)
+    {
+        Canvas* previous = this->drawArea->getCanvas();
+        addButton->disconnect(previous);
+        removeButton->disconnect(previous);
+        upButton->disconnect(previous);
+        downButton->disconnect(previous);
+        opacitySlider->disconnect(previous);
+        blendCombo->disconnect(previous);
+        visibleCheck->disconnect(previous);
+        previous->disconnect(this);
+    }
+
+    this->drawArea = drawArea;
+    Canvas* canvas = drawArea->getCanvas();
+    connect(addButton, SIGNAL(clicked()), canvas, SLOT(OnAddLayer()));
+    connect(removeButton, SIGNAL(clicked()), canvas, SLOT(OnRemoveLayer()));
+    connect(upButton, SIGNAL(clicked()), canvas, SLOT(OnLayerUp()));
+    connect(downButton, SIGNAL(clicked()), canvas, SLOT(OnLayerDown()));
+    connect(opacitySlider, SIGNAL(valueChanged(int)), canvas, SLOT(OnLayerOpacity(int)));
+    connect(blendCombo, SIGNAL(currentIndexChanged(int)), canvas, SLOT(OnLayerBlendMode(int)));
+    connect(visibleCheck, SIGNAL(toggled(bool)), canvas, SLOT(OnLayerVisibility(bool)));
+    connect(canvas, SIGNAL(layersChanged()), this, SLOT(OnLayersChanged()));
+
+    OnLayersChanged();
+}
+
+/**
+ * @brief LayerPanel::OnLayersChanged: Vuelve a llenar la lista y los controles. La capa de arriba se muestra primero,
+ *                                     por eso la fila es el indice invertido. Las senales se bloquean para que
+ *                                     llenar los controles no se interprete como un cambio del usuario.
+ */
+void LayerPanel::OnLayersChanged()
+{
+    LayerStack* layers = drawArea->getLayers();
+    int count = layers->count();
+
+    layerList->blockSignals(true);
+    layerList->clear();
+    for(int i = count - 1; i >= 0; --i)
+        layerList->addItem(layers->layer(i)->name);
+    layerList->setCurrentRow(count - 1 - layers->activeIndex());
+    layerList->blockSignals(false);
+
+    // los documentos de 8 bits no tienen transparencia, tienen una sola capa
+    addButton->setEnabled(layers->pixelFormat() == rgb_pixels);
+
+    const Layer* active = layers->activeLayer();
+    opacitySlider->blockSignals(true);
+    opacitySlider->setValue(active->opacity);
+    opacitySlider->blockSignals(false);
+
+    blendCombo->blockSignals(true);
+    blendCombo->setCurrentIndex(active->mode);
+    blendCombo->blockSignals(false);
+
+    visibleCheck->blockSignals(true);
+    visibleCheck->setChecked(active->visible);
+    visibleCheck->blockSignals(false);
+}
+
+void LayerPanel::OnRowChanged(int row)
+{
+    if(row < 0)
+        return;
+
+    drawArea->getCanvas()->OnSelectLayer(layerList->count() - 1 - row);
+}
@@ -0,0 +1,48 @@
+#ifndef LAYER_PANEL_H
+#define LAYER_PANEL_H
+
+#include <QWidget>
+
+#include "constants.h"
+
+
+class DrawArea;
+class QListWidget;
+class QSlider;
+class QComboBox;
+class QCheckBox;
+class QPushButton;
+
+/**
+ * LayerPanel: Panel lateral con la lista de capas y las propiedades de la capa activa (opacidad, modo de mezcla y
+ * visibilidad). No guarda estado propio, cada vez que la pila de capas cambia se vuelve a leer desde drawArea.
+ * Muestra las capas del documento activo, setDrawArea() lo cambia al cambiar de pestaña.
+ */
+class LayerPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    LayerPanel(QWidget* parent, DrawArea* drawArea);
+
+    void setDrawArea(DrawArea* drawArea);
+
+public slots:
+    void OnLayersChanged();
+
+private slots:
+    void OnRowChanged(int);
+
+private:
+    DrawArea* drawArea;
+    QListWidget* layerList;
+    QPushButton* addButton;
+    QPushButton* removeButton;
+    QPushButton* upButton;
+    QPushButton* downButton;
+    QSlider* opacitySlider;
+    QComboBox* blendCombo;
+    QCheckBox* visibleCheck;
+};
+
+#endif // LAYER_PANEL_H
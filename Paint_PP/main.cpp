@@ -1,10 +1,16 @@
 #include <qapplication.h>
 #include "main_window.h"
+#include "trace.h"
 
 
 int main(int argc, char* argv[])
 {
     QApplication a(argc, argv);
+    // nombre de la configuracion y de la carpeta de datos (registros de recuperacion)
+    QApplication::setOrganizationName("Paint++");
+    QApplication::setApplicationName("Paint++");
+    // PAINTPP_TRACE=archivo.json registra desde el inicio y guarda la traza al salir
+    Trace::startFromEnvironment();
     QWidget* w = new MainWindow(0, "Paint++");
     w->show();
     int exitCode = a.exec();
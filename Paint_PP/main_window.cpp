@@ -4,13 +4,25 @@ using namespace std;
 #include <QDesktopWidget>
 #include <QMouseEvent>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QColorDialog>
 #include <QSignalMapper>
 #include <QMenuBar>
 #include <QMenu>
+#include <QProgressDialog>
+#include <QDockWidget>
+#include <QMessageBox>
+#include <QTimer>
+#include <QStatusBar>
+#include <QInputDialog>
+#include <QTabWidget>
 #include "main_window.h"
 #include "commands.h"
 #include "draw_area.h"
+#include "layer_panel.h"
+#include "navigator.h"
+#include "trace.h"
+#include "memory_accountant.h"
 
 
 /**
@@ -22,19 +34,49 @@ using namespace std;
 MainWindow::MainWindow(QWidget* parent, const char* name)
     :QMainWindow(parent)
 {
-    // crea el drawarea, la cual recive los eventos del mouse para implementar las herramientas y usus funciones.
-    drawArea = new DrawArea(this);
-    drawArea->setStyleSheet("background-color:transparent");
-    // se asignan las herramientas que tiene drawArea en una variable aparte dentro de la clase que defina la ventana
-    // donde se desarrola el programa.
-    currentTool = drawArea->getCurrentTool();
-    // crea el ToolBar
-    createMenuAndToolBar();
-
     pencilDialog = 0;
     penDialog = 0;
     eraserDialog = 0;
     shapesDialog = 0;
+    layerPanel = 0;
+    navigator = 0;
+    hudVisible = false;
+
+    // cada documento es un drawarea en una pestaña, el drawarea recibe los eventos del mouse para implementar las
+    // herramientas y sus funciones. Todos comparten el grupo de hilos de QtConcurrent y el presupuesto de memoria.
+    drawArea = 0;
+    recoveryLog = 0;
+    untitledCount = 0;
+    tabs = new QTabWidget(this);
+    tabs->setDocumentMode(true);
+    tabs->setTabsClosable(true);
+    tabs->setMovable(true);
+    connect(tabs, SIGNAL(currentChanged(int)), this, SLOT(OnDocumentChanged(int)));
+    connect(tabs, SIGNAL(tabCloseRequested(int)), this, SLOT(OnCloseDocument(int)));
+    addDocument();
+    // crea el ToolBar
+    createMenuAndToolBar();
+
+    // reproduccion de registros de operaciones, cada paso lo dispara el temporizador
+    player = 0;
+    replayArea = 0;
+    recordCanvas = 0;
+    replayFast = false;
+    replayTimer = new QTimer(this);
+    replayTimer->setSingleShot(true);
+    connect(replayTimer, SIGNAL(timeout()), this, SLOT(OnReplayStep()));
+
+    // memoria de los documentos y del historial en la barra de estado
+    memoryLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(memoryLabel);
+    memoryTimer = new QTimer(this);
+    memoryTimer->setInterval(MEMORY_STATUS_REFRESH_MS);
+    connect(memoryTimer, SIGNAL(timeout()), this, SLOT(OnMemoryStatus()));
+    memoryTimer->start();
+
+    // antes de empezar los registros de recuperacion se ofrece recuperar lo que haya dejado una caida
+    QTimer::singleShot(0, this, SLOT(OnRecover()));
+
     etiqueta->setStyleSheet("background-color:"+ drawArea->getForegroundColor().name() );
     etiqueta->setFixedSize(25,25);
     estado->setFixedSize(65,25);
@@ -42,12 +84,29 @@ MainWindow::MainWindow(QWidget* parent, const char* name)
     setWindowTitle(name);
     resize(QDesktopWidget().availableGeometry(this).size()*.6);
     setContextMenuPolicy(Qt::PreventContextMenu);
-    setCentralWidget(drawArea);
+    setCentralWidget(tabs);
+
+    // panel de capas a la derecha del lienzo, muestra el documento activo
+    QDockWidget* layerDock = new QDockWidget(tr("Capas"), this);
+    layerPanel = new LayerPanel(layerDock, drawArea);
+    layerDock->setWidget(layerPanel);
+    addDockWidget(Qt::RightDockWidgetArea, layerDock);
+
+    // navegador con la miniatura del documento activo, encima de las capas
+    QDockWidget* navigatorDock = new QDockWidget(tr("Navegador"), this);
+    navigator = new Navigator(navigatorDock, drawArea);
+    navigatorDock->setWidget(navigator);
+    addDockWidget(Qt::RightDockWidgetArea, navigatorDock);
+    splitDockWidget(navigatorDock, layerDock, Qt::Vertical);
 }
 
 MainWindow::~MainWindow()
 {
+    // salida normal, los registros de recuperacion ya no hacen falta
+    for(WriteAheadLog* log : recoveryLogs)
+        log->close();
     toolActions.clear();
+    delete player;
 }
 
 /**
@@ -76,7 +135,9 @@ void MainWindow::OnNewImage()
     {
         QSize size = QSize(newCanvas->getWidthValue(),
                            newCanvas->getHeightValue());
-        drawArea->createNewImage(size);
+        // cada imagen nueva se abre en su propia pestaña
+        addDocument()->createNewImage(size, newCanvas->getPixelFormat());
+        recoveryLog->open();
     }
     delete newCanvas;
 }
@@ -89,10 +150,18 @@ void MainWindow::OnLoadImage()
 {
     QString s = QFileDialog::getOpenFileName(this, tr("Open File"),
                                                     ".",
-                                                    tr("BMP image (*.bmp)"));
+                                                    tr("Images (*.bmp *.png *.qoi);;BMP image (*.bmp);;"
+                                                       "PNG image (*.png);;QOI image (*.qoi)"));
 	if (! s.isNull())
 	{
-        drawArea->loadImage(s);
+        DrawArea* area = addDocument();
+        if(area->loadImage(s))
+        {
+            recoveryLog->open(s);
+            setDocumentTitle(area, s);
+        }
+        else
+            closeDocument(area);
 	}
 }
 
@@ -109,7 +178,18 @@ void MainWindow::OnSaveImage()
     QFileDialog *fileDialog = new QFileDialog(this);
     fileDialog->setAcceptMode(QFileDialog::AcceptSave);
     fileDialog->setDirectory(".");
-    fileDialog->setNameFilter("BMP image (*.bmp)");
+    // el orden de los filtros de 256 colores es el de DitherMode, despues el BMP comprimido, PNG y QOI
+    const QStringList filters = QStringList() << tr("BMP image (*.bmp)")
+                                              << tr("BMP image, 256 colors (*.bmp)")
+                                              << tr("BMP image, 256 colors, ordered dithering (*.bmp)")
+                                              << tr("BMP image, 256 colors, error diffusion (*.bmp)")
+                                              << tr("BMP image, 256 colors, RLE compressed (*.bmp)")
+                                              << tr("PNG image (*.png)")
+                                              << tr("QOI image (*.qoi)");
+    const int rleFilter = 4;
+    const int pngFilter = 5;
+    const int qoiFilter = 6;
+    fileDialog->setNameFilters(filters);
     fileDialog->setDefaultSuffix("bmp");
     fileDialog->exec();
 
@@ -117,10 +197,27 @@ void MainWindow::OnSaveImage()
     if (fileDialog->result())
     {
         QString s = fileDialog->selectedFiles().first();
-
-        if (! s.isNull())
+        int filter = filters.indexOf(fileDialog->selectedNameFilter());
+        bool saved = false;
+        if (!s.isNull() && (filter == pngFilter || filter == qoiFilter))
         {
-            drawArea->saveImage(s);
+            // el sufijo por defecto es bmp, se cambia por el del formato elegido
+            QFileInfo info(s);
+            s = info.path() + "/" + info.completeBaseName() + (filter == pngFilter ? ".png" : ".qoi");
+            saved = drawArea->saveImage(s);
+        }
+        else if (!s.isNull() && filter == rleFilter)
+            saved = drawArea->exportIndexed(s, no_dither, true);
+        else if (!s.isNull() && filter > 0)
+            saved = drawArea->exportIndexed(s, DitherMode(filter - 1));
+        else if (!s.isNull())
+            saved = drawArea->saveImage(s);
+
+        // el registro de recuperacion se pasa junto al documento guardado
+        if (saved)
+        {
+            recoveryLog->open(s);
+            setDocumentTitle(drawArea, s);
         }
     }
     delete fileDialog;
@@ -133,13 +230,14 @@ void MainWindow::OnSaveImage()
  */
 void MainWindow::OnResizeImage()
 {
-    QPixmap *image = drawArea->getImage();
+    QImage *image = drawArea->getImage();
     if(image->isNull())
         return;
 
     CanvasSizeDialog* newCanvas = new CanvasSizeDialog(this, "Resize Image",
                                                        image->width(),
-                                                       image->height());
+                                                       image->height(),
+                                                       drawArea);
     newCanvas->exec();
     // Si el usuario presiona el boton Ok crea la nueva imagen con el nuevo tamaño.
     if (newCanvas->result())
@@ -191,6 +289,7 @@ void MainWindow::OnPickColor(int which)
  *                                  -Pen:    Es el objeto que abstrae la funcion Lapicero, se asigna este si el parametro newTool es 1.
  *                                  -Eraser: Es el objeto que abstrae la funcion Borrador, se asigna este si el parametro newTool es 2.
  *                                  -Shapes: Es el objeto que abstrae la funcion de dibujar las figuras, se asigna este si el parametro newTool es 3.
+ *                                  -Selection: Es el objeto que abstrae la seleccion rectangular, se asigna este si el parametro newTool es 4.
  */
 void MainWindow::OnChangeTool(int newTool)
 {
@@ -199,6 +298,7 @@ void MainWindow::OnChangeTool(int newTool)
     if(newTool == 0){estado->setText("Lapiz");}
     else if(newTool == 1){estado->setText("Lapicero");}
     else if(newTool == 2){estado->setText("Borrador");}
+    else if(newTool == 4){estado->setText("Seleccion");}
 }
 /**
  * @brief MainWindow::OnSelectRectangle: Este metodo ejecuta el metodo OnChangeTool con el parametro 3 para implementar la Herramienta Shapes que se encarga de
@@ -207,7 +307,7 @@ void MainWindow::OnChangeTool(int newTool)
  */
 void MainWindow::OnSelectRectangle(){
     OnChangeTool(3);
-    drawArea->OnSelectShapeTypeConfig(0);
+    drawArea->getCanvas()->OnSelectShapeTypeConfig(0);
     estado->setText("Rectangulo");
 }
 /**
@@ -217,7 +317,7 @@ void MainWindow::OnSelectRectangle(){
  */
 void MainWindow::OnSelectCircle(){
     OnChangeTool(3);
-    drawArea->OnSelectShapeTypeConfig(1);
+    drawArea->getCanvas()->OnSelectShapeTypeConfig(1);
     estado->setText("Circulo");
 
 }
@@ -228,9 +328,429 @@ void MainWindow::OnSelectCircle(){
  */
 void MainWindow::OnSelectTriangle(){
     OnChangeTool(3);
-    drawArea->OnSelectShapeTypeConfig(2);
+    drawArea->getCanvas()->OnSelectShapeTypeConfig(2);
     estado->setText("Triangulo");
 }
+/**
+ * @brief MainWindow::OnPaste: Activa la herramienta de seleccion y pega el contenido del portapapeles como una seleccion
+ *                             flotante que se puede mover con el mouse antes de confirmarla.
+ */
+void MainWindow::OnPaste(){
+    OnChangeTool(4);
+    drawArea->OnPaste();
+}
+/**
+ * @brief MainWindow::OnFilter: Pide los parametros del filtro (la deteccion de bordes no tiene) y lo inicia en segundo
+ *                              plano mostrando el progreso, el boton "Cancel" detiene el filtro sin modificar el lienzo.
+ */
+void MainWindow::OnFilter(int type)
+{
+    if(drawArea->getImage()->isNull())
+        return;
+
+    FilterParams params;
+    params.type = FilterType(type);
+    params.radius = DEFAULT_FILTER_RADIUS;
+    params.amount = DEFAULT_SHARPEN_AMOUNT;
+
+    if(type != edge_detect)
+    {
+        FilterDialog* filterDialog = new FilterDialog(this, drawArea, FilterType(type));
+        filterDialog->exec();
+        bool accepted = filterDialog->result();
+        params = filterDialog->getParams();
+        delete filterDialog;
+        if(!accepted)
+            return;
+    }
+
+    QProgressDialog* progress = new QProgressDialog(tr("Applying filter..."), tr("Cancel"), 0, 0, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+
+    QFutureWatcher<void>* watcher = drawArea->getFilterWatcher();
+    connect(watcher, SIGNAL(progressRangeChanged(int,int)), progress, SLOT(setRange(int,int)));
+    connect(watcher, SIGNAL(progressValueChanged(int)), progress, SLOT(setValue(int)));
+    connect(watcher, SIGNAL(finished()), progress, SLOT(deleteLater()));
+    connect(progress, SIGNAL(canceled()), watcher, SLOT(cancel()));
+
+    if(!drawArea->applyFilter(params))
+        delete progress;
+}
+/**
+ * @brief MainWindow::OnTransform: Gira o refleja todo el lienzo, con todas las capas.
+ */
+void MainWindow::OnTransform(int transform)
+{
+    if(drawArea->getImage()->isNull())
+        return;
+
+    drawArea->transformImage(ImageTransform(transform));
+}
+/**
+ * @brief MainWindow::OnAdjustColors: Abre el QDialog de ajustes de color y, si el usuario acepta, los aplica al lienzo.
+ */
+void MainWindow::OnAdjustColors()
+{
+    if(drawArea->getImage()->isNull())
+        return;
+
+    AdjustmentsDialog* adjustmentsDialog = new AdjustmentsDialog(this, drawArea);
+    adjustmentsDialog->exec();
+    if(adjustmentsDialog->result())
+        drawArea->applyAdjustments(adjustmentsDialog->getPipeline());
+    delete adjustmentsDialog;
+}
+/**
+ * @brief MainWindow::OnRecord: Inicia o detiene la grabacion de las operaciones del lienzo. Al detenerla se pregunta
+ *                              donde guardar el registro.
+ */
+void MainWindow::OnRecord(bool checked)
+{
+    if(checked)
+    {
+        recordCanvas = drawArea->getCanvas();
+        recordCanvas->startRecording();
+        estado->setText("Grabando");
+        return;
+    }
+
+    // se detiene la grabacion del documento donde empezo, aunque ahora se vea otra pestaña
+    Canvas* canvas = recordCanvas;
+    recordCanvas = 0;
+    estado->setText("");
+    if(!canvas)
+        return;
+
+    canvas->stopRecording();
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save operation log"), QDir::currentPath(),
+                                                    tr("Paint++ log (*.ppol)"));
+    if(!fileName.isEmpty() && !canvas->getOpLog()->save(fileName))
+        QMessageBox::warning(this, tr("Save operation log"), tr("Could not write %1").arg(fileName));
+}
+
+/**
+ * @brief MainWindow::OnTrace: Inicia o detiene el registro de trazas de rendimiento. Al detenerlo se guarda en formato
+ *                             JSON de Chrome, se abre con chrome://tracing o ui.perfetto.dev.
+ */
+void MainWindow::OnTrace(bool checked)
+{
+    if(checked)
+    {
+        Trace::start();
+        return;
+    }
+
+    Trace::stop();
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save trace"), QDir::currentPath(),
+                                                    tr("Chrome trace (*.json)"));
+    if(!fileName.isEmpty() && !Trace::dump(fileName))
+        QMessageBox::warning(this, tr("Save trace"), tr("Could not write %1").arg(fileName));
+}
+
+/**
+ * @brief MainWindow::OnMemoryBudget: Cambia el presupuesto de memoria de todos los documentos. Si el historial ya lo
+ *                                    supera se reduce en ese momento.
+ */
+void MainWindow::OnMemoryBudget()
+{
+    MemoryAccountant* accountant = MemoryAccountant::instance();
+    bool ok = false;
+    int megabytes = QInputDialog::getInt(this, tr("Memory budget"), tr("Budget (MB):"),
+                                         int(accountant->budget() / (1024 * 1024)),
+                                         MIN_MEMORY_BUDGET_MB, MAX_MEMORY_BUDGET_MB, 64, &ok);
+    if(!ok)
+        return;
+
+    accountant->setBudget(qint64(megabytes) * 1024 * 1024);
+    drawArea->getCanvas()->updateMemory();
+    OnMemoryStatus();
+}
+
+/**
+ * @brief MainWindow::OnMemoryStatus: Actualiza la lectura de memoria de la barra de estado.
+ */
+void MainWindow::OnMemoryStatus()
+{
+    drawArea->getCanvas()->updateMemory();
+
+    MemoryAccountant* accountant = MemoryAccountant::instance();
+    MemoryReport report = accountant->report();
+    const double mb = 1024.0 * 1024.0;
+    memoryLabel->setText(tr("Memory %1 / %2 MB  (canvas %3, history %4, previews %5, caches %6)")
+                         .arg(report.total() / mb, 0, 'f', 1).arg(accountant->budget() / mb, 0, 'f', 0)
+                         .arg(report.canvas / mb, 0, 'f', 1).arg(report.history / mb, 0, 'f', 1)
+                         .arg(report.previews / mb, 0, 'f', 1).arg(report.caches / mb, 0, 'f', 1));
+}
+
+/**
+ * @brief MainWindow::OnRecover: Al iniciar, si una sesion anterior no se cerro bien, ofrece recuperar su documento
+ *                               desde el ultimo punto de control y las operaciones que le siguen. Despues empieza el
+ *                               registro de recuperacion del documento actual.
+ */
+void MainWindow::OnRecover()
+{
+    for(const QString &log : WriteAheadLog::pending())
+    {
+        QString name = WriteAheadLog::documentFor(log);
+        QMessageBox::StandardButton answer = QMessageBox::question(
+                    this, tr("Recover"), tr("Paint++ did not close normally. Recover the changes to %1?")
+                    .arg(name.isEmpty() ? tr("an untitled image") : QFileInfo(name).fileName()),
+                    QMessageBox::Yes | QMessageBox::No);
+
+        // cada documento recuperado se abre en su propia pestaña
+        if(answer == QMessageBox::Yes)
+        {
+            DrawArea* area = addDocument();
+            if(WriteAheadLog::recover(area->getCanvas(), log))
+            {
+                // el registro nuevo empieza con lo recuperado antes de borrar el anterior
+                recoveryLog->open(name);
+                if(!name.isEmpty())
+                    setDocumentTitle(area, name);
+                if(recoveryLog->fileName() != log)
+                    WriteAheadLog::discard(log);
+                continue;
+            }
+            QMessageBox::warning(this, tr("Recover"), tr("Could not recover %1").arg(log));
+            closeDocument(area);
+        }
+        WriteAheadLog::discard(log);
+    }
+
+    for(WriteAheadLog* log : recoveryLogs)
+        if(!log->isOpen())
+            log->open();
+}
+
+/**
+ * @brief MainWindow::addDocument: Abre un documento vacio en una pestaña nueva y la activa. Cada documento tiene su
+ *                                 propio registro de recuperacion, que se empieza cuando se sabe su nombre.
+ */
+DrawArea* MainWindow::addDocument()
+{
+    DrawArea* area = new DrawArea(tabs);
+    area->setStyleSheet("background-color:transparent");
+    recoveryLogs.insert(area, new WriteAheadLog(area->getCanvas(), area));
+    connect(area->getCanvas(), SIGNAL(overBudget()), this, SLOT(OnOverBudget()));
+
+    tabs->addTab(area, tr("Untitled %1").arg(++untitledCount));
+    tabs->setCurrentWidget(area);
+    return area;
+}
+
+/**
+ * @brief MainWindow::closeDocument: Cierra la pestaña sin preguntar. La reproduccion o grabacion de ese lienzo
+ *                                   terminan con el y su registro de recuperacion se borra. Siempre queda al menos
+ *                                   un documento abierto.
+ */
+void MainWindow::closeDocument(DrawArea* area)
+{
+    if(area == replayArea)
+    {
+        replayTimer->stop();
+        delete player;
+        player = 0;
+        replayArea = 0;
+    }
+    if(recordCanvas == area->getCanvas())
+    {
+        recordCanvas->stopRecording();
+        recordCanvas = 0;
+    }
+
+    recoveryLogs.take(area)->close();
+    recentDocuments.removeAll(area);
+    if(area == drawArea)
+        drawArea = 0;
+    tabs->removeTab(tabs->indexOf(area));
+    area->deleteLater();
+
+    if(tabs->count() == 0)
+    {
+        addDocument();
+        recoveryLog->open();
+    }
+}
+
+void MainWindow::setDocumentTitle(DrawArea* area, const QString &fileName)
+{
+    int index = tabs->indexOf(area);
+    tabs->setTabText(index, QFileInfo(fileName).fileName());
+    tabs->setTabToolTip(index, fileName);
+}
+
+/**
+ * @brief MainWindow::OnCloseDocument: Boton de cerrar de la pestaña, pregunta antes si el documento tiene cambios.
+ */
+void MainWindow::OnCloseDocument(int index)
+{
+    DrawArea* area = qobject_cast<DrawArea*>(tabs->widget(index));
+    if(!area)
+        return;
+
+    if(area->getCanvas()->getUndoStack()->canUndo()
+       && QMessageBox::question(this, tr("Close"), tr("Close %1? Changes that were not saved are lost.")
+                                .arg(tabs->tabText(index)), QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes)
+        return;
+
+    closeDocument(area);
+}
+
+/**
+ * @brief MainWindow::OnDocumentChanged: Cambia el documento activo. El que pasa a segundo plano libera el cache de
+ *                                       la composicion (se recompone al volver), el panel de capas, el navegador y
+ *                                       el HUD pasan al nuevo y los dialogos de las herramientas se vuelven a crear
+ *                                       con su lienzo.
+ */
+void MainWindow::OnDocumentChanged(int index)
+{
+    DrawArea* area = qobject_cast<DrawArea*>(tabs->widget(index));
+    if(!area || area == drawArea)
+        return;
+
+    if(drawArea)
+    {
+        drawArea->OnShowHud(false);
+        drawArea->getCanvas()->releaseCaches();
+    }
+
+    drawArea = area;
+    recoveryLog = recoveryLogs.value(area);
+    recentDocuments.removeAll(area);
+    recentDocuments.append(area);
+
+    drawArea->OnShowHud(hudVisible);
+    currentTool = drawArea->getCurrentTool();
+    etiqueta->setStyleSheet("background-color:"+ drawArea->getForegroundColor().name() );
+    if(layerPanel)
+        layerPanel->setDrawArea(drawArea);
+    if(navigator)
+        navigator->setDrawArea(drawArea);
+
+    delete pencilDialog;
+    delete penDialog;
+    delete eraserDialog;
+    delete shapesDialog;
+    pencilDialog = 0;
+    penDialog = 0;
+    eraserDialog = 0;
+    shapesDialog = 0;
+}
+
+/**
+ * @brief MainWindow::OnOverBudget: Un documento paso del presupuesto de memoria. Antes de que reduzca su propio
+ *                                  historial se liberan los documentos en segundo plano, del que hace mas tiempo no se
+ *                                  usa al mas reciente: primero el cache de la composicion, despues se compacta y por
+ *                                  ultimo se descarta su historial.
+ */
+void MainWindow::OnOverBudget()
+{
+    MemoryAccountant* accountant = MemoryAccountant::instance();
+    for(DrawArea* area : recentDocuments)
+    {
+        if(area == drawArea || area->getCanvas() == sender())
+            continue;
+
+        while(accountant->overBudget() && area->getCanvas()->trimMemory())
+            ;
+        if(!accountant->overBudget())
+            return;
+    }
+}
+
+void MainWindow::OnUndo()
+{
+    drawArea->OnUndo();
+}
+
+void MainWindow::OnRedo()
+{
+    drawArea->OnRedo();
+}
+
+void MainWindow::OnClearAll()
+{
+    drawArea->OnClearAll();
+}
+
+void MainWindow::OnCopy()
+{
+    drawArea->OnCopy();
+}
+
+void MainWindow::OnCut()
+{
+    drawArea->OnCut();
+}
+
+/**
+ * @brief MainWindow::OnShowHud: El HUD se muestra sobre el documento activo y sigue al cambiar de pestaña.
+ */
+void MainWindow::OnShowHud(bool show)
+{
+    hudVisible = show;
+    drawArea->OnShowHud(show);
+}
+
+/**
+ * @brief MainWindow::OnReplay: Abre un registro de operaciones y lo reproduce sobre el lienzo, a la velocidad original
+ *                              o tan rapido como se pueda. La ventana sigue respondiendo mientras se reproduce.
+ */
+void MainWindow::OnReplay()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Replay operation log"), QDir::currentPath(),
+                                                    tr("Paint++ log (*.ppol)"));
+    if(fileName.isEmpty())
+        return;
+
+    QByteArray data;
+    if(!OpLog::load(fileName, &data))
+        return;
+
+    replayTimer->stop();
+    delete player;
+    replayArea = drawArea;
+    player = new OpPlayer(drawArea->getCanvas(), data);
+    if(!player->isValid())
+    {
+        QMessageBox::warning(this, tr("Replay operation log"), tr("%1 is not an operation log").arg(fileName));
+        delete player;
+        player = 0;
+        replayArea = 0;
+        return;
+    }
+
+    replayFast = QMessageBox::question(this, tr("Replay operation log"), tr("Replay at original speed?"),
+                                       QMessageBox::Yes | QMessageBox::No) == QMessageBox::No;
+    replayTimer->start(0);
+}
+
+/**
+ * @brief MainWindow::OnReplayStep: Ejecuta la siguiente operacion (o un grupo de operaciones en modo rapido) y
+ *                                  programa el siguiente paso con la espera que hubo al grabar.
+ */
+void MainWindow::OnReplayStep()
+{
+    if(!player)
+        return;
+
+    int batch = replayFast ? REPLAY_FAST_BATCH : 1;
+    for(int i = 0; i < batch && player->step(); ++i)
+        ;
+
+    if(player->atEnd())
+    {
+        estado->setText(tr("%1 ops").arg(player->played()));
+        delete player;
+        player = 0;
+        replayArea = 0;
+        return;
+    }
+
+    replayTimer->start(replayFast ? 0 : int(player->nextDelay()));
+}
+
 /**
  * @brief MainWindow::OnPenDialog: Abre el QDialog que se encarga de la configuracion del objeto Pencil, encargado de la funcion Lapiz.
  */
@@ -299,6 +819,7 @@ void MainWindow::openToolDialog()
         case pen: OpenPenDialog();           break;
         case eraser: OpenEraserDialog();       break;
         case shapes_tool: OpenShapesDialog(); break;
+        case selection:                       break;
     }
 }
 /**
@@ -352,11 +873,11 @@ void MainWindow::createMenuActions()
 
     QAction* saveAction = barra_herramientas->addAction(save_image_Icon, tr("Save image..."),this, SLOT(OnSaveImage()), tr("Ctrl+S"));
 
-    QAction* undoAction = barra_herramientas->addAction(undo_command_Icon, tr("Undo"),drawArea, SLOT(OnUndo()), tr("Ctrl+Z"));
+    QAction* undoAction = barra_herramientas->addAction(undo_command_Icon, tr("Undo"),this, SLOT(OnUndo()), tr("Ctrl+Z"));
 
-    QAction* redoAction = barra_herramientas->addAction(redo_command_Icon, tr("Redo"),drawArea, SLOT(OnRedo()), tr("Ctrl+Y"));
+    QAction* redoAction = barra_herramientas->addAction(redo_command_Icon, tr("Redo"),this, SLOT(OnRedo()), tr("Ctrl+Y"));
 
-    QAction* clear_canvas_Action = barra_herramientas->addAction(clear_canvas_Icon, tr("Clear Canvas"),drawArea, SLOT(OnClearAll()), tr("Ctrl+C"));
+    QAction* clear_canvas_Action = barra_herramientas->addAction(clear_canvas_Icon, tr("Clear Canvas"),this, SLOT(OnClearAll()), tr("Ctrl+C"));
 
     QAction* resizeAction = barra_herramientas->addAction( custom_size_canvas_Icon, tr("Custom Canvas"),this, SLOT(OnResizeImage()), tr("Ctrl+R"));
 
@@ -370,6 +891,33 @@ void MainWindow::createMenuActions()
 
     QAction* propertiesAction = barra_herramientas->addAction(propertiesIcon, tr("Draw Config"),this, SLOT(openToolDialog()));
 
+    QAction* copyAction = barra_herramientas->addAction(tr("Copy"),this, SLOT(OnCopy()), tr("Ctrl+Shift+C"));
+
+    QAction* cutAction = barra_herramientas->addAction(tr("Cut"),this, SLOT(OnCut()), tr("Ctrl+X"));
+
+    QAction* pasteAction = barra_herramientas->addAction(tr("Paste"),this, SLOT(OnPaste()), tr("Ctrl+V"));
+
+    QAction* adjustAction = barra_herramientas->addAction(tr("Adjust"),this, SLOT(OnAdjustColors()), tr("Ctrl+U"));
+
+    QAction* recordAction = barra_herramientas->addAction(tr("Record"));
+    recordAction->setCheckable(true);
+    recordAction->setShortcut(tr("Ctrl+Shift+R"));
+    connect(recordAction, SIGNAL(toggled(bool)), this, SLOT(OnRecord(bool)));
+
+    QAction* replayAction = barra_herramientas->addAction(tr("Replay"),this, SLOT(OnReplay()), tr("Ctrl+Shift+P"));
+
+    QAction* traceAction = barra_herramientas->addAction(tr("Trace"));
+    traceAction->setCheckable(true);
+    traceAction->setShortcut(tr("Ctrl+Shift+T"));
+    connect(traceAction, SIGNAL(toggled(bool)), this, SLOT(OnTrace(bool)));
+
+    QAction* budgetAction = barra_herramientas->addAction(tr("Memory Budget..."),this, SLOT(OnMemoryBudget()));
+
+    QAction* hudAction = barra_herramientas->addAction(tr("HUD"));
+    hudAction->setCheckable(true);
+    hudAction->setShortcut(tr("Ctrl+Shift+H"));
+    connect(hudAction, SIGNAL(toggled(bool)), this, SLOT(OnShowHud(bool)));
+
     QSignalMapper *signalMapper = new QSignalMapper(this);
 
     QAction* fColorAction = new QAction(fColorIcon, tr("Foreground Color..."), this);
@@ -409,15 +957,71 @@ void MainWindow::createMenuActions()
             signalMapperT, SLOT(map()));
     eraserAction->setShortcut(tr("E"));
 
+    QAction* selectAction = new QAction(tr("Select"), this);
+    connect(selectAction, SIGNAL(triggered()),
+            signalMapperT, SLOT(map()));
+    selectAction->setShortcut(tr("S"));
+
 
 
 
     signalMapperT->setMapping(penAction, pencil);
     signalMapperT->setMapping(lineAction, pen);
     signalMapperT->setMapping(eraserAction, eraser);
+    signalMapperT->setMapping(selectAction, selection);
 
     connect(signalMapperT, SIGNAL(mapped(int)), this, SLOT(OnChangeTool(int)));
 
+    QSignalMapper *signalMapperF = new QSignalMapper(this);
+
+    QAction* blurAction = new QAction(tr("Blur"), this);
+    connect(blurAction, SIGNAL(triggered()),
+            signalMapperF, SLOT(map()));
+
+    QAction* sharpenAction = new QAction(tr("Sharpen"), this);
+    connect(sharpenAction, SIGNAL(triggered()),
+            signalMapperF, SLOT(map()));
+
+    QAction* edgesAction = new QAction(tr("Edges"), this);
+    connect(edgesAction, SIGNAL(triggered()),
+            signalMapperF, SLOT(map()));
+
+    signalMapperF->setMapping(blurAction, gaussian_blur);
+    signalMapperF->setMapping(sharpenAction, unsharp_mask);
+    signalMapperF->setMapping(edgesAction, edge_detect);
+
+    connect(signalMapperF, SIGNAL(mapped(int)), this, SLOT(OnFilter(int)));
+
+    QSignalMapper *signalMapperR = new QSignalMapper(this);
+
+    QAction* rotateRightAction = new QAction(tr("Rotate Right"), this);
+    connect(rotateRightAction, SIGNAL(triggered()),
+            signalMapperR, SLOT(map()));
+
+    QAction* rotate180Action = new QAction(tr("Rotate 180"), this);
+    connect(rotate180Action, SIGNAL(triggered()),
+            signalMapperR, SLOT(map()));
+
+    QAction* rotateLeftAction = new QAction(tr("Rotate Left"), this);
+    connect(rotateLeftAction, SIGNAL(triggered()),
+            signalMapperR, SLOT(map()));
+
+    QAction* flipHorizontalAction = new QAction(tr("Flip Horizontal"), this);
+    connect(flipHorizontalAction, SIGNAL(triggered()),
+            signalMapperR, SLOT(map()));
+
+    QAction* flipVerticalAction = new QAction(tr("Flip Vertical"), this);
+    connect(flipVerticalAction, SIGNAL(triggered()),
+            signalMapperR, SLOT(map()));
+
+    signalMapperR->setMapping(rotateRightAction, rotate_90);
+    signalMapperR->setMapping(rotate180Action, rotate_180);
+    signalMapperR->setMapping(rotateLeftAction, rotate_270);
+    signalMapperR->setMapping(flipHorizontalAction, flip_horizontal);
+    signalMapperR->setMapping(flipVerticalAction, flip_vertical);
+
+    connect(signalMapperR, SIGNAL(mapped(int)), this, SLOT(OnTransform(int)));
+
     toolActions.append(newAction);
     toolActions.append(openAction);
     toolActions.append(saveAction);
@@ -435,5 +1039,23 @@ void MainWindow::createMenuActions()
     toolActions.append(circleAction);
     toolActions.append(triangleAction);
     toolActions.append(propertiesAction);
+    toolActions.append(selectAction);
+    toolActions.append(copyAction);
+    toolActions.append(cutAction);
+    toolActions.append(pasteAction);
+    toolActions.append(blurAction);
+    toolActions.append(sharpenAction);
+    toolActions.append(edgesAction);
+    toolActions.append(rotateRightAction);
+    toolActions.append(rotate180Action);
+    toolActions.append(rotateLeftAction);
+    toolActions.append(flipHorizontalAction);
+    toolActions.append(flipVerticalAction);
+    toolActions.append(adjustAction);
+    toolActions.append(recordAction);
+    toolActions.append(replayAction);
+    toolActions.append(traceAction);
+    toolActions.append(hudAction);
+    toolActions.append(budgetAction);
 }
 
@@ -6,13 +6,20 @@
 #include <QAction>
 #include <QWidget>
 #include <QLabel>
+#include <QHash>
 #include "dialog_windows.h"
 #include "draw_area.h"
 #include "toolbar.h"
+#include "op_log.h"
+#include "write_ahead_log.h"
 
 
 class Tool;
 class QLabel;
+class QTimer;
+class QTabWidget;
+class LayerPanel;
+class Navigator;
 class MainWindow: public QMainWindow
 {
 	Q_OBJECT
@@ -37,6 +44,26 @@ public slots:
     void OnSelectRectangle();
     void OnSelectCircle();
     void OnSelectTriangle();
+    void OnPaste();
+    void OnFilter(int);
+    void OnTransform(int);
+    void OnAdjustColors();
+    void OnRecord(bool);
+    void OnReplay();
+    void OnReplayStep();
+    void OnTrace(bool);
+    void OnMemoryBudget();
+    void OnMemoryStatus();
+    void OnRecover();
+    void OnDocumentChanged(int);
+    void OnCloseDocument(int);
+    void OnOverBudget();
+    void OnUndo();
+    void OnRedo();
+    void OnClearAll();
+    void OnCopy();
+    void OnCut();
+    void OnShowHud(bool);
     /** tool dialogs */
     void OpenPencilDialog();
     void OpenPenDialog();
@@ -49,9 +76,22 @@ private:
     void createMenuActions();
     void createToolBarToggle();
     void createMenuAndToolBar();
+    DrawArea* addDocument();
+    void closeDocument(DrawArea*);
+    void setDocumentTitle(DrawArea*, const QString&);
 
 
+    // documentos abiertos, uno por pestaña; drawArea y recoveryLog son siempre los de la pestaña activa
+    QTabWidget* tabs;
     DrawArea* drawArea;
+    WriteAheadLog* recoveryLog;
+    QHash<DrawArea*, WriteAheadLog*> recoveryLogs;
+    QList<DrawArea*> recentDocuments;
+    int untitledCount;
+
+    LayerPanel* layerPanel;
+    Navigator* navigator;
+    bool hudVisible;
 
     QList<QAction*> toolActions;
 
@@ -59,6 +99,15 @@ private:
 
     Tool* currentTool;
 
+    OpPlayer* player;
+    DrawArea* replayArea;
+    QTimer* replayTimer;
+    bool replayFast;
+    Canvas* recordCanvas;
+
+    QLabel* memoryLabel;
+    QTimer* memoryTimer;
+
     PencilDialog* pencilDialog;
     PenDialog* penDialog;
     EraserDialog* eraserDialog;
@@ -0,0 +1,139 @@
+#include <QPainter>
+#include <QTimer>
+#include <QEvent>
+
+#include "navigator.h"
+#include "draw_area.h"
+#include "memory_accountant.h"
+
+
+Navigator::Navigator(QWidget* parent, DrawArea* drawArea)
+    : QWidget(parent)
+{
+    this->drawArea = 0;
+
+    refreshTimer = new QTimer(this);
+    refreshTimer->setSingleShot(true);
+    refreshTimer->setInterval(NAVIGATOR_REFRESH_MS);
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(OnRefresh()));
+
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setDrawArea(drawArea);
+}
+
+Navigator::~Navigator()
+{
+    MemoryAccountant::instance()->remove(this);
+}
+
+/**
+ * @brief Navigator::setDrawArea: Muestra otro documento. La piramide se rearma completa una sola vez.
+ */
+void Navigator::setDrawArea(DrawArea* drawArea)
+{
+    if(this->drawArea)
+    {
+        this->drawArea->getCanvas()->disconnect(this);
+        this->drawArea->removeEventFilter(this);
+    }
+
+    this->drawArea = drawArea;
+    connect(drawArea->getCanvas(), SIGNAL(changed(QRect)), this, SLOT(OnCanvasChanged(QRect)));
+    // el rectangulo de la vista cambia con el tamaño de la ventana
+    drawArea->installEventFilter(this);
+
+    pyramid.invalidateAll();
+    OnRefresh();
+}
+
+QSize Navigator::sizeHint() const
+{
+    return QSize(200, 150);
+}
+
+/**
+ * @brief Navigator::OnCanvasChanged: Solo marca los mosaicos, la reduccion espera al temporizador para que un trazo
+ *                                    rapido no la repita en cada movimiento del mouse.
+ */
+void Navigator::OnCanvasChanged(const QRect &rect)
+{
+    if(rect.isNull())
+        pyramid.invalidateAll();
+    else
+        pyramid.invalidate(rect);
+
+    if(!refreshTimer->isActive())
+        refreshTimer->start();
+}
+
+/**
+ * @brief Navigator::OnRefresh: Reduce los mosaicos marcados y repinta. Oculto (el panel cerrado) no hace nada, los
+ *                              mosaicos quedan marcados hasta que se vuelve a mostrar.
+ */
+void Navigator::OnRefresh()
+{
+    if(!isVisible())
+        return;
+
+    if(pyramid.update(*drawArea->getLayers()))
+    {
+        QSet<qint64> seen;
+        MemoryReport report;
+        report.caches = pyramid.byteCount(&seen);
+        MemoryAccountant::instance()->update(this, report);
+    }
+    update();
+}
+
+void Navigator::showEvent(QShowEvent*)
+{
+    OnRefresh();
+}
+
+bool Navigator::eventFilter(QObject* watched, QEvent* event)
+{
+    if(watched == drawArea && event->type() == QEvent::Resize)
+        update();
+    return QWidget::eventFilter(watched, event);
+}
+
+/**
+ * @brief Navigator::thumbnailRect: Donde va la miniatura dentro del panel, centrada y con la proporcion del lienzo.
+ */
+QRect Navigator::thumbnailRect() const
+{
+    QSize canvas = drawArea->getLayers()->size();
+    if(canvas.isEmpty())
+        return QRect();
+
+    QSize fitted = canvas.scaled(size() - QSize(8, 8), Qt::KeepAspectRatio);
+    return QRect(QPoint((width() - fitted.width()) / 2, (height() - fitted.height()) / 2), fitted);
+}
+
+/**
+ * @brief Navigator::paintEvent: La miniatura sobre blanco, como el lienzo, y encima el rectangulo de la parte del
+ *                               lienzo que se ve en el DrawArea.
+ */
+void Navigator::paintEvent(QPaintEvent*)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+
+    QRect target = thumbnailRect();
+    if(target.isEmpty())
+        return;
+
+    painter.fillRect(target, Qt::white);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(target, pyramid.levelFor(target.size()));
+
+    QSize canvas = drawArea->getLayers()->size();
+    QRect visible = drawArea->rect().intersected(QRect(QPoint(0, 0), canvas));
+    qreal scale = qreal(target.width()) / canvas.width();
+    QRectF viewport(target.left() + visible.left() * scale, target.top() + visible.top() * scale,
+                    visible.width() * scale, visible.height() * scale);
+
+    painter.setPen(QPen(Qt::red, 1));
+    painter.setBrush(Qt::NoBrush);
+    painter.drawRect(viewport.adjusted(0.5, 0.5, -0.5, -0.5));
+}
@@ -0,0 +1,45 @@
+#ifndef NAVIGATOR_H
+#define NAVIGATOR_H
+
+#include <QWidget>
+
+#include "mip_pyramid.h"
+
+
+class DrawArea;
+class QTimer;
+
+/**
+ * Navigator: Miniatura de todo el lienzo del documento activo con el rectangulo de la parte que se ve en la ventana.
+ * La miniatura sale de una MipPyramid: los cambios del lienzo solo marcan mosaicos y, a lo sumo cada
+ * NAVIGATOR_REFRESH_MS, se reducen los marcados y se escala el nivel mas chico que alcanza para el panel.
+ */
+class Navigator : public QWidget
+{
+    Q_OBJECT
+
+public:
+    Navigator(QWidget* parent, DrawArea* drawArea);
+    ~Navigator();
+
+    void setDrawArea(DrawArea* drawArea);
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent*) override;
+    void showEvent(QShowEvent*) override;
+    bool eventFilter(QObject*, QEvent*) override;
+
+private slots:
+    void OnCanvasChanged(const QRect&);
+    void OnRefresh();
+
+private:
+    QRect thumbnailRect() const;
+
+    DrawArea* drawArea;
+    MipPyramid pyramid;
+    QTimer* refreshTimer;
+};
+
+#endif // NAVIGATOR_H
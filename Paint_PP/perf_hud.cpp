@@ -0,0 +1,105 @@
+#include <QPainter>
+#include <QTimer>
+#include <QFontDatabase>
+
+#include "perf_hud.h"
+#include "perf_stats.h"
+#include "canvas.h"
+
+
+static QString ms(qint64 nsecs)
+{
+    return QString::number(nsecs / 1000000.0, 'f', 2);
+}
+
+static QString mb(qint64 bytes)
+{
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+}
+
+/**
+ * @brief PerfHud::PerfHud: El panel es opaco, asi actualizarlo no obliga a repintar el lienzo que tiene debajo, y
+ *                          deja pasar los eventos del mouse al lienzo.
+ */
+PerfHud::PerfHud(QWidget* parent, Canvas* canvas)
+    : QWidget(parent)
+{
+    this->canvas = canvas;
+
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(PERF_HUD_REFRESH_MS);
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(OnRefresh()));
+
+    hide();
+}
+
+/**
+ * @brief PerfHud::setActive: Muestra u oculta el panel. Las mediciones de PerfStats solo estan activas mientras el
+ *                            panel esta visible.
+ */
+void PerfHud::setActive(bool active)
+{
+    PerfStats::setEnabled(active);
+    if(active)
+    {
+        OnRefresh();
+        refreshTimer->start();
+        show();
+        raise();
+    }
+    else
+    {
+        refreshTimer->stop();
+        hide();
+    }
+}
+
+/**
+ * @brief PerfHud::OnRefresh: Lee los contadores de la ultima ventana de medicion y empieza una nueva.
+ */
+void PerfHud::OnRefresh()
+{
+    PerfStats::Sample paint = PerfStats::sample(perf_paint);
+    PerfStats::Sample compose = PerfStats::sample(perf_compose);
+    PerfStats::Sample tool = PerfStats::sample(perf_tool);
+    MemoryReport memory = canvas->memoryReport();
+
+    lines.clear();
+    lines << tr("frame   %1 ms  avg %2  max %3  (%4/s)").arg(ms(paint.last))
+             .arg(ms(paint.count ? paint.total / paint.count : 0)).arg(ms(paint.worst))
+             .arg(paint.count * 1000 / PERF_HUD_REFRESH_MS)
+          << tr("area    %1 Kpx").arg(PerfStats::paintArea() / 1000)
+          << tr("compose %1 ms  max %2").arg(ms(compose.last)).arg(ms(compose.worst))
+          << tr("tool    %1 ms  max %2  stroke %3 ms").arg(ms(tool.last)).arg(ms(tool.worst))
+             .arg(ms(PerfStats::strokeTime()))
+          << tr("canvas  %1  cache %2").arg(mb(memory.canvas)).arg(mb(memory.caches))
+          << tr("undo    %1  (%2 cmds)").arg(mb(memory.history)).arg(canvas->getUndoStack()->count())
+          << tr("preview %1").arg(mb(memory.previews));
+    PerfStats::reset();
+
+    QFontMetrics metrics(font());
+    int width = 0;
+    for(const QString &line : lines)
+        width = qMax(width, metrics.horizontalAdvance(line));
+    setGeometry(8, 8, width + 16, lines.size() * metrics.height() + 12);
+    update();
+}
+
+void PerfHud::paintEvent(QPaintEvent*)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(32, 32, 32));
+    painter.setPen(QColor(120, 255, 120));
+
+    QFontMetrics metrics(font());
+    int y = 6 + metrics.ascent();
+    for(const QString &line : lines)
+    {
+        painter.drawText(8, y, line);
+        y += metrics.height();
+    }
+}
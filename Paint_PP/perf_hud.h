@@ -0,0 +1,37 @@
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include <QWidget>
+#include <QStringList>
+
+
+class Canvas;
+class QTimer;
+
+/**
+ * PerfHud: Panel sobre la esquina del lienzo con los tiempos de PerfStats (cuadro, composicion, herramienta y trazo),
+ * el area repintada y la memoria del lienzo y de la pila de "undo". Se actualiza con un temporizador, no en cada
+ * cuadro, para no agregar repintados a lo que mide.
+ */
+class PerfHud : public QWidget
+{
+    Q_OBJECT
+
+public:
+    PerfHud(QWidget* parent, Canvas* canvas);
+
+    void setActive(bool);
+
+private slots:
+    void OnRefresh();
+
+protected:
+    void paintEvent(QPaintEvent*) override;
+
+private:
+    Canvas* canvas;
+    QTimer* refreshTimer;
+    QStringList lines;
+};
+
+#endif // PERF_HUD_H